@@ -274,10 +274,12 @@ if [ "$RUN_CLANG_TIDY" = true ] && [ "$BUILD_SUCCESS" = true ]; then
             "src/xcpappl.c"
             "src/xcplite.c"
             "src/xcpethserver.c"
+            "src/xcpdaqlogger.c"
             "src/xcpethtl.c"
             "src/queue32.c"
             "src/queue64v.c"
             "src/queue64f.c"
+            "src/queue_stats.c"
             "src/shm.c" 
             "src/cal.c" 
             "src/a2l.c"
@@ -110,7 +110,7 @@ static inline const char *XcpGetContextName(void) { return gXcpContext.name; }
     tXcpEventId previous_span_id = ctx->span_id;                                                                                                                                   \
     ctx->span_id = span_id;                                                                                                                                                        \
     ctx->level++;                                                                                                                                                                  \
-    XcpEventExtAt_Var(ctx->id, span_t1, 2, xcp_get_frame_addr(), (const uint8_t *)ctx);
+    XcpEventExtAt2(ctx->id, span_t1, xcp_get_frame_addr(), (const uint8_t *)ctx);
 
 // End span
 // Trigger the span event and the context event on exit
@@ -118,10 +118,10 @@ static inline const char *XcpGetContextName(void) { return gXcpContext.name; }
 #define EndSpan()                                                                                                                                                                  \
     uint64_t span_t2 = ApplXcpGetClock64();                                                                                                                                        \
     span_dt = span_t2 - span_t1;                                                                                                                                                   \
-    XcpEventExtAt_Var(ctx->span_id, span_t2, 2, xcp_get_frame_addr(), (const uint8_t *)ctx);                                                                                       \
+    XcpEventExtAt2(ctx->span_id, span_t2, xcp_get_frame_addr(), (const uint8_t *)ctx);                                                                                             \
     ctx->span_id = previous_span_id;                                                                                                                                               \
     ctx->level--;                                                                                                                                                                  \
-    XcpEventExtAt_Var(ctx->id, span_t2, 2, xcp_get_frame_addr(), (const uint8_t *)ctx);
+    XcpEventExtAt2(ctx->id, span_t2, xcp_get_frame_addr(), (const uint8_t *)ctx);
 
 // Create a named context
 // Create the context event (name is 'context_name'_'context_index')
@@ -39,6 +39,12 @@ extern "C" {
 /// @return true on success, otherwise false.
 bool XcpEthServerInit(const uint8_t *address, uint16_t port, bool use_tcp, uint32_t measurement_queue_size);
 
+/// Initialize the XCP on Ethernet server singleton, optionally with a transmit queue backed by huge pages.
+/// XcpEthServerInit uses huge pages, if OPTION_QUEUE_HUGE_PAGES is defined.
+/// @param huge_pages Allocate the measurement queue with 2 MiB huge pages, pre-faulted and locked in RAM, falls back to normal pages. In SHM mode, the shared queue is pre-faulted and locked.
+/// @return true on success, otherwise false.
+bool XcpEthServerInitEx(const uint8_t *address, uint16_t port, bool use_tcp, uint32_t measurement_queue_size, bool huge_pages);
+
 /// Shutdown the XCP on Ethernet server.
 bool XcpEthServerShutdown(void);
 
@@ -46,6 +52,31 @@ bool XcpEthServerShutdown(void);
 /// @return true if the server is running, otherwise false.
 bool XcpEthServerStatus(void);
 
+// ---------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// DAQ logger
+
+/// Save the DAQ setup of the currently connected XCP client to a file.
+/// The file can be used by the DAQ logger to start the same measurement without client, it is only valid for the same EPK.
+/// @param filename DAQ setup file name.
+/// @return true on success, otherwise false.
+bool XcpSaveDaqConfig(const char *filename);
+
+/// Initialize the DAQ logger singleton.
+/// Starts a saved DAQ setup without XCP client and writes the DAQ data into MDF4 files.
+/// @pre User has called XcpInit, the XCP on Ethernet server is not running.
+/// @param daq_config_file DAQ setup file written by XcpSaveDaqConfig.
+/// @param mdf_file_prefix Path and name prefix of the MDF4 files, a file number and the extension .mf4 are appended.
+/// @param measurement_queue_size Measurement queue size in bytes. Includes the bytes occupied by the queue header and some space needed for alignment.
+/// @return true on success, otherwise false.
+bool XcpDaqLoggerInit(const char *daq_config_file, const char *mdf_file_prefix, uint32_t measurement_queue_size);
+
+/// Stop DAQ, finalize the current MDF4 file and shutdown the DAQ logger.
+bool XcpDaqLoggerShutdown(void);
+
+/// Get the DAQ logger status.
+/// @return true if the DAQ logger is running, otherwise false.
+bool XcpDaqLoggerStatus(void);
+
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Calibration segments
 
@@ -297,9 +328,28 @@ void XcpEventExt_Var(tXcpEventId event, int count, ...);
 // At timestamp variants (clock==0 -> same as non timestamped versions)
 void XcpEventAt(tXcpEventId event, uint64_t clock);
 void XcpEventExtAt(tXcpEventId event, const uint8_t *base2, uint64_t clock);
-void XcpEventExtAt_(tXcpEventId event, int count, const uint8_t **bases, uint64_t clock); // Used by variadic C++ macro/template
+void XcpEventExtAt_(tXcpEventId event, int count, const uint8_t **bases, uint64_t clock); // Used by variadic C++ macro/template for more than 4 base addresses
 void XcpEventExtAt_Var(tXcpEventId event, uint64_t clock, int count, ...);
 
+/// Fixed arity variants of XcpEventExt_Var and XcpEventExtAt_Var for 1 to 4 base addresses (address extensions = [2..5])
+/// No variadic argument list, used by the DAQ trigger macros and templates
+void XcpEventExt1(tXcpEventId event, const uint8_t *base2);
+void XcpEventExt2(tXcpEventId event, const uint8_t *base2, const uint8_t *base3);
+void XcpEventExt3(tXcpEventId event, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4);
+void XcpEventExt4(tXcpEventId event, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4, const uint8_t *base5);
+void XcpEventExtAt1(tXcpEventId event, uint64_t clock, const uint8_t *base2);
+void XcpEventExtAt2(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3);
+void XcpEventExtAt3(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4);
+void XcpEventExtAt4(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4, const uint8_t *base5);
+
+/// Check if the XCP event 'event' needs to be triggered, because it has running DAQ lists or a pending command
+/// Costs a single load and branch, used by the DAQ event trigger macros to skip the trigger function call for unmeasured events
+/// Event ids are folded into XCP_EVENT_MASK_WORDS*64 bits, a false positive is filtered by the trigger function
+/// @param event Event id.
+#define XCP_EVENT_MASK_WORDS 16
+extern const volatile uint64_t *gXcpEventMask;
+#define XcpIsEventActive(event) (0 != (gXcpEventMask[((uint16_t)(event) >> 6) & (XCP_EVENT_MASK_WORDS - 1)] & ((uint64_t)1 << ((event) & 63))))
+
 // Enable or disable a XCP DAQ event
 void XcpEventEnable(tXcpEventId event, bool enable);
 
@@ -371,34 +421,38 @@ extern const uint8_t *gXcpBaseAddr;
 /// Cache the event name lookup in global storage, can not be called with different names in its code location
 /// @param name Name given as identifier
 #define DaqTriggerEvent(name)                                                                                                                                                      \
-    if (XcpIsActivated()) {                                                                                                                                                        \
+    do {                                                                                                                                                                           \
         static tXcpEventId trg__AAS__##name = XCP_UNDEFINED_EVENT_ID;                                                                                                              \
-        if (trg__AAS__##name == XCP_UNDEFINED_EVENT_ID) {                                                                                                                          \
+        if (trg__AAS__##name == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {                                                                                                      \
             trg__AAS__##name = XcpFindEvent(#name);                                                                                                                                \
             assert(trg__AAS__##name != XCP_UNDEFINED_EVENT_ID);                                                                                                                    \
         }                                                                                                                                                                          \
-        XcpEventExt_Var(trg__AAS__##name, 1, xcp_get_frame_addr());                                                                                                                \
-    }
+        if (XcpIsEventActive(trg__AAS__##name)) {                                                                                                                                  \
+            XcpEventExt1(trg__AAS__##name, xcp_get_frame_addr());                                                                                                                  \
+        }                                                                                                                                                                          \
+    } while (0)
 #define DaqTriggerEventAt(name, clock)                                                                                                                                             \
-    if (XcpIsActivated()) {                                                                                                                                                        \
+    do {                                                                                                                                                                           \
         static tXcpEventId trg__AAS__##name = XCP_UNDEFINED_EVENT_ID;                                                                                                              \
-        if (trg__AAS__##name == XCP_UNDEFINED_EVENT_ID) {                                                                                                                          \
+        if (trg__AAS__##name == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {                                                                                                      \
             trg__AAS__##name = XcpFindEvent(#name);                                                                                                                                \
             assert(trg__AAS__##name != XCP_UNDEFINED_EVENT_ID);                                                                                                                    \
         }                                                                                                                                                                          \
-        XcpEventExtAt_Var(trg__AAS__##name, clock, 1, xcp_get_frame_addr());                                                                                                       \
-    }
+        if (XcpIsEventActive(trg__AAS__##name)) {                                                                                                                                  \
+            XcpEventExtAt1(trg__AAS__##name, clock, xcp_get_frame_addr());                                                                                                         \
+        }                                                                                                                                                                          \
+    } while (0)
 
 /// Trigger the XCP event by handle 'event_id' for stack relative or absolute addressing
 /// No lookup overhead, event id must be valid
 /// @param name Event given as id
 #define DaqTriggerEvent_i(event_id)                                                                                                                                                \
-    if (XcpIsActivated()) {                                                                                                                                                        \
+    if (XcpIsEventActive(event_id)) {                                                                                                                                              \
         static tXcpEventId trg__AAS__##name = XCP_UNDEFINED_EVENT_ID;                                                                                                              \
         XcpEventExt(event_id, xcp_get_frame_addr());                                                                                                                               \
     }
 #define DaqTriggerEventAt_i(event_id, clock)                                                                                                                                       \
-    if (XcpIsActivated()) {                                                                                                                                                        \
+    if (XcpIsEventActive(event_id)) {                                                                                                                                              \
         static tXcpEventId trg__AAS__##name = XCP_UNDEFINED_EVENT_ID;                                                                                                              \
         XcpEventExtAt(event_id, xcp_get_frame_addr(), clock);                                                                                                                      \
     }
@@ -408,37 +462,41 @@ extern const uint8_t *gXcpBaseAddr;
 /// @param name Name given as identifier
 /// @param base_addr Base address pointer for relative addressing mode
 #define DaqTriggerEventExt(name, base_addr)                                                                                                                                        \
-    if (XcpIsActivated()) {                                                                                                                                                        \
+    do {                                                                                                                                                                           \
         static tXcpEventId trg__AASD__##name = XCP_UNDEFINED_EVENT_ID;                                                                                                             \
-        if (trg__AASD__##name == XCP_UNDEFINED_EVENT_ID) {                                                                                                                         \
+        if (trg__AASD__##name == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {                                                                                                     \
             trg__AASD__##name = XcpFindEvent(#name);                                                                                                                               \
             assert(trg__AASD__##name != XCP_UNDEFINED_EVENT_ID);                                                                                                                   \
         }                                                                                                                                                                          \
-        XcpEventExt_Var(trg__AASD__##name, 2, xcp_get_frame_addr(), (const uint8_t *)(base_addr));                                                                                 \
-    }
+        if (XcpIsEventActive(trg__AASD__##name)) {                                                                                                                                 \
+            XcpEventExt2(trg__AASD__##name, xcp_get_frame_addr(), (const uint8_t *)(base_addr));                                                                                   \
+        }                                                                                                                                                                          \
+    } while (0)
 
 /// Trigger the XCP event 'name' for absolute, stack and relative addressing mode with given individual base address (from A2lSetRelativeAddrMode(base_addr))
 /// Cache the event lookup in thread local storage, can be called with different names in the same code location in different threads
 /// @param name Name given as string, must be unique per thread and code location
 /// @param base_addr Base address pointer for relative addressing mode
 #define DaqTriggerEventExt_s(name, base_addr)                                                                                                                                      \
-    if (XcpIsActivated()) {                                                                                                                                                        \
+    do {                                                                                                                                                                           \
         static THREAD_LOCAL tXcpEventId trg__AASD__ = XCP_UNDEFINED_EVENT_ID;                                                                                                      \
-        if (trg__AASD__ == XCP_UNDEFINED_EVENT_ID) {                                                                                                                               \
+        if (trg__AASD__ == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {                                                                                                           \
             trg__AASD__ = XcpFindEvent(name);                                                                                                                                      \
             assert(trg__AASD__ != XCP_UNDEFINED_EVENT_ID);                                                                                                                         \
         }                                                                                                                                                                          \
-        XcpEventExt_Var(trg__AASD__, 2, xcp_get_frame_addr(), (const uint8_t *)(base_addr));                                                                                       \
-    }
+        if (XcpIsEventActive(trg__AASD__)) {                                                                                                                                       \
+            XcpEventExt2(trg__AASD__, xcp_get_frame_addr(), (const uint8_t *)(base_addr));                                                                                         \
+        }                                                                                                                                                                          \
+    } while (0)
 
 /// Trigger the XCP event by handle 'event_id' for absolute, stack and relative addressing mode with given individual base address (from A2lSetRelativeAddrMode(base_addr))
 /// No lookup overhead, event id must be valid
 /// @param event_id Event given as id
 /// @param base_addr Base address pointer for relative addressing mode
 #define DaqTriggerEventExt_i(event_id, base_addr)                                                                                                                                  \
-    if (XcpIsActivated()) {                                                                                                                                                        \
+    if (XcpIsEventActive(event_id)) {                                                                                                                                              \
         static tXcpEventId trg__AASD = XCP_UNDEFINED_EVENT_ID;                                                                                                                     \
-        XcpEventExt_Var(event_id, 2, xcp_get_frame_addr(), (const uint8_t *)(base_addr));                                                                                          \
+        XcpEventExt2(event_id, xcp_get_frame_addr(), (const uint8_t *)(base_addr));                                                                                                \
     }
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -449,15 +507,17 @@ extern const uint8_t *gXcpBaseAddr;
 /// The first call creates the event
 /// @param name Name given as identifier
 #define DaqCreateAndTriggerEvent(name)                                                                                                                                             \
-    if (XcpIsActivated()) {                                                                                                                                                        \
+    do {                                                                                                                                                                           \
         static tXcpEventId evt__##name = XCP_UNDEFINED_EVENT_ID;                                                                                                                   \
         static tXcpEventId trg__AAS__##name = XCP_UNDEFINED_EVENT_ID;                                                                                                              \
-        if (trg__AAS__##name == XCP_UNDEFINED_EVENT_ID) {                                                                                                                          \
+        if (trg__AAS__##name == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {                                                                                                      \
             evt__##name = trg__AAS__##name;                                                                                                                                        \
             trg__AAS__##name = XcpCreateEvent(#name, 0, 0);                                                                                                                        \
         }                                                                                                                                                                          \
-        XcpEventExt_Var(trg__AAS__##name, 1, xcp_get_frame_addr());                                                                                                                \
-    }
+        if (XcpIsEventActive(trg__AAS__##name)) {                                                                                                                                  \
+            XcpEventExt1(trg__AAS__##name, xcp_get_frame_addr());                                                                                                                  \
+        }                                                                                                                                                                          \
+    } while (0)
 
 // ---------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Enable/disable events
@@ -596,6 +656,15 @@ void XcpSetLogLevel(uint8_t level);
 bool XcpInit(const char *name, const char *epk, uint8_t mode);
 void XcpDeinit(void); // Internal function for Rust build.rs
 
+/// Change the size of the memory for DAQ tables
+/// The default size is OPTION_DAQ_MEM_SIZE, each DAQ list needs 12 bytes, each ODT 8 bytes and each ODT entry (measurement signal or memory block) 6 bytes
+/// Additional memory is allocated to compile the DAQ lists into copy plans (8 bytes per ODT entry) and for the shadow copies of send on change DAQ lists
+/// Not available in SHM mode, the DAQ tables have the fixed size OPTION_DAQ_MEM_SIZE
+/// @pre User has called XcpInit, no XCP client is connected and DAQ is not running
+/// @param size Memory size in bytes
+/// @return true on success, false if the DAQ memory could not be changed, or has been reset to the default size, because the allocation failed
+bool XcpSetDaqMemSize(uint32_t size);
+
 /// Check if XCP has been activated
 bool XcpIsActivated(void);
 
@@ -862,19 +931,19 @@ void sleepMs(uint32_t ms);
 /// Supports absolute, stack and relative addressing mode measurements
 #define DaqEventVar(event_name, ...)                                                                                                                                               \
     do {                                                                                                                                                                           \
-        if (XcpIsActivated()) {                                                                                                                                                    \
-            static tXcpEventId evt__##event_name = XCP_UNDEFINED_EVENT_ID;                                                                                                         \
-            if (evt__##event_name == XCP_UNDEFINED_EVENT_ID) {                                                                                                                     \
-                evt__##event_name = XcpCreateEvent(#event_name, 0, 0);                                                                                                             \
-                A2lOnce() {                                                                                                                                                        \
-                    A2lLock();                                                                                                                                                     \
-                    A2lSetAutoAddrMode__s(#event_name, xcp_get_frame_addr(), NULL);                                                                                                \
-                    XCPLIB_FOR_EACH_MEAS_(A2L_UNPACK_AND_REG_, __VA_ARGS__)                                                                                                        \
-                    A2lUnlock();                                                                                                                                                   \
-                }                                                                                                                                                                  \
+        static tXcpEventId evt__##event_name = XCP_UNDEFINED_EVENT_ID;                                                                                                             \
+        if (evt__##event_name == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {                                                                                                     \
+            evt__##event_name = XcpCreateEvent(#event_name, 0, 0);                                                                                                                 \
+            A2lOnce() {                                                                                                                                                            \
+                A2lLock();                                                                                                                                                         \
+                A2lSetAutoAddrMode__s(#event_name, xcp_get_frame_addr(), NULL);                                                                                                    \
+                XCPLIB_FOR_EACH_MEAS_(A2L_UNPACK_AND_REG_, __VA_ARGS__)                                                                                                            \
+                A2lUnlock();                                                                                                                                                       \
             }                                                                                                                                                                      \
-            static tXcpEventId trg__AAS__##event_name = XCP_UNDEFINED_EVENT_ID;                                                                                                    \
-            XcpEventExt_Var(evt__##event_name, 1, xcp_get_frame_addr());                                                                                                           \
+        }                                                                                                                                                                          \
+        static tXcpEventId trg__AAS__##event_name = XCP_UNDEFINED_EVENT_ID;                                                                                                        \
+        if (XcpIsEventActive(evt__##event_name)) {                                                                                                                                 \
+            XcpEventExt1(evt__##event_name, xcp_get_frame_addr());                                                                                                                 \
         }                                                                                                                                                                          \
     } while (0)
 
@@ -882,20 +951,20 @@ void sleepMs(uint32_t ms);
 /// Supports absolute, stack and relative addressing mode measurements
 #define DaqEventExtVar(event_name, base, ...)                                                                                                                                      \
     do {                                                                                                                                                                           \
-        if (XcpIsActivated()) {                                                                                                                                                    \
-            static tXcpEventId evt__##event_name = XCP_UNDEFINED_EVENT_ID;                                                                                                         \
-            if (evt__##event_name == XCP_UNDEFINED_EVENT_ID) {                                                                                                                     \
-                evt__##event_name = XcpCreateEvent(#event_name, 0, 0);                                                                                                             \
-                A2lOnce() {                                                                                                                                                        \
-                    A2lLock();                                                                                                                                                     \
-                    A2lSetAutoAddrMode__s(#event_name, xcp_get_frame_addr(), (const uint8_t *)base);                                                                               \
-                    XCPLIB_FOR_EACH_MEAS_(A2L_UNPACK_AND_REG_, __VA_ARGS__)                                                                                                        \
-                    A2lUnlock();                                                                                                                                                   \
-                }                                                                                                                                                                  \
-                static tXcpEventId trg__AASD__##event_name = XCP_UNDEFINED_EVENT_ID;                                                                                               \
-                XcpEventExt_Var(evt__##event_name, 2, xcp_get_frame_addr(), (const uint8_t *)base);                                                                                \
+        static tXcpEventId evt__##event_name = XCP_UNDEFINED_EVENT_ID;                                                                                                             \
+        if (evt__##event_name == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {                                                                                                     \
+            evt__##event_name = XcpCreateEvent(#event_name, 0, 0);                                                                                                                 \
+            A2lOnce() {                                                                                                                                                            \
+                A2lLock();                                                                                                                                                         \
+                A2lSetAutoAddrMode__s(#event_name, xcp_get_frame_addr(), (const uint8_t *)base);                                                                                   \
+                XCPLIB_FOR_EACH_MEAS_(A2L_UNPACK_AND_REG_, __VA_ARGS__)                                                                                                            \
+                A2lUnlock();                                                                                                                                                       \
             }                                                                                                                                                                      \
         }                                                                                                                                                                          \
+        static tXcpEventId trg__AASD__##event_name = XCP_UNDEFINED_EVENT_ID;                                                                                                       \
+        if (XcpIsEventActive(evt__##event_name)) {                                                                                                                                 \
+            XcpEventExt2(evt__##event_name, xcp_get_frame_addr(), (const uint8_t *)base);                                                                                          \
+        }                                                                                                                                                                          \
     } while (0)
 
 #endif // !__cplusplus
@@ -202,20 +202,41 @@ namespace xcp {
 // For XCP DAQ event creation, measurement registration and triggering
 // =============================================================================
 
+// Trigger an event with a compile time number of base addresses (address extensions = [2..])
+// Dispatched to the fixed arity trigger functions, the base addresses are passed in registers
+// More than 4 base addresses are passed as a base pointer array on the stack
+template <typename... Bases> XCPLIB_ALWAYS_INLINE void EventExtAt(tXcpEventId event_id, uint64_t clock, Bases... bases) {
+    constexpr size_t n = sizeof...(Bases);
+    if constexpr (n == 1) {
+        XcpEventExtAt1(event_id, clock, bases...);
+    } else if constexpr (n == 2) {
+        XcpEventExtAt2(event_id, clock, bases...);
+    } else if constexpr (n == 3) {
+        XcpEventExtAt3(event_id, clock, bases...);
+    } else if constexpr (n == 4) {
+        XcpEventExtAt4(event_id, clock, bases...);
+    } else {
+        const uint8_t *b[] = {xcp_get_base_addr(), xcp_get_base_addr(), bases...};
+        XcpEventExtAt_(event_id, (int)(sizeof(b) / sizeof(b[0])), b, clock);
+    }
+}
+
 /// Trigger an event with variadic base address list
 #define DaqTriggerEventVar(event_name, ...) xcp::DaqTriggerVarTemplate(#event_name, __VA_ARGS__)
 
 // Main template function for event triggering with variadic base address list
 template <typename... Bases> XCPLIB_ALWAYS_INLINE void DaqTriggerVarTemplate(const char *event_name, Bases const &...bases) {
 
-    if (XcpIsActivated()) {
-        static tXcpEventId event_id = XCP_UNDEFINED_EVENT_ID;
+    static tXcpEventId event_id = XCP_UNDEFINED_EVENT_ID;
+    if (event_id == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {
         static std::once_flag once_flag;
         std::call_once(once_flag, [&]() {
             event_id = XcpCreateEvent(event_name, 0, 0);
             assert(event_id != XCP_UNDEFINED_EVENT_ID);
         });
-        XcpEventExt_Var(event_id, sizeof...(Bases), &bases...);
+    }
+    if (XcpIsEventActive(event_id)) {
+        EventExtAt(event_id, 0, (const uint8_t *)&bases...);
     }
 }
 
@@ -287,10 +308,10 @@ template <typename T> XCPLIB_ALWAYS_INLINE void registerMeasurement(const Measur
 
 // Main template function for once event creation and registration with automatic addressing mode, and event triggering with base address
 template <typename... Measurements> XCPLIB_ALWAYS_INLINE void DaqEventExtTemplate(const char *event_name, const void *base, Measurements &&...measurements) {
-    if (XcpIsActivated()) {
-        static tXcpEventId event_id = XCP_UNDEFINED_EVENT_ID;
+    static tXcpEventId event_id = XCP_UNDEFINED_EVENT_ID;
+    const uint8_t *frame_addr = (const uint8_t *)xcp_get_frame_addr(); // Capture caller's frame address before lambda
+    if (event_id == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {
         static std::once_flag once_flag;
-        const uint8_t *frame_addr = (const uint8_t *)xcp_get_frame_addr(); // Capture caller's frame address before lambda
         std::call_once(once_flag, [&]() {
             event_id = XcpCreateEvent(event_name, 0, 0);
             assert(event_id != XCP_UNDEFINED_EVENT_ID);
@@ -299,16 +320,18 @@ template <typename... Measurements> XCPLIB_ALWAYS_INLINE void DaqEventExtTemplat
             (registerMeasurement(measurements), ...);
             A2lUnlock();
         });
-        XcpEventExt_Var(event_id, 2, frame_addr, (const uint8_t *)base);
+    }
+    if (XcpIsEventActive(event_id)) {
+        XcpEventExt2(event_id, frame_addr, (const uint8_t *)base);
     }
 }
 
 // Main template function for once event creation and registration with automatic addressing mode, and event triggering
 template <typename... Measurements> XCPLIB_ALWAYS_INLINE void DaqEventTemplate(const char *event_name, Measurements &&...measurements) {
-    if (XcpIsActivated()) {
-        static tXcpEventId event_id = XCP_UNDEFINED_EVENT_ID;
+    static tXcpEventId event_id = XCP_UNDEFINED_EVENT_ID;
+    const uint8_t *frame_addr = (const uint8_t *)xcp_get_frame_addr(); // Capture caller's frame address before lambda
+    if (event_id == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {
         static std::once_flag once_flag;
-        const uint8_t *frame_addr = (const uint8_t *)xcp_get_frame_addr(); // Capture caller's frame address before lambda
         std::call_once(once_flag, [&]() {
             event_id = XcpCreateEvent(event_name, 0, 0);
             assert(event_id != XCP_UNDEFINED_EVENT_ID);
@@ -317,7 +340,9 @@ template <typename... Measurements> XCPLIB_ALWAYS_INLINE void DaqEventTemplate(c
             (registerMeasurement(measurements), ...);
             A2lUnlock();
         });
-        XcpEventExt_Var(event_id, 1, frame_addr);
+    }
+    if (XcpIsEventActive(event_id)) {
+        XcpEventExt1(event_id, frame_addr);
     }
 }
 
@@ -345,10 +370,9 @@ template <typename T> XCPLIB_ALWAYS_INLINE void registerDynMeasurement(uint8_t i
 // Main template function for once event creation and registration with individual relative addressing mode, and event triggering
 template <typename... Measurements> XCPLIB_ALWAYS_INLINE void DaqEventVarTemplate(const char *event_name, uint64_t clock, Measurements &&...measurements) {
 
-    if (XcpIsActivated()) {
-
-        // Once
-        static tXcpEventId event_id = XCP_UNDEFINED_EVENT_ID;
+    // Once
+    static tXcpEventId event_id = XCP_UNDEFINED_EVENT_ID;
+    if (event_id == XCP_UNDEFINED_EVENT_ID && XcpIsActivated()) {
         static std::once_flag once_flag;
         std::call_once(once_flag, [&]() {
             // Create event, ignore if already created
@@ -360,11 +384,12 @@ template <typename... Measurements> XCPLIB_ALWAYS_INLINE void DaqEventVarTemplat
             (registerDynMeasurement(index++, event_id, measurements), ...);
             A2lUnlock();
         });
+    }
 
-        // Always
-        // Create base pointer list and trigger
-        const uint8_t *bases[] = {xcp_get_base_addr(), xcp_get_base_addr(), xcp_get_frame_addr(), (const uint8_t *)measurements.addr...};
-        XcpEventExtAt_(event_id, (sizeof(bases) / sizeof(bases[0])), bases, clock);
+    // Only if the event is measured
+    // Trigger with the frame address and the measurement addresses as base addresses
+    if (XcpIsEventActive(event_id)) {
+        EventExtAt(event_id, clock, xcp_get_frame_addr(), (const uint8_t *)measurements.addr...);
     }
 }
 
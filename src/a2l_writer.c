@@ -24,7 +24,9 @@
 #include "dbg_print.h"  // for DBG_PRINT
 #include "xcp_cfg.h"    // for XCP_xxx
 #include "xcplib_cfg.h" // for OPTION_xxx
+#include "queue.h"      // for tQueueStatistics
 #include "xcplite.h"    // for tXcpCalSeg, tXcpDaqLists, XcpXxx, ApplXcpXxx, ...
+#include "xcptl.h"      // for XcpTlGetQueueStatistics
 #include "xcptl_cfg.h"  // for XCPTL_xxx
 
 #ifdef OPTION_ENABLE_A2L_GENERATOR
@@ -409,6 +411,58 @@ static void createEventGroupsAndConversions(const char *project_name, bool event
 
 //----------------------------------------------------------------------------------------------
 
+// Create the transmit queue statistics measurements (OPTION_QUEUE_STATISTICS_EVENT)
+// The statistics are updated by the transport layer and measured on the queue statistics event with absolute addressing
+#if defined(OPTION_QUEUE_STATISTICS_EVENT) && defined(XCP_ENABLE_DAQ_EVENT_LIST) && defined(XCP_ENABLE_ABS_ADDRESSING)
+
+static void createQueueStatisticsMeasurement(const char *project_name, uint16_t event_id, const char *name, tA2lTypeId type_id, const void *ptr, const char *unit,
+                                             const char *comment) {
+    char s[XCP_A2L_MAX_SYMBOL_NAME_LENGTH];
+    SNPRINTF(s, XCP_A2L_MAX_SYMBOL_NAME_LENGTH, "%s.%s", XCPTL_QUEUE_STATISTICS_EVENT_NAME, name);
+    fprintf(gA2lFile, "/begin MEASUREMENT %s \"%s\" %s NO_COMPU_METHOD 0 0 %.0f %.0f ECU_ADDRESS 0x%X", A2lGetPrefixedName_(project_name, s), comment,
+            A2lGetA2lTypeName(type_id), A2lGetTypeMin(type_id), A2lGetTypeMax(type_id), ApplXcpGetAddr((const uint8_t *)ptr));
+    uint8_t ext = ApplXcpGetAddrExt((const uint8_t *)ptr);
+    if (ext > 0) {
+        fprintf(gA2lFile, " ECU_ADDRESS_EXTENSION %u", ext);
+    }
+    if (unit != NULL) {
+        fprintf(gA2lFile, " PHYS_UNIT \"%s\"", unit);
+    }
+    fprintf(gA2lFile, " /begin IF_DATA XCP /begin DAQ_EVENT FIXED_EVENT_LIST EVENT 0x%X /end DAQ_EVENT /end IF_DATA /end MEASUREMENT\n", event_id);
+}
+
+static void createQueueStatisticsMeasurements(const char *project_name) {
+
+    uint16_t event_id = 0;
+    const tQueueStatistics *q = XcpTlGetQueueStatistics(&event_id);
+    if (q == NULL) {
+        return; // No transport layer in this process
+    }
+
+    fprintf(gA2lFile, "\n");
+    createQueueStatisticsMeasurement(project_name, event_id, "queue_size", A2L_TYPE_UINT32, &q->queue_size, NULL, "Transmit queue maximum level");
+    createQueueStatisticsMeasurement(project_name, event_id, "level", A2L_TYPE_UINT32, &q->level, NULL, "Transmit queue level");
+    createQueueStatisticsMeasurement(project_name, event_id, "level_max", A2L_TYPE_UINT32, &q->level_max, NULL, "Transmit queue level high water mark");
+    createQueueStatisticsMeasurement(project_name, event_id, "producer_count", A2L_TYPE_UINT32, &q->producer_count, NULL, "Number of producer threads");
+    createQueueStatisticsMeasurement(project_name, event_id, "acquire_count", A2L_TYPE_UINT64, &q->acquire_count, NULL, "Number of buffers acquired");
+    createQueueStatisticsMeasurement(project_name, event_id, "acquire_retries", A2L_TYPE_UINT64, &q->acquire_retries, NULL, "Number of acquire retries");
+    createQueueStatisticsMeasurement(project_name, event_id, "acquire_retries_max", A2L_TYPE_UINT32, &q->acquire_retries_max, NULL, "Maximum retries of an acquire");
+    createQueueStatisticsMeasurement(project_name, event_id, "overflow_bursts", A2L_TYPE_UINT32, &q->overflow_bursts, NULL, "Number of overflow bursts");
+    createQueueStatisticsMeasurement(project_name, event_id, "packets_lost", A2L_TYPE_UINT64, &q->packets_lost, NULL, "Number of buffers lost");
+    createQueueStatisticsMeasurement(project_name, event_id, "acquire_time_p50", A2L_TYPE_UINT32, &q->acquire_time_p50, "ns", "Median acquire latency");
+    createQueueStatisticsMeasurement(project_name, event_id, "acquire_time_p99", A2L_TYPE_UINT32, &q->acquire_time_p99, "ns", "99th percentile acquire latency");
+    createQueueStatisticsMeasurement(project_name, event_id, "acquire_time_max", A2L_TYPE_UINT32, &q->acquire_time_max, "ns", "Maximum acquire latency");
+    createQueueStatisticsMeasurement(project_name, event_id, "peek_time_p50", A2L_TYPE_UINT32, &q->peek_time_p50, "ns", "Median consumer peek latency");
+    createQueueStatisticsMeasurement(project_name, event_id, "peek_time_p99", A2L_TYPE_UINT32, &q->peek_time_p99, "ns", "99th percentile consumer peek latency");
+    createQueueStatisticsMeasurement(project_name, event_id, "peek_time_max", A2L_TYPE_UINT32, &q->peek_time_max, "ns", "Maximum consumer peek latency");
+    createQueueStatisticsMeasurement(project_name, event_id, "peek_count", A2L_TYPE_UINT64, &q->peek_count, NULL, "Number of buffers obtained by the consumer");
+    createQueueStatisticsMeasurement(project_name, event_id, "wait_count", A2L_TYPE_UINT64, &q->wait_count, NULL, "Number of consumer waits");
+}
+
+#endif
+
+//----------------------------------------------------------------------------------------------
+
 // Include the partial A2L files generated by the application(s) into the main file
 static void includePartialA2lFiles(uint8_t a2l_mode, uint16_t count, const char **files) {
 
@@ -518,6 +572,11 @@ bool A2lWriter(const char *a2l_filename, uint8_t a2l_mode, const char *project_n
     // Include the partial A2L files generated by the application(s) into the main file
     includePartialA2lFiles(a2l_mode, include_count, include_files);
 
+    // Create the transmit queue statistics measurements
+#if defined(OPTION_QUEUE_STATISTICS_EVENT) && defined(XCP_ENABLE_DAQ_EVENT_LIST) && defined(XCP_ENABLE_ABS_ADDRESSING)
+    createQueueStatisticsMeasurements(project_name);
+#endif
+
 // Create event conversions and groups
 #if defined(XCP_ENABLE_DAQ_EVENT_LIST)
     createEventGroupsAndConversions(project_name, a2l_mode & A2L_MODE_AUTO_GROUPS, a2l_mode & A2L_MODE_EVENT_CONVERSION);
@@ -42,14 +42,16 @@
 #pragma pack(push, 1)
 
 typedef struct {
-    char signature[16];                              // File signature "XCPLITE__BINARY"
-    uint16_t version;                                // File version
-    uint16_t event_count;                            // Number of events, tEventDescriptor
-    uint16_t calseg_count;                           // Number of calibration segments, tCalSegDescriptor
-    uint16_t app_count;                              // Number of applications (processes) in SHM mode, 0 in local mode
-    uint8_t reserved[128 - 16 - 2 - 2 - 2 - 2];      // Reserved for future use
-    char Epk[XCP_EPK_MAX_LENGTH + 1];                // EPK string, 0 terminated
-    uint8_t padding[128 - (XCP_EPK_MAX_LENGTH + 1)]; // Reserved for longer EPK strings up to 128 bytes
+    char signature[16];                                 // File signature "XCPLITE__BINARY"
+    uint16_t version;                                   // File version
+    uint16_t event_count;                               // Number of events, tEventDescriptor
+    uint16_t calseg_count;                              // Number of calibration segments, tCalSegDescriptor
+    uint16_t app_count;                                 // Number of applications (processes) in SHM mode, 0 in local mode
+    uint32_t daq_offset;                                // File position after the calibration data, where a DAQ setup for resume mode is stored, 0 if unknown
+    uint8_t daq_resume;                                 // A DAQ setup for resume mode is stored at daq_offset
+    uint8_t reserved[128 - 16 - 2 - 2 - 2 - 2 - 4 - 1]; // Reserved for future use
+    char Epk[XCP_EPK_MAX_LENGTH + 1];                   // EPK string, 0 terminated
+    uint8_t padding[128 - (XCP_EPK_MAX_LENGTH + 1)];    // Reserved for longer EPK strings up to 128 bytes
 } tHeader;
 
 static_assert(sizeof(tHeader) == 256, "Size of tHeader must be 256 bytes");
@@ -304,6 +306,16 @@ bool XcpBinWrite(const char *epk) {
     }
 #endif // SHM_MODE
 
+    // Remember the end of the calibration data, a DAQ setup for resume mode is appended there
+#ifdef XCP_ENABLE_DAQ_RESUME
+    gBinHeader.daq_offset = (uint32_t)ftell(file);
+    if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&gBinHeader, sizeof(tHeader), 1, file) != 1) {
+        DBG_PRINT_ERROR("Failed to write header to BIN file\n");
+        fclose(file);
+        return false;
+    }
+#endif
+
     fclose(file);
 
     DBG_PRINTF3(ANSI_COLOR_GREEN "Persistence data written to BIN file '%s'\n" ANSI_COLOR_RESET, XcpBinGetFilename());
@@ -539,6 +551,97 @@ bool XcpBinLoad(void) {
     return false;
 }
 
+//--------------------------------------------------------------------------------------------------------------------------------
+// DAQ setup for resume mode
+
+#ifdef XCP_ENABLE_DAQ_RESUME
+
+// Read and verify the BIN file header, the DAQ setup belongs to the calibration data of the same EPK
+static bool readDaqHeader(FILE *file, const char *filename) {
+    if (fread(&gBinHeader, sizeof(tHeader), 1, file) != 1 || strncmp(gBinHeader.signature, BIN_SIGNATURE, sizeof(gBinHeader.signature)) != 0 ||
+        gBinHeader.version != BIN_VERSION) {
+        DBG_PRINTF_ERROR("Invalid file format or signature in '%s'\n", filename);
+        return false;
+    }
+    if (strncmp(gBinHeader.Epk, XcpGetEpk(), XCP_EPK_MAX_LENGTH) != 0) {
+        DBG_PRINTF_WARNING("Persistence file '%s' EPK mismatch: file EPK '%s', current EPK '%s'\n", filename, gBinHeader.Epk, XcpGetEpk());
+        return false;
+    }
+    return true;
+}
+
+// Store the current DAQ setup in the binary persistence file, to resume DAQ on the next start
+// @return
+// Returns true if the DAQ setup was successfully written.
+bool XcpBinStoreDaq(void) {
+
+    const char *filename = XcpBinGetFilename();
+    FILE *file = fopen(filename, "r+b");
+    if (file == NULL) {
+        DBG_PRINTF_ERROR("Failed to open file '%s'\n", filename);
+        return false;
+    }
+
+    bool ok = readDaqHeader(file, filename);
+    if (ok && gBinHeader.daq_offset == 0) { // File written without DAQ setup position, append
+        ok = fseek(file, 0, SEEK_END) == 0;
+        gBinHeader.daq_offset = (uint32_t)ftell(file);
+    }
+    ok = ok && fseek(file, gBinHeader.daq_offset, SEEK_SET) == 0 && XcpWriteDaqConfig(file);
+    gBinHeader.daq_resume = ok ? 1 : 0;
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&gBinHeader, sizeof(tHeader), 1, file) == 1;
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        DBG_PRINTF_ERROR("Failed to store DAQ setup in '%s'\n", filename);
+        return false;
+    }
+    DBG_PRINTF3(ANSI_COLOR_GREEN "DAQ setup for resume mode stored in '%s'\n" ANSI_COLOR_RESET, filename);
+    return true;
+}
+
+// Remove the DAQ setup from the binary persistence file
+void XcpBinClearDaq(void) {
+
+    const char *filename = XcpBinGetFilename();
+    FILE *file = fopen(filename, "r+b");
+    if (file == NULL) {
+        return;
+    }
+    if (readDaqHeader(file, filename) && gBinHeader.daq_resume != 0) {
+        gBinHeader.daq_resume = 0;
+        if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&gBinHeader, sizeof(tHeader), 1, file) != 1) {
+            DBG_PRINTF_ERROR("Failed to clear DAQ setup in '%s'\n", filename);
+        } else {
+            DBG_PRINTF3("DAQ setup for resume mode cleared in '%s'\n", filename);
+        }
+    }
+    fclose(file);
+}
+
+// Load the DAQ setup from the binary persistence file and select its DAQ lists
+// Called by XcpStart in resume mode, the events referenced by the DAQ lists have been preloaded by XcpBinLoad
+// @return
+// Returns true if a DAQ setup for resume mode was found and loaded.
+bool XcpBinLoadDaq(void) {
+
+    const char *filename = XcpBinGetFilename();
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = readDaqHeader(file, filename) && gBinHeader.daq_resume != 0 && gBinHeader.daq_offset != 0;
+    ok = ok && fseek(file, gBinHeader.daq_offset, SEEK_SET) == 0 && XcpReadDaqConfig(file);
+    fclose(file);
+    if (ok) {
+        DBG_PRINTF3(ANSI_COLOR_GREEN "DAQ setup for resume mode loaded from '%s'\n" ANSI_COLOR_RESET, filename);
+    }
+    return ok;
+}
+
+#endif // XCP_ENABLE_DAQ_RESUME
+
 void XcpBinDelete(void) {
     const char *filename = XcpBinGetFilename();
     if (remove(filename) == 0) {
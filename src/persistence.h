@@ -38,6 +38,19 @@ void XcpBinDelete(void);
 // Freeze current working page data of the specified calibration segment in the binary file
 bool XcpBinFreezeCalSeg(tXcpCalSegIndex calseg);
 
+#ifdef XCP_ENABLE_DAQ_RESUME
+
+// Store the current DAQ setup for resume mode in the binary file
+bool XcpBinStoreDaq(void);
+
+// Remove the DAQ setup for resume mode from the binary file
+void XcpBinClearDaq(void);
+
+// Load the DAQ setup for resume mode from the binary file and select its DAQ lists
+bool XcpBinLoadDaq(void);
+
+#endif
+
 /// Get the filename of the binary persistence file
 /// Buffer valid until the next call of this function
 const char *XcpBinGetFilename(void);
@@ -9,6 +9,7 @@
 |     Threads
 |     Mutex
 |     Sockets
+|     io_uring socket I/O (Linux only)
 |     Clock
 |     Virtual memory
 |     Keyboard
@@ -143,6 +144,39 @@ void sleepMs(uint32_t ms) {
 
 #endif // Windows
 
+/**************************************************************************/
+// Wait on address
+/**************************************************************************/
+
+#if defined(_LINUX)
+
+#include <linux/futex.h> // for FUTEX_WAIT, FUTEX_WAKE
+#include <sys/syscall.h> // for SYS_futex
+#include <unistd.h>      // for syscall
+
+static_assert(sizeof(atomic_uint_least32_t) == sizeof(uint32_t), "futex requires a 32 bit value");
+
+bool platformWaitOnAddress(atomic_uint_least32_t *addr, uint32_t expected, uint32_t timeout_us) {
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)(timeout_us / 1000000);
+    timeout.tv_nsec = (long)(timeout_us % 1000000) * 1000;
+    // The futex system call is not a cancellation point, allow cancel_thread to terminate the waiting thread like one blocked in sleepUs
+    int cancel_type;
+    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &cancel_type);
+    // Not FUTEX_PRIVATE, the value may be in shared memory
+    long res = syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAIT, expected, &timeout, NULL, 0);
+    int err = errno;
+    pthread_setcanceltype(cancel_type, NULL);
+    if (res == 0) {
+        return true;
+    }
+    return err != ETIMEDOUT; // EAGAIN if the value has already changed, EINTR on signal
+}
+
+void platformWakeOnAddress(atomic_uint_least32_t *addr) { syscall(SYS_futex, (uint32_t *)addr, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0); }
+
+#endif
+
 /**************************************************************************/
 // Memory mapping
 /**************************************************************************/
@@ -173,6 +207,63 @@ void platformMemFree(void *ptr, size_t size) {
 #endif
 }
 
+#define PLATFORM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+void *platformMemAllocHuge(size_t *size) {
+    assert(size != NULL && *size > 0);
+#if defined(_WIN)
+    return platformMemAlloc(*size);
+#else
+    size_t huge_size = (*size + PLATFORM_HUGE_PAGE_SIZE - 1) & ~((size_t)PLATFORM_HUGE_PAGE_SIZE - 1);
+    void *mem = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    // Explicit huge pages from the hugetlbfs pool (/proc/sys/vm/nr_hugepages), pre-faulted
+    mem = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    if (mem != MAP_FAILED) {
+        DBG_PRINTF3("platformMemAllocHuge: %zu bytes in %zu huge pages\n", huge_size, huge_size / PLATFORM_HUGE_PAGE_SIZE);
+        *size = huge_size;
+        return mem;
+    }
+    DBG_PRINTF3("platformMemAllocHuge: no huge pages available (%s), using normal pages\n", strerror(errno));
+#endif
+    // Fallback to normal pages, transparent huge pages if enabled
+    mem = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        DBG_PRINTF_ERROR("platformMemAllocHuge: mmap failed: %s\n", strerror(errno));
+        return NULL;
+    }
+#if defined(MADV_HUGEPAGE)
+    madvise(mem, huge_size, MADV_HUGEPAGE);
+#endif
+    *size = huge_size;
+    return mem;
+#endif
+}
+
+bool platformMemLock(void *ptr, size_t size) {
+    assert(ptr != NULL);
+#if defined(_WIN)
+    if (!VirtualLock(ptr, size)) {
+        DBG_PRINTF_WARNING("platformMemLock: VirtualLock failed (%lu), memory not locked\n", GetLastError());
+        return false;
+    }
+    return true;
+#else
+#if defined(MADV_HUGEPAGE)
+    madvise(ptr, size, MADV_HUGEPAGE); // Transparent huge pages for shared memory, if /sys/kernel/mm/transparent_hugepage/shmem_enabled is advise
+#endif
+    // mlock faults in all pages
+    if (mlock(ptr, size) != 0) {
+        DBG_PRINTF_WARNING("platformMemLock: mlock failed (%s), check RLIMIT_MEMLOCK (ulimit -l), memory not locked\n", strerror(errno));
+#if defined(MADV_POPULATE_WRITE)
+        madvise(ptr, size, MADV_POPULATE_WRITE); // Pre-fault without locking
+#endif
+        return false;
+    }
+    return true;
+#endif
+}
+
 /**************************************************************************/
 // POSIX shared memory
 /**************************************************************************/
@@ -426,8 +517,19 @@ const char *socketGetErrorString(int32_t err) {
 #if defined(_LINUX)           // Linux platform hardware timestamping support
 #include <net/if.h>           // for if_nametoindex, struct ifreq, IFNAMSIZ
 #include <netpacket/packet.h> // for struct sockaddr_ll (AF_PACKET, used by socketGetMAC)
+#include <netinet/udp.h>      // for UDP_SEGMENT
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // UDP generic segmentation offload, Linux 4.18, not defined by older C libraries
+#endif
+#include <linux/errqueue.h> // for sock_extended_err, SO_EE_ORIGIN_ZEROCOPY
+#include <poll.h>           // for poll
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60 // Zero copy transmit, Linux 4.14, not defined by older C libraries
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
 #if defined(OPTION_SOCKET_HW_TIMESTAMPS)
-#include <linux/errqueue.h>
 #include <linux/net_tstamp.h>
 #include <linux/sockios.h> // for SIOCSHWTSTAMP
 #include <sys/ioctl.h>     // for ioctl
@@ -1562,6 +1664,312 @@ int16_t socketSendToV(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t cou
     return (int16_t)n;
 }
 
+// Send multiple UDP datagrams, each composed of multiple buffers, to a specific address/port
+// Linux: all datagrams are sent with a single sendmmsg system call, other POSIX platforms: one sendmsg per datagram
+// Thread safe
+// buffers:     array of pointers to data buffers
+// count:       number of buffers
+// segment_end: array of datagrams, buffer index after the last buffer of each datagram, the last one is count
+// segments:    number of datagrams
+// Returns total number of bytes sent, 0 on socket closed or -1 on error
+int32_t socketSendToMV(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, const uint16_t segment_end[], uint16_t segments, const uint8_t *addr,
+                       uint16_t port) {
+
+    assert(socket != NULL);
+    assert(segments > 0 && segment_end[segments - 1] == count);
+    SOCKET sock = socket->sock;
+    assert(sock != INVALID_SOCKET);
+
+    SOCKADDR_IN sa;
+    sa.sin_family = AF_INET;
+    memcpy(&sa.sin_addr.s_addr, addr, 4);
+    sa.sin_port = htons(port);
+
+    // Build iovec and message arrays on the stack - VLAs are acceptable here as count and segments are limited by the transmit queue peek size
+    struct iovec iov[count];
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        iov[i].iov_base = (void *)buffers[i].buffer;
+        iov[i].iov_len = buffers[i].size;
+        total += buffers[i].size;
+    }
+
+#if defined(_LINUX)
+
+    struct mmsghdr msgs[segments];
+    memset(msgs, 0, sizeof(msgs));
+    for (uint16_t s = 0, i = 0; s < segments; i = segment_end[s++]) {
+        msgs[s].msg_hdr.msg_name = &sa;
+        msgs[s].msg_hdr.msg_namelen = sizeof(sa);
+        msgs[s].msg_hdr.msg_iov = &iov[i];
+        msgs[s].msg_hdr.msg_iovlen = (size_t)(segment_end[s] - i);
+    }
+
+    // sendmmsg may send less datagrams than requested, loop until all datagrams are sent
+    uint32_t sent = 0;
+    for (uint16_t s = 0; s < segments;) {
+        int n = sendmmsg(sock, &msgs[s], (unsigned int)(segments - s), 0);
+        if (n <= 0) {
+            int32_t err = socketGetLastError();
+            if (socketWouldBlock(err)) {
+                DBG_PRINT_ERROR("socketSendToMV: unexpected WBLOCK\n");
+                return -1; // Should never happen on a blocking socket
+            }
+            if (socketIsClosed(err)) {
+                DBG_PRINTF6("socketSendToMV: socket closed (errno=%d,%s)\n", err, socketGetErrorString(err));
+                return 0; // Transmit socket closed
+            }
+            DBG_PRINTF_ERROR("socketSendToMV: sendmmsg failed with errno=%d,%s!\n", err, socketGetErrorString(err));
+            return -1;
+        }
+        for (int k = 0; k < n; k++, s++) {
+            sent += msgs[s].msg_len;
+        }
+    }
+
+#else
+
+    uint32_t sent = 0;
+    for (uint16_t s = 0, i = 0; s < segments; i = segment_end[s++]) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &sa;
+        msg.msg_namelen = sizeof(sa);
+        msg.msg_iov = &iov[i];
+        msg.msg_iovlen = segment_end[s] - i;
+        ssize_t n = sendmsg(sock, &msg, 0);
+        if (n < 0) {
+            int32_t err = socketGetLastError();
+            if (socketIsClosed(err)) {
+                DBG_PRINTF6("socketSendToMV: socket closed (errno=%d,%s)\n", err, socketGetErrorString(err));
+                return 0; // Transmit socket closed
+            }
+            DBG_PRINTF_ERROR("socketSendToMV: sendmsg failed with errno=%d,%s!\n", err, socketGetErrorString(err));
+            return -1;
+        }
+        sent += (uint32_t)n;
+    }
+
+#endif
+
+    if (total != sent) {
+        DBG_PRINTF_WARNING("socketSendToMV: partial send, sent %" PRIu32 " of %" PRIu32 " bytes\n", sent, total);
+        return -1; // Treat partial sends as an error on UDP sockets, as the caller cannot recover
+    }
+    return (int32_t)sent;
+}
+
+#if defined(_LINUX)
+
+// Send multiple UDP datagrams of equal size with a single sendmsg, using UDP generic segmentation offload (UDP_SEGMENT)
+// The kernel or the network interface splits the buffers into datagrams of segment_size bytes, the last one may be smaller
+// Datagram boundaries don't need to be buffer boundaries
+// Thread safe
+// buffers:      array of pointers to data buffers
+// count:        number of buffers
+// segment_size: size of each datagram
+// Returns total number of bytes sent, 0 on socket closed, -1 on error or -2 if UDP GSO is not supported by the kernel or the network interface
+int32_t socketSendToGso(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, uint16_t segment_size, const uint8_t *addr, uint16_t port) {
+
+    assert(socket != NULL);
+    SOCKET sock = socket->sock;
+    assert(sock != INVALID_SOCKET);
+
+    SOCKADDR_IN sa;
+    sa.sin_family = AF_INET;
+    memcpy(&sa.sin_addr.s_addr, addr, 4);
+    sa.sin_port = htons(port);
+
+    // Build iovec array on the stack - VLAs are acceptable here as count is limited by the transmit queue peek size
+    struct iovec iov[count];
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        iov[i].iov_base = (void *)buffers[i].buffer;
+        iov[i].iov_len = buffers[i].size;
+        total += buffers[i].size;
+    }
+
+    // Segment size as UDP_SEGMENT control message
+    union {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &sa;
+    msg.msg_namelen = sizeof(sa);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(uint16_t));
+
+    ssize_t n = sendmsg(sock, &msg, 0);
+    if (n < 0) {
+        int32_t err = socketGetLastError();
+        if (socketIsClosed(err)) {
+            DBG_PRINTF6("socketSendToGso: socket closed (errno=%d,%s)\n", err, socketGetErrorString(err));
+            return 0; // Transmit socket closed
+        }
+        // Kernel without UDP GSO, segment size larger than the path MTU, too many segments or no checksum offload on the network interface
+        if (err == EINVAL || err == EIO || err == ENOPROTOOPT || err == EOPNOTSUPP || err == EMSGSIZE) {
+            DBG_PRINTF4("socketSendToGso: UDP GSO not supported (errno=%d,%s)\n", err, socketGetErrorString(err));
+            return -2;
+        }
+        DBG_PRINTF_ERROR("socketSendToGso: sendmsg failed with errno=%d,%s!\n", err, socketGetErrorString(err));
+        return -1;
+    }
+    if (total != n) {
+        DBG_PRINTF_WARNING("socketSendToGso: partial send, sent %" PRIu32 " of %" PRIu32 " bytes\n", (uint32_t)n, total);
+        return -1;
+    }
+    return (int32_t)n;
+}
+
+// Enable zero copy transmit on a TCP socket (SO_ZEROCOPY, Linux 4.14)
+// Returns false, if not supported
+bool socketEnableZeroCopy(SOCKET_HANDLE socket) {
+
+    assert(socket != NULL);
+    SOCKET sock = socket->sock;
+    assert(sock != INVALID_SOCKET);
+
+    int one = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+        DBG_PRINTF4("socketEnableZeroCopy: SO_ZEROCOPY not supported (errno=%d,%s)\n", errno, socketGetErrorString(errno));
+        return false;
+    }
+    return true;
+}
+
+// Send multiple buffers on a TCP socket with MSG_ZEROCOPY, the kernel transmits directly from the buffers
+// The buffers must not be modified or freed, until their completion is notified with socketGetZeroCopyCompletion
+// Loops internally until all data is accepted by the kernel, each sendmsg call consumes one completion id, the first send on a socket has id 0
+// A sendmsg, which fails with ENOBUFS (socket option memory limit for pending notifications), is repeated without MSG_ZEROCOPY and consumes no id
+// Thread safe
+// calls: number of completion ids consumed
+// Returns total number of bytes sent, 0 on socket closed or -1 on error
+int32_t socketSendZeroCopyV(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, uint32_t *calls) {
+
+    assert(socket != NULL);
+    assert(calls != NULL);
+    SOCKET sock = socket->sock;
+    assert(sock != INVALID_SOCKET);
+
+    *calls = 0;
+
+    // Build iovec array on the stack - VLAs are acceptable here as count is limited by the transmit queue peek size
+    struct iovec iov[count];
+    for (uint16_t i = 0; i < count; i++) {
+        iov[i].iov_base = (void *)buffers[i].buffer;
+        iov[i].iov_len = buffers[i].size;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    // Loop on partial sends, see socketSendV
+    int32_t total = 0;
+    int flags = MSG_ZEROCOPY;
+    for (;;) {
+        ssize_t n = sendmsg(sock, &msg, flags);
+        if (n < 0) {
+            int32_t err = socketGetLastError();
+            if (err == ENOBUFS && flags != 0) {
+                flags = 0; // Copy this chunk
+                continue;
+            }
+            if (socketWouldBlock(err)) {
+                DBG_PRINT_ERROR("socketSendZeroCopyV: unexpected WBLOCK\n");
+                return -1; // Should never happen on a blocking socket
+            }
+            if (socketIsClosed(err)) {
+                DBG_PRINTF6("socketSendZeroCopyV: socket closed (errno=%d,%s)\n", err, socketGetErrorString(err));
+                return 0; // Transmit socket closed
+            }
+            DBG_PRINTF_ERROR("socketSendZeroCopyV: sendmsg failed with errno=%d,%s!\n", err, socketGetErrorString(err));
+            return -1;
+        }
+        if (flags != 0 && n > 0) {
+            (*calls)++;
+        }
+        flags = MSG_ZEROCOPY;
+        total += (int32_t)n;
+
+        // Advance the iovec past the bytes already sent
+        size_t remaining = (size_t)n;
+        while (msg.msg_iovlen > 0 && remaining >= msg.msg_iov[0].iov_len) {
+            remaining -= msg.msg_iov[0].iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen == 0)
+            break; // All data sent
+        // Adjust the first remaining iovec for the partial send
+        msg.msg_iov[0].iov_base = (uint8_t *)msg.msg_iov[0].iov_base + remaining;
+        msg.msg_iov[0].iov_len -= remaining;
+    }
+
+    return total;
+}
+
+// Get the next zero copy completion notification from the socket error queue
+// timeoutMs: maximum time to wait for a notification, 0 = don't wait
+// lo, hi: range of completed ids
+// copied: true, if the kernel copied the data instead (no zero copy support for the route or the network interface, e.g. loopback)
+// Returns 1 if a notification was received, 0 if there is none or -1 on error
+int32_t socketGetZeroCopyCompletion(SOCKET_HANDLE socket, uint32_t timeoutMs, uint32_t *lo, uint32_t *hi, bool *copied) {
+
+    assert(socket != NULL);
+    assert(lo != NULL && hi != NULL && copied != NULL);
+    SOCKET sock = socket->sock;
+    assert(sock != INVALID_SOCKET);
+
+    // Error queue notifications are signalled with POLLERR, which is always reported
+    if (timeoutMs > 0) {
+        struct pollfd pfd = {.fd = sock, .events = 0, .revents = 0};
+        if (poll(&pfd, 1, (int)timeoutMs) <= 0)
+            return 0;
+    }
+
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        int32_t err = socketGetLastError();
+        if (socketWouldBlock(err))
+            return 0;
+        DBG_PRINTF_ERROR("socketGetZeroCopyCompletion: recvmsg failed with errno=%d,%s!\n", err, socketGetErrorString(err));
+        return -1;
+    }
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+            struct sock_extended_err serr;
+            memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+            if (serr.ee_origin == SO_EE_ORIGIN_ZEROCOPY && serr.ee_errno == 0) {
+                *lo = serr.ee_info;
+                *hi = serr.ee_data;
+                *copied = (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+                return 1;
+            }
+        }
+    }
+    return 0; // Other error queue message, e.g. a timestamp
+}
+
+#endif // _LINUX
+
 // Send multiple buffers on a TCP socket
 // Using iovec for efficient scatter-gather I/O (POSIX: Linux, macOS, QNX)
 // Thread safe
@@ -1736,6 +2144,394 @@ bool socketGetSendTime(SOCKET_HANDLE socket, uint64_t *hw_time, uint64_t *sw_tim
 
 #endif
 
+/**************************************************************************/
+// io_uring socket I/O
+/**************************************************************************/
+
+#if defined(_LINUX) && defined(OPTION_ENABLE_IO_URING) && (defined(OPTION_ENABLE_TCP) || defined(OPTION_ENABLE_UDP)) && !defined(OPTION_DISABLE_VECTORED_IO)
+
+// Minimal io_uring implementation based on the raw system calls, does not need liburing
+// Requires Linux 5.7 (single mmap, fast poll of sockets)
+
+#include <linux/io_uring.h> // for io_uring_params, io_uring_sqe, io_uring_cqe, IORING_xxx
+#include <poll.h>           // for poll
+#include <sys/syscall.h>    // for __NR_io_uring_setup, __NR_io_uring_enter
+
+#define IO_URING_SEND_TAG 0x10000ULL // user_data of send operations, receive operations use their slot number
+#define IO_URING_CANCEL_TAG 0x20000ULL
+#define IO_URING_CLOSE_TIMEOUT_MS 100
+
+// Receive operation state, must be stable until the operation completed
+typedef struct {
+    struct msghdr msg;
+    struct iovec iov;
+    SOCKADDR_IN src;
+    bool pending;
+} tIoUringRecv;
+
+struct ioUring {
+    int fd;
+    uint32_t entries;
+
+    // Submission queue ring
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t sq_mask;
+    uint32_t *sq_array;
+    struct io_uring_sqe *sqes;
+    uint32_t sq_unsubmitted; // Prepared and not submitted entries
+
+    // Completion queue ring
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t cq_mask;
+    struct io_uring_cqe *cqes;
+
+    // Memory mappings
+    void *ring_ptr;
+    size_t ring_size;
+    size_t sqes_size;
+
+    tIoUringRecv recv[IO_URING_RECV_SLOTS];
+};
+
+static int ioUringEnter(IO_URING_HANDLE ring, uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+    int r;
+    do {
+        r = (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, NULL, 0);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
+
+// Get a free submission queue entry, NULL if the submission queue is full
+static struct io_uring_sqe *ioUringGetSqe(IO_URING_HANDLE ring) {
+    uint32_t tail = *ring->sq_tail; // Single producer
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->entries)
+        return NULL;
+    uint32_t index = tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->sq_unsubmitted++;
+    return sqe;
+}
+
+// Submit all prepared entries without waiting
+static bool ioUringSubmit(IO_URING_HANDLE ring) {
+    while (ring->sq_unsubmitted > 0) {
+        int r = ioUringEnter(ring, ring->sq_unsubmitted, 0, 0);
+        if (r < 0) {
+            DBG_PRINTF_ERROR("ioUringSubmit: io_uring_enter failed (errno=%d,%s)!\n", errno, strerror(errno));
+            return false;
+        }
+        ring->sq_unsubmitted -= (uint32_t)r;
+    }
+    return true;
+}
+
+// Get the next completion, NULL if there is none
+static struct io_uring_cqe *ioUringPeekCqe(IO_URING_HANDLE ring) {
+    uint32_t head = *ring->cq_head; // Single consumer
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        return NULL;
+    return &ring->cqes[head & ring->cq_mask];
+}
+
+static void ioUringSeenCqe(IO_URING_HANDLE ring) { __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE); }
+
+// Wait until a completion is available
+// poll is a cancellation point, like the blocking socket calls
+// Returns false on timeout
+static bool ioUringWaitCqe(IO_URING_HANDLE ring, int timeoutMs) {
+    while (ioUringPeekCqe(ring) == NULL) {
+        struct pollfd pfd = {.fd = ring->fd, .events = POLLIN, .revents = 0};
+        int r = poll(&pfd, 1, timeoutMs);
+        if (r == 0)
+            return false;
+        if (r < 0 && errno != EINTR) {
+            DBG_PRINTF_ERROR("ioUringWaitCqe: poll failed (errno=%d,%s)!\n", errno, strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+IO_URING_HANDLE ioUringInit(uint32_t entries) {
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) {
+        DBG_PRINTF4("ioUringInit: io_uring not available (errno=%d,%s)\n", errno, strerror(errno));
+        return NULL;
+    }
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP) || !(p.features & IORING_FEAT_FAST_POLL)) {
+        DBG_PRINTF4("ioUringInit: io_uring features 0x%X not sufficient\n", p.features);
+        close(fd);
+        return NULL;
+    }
+
+    IO_URING_HANDLE ring = (IO_URING_HANDLE)malloc(sizeof(struct ioUring));
+    if (ring == NULL) {
+        close(fd);
+        return NULL;
+    }
+    memset(ring, 0, sizeof(struct ioUring));
+    ring->fd = fd;
+    ring->entries = p.sq_entries;
+
+    // Submission and completion queue rings share one mapping
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    ring->ring_ptr = mmap(NULL, ring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->ring_ptr == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        DBG_PRINTF_ERROR("ioUringInit: mmap failed (errno=%d,%s)!\n", errno, strerror(errno));
+        if (ring->ring_ptr != MAP_FAILED)
+            munmap(ring->ring_ptr, ring->ring_size);
+        if (ring->sqes != MAP_FAILED)
+            munmap(ring->sqes, ring->sqes_size);
+        close(fd);
+        free(ring);
+        return NULL;
+    }
+
+    uint8_t *r = (uint8_t *)ring->ring_ptr;
+    ring->sq_head = (uint32_t *)(r + p.sq_off.head);
+    ring->sq_tail = (uint32_t *)(r + p.sq_off.tail);
+    ring->sq_mask = *(uint32_t *)(r + p.sq_off.ring_mask);
+    ring->sq_array = (uint32_t *)(r + p.sq_off.array);
+    ring->cq_head = (uint32_t *)(r + p.cq_off.head);
+    ring->cq_tail = (uint32_t *)(r + p.cq_off.tail);
+    ring->cq_mask = *(uint32_t *)(r + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(r + p.cq_off.cqes);
+
+    DBG_PRINTF4("ioUringInit: io_uring with %u entries created\n", ring->entries);
+    return ring;
+}
+
+void ioUringClose(IO_URING_HANDLE *ringp) {
+
+    assert(ringp != NULL);
+    IO_URING_HANDLE ring = *ringp;
+    if (ring == NULL)
+        return;
+
+    // Cancel pending receives and wait for their completion, the kernel writes the source address into the receive state
+    uint32_t pending = 0;
+    for (uint8_t slot = 0; slot < IO_URING_RECV_SLOTS; slot++) {
+        if (ring->recv[slot].pending) {
+            struct io_uring_sqe *sqe = ioUringGetSqe(ring);
+            if (sqe == NULL)
+                break;
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = slot;
+            sqe->user_data = IO_URING_CANCEL_TAG;
+            pending++;
+        }
+    }
+    if (pending > 0 && ioUringSubmit(ring)) {
+        while (pending > 0 && ioUringWaitCqe(ring, IO_URING_CLOSE_TIMEOUT_MS)) {
+            struct io_uring_cqe *cqe = ioUringPeekCqe(ring);
+            if (cqe->user_data < IO_URING_RECV_SLOTS && ring->recv[cqe->user_data].pending) {
+                ring->recv[cqe->user_data].pending = false;
+                pending--;
+            }
+            ioUringSeenCqe(ring);
+        }
+    }
+
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->ring_ptr, ring->ring_size);
+    close(ring->fd);
+    free(ring);
+    *ringp = NULL;
+}
+
+// Send the remaining bytes of a TCP segment after a partial or cancelled io_uring send
+static int32_t ioUringSendRemainder(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, uint32_t offset) {
+    uint16_t i = 0;
+    while (i < count && offset >= buffers[i].size) {
+        offset -= buffers[i++].size;
+    }
+    if (i == count)
+        return 0;
+    tQueueBuffer remainder[count - i];
+    memcpy(remainder, &buffers[i], sizeof(remainder));
+    remainder[0].buffer += offset;
+    remainder[0].size = (uint16_t)(remainder[0].size - offset);
+    return socketSendV(socket, remainder, (uint16_t)(count - i));
+}
+
+int32_t ioUringSendMV(IO_URING_HANDLE ring, SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, const uint16_t segment_end[], uint16_t segments, const uint8_t *addr,
+                      uint16_t port) {
+
+    assert(ring != NULL);
+    assert(socket != NULL);
+    assert(segments > 0 && segment_end[segments - 1] == count);
+    assert(segments <= ring->entries);
+    SOCKET sock = socket->sock;
+    assert(sock != INVALID_SOCKET);
+    bool tcp = (socket->flags & SOCKET_MODE_TCP) != 0;
+
+    SOCKADDR_IN sa;
+    memset(&sa, 0, sizeof(sa));
+    if (!tcp) {
+        sa.sin_family = AF_INET;
+        memcpy(&sa.sin_addr.s_addr, addr, 4);
+        sa.sin_port = htons(port);
+    }
+
+    // Build iovec and message arrays on the stack - VLAs are acceptable here as count and segments are limited by the transmit queue peek size
+    // They must be stable until all sends are completed
+    struct iovec iov[count];
+    for (uint16_t i = 0; i < count; i++) {
+        iov[i].iov_base = (void *)buffers[i].buffer;
+        iov[i].iov_len = buffers[i].size;
+    }
+    struct msghdr msgs[segments];
+    uint32_t length[segments];
+    memset(msgs, 0, sizeof(msgs));
+    for (uint16_t s = 0, i = 0; s < segments; i = segment_end[s++]) {
+        if (!tcp) {
+            msgs[s].msg_name = &sa;
+            msgs[s].msg_namelen = sizeof(sa);
+        }
+        msgs[s].msg_iov = &iov[i];
+        msgs[s].msg_iovlen = (size_t)(segment_end[s] - i);
+        length[s] = 0;
+        for (uint16_t j = i; j < segment_end[s]; j++) {
+            length[s] += buffers[j].size;
+        }
+
+        struct io_uring_sqe *sqe = ioUringGetSqe(ring);
+        assert(sqe != NULL); // All previous operations are completed
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = sock;
+        sqe->addr = (uint64_t)(uintptr_t)&msgs[s];
+        sqe->len = 1;
+        sqe->user_data = IO_URING_SEND_TAG + s;
+        if (tcp) {
+            sqe->msg_flags = MSG_WAITALL; // Retry partial sends (Linux 5.18)
+            if (s + 1 < segments)
+                sqe->flags = IOSQE_IO_LINK; // Keep the order of the TCP stream segments
+        }
+    }
+
+    // Submit all sends with a single system call and wait for their completion
+    if (!ioUringSubmit(ring))
+        return -1;
+    int32_t result[segments];
+    for (uint16_t s = 0; s < segments; s++) {
+        result[s] = INT32_MIN;
+    }
+    for (uint16_t n = 0; n < segments; n++) {
+        if (!ioUringWaitCqe(ring, -1))
+            return -1;
+        struct io_uring_cqe *cqe = ioUringPeekCqe(ring);
+        assert(cqe != NULL && cqe->user_data >= IO_URING_SEND_TAG && cqe->user_data < IO_URING_SEND_TAG + segments);
+        result[cqe->user_data - IO_URING_SEND_TAG] = cqe->res;
+        ioUringSeenCqe(ring);
+    }
+
+    uint32_t sent = 0;
+    for (uint16_t s = 0, i = 0; s < segments; i = segment_end[s++]) {
+        int32_t r = result[s];
+        if (r < 0 && !(tcp && r == -ECANCELED)) {
+            int32_t err = -r;
+            if (socketIsClosed(err)) {
+                DBG_PRINTF6("ioUringSendMV: socket closed (errno=%d,%s)\n", err, socketGetErrorString(err));
+                return 0; // Transmit socket closed
+            }
+            DBG_PRINTF_ERROR("ioUringSendMV: sendmsg failed with errno=%d,%s!\n", err, socketGetErrorString(err));
+            return -1;
+        }
+        if (r >= 0 && (uint32_t)r == length[s]) {
+            sent += length[s];
+            continue;
+        }
+        if (!tcp) {
+            DBG_PRINTF_WARNING("ioUringSendMV: partial send, sent %d of %" PRIu32 " bytes\n", r, length[s]);
+            return -1; // Treat partial sends as an error on UDP sockets, as the caller cannot recover
+        }
+        // TCP partial send breaks the link, the following segments are cancelled, send the rest of the stream blocking
+        int32_t n = ioUringSendRemainder(socket, &buffers[i], (uint16_t)(segment_end[s] - i), r > 0 ? (uint32_t)r : 0);
+        if (n <= 0)
+            return n;
+        sent += length[s];
+    }
+    return (int32_t)sent;
+}
+
+bool ioUringRecvFrom(IO_URING_HANDLE ring, uint8_t slot, SOCKET_HANDLE socket, uint8_t *buffer, uint16_t bufferSize) {
+
+    assert(ring != NULL);
+    assert(socket != NULL);
+    assert(slot < IO_URING_RECV_SLOTS);
+    tIoUringRecv *recv = &ring->recv[slot];
+    assert(!recv->pending);
+
+    struct io_uring_sqe *sqe = ioUringGetSqe(ring);
+    if (sqe == NULL)
+        return false;
+    memset(&recv->msg, 0, sizeof(recv->msg));
+    memset(&recv->src, 0, sizeof(recv->src));
+    recv->iov.iov_base = buffer;
+    recv->iov.iov_len = bufferSize;
+    recv->msg.msg_name = &recv->src;
+    recv->msg.msg_namelen = sizeof(recv->src);
+    recv->msg.msg_iov = &recv->iov;
+    recv->msg.msg_iovlen = 1;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = socket->sock;
+    sqe->addr = (uint64_t)(uintptr_t)&recv->msg;
+    sqe->len = 1;
+    sqe->user_data = slot;
+    recv->pending = true;
+    return true;
+}
+
+int16_t ioUringWaitRecv(IO_URING_HANDLE ring, uint32_t timeoutMs, uint8_t *slot, uint8_t *srcAddr, uint16_t *srcPort) {
+
+    assert(ring != NULL);
+    assert(slot != NULL);
+    *slot = IO_URING_RECV_SLOTS;
+
+    // Submit the receives prepared by ioUringRecvFrom
+    if (!ioUringSubmit(ring))
+        return -1;
+
+    // Wait for the next completed receive
+    if (!ioUringWaitCqe(ring, (int)timeoutMs))
+        return 0; // Timeout
+    struct io_uring_cqe *cqe = ioUringPeekCqe(ring);
+    int32_t r = cqe->res;
+    uint64_t tag = cqe->user_data;
+    ioUringSeenCqe(ring);
+    if (tag >= IO_URING_RECV_SLOTS)
+        return 0; // Not a receive completion, caller loops
+    tIoUringRecv *recv = &ring->recv[tag];
+    recv->pending = false;
+    *slot = (uint8_t)tag;
+
+    if (r < 0) {
+        errno = -r;
+        DBG_PRINTF_ERROR("ioUringWaitRecv: recvmsg failed (errno=%d,%s)!\n", -r, socketGetErrorString(-r));
+        return -1;
+    }
+    if (srcPort != NULL)
+        *srcPort = htons(recv->src.sin_port);
+    if (srcAddr != NULL)
+        memcpy(srcAddr, &recv->src.sin_addr.s_addr, 4);
+    return (int16_t)r;
+}
+
+#endif // _LINUX && OPTION_ENABLE_IO_URING
+
 /**************************************************************************/
 // Clock
 /**************************************************************************/
@@ -199,12 +199,37 @@ void sleepUs(uint32_t us);
 // Delay - Less precise and less CPU load, not based on XCP clock, time domain different
 void sleepMs(uint32_t ms);
 
+//-------------------------------------------------------------------------------
+// Wait on address (Linux futex)
+
+#if defined(_LINUX)
+
+// Block while the 32 bit value at addr is equal to expected, until woken up with platformWakeOnAddress or timeout
+// Works across processes for values in shared memory
+// Returns false on timeout
+bool platformWaitOnAddress(atomic_uint_least32_t *addr, uint32_t expected, uint32_t timeout_us);
+
+// Wake up all threads blocked in platformWaitOnAddress on addr
+void platformWakeOnAddress(atomic_uint_least32_t *addr);
+
+#endif
+
 //-------------------------------------------------------------------------------
 // Memory mapping (platform abstraction)
 
 void *platformMemAlloc(size_t size);
 void platformMemFree(void *ptr, size_t size);
 
+// Allocate memory backed by 2 MiB huge pages (Linux MAP_HUGETLB), pre-faulted
+// Falls back to normal pages with transparent huge pages advised, if no huge pages are reserved (/proc/sys/vm/nr_hugepages)
+// The size is rounded up to the huge page size and returned in *size, free with platformMemFree(ptr, *size)
+void *platformMemAllocHuge(size_t *size);
+
+// Pre-fault and lock memory in RAM, to avoid page faults and swapping at runtime
+// Advises transparent huge pages for shared memory mappings
+// Returns false, if the memory could not be locked (RLIMIT_MEMLOCK), this is not fatal
+bool platformMemLock(void *ptr, size_t size);
+
 #if !defined(_WIN) // POSIX shared memory — not available on Windows
 
 // Open or create a named POSIX shared-memory region of `size` bytes.
@@ -481,12 +506,80 @@ int16_t socketSend(SOCKET_HANDLE socket, const uint8_t *buffer, uint16_t bufferS
 // Returns: total bytes sent, 0 on closed socket, -1 on error (partial UDP sends treated as error)
 int16_t socketSendToV(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, const uint8_t *addr, uint16_t port);
 
+// Send multiple UDP datagrams, each composed of multiple buffers (sendmmsg on Linux, one sendmsg per datagram on other POSIX platforms)
+// segment_end: buffer index after the last buffer of each datagram
+// Returns: total bytes sent, 0 on closed socket, -1 on error (partial UDP sends treated as error)
+int32_t socketSendToMV(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, const uint16_t segment_end[], uint16_t segments, const uint8_t *addr, uint16_t port);
+
+#if defined(_LINUX)
+// Send multiple UDP datagrams of equal size with a single sendmsg, using UDP generic segmentation offload (UDP_SEGMENT, Linux only)
+// segment_size: size of each datagram, the last one may be smaller, datagram boundaries don't need to be buffer boundaries
+// Returns: total bytes sent, 0 on closed socket, -1 on error, -2 if UDP GSO is not supported by the kernel or the network interface
+int32_t socketSendToGso(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, uint16_t segment_size, const uint8_t *addr, uint16_t port);
+
+// Enable zero copy transmit on a TCP socket (SO_ZEROCOPY, Linux only)
+// Returns false, if not supported
+bool socketEnableZeroCopy(SOCKET_HANDLE socket);
+
+// Send multiple buffers on a TCP socket with MSG_ZEROCOPY (Linux only), loops internally until all data is accepted by the kernel
+// The buffers must not be modified or freed, until their completion is notified by socketGetZeroCopyCompletion
+// calls: set to the number of completion ids consumed, ids are counted per socket starting with 0
+// Returns: total bytes sent, 0 on closed socket, -1 on error
+int32_t socketSendZeroCopyV(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, uint32_t *calls);
+
+// Get the next zero copy completion notification from the socket error queue (Linux only)
+// timeoutMs: maximum time to wait for a notification, 0 = don't wait
+// lo / hi: range of completed ids
+// copied: set to true, if the kernel copied the data, zero copy is not supported for the route or the network interface (e.g. loopback)
+// Returns: 1 if a notification was received, 0 if there is none, -1 on error
+int32_t socketGetZeroCopyCompletion(SOCKET_HANDLE socket, uint32_t timeoutMs, uint32_t *lo, uint32_t *hi, bool *copied);
+#endif
+
 // Send multiple buffers on a TCP socket (scatter-gather I/O via sendmsg, POSIX only)
 // Loops internally until all data is accepted by the kernel
 // Returns: total bytes sent, 0 on closed socket, -1 on error
 int16_t socketSendV(SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count);
 #endif
 
+#if defined(_LINUX) && defined(OPTION_ENABLE_IO_URING) && !defined(OPTION_DISABLE_VECTORED_IO)
+// io_uring socket I/O (Linux only)
+// Submits multiple socket operations and reaps their completions with a minimum number of system calls
+// An io_uring instance must be used by a single thread only
+
+typedef struct ioUring *IO_URING_HANDLE;
+#define INVALID_IO_URING_HANDLE NULL
+#define IO_URING_RECV_SLOTS 4 // Maximum number of pending receives
+
+// Create an io_uring instance with the given number of submission queue entries
+// Returns INVALID_IO_URING_HANDLE, if io_uring is not available (kernel too old, disabled by sysctl kernel.io_uring_disabled or seccomp), use the socket functions instead
+IO_URING_HANDLE ioUringInit(uint32_t entries);
+
+// Cancel pending receives, destroy the io_uring instance and set *ringp to NULL
+void ioUringClose(IO_URING_HANDLE *ringp);
+
+// Send multiple UDP datagrams or TCP stream segments, each composed of multiple buffers, with a single system call
+// segment_end: buffer index after the last buffer of each datagram or segment, segments must not exceed the number of io_uring entries
+// TCP segments are linked to keep their order, addr and port are ignored
+// Blocks until all sends are completed
+// Returns: total bytes sent, 0 on closed socket, -1 on error (partial UDP sends treated as error)
+int32_t ioUringSendMV(IO_URING_HANDLE ring, SOCKET_HANDLE socket, tQueueBuffer buffers[], uint16_t count, const uint16_t segment_end[], uint16_t segments, const uint8_t *addr,
+                      uint16_t port);
+
+// Prepare the asynchronous receive of a UDP datagram into buffer, submitted with the next ioUringWaitRecv
+// slot: identifies the receive (0..IO_URING_RECV_SLOTS-1), must not be pending
+// buffer must stay valid until the receive is completed
+// Returns true on success
+bool ioUringRecvFrom(IO_URING_HANDLE ring, uint8_t slot, SOCKET_HANDLE socket, uint8_t *buffer, uint16_t bufferSize);
+
+// Submit prepared receives and wait for the next completed receive
+// slot: set to the slot of the completed receive, which may be prepared again, or IO_URING_RECV_SLOTS on timeout
+// srcAddr / srcPort: filled with sender's address/port if non-NULL
+// Return values:  > 0  bytes received
+//                == 0  timeout — no data yet, do background work and loop
+//                 < 0  error
+int16_t ioUringWaitRecv(IO_URING_HANDLE ring, uint32_t timeoutMs, uint8_t *slot, uint8_t *srcAddr, uint16_t *srcPort);
+#endif
+
 // Retrieve TX hardware and/or software timestamp after socketSendTo (Linux only)
 // Must be called shortly after socketSendTo returned *time==0
 // Requires OPTION_SOCKET_HW_TIMESTAMPS and socketEnableTimestamps() to have been called
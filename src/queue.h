@@ -8,10 +8,10 @@
 | Description:
 |   Generic queue API
 |   There are 4 different implementations of the queue API, which are selected based on platform and configuration:
-|       queue64v.c  - Generic, lockless, variable entry size
+|       queue64v.c  - Generic, lockless, variable entry size, optional per thread producer lanes
 |       queue64f.c  - Generic, lockless, fixed entry size
 |       queue64.c   - XCP specific, lockless, variable entry size with optional message accumulation (deprecated)
-|       queue32.c   - XCP specific, mutex based, variable entry size with message accumulation (fallback for 32-bit platforms and Windows)
+|       queue32.c   - XCP specific, lockless with 32 bit atomics, variable entry size with message accumulation (fallback for 32-bit platforms and Windows)
 |
 |   Note:
 |     The 2 generic queue implementations are not specific for the XCP on Ethernet transport layer
@@ -38,8 +38,14 @@
 #define QUEUE_ENTRY_USER_PAYLOAD_SIZE (XCPTL_MAX_DTO_SIZE)
 #define QUEUE_ENTRY_USER_SIZE (XCPTL_MAX_DTO_SIZE + XCPTL_TRANSPORT_LAYER_HEADER_SIZE)
 #define QUEUE_SEGMENT_SIZE (XCPTL_MAX_SEGMENT_SIZE) // for accumulating multiple messages in one segment with queuePop
+#if defined(OPTION_QUEUE_64_VAR_SIZE) && defined(OPTION_QUEUE_64_VAR_SIZE_LARGE_ENTRIES)
+#define QUEUE_ENABLE_LARGE_ENTRIES
+#define QUEUE_MAX_ENTRY_SIZE (XCPTL_MAX_SEGMENT_SIZE) // Large entries with multiple messages up to the segment size (queue64v)
+#else
 #define QUEUE_MAX_ENTRY_SIZE (XCPTL_MAX_DTO_SIZE + XCPTL_TRANSPORT_LAYER_HEADER_SIZE)
+#endif
 #define QUEUE_PAYLOAD_SIZE_ALIGNMENT (XCPTL_PACKET_ALIGNMENT)
+#define QUEUE_PEEK_MAX_COUNT 256 // Maximum number of entries which can be peeked ahead without releasing them (queue64v)
 
 // For generic uses case without optional header space reserved, use the following configuration:
 /*
@@ -54,11 +60,19 @@
 #if (QUEUE_MAX_ENTRY_SIZE % QUEUE_PAYLOAD_SIZE_ALIGNMENT) != 0
 #error "QUEUE_MAX_ENTRY_SIZE should be aligned to QUEUE_PAYLOAD_SIZE_ALIGNMENT"
 #endif
+#if defined(QUEUE_ENABLE_LARGE_ENTRIES) && (QUEUE_ENTRY_USER_HEADER_SIZE < 2)
+#error "Large queue entries require a user header to store the message size"
+#endif
 
 // Note:
 // On the producer side, a tQueueBuffer from queueAcquire don't include the user header space
 // On the consumer side, a tQueueBuffer from queuePeek includes the space for the user header
 
+// Large entries (queue64v with OPTION_QUEUE_64_VAR_SIZE_LARGE_ENTRIES):
+// A queue entry may contain multiple messages packed back to back, each with its own user header space, up to QUEUE_MAX_ENTRY_SIZE
+// The queue stores the payload size of each message in the first 16 bit of its user header, for single message entries as well
+// On the consumer side, a tQueueBuffer from queuePeek is a sequence of messages, use queueGetMessageSize to iterate
+
 // Buffer acquired from the queue with `queueAcquire` (producer) or from queuePeek` (consumer)
 typedef struct QueueBuffer {
 #if defined(PLATFORM_32BIT) || defined(_WIN) || defined(OPTION_ATOMIC_EMULATION) || (!defined(OPTION_QUEUE_64_FIX_SIZE) && !defined(OPTION_QUEUE_64_VAR_SIZE))
@@ -75,8 +89,16 @@ typedef struct Queue *tQueueHandle;
 /// Create new heap allocated queue.
 /// Free using `queueDeinit`.
 /// @param buffer_size          Queue buffer size in bytes. Does not include the queue header size.
+/// @return Queue handle or NULL, if the size is invalid (queue64v: each producer lane must fit 2 entries of maximum size) or out of memory.
 tQueueHandle queueInit(size_t queue_buffer_size);
 
+/// Create new heap allocated queue, optionally backed by huge pages.
+/// queueInit uses huge pages, if OPTION_QUEUE_HUGE_PAGES is defined.
+/// @param buffer_size          Queue buffer size in bytes. Does not include the queue header size.
+/// @param huge_pages           Allocate 2 MiB huge pages, pre-faulted and locked in RAM. Falls back to normal pages, if no huge pages are reserved.
+/// @return Queue handle or NULL, see queueInit.
+tQueueHandle queueInitEx(size_t queue_buffer_size, bool huge_pages);
+
 /// Creates a queue inside the user provided buffer.
 /// @precondition queue_buffer_size must at least fit the queue header and minimum payload size.
 /// This can be used to place the queue inside shared memory
@@ -84,26 +106,49 @@ tQueueHandle queueInit(size_t queue_buffer_size);
 /// @param queue_buffer_size    Buffer size including the queue header.
 /// @param clear_queue          Clear the queue memory or keep the passed buffer untouched.
 /// @param out out_buffer_size  Optional out parameter can be used to get the remaining buffer size.
-/// @return Queue handle.
+/// @return Queue handle or NULL, if the size is invalid or an already initialized queue does not match.
 tQueueHandle queueInitFromMemory(void *queue_memory, size_t queue_memory_size, bool clear_queue, uint64_t *out_buffer_size);
 
+/// Creates a queue inside the user provided buffer, optionally pre-faulted and locked in RAM.
+/// queueInitFromMemory locks the buffer, if OPTION_QUEUE_HUGE_PAGES is defined.
+/// @param huge_pages           Pre-fault and lock the buffer in RAM in this process and advise transparent huge pages, the caller allocates the buffer.
+/// @return Queue handle or NULL, see queueInitFromMemory.
+tQueueHandle queueInitFromMemoryEx(void *queue_memory, size_t queue_memory_size, bool clear_queue, uint64_t *out_buffer_size, bool huge_pages);
+
 /// Deinitialize queue.
 /// Does **not** free user allocated memory provided to `queueInitFromMemory`.
 /// Must not be called for queue handles created from already initialized queues
 /// @param queue_handle         Queue handle.
 void queueDeinit(tQueueHandle queue_handle);
 
+// Producer priority for queueAcquire and queueAcquireMulti
+#define QUEUE_PRIORITY_NORMAL 0x00 // Limited to the queue size minus the priority headroom
+#define QUEUE_PRIORITY_HIGH 0xFF   // May use the full queue size
+
+// Overflow policies, see queueSetOverflowPolicy
+// Both policies reserve headroom and drop the new entry on overflow, entries already in the queue are never evicted
+#define QUEUE_OVERFLOW_DROP_NEWEST 0          // Producers with priority > 0 may use the priority headroom, others overflow when the queue is full minus the headroom
+#define QUEUE_OVERFLOW_GRADED_HEADROOM 1 // The usable part of the priority headroom grows with the producer priority, lower priorities overflow first
+
+/// Set the overflow policy and the priority headroom.
+/// Not thread safe, should be called after initialization, before producers are active. Default is QUEUE_OVERFLOW_DROP_NEWEST without headroom.
+/// @param queue_handle         Queue handle.
+/// @param policy               QUEUE_OVERFLOW_DROP_NEWEST or QUEUE_OVERFLOW_GRADED_HEADROOM.
+/// @param headroom_percent     Part of the queue in percent, reserved for producers with priority > 0 (0..50).
+void queueSetOverflowPolicy(tQueueHandle queue_handle, uint8_t policy, uint8_t headroom_percent);
+
 /// Acquire a buffer and reserve space in the queue.
 /// The buffer can be written by the user, but can not be read by the consumer until it is committed with queuePush.
 /// @param queue_handle         Queue handle.
-/// @param payload_size         Requested buffer size.
+/// @param payload_size         Requested buffer size, maximum is QUEUE_MAX_ENTRY_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE.
+/// @param priority             Producer priority (QUEUE_PRIORITY_NORMAL..QUEUE_PRIORITY_HIGH), see queueSetOverflowPolicy.
 /// @return QueueBuffer
 /// NOTE:
 /// The QueueBuffer::size returned may exceed the requested size due to padding
 /// If QueueBuffer::size is 0, there is no space left in the queue - overflow
 /// QueueBuffer::size may be larger than the requested payload_size due to padding, but it will always be at least as large as the requested payload_size
 /// The full returned buffer size can be safely read and written by the user even if it exceeds the requested size.
-tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t payload_size);
+tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t payload_size, uint8_t priority);
 
 /// Commit an acquired buffer to the queue to indicate that the data written is complete and valid for the consumer.
 /// @param queue_handle         Queue handle.
@@ -112,6 +157,26 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t payload_size);
 /// @return Queue buffer.
 void queuePush(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer, bool priority);
 
+/// Acquire multiple buffers with a single reservation in the queue.
+/// Either all buffers are acquired or none of them (overflow), on overflow all buffers are accounted as packets lost.
+/// The buffers are consecutive in the queue and must be committed together with queuePushMulti.
+/// @param queue_handle         Queue handle.
+/// @param payload_sizes        Requested buffer sizes.
+/// @param count                Number of buffers requested.
+/// @param priority             Producer priority (QUEUE_PRIORITY_NORMAL..QUEUE_PRIORITY_HIGH), see queueSetOverflowPolicy.
+/// @param queue_buffers        Out parameter, array of count QueueBuffers, QueueBuffer::size may exceed the requested size due to padding.
+/// @return true if all buffers have been acquired, false on overflow.
+/// NOTE: With large entries (QUEUE_ENABLE_LARGE_ENTRIES), the buffers are packed into a single queue entry, if they fit into QUEUE_MAX_ENTRY_SIZE.
+bool queueAcquireMulti(tQueueHandle queue_handle, const uint16_t *payload_sizes, uint16_t count, uint8_t priority, tQueueBuffer *queue_buffers);
+
+/// Commit all buffers acquired with queueAcquireMulti.
+/// The consumer can not read any of the buffers, before all of them are committed.
+/// @param queue_handle         Queue handle.
+/// @param queue_buffers        Array of count queue buffers from queueAcquireMulti.
+/// @param count                Number of buffers.
+/// @param priority             Optional: Indicate producer priority for the last buffer, see queuePush.
+void queuePushMulti(tQueueHandle queue_handle, const tQueueBuffer *queue_buffers, uint16_t count, bool priority);
+
 /// Get a queue entry without removing it from the queue.
 /// Single consumer thread only, not thread safe.
 /// @param queue_handle         Queue handle.
@@ -122,8 +187,62 @@ void queuePush(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer, bool
 /// NOTE: The returned buffer must be released using `queueRelease` and in the same order as they were obtained (sequential index order).
 /// NOTE: The payload already includes header space for the XCP transport layer header (ctr+len) in the buffer, but the transport layer counter is not set yet!
 /// NOTE: The function may be called multiple times with the same index, but the entries obtained must be released in sequential index order.
+/// NOTE: With multiple producer lanes (queue64v), entries are ordered FIFO per producer thread only. Index is limited to QUEUE_PEEK_MAX_COUNT.
 tQueueBuffer queuePeek(tQueueHandle queue_handle, uint32_t index, uint32_t *packets_lost, bool *flush_requested);
 
+#ifndef OPTION_QUEUE_32
+/// Get multiple queue entries without removing them from the queue, with a single scan of the queue.
+/// Single consumer thread only, not thread safe.
+/// Same as calling queuePeek with index, index+1, ... until max_bytes or max_count is reached, there are no more committed entries or a flush is requested.
+/// The entry which does not fit into max_bytes anymore stays peeked and is returned again with the next call.
+/// @param queue_handle         Queue handle.
+/// @param index                Peek ahead index of the first entry, the number of entries already obtained and not yet released.
+/// @param max_bytes            Maximum sum of the buffer sizes.
+/// @param queue_buffers        Out parameter, array of max_count queue buffers, ready for vectored io.
+/// @param max_count            Maximum number of buffers.
+/// @param packets_lost         Optional out parameter to get the number of packets lost since the last call.
+/// @param flush_requested      Optional out parameter to indicate if a flush was requested on the last buffer returned.
+/// @return Number of buffers returned.
+/// NOTE: The returned buffers must be released using `queueReleaseBatch` or `queueRelease` in sequential index order.
+uint32_t queuePeekBatch(tQueueHandle queue_handle, uint32_t index, uint32_t max_bytes, tQueueBuffer *queue_buffers, uint32_t max_count, uint32_t *packets_lost,
+                        bool *flush_requested);
+
+/// Release multiple buffers from `queuePeek` or `queuePeekBatch` in sequential index order, with a single tail update.
+/// Single consumer thread only, not thread safe.
+/// @param queue_handle         Queue handle.
+/// @param queue_buffers        Array of count queue buffers to release, starting with the oldest peeked entry.
+/// @param count                Number of buffers.
+void queueReleaseBatch(tQueueHandle queue_handle, const tQueueBuffer *queue_buffers, uint32_t count);
+
+// Number of dead producers remembered by a queue, see queueReclaimProducer
+#define QUEUE_DEAD_PRODUCER_COUNT 8
+
+/// Register the calling process as producer of a queue in shared memory.
+/// Allocates a new producer tag, which is recorded in all entries reserved by this process in this queue, until they are committed.
+/// Not required for queues used by a single process, entries of unregistered producers have tag 0 and are never reclaimed.
+/// The tag is kept per process and queue, a process can be registered to 4 queues.
+/// @param queue_handle         Queue handle.
+/// @return Producer tag of this process (1..0x7FFF), unique for each registration of the queue, until the tag counter wraps around. A reissued tag is removed from the dead producers.
+uint16_t queueRegisterProducer(tQueueHandle queue_handle);
+
+/// Reclaim the entries of a dead producer process.
+/// Entries reserved and never committed by this producer are skipped by the consumer, instead of blocking it forever.
+/// Only call this, when the process is known to be terminated. A dead producer, which crashed after advancing the head but before writing its entry header,
+/// can not be detected and still blocks the queue.
+/// Thread safe, the last QUEUE_DEAD_PRODUCER_COUNT dead producers are remembered.
+/// @param queue_handle         Queue handle.
+/// @param producer_tag         Tag of the dead producer from `queueRegisterProducer`.
+void queueReclaimProducer(tQueueHandle queue_handle, uint16_t producer_tag);
+#endif
+
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+/// Get the payload size of a message in a buffer from queuePeek.
+/// The next message in the buffer starts at message + QUEUE_ENTRY_USER_HEADER_SIZE + size.
+/// @param message              Pointer to the user header of the message, the first message starts at tQueueBuffer::buffer.
+/// @return Payload size of the message, without user header.
+static inline uint16_t queueGetMessageSize(const uint8_t *message) { return *(const uint16_t *)message; }
+#endif
+
 /// Get the next entry or multiple accumulated entries from the queue.
 /// Single consumer thread only, not thread safe.
 /// @param queue_handle         Queue handle.
@@ -137,6 +256,23 @@ tQueueBuffer queuePeek(tQueueHandle queue_handle, uint32_t index, uint32_t *pack
 tQueueBuffer queuePop(tQueueHandle queue_handle, bool accumulate, bool priority, uint32_t *packets_lost);
 #endif
 
+/// Wait until new committed data may be available.
+/// Single consumer thread only, not thread safe.
+/// With notification support (queue64v with OPTION_QUEUE_NOTIFY), the consumer blocks until a producer commits an entry with priority,
+/// the queue level exceeds the notification level (OPTION_QUEUE_NOTIFY_LEVEL) or the timeout expires.
+/// It returns immediately, if there are committed entries not peeked yet.
+/// Without notification support, it sleeps up to 1ms, with OPTION_QUEUE_NOTIFY queueNotify ends the sleep early.
+/// @param queue_handle         Queue handle.
+/// @param timeout_us           Maximum time to wait in microseconds.
+/// @return false on timeout, true if new data may be available.
+bool queueWait(tQueueHandle queue_handle, uint32_t timeout_us);
+
+/// Wake up the consumer, if it is blocked in queueWait, otherwise the next queueWait returns immediately.
+/// Thread safe, used to signal data outside of the queue to the consumer thread.
+/// Supported by all queue variants with OPTION_QUEUE_NOTIFY, without it the consumer polls and this has no effect.
+/// @param queue_handle         Queue handle.
+void queueNotify(tQueueHandle queue_handle);
+
 /// Release a buffer from `queuePeek` or `queuePop`.
 /// Single consumer thread only, not thread safe.
 /// This is required to notify the queue that it can reuse memory and it will end the lifetime of the buffer obtained from `queuePeek` or `queuePop`.
@@ -154,3 +290,41 @@ uint32_t queueLevel(tQueueHandle queue_handle, uint32_t *queue_max_level);
 /// Clear queue content.
 /// @param queue_handle         Queue handle.
 void queueClear(tQueueHandle queue_handle);
+
+/// Queue runtime statistics.
+/// Levels are in the same unit as `queueLevel` (implementation specific bytes or entries).
+/// Latencies are sampled (every QUEUE_STATS_SAMPLE_RATE-th operation of a thread), percentiles are upper bounds of logarithmic histogram bins in ns.
+/// Latencies require OPTION_QUEUE_STATISTICS and a queue created with queueInit, they are 0 otherwise.
+typedef struct QueueStatistics {
+    uint32_t queue_size;          // Maximum level, see queueLevel
+    uint32_t level;               // Current level, see queueLevel
+    uint32_t level_max;           // High water mark of the level seen by the producers (queue64v with producer lanes: level of the producers lane)
+    uint32_t producer_count;      // Number of producer threads which used the queue
+    uint64_t acquire_count;       // Number of buffers acquired
+    uint64_t acquire_retries;     // Number of acquire retries caused by producer contention (CAS retries)
+    uint32_t acquire_retries_max; // Maximum number of retries of a single acquire
+    uint32_t overflow_bursts;     // Number of overflow bursts, a burst is a sequence of failed acquires of a producer
+    uint64_t packets_lost;        // Number of buffers lost because of overflow
+    uint32_t acquire_time_p50;    // Median acquire latency in ns
+    uint32_t acquire_time_p99;    // 99th percentile of the acquire latency in ns
+    uint32_t acquire_time_max;    // Maximum sampled acquire latency in ns
+    uint32_t peek_time_p50;       // Median consumer peek latency in ns
+    uint32_t peek_time_p99;       // 99th percentile of the consumer peek latency in ns
+    uint32_t peek_time_max;       // Maximum sampled consumer peek latency in ns
+    uint64_t peek_count;          // Number of buffers obtained by the consumer
+    uint64_t wait_count;          // Number of times the consumer waited for new data
+} tQueueStatistics;
+
+#define QUEUE_STATISTICS_ALL_PRODUCERS 0xFFFFFFFF
+
+/// Get the queue runtime statistics.
+/// Thread safe, the per producer thread counters are aggregated on read, the result is not an atomic snapshot.
+/// @param queue_handle         Queue handle.
+/// @param producer             Index of the producer thread (in order of its first acquire) or QUEUE_STATISTICS_ALL_PRODUCERS for the aggregated statistics.
+/// @param statistics           Out parameter.
+/// @return false, if there is no producer with this index. Producers beyond QUEUE_STATS_PRODUCER_COUNT-1 share the last statistics slot.
+bool queueGetStatistics(tQueueHandle queue_handle, uint32_t producer, tQueueStatistics *statistics);
+
+/// Reset the queue runtime statistics.
+/// @param queue_handle         Queue handle.
+void queueResetStatistics(tQueueHandle queue_handle);
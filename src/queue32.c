@@ -21,6 +21,7 @@
 #if defined(OPTION_QUEUE_32) || defined(PLATFORM_32BIT) || defined(_WIN) || defined(OPTION_ATOMIC_EMULATION)
 
 #include "queue.h"
+#include "queue_stats.h"
 
 #include <assert.h>   // for assert
 #include <inttypes.h> // for PRIu64
@@ -62,68 +63,179 @@ typedef struct {
 
 static_assert(sizeof(tXcpMessage) == XCPTL_TRANSPORT_LAYER_HEADER_SIZE, "tXcpMessage size must be equal to XCPTL_TRANSPORT_LAYER_HEADER_SIZE");
 
+/*
+
+Lockless segment queue:
+
+    The queue is a ring of segment buffers, the number of segments is a power of 2
+    head is the sequence number of the segment currently filled by the producers, tail is the sequence number of the oldest segment not released by the consumer
+    head and tail are 32 bit sequence numbers, the segment index is seq % queue_size, head - tail + 1 is the number of segments in use
+
+    Producers reserve space for messages in the head segment with a CAS on the segment state, which contains
+    the number of bytes reserved, the number of uncommitted messages, a closed flag and the epoch (upper bits of the sequence number) of the segment
+    A producer commits a message by decrementing the uncommitted count
+    The producer or consumer which closes the head segment opens the next segment by incrementing head, other producers retry until head has been incremented
+    The epoch detects producers which reserve with an outdated head, after the segment has been recycled
+    The consumer pops the tail segment, when it is closed and completely committed and resets the segment state for its next use
+
+*/
+
+#define SEGMENT_SIZE_MASK 0x00003FFFu       // Number of bytes reserved in the segment
+#define SEGMENT_UNCOMMITTED_ONE 0x00004000u // Number of uncommitted messages in the segment
+#define SEGMENT_UNCOMMITTED_MASK 0x01FFC000u
+#define SEGMENT_CLOSED 0x02000000u // Segment is closed, no more messages can be reserved
+#define SEGMENT_EPOCH_SHIFT 26     // Lower 6 bits of seq / queue_size
+#define SEGMENT_EPOCH_MASK 0xFC000000u
+
+static_assert(XCPTL_MAX_SEGMENT_SIZE <= SEGMENT_SIZE_MASK, "XCPTL_MAX_SEGMENT_SIZE too large for the segment state");
+static_assert(XCPTL_MAX_SEGMENT_SIZE / (XCPTL_TRANSPORT_LAYER_HEADER_SIZE + XCPTL_PACKET_ALIGNMENT) <= (SEGMENT_UNCOMMITTED_MASK / SEGMENT_UNCOMMITTED_ONE),
+              "Too many messages per segment for the segment state");
+
 typedef struct {
-    uint32_t magic;                             // Magic number to identify the segment buffer
-    uint16_t uncommitted;                       // Number of uncommitted messages in this segment
-    uint16_t size;                              // Number of overall bytes in this segment
+    atomic_uint_fast32_t state;                 // Segment state, size, uncommitted messages, closed flag and epoch
     uint8_t msg_buffer[XCPTL_MAX_SEGMENT_SIZE]; // Segment/UDP MTU - concatenated transport layer messages tXcpMessage
 } tXcpSegmentBuffer;
 
 typedef struct Queue {
 
+    // Shared state
+    atomic_uint_fast32_t head;         // Sequence number of the segment filled by the producers
+    atomic_uint_fast32_t tail;         // Sequence number of the oldest segment not released, written by the consumer only
+    atomic_uint_fast32_t packets_lost; // Number of packets lost since last call to queuePop
+
+    // Constant
     uint32_t queue_buffer_size; // Size of queue memory allocated in bytes
-    uint32_t queue_size;        // Size of queue in segments of type tXcpSegmentBuffer
+    uint32_t queue_size;        // Size of queue in segments of type tXcpSegmentBuffer, power of 2
+    uint32_t queue_shift;       // log2(queue_size)
+    uint32_t headroom;          // Segments reserved for producers with priority, see queueSetOverflowPolicy
+    uint8_t policy;             // Overflow policy
+    bool huge_pages;            // Queue buffer allocated with platformMemAllocHuge
 
     // Transmit segment queue
-    tXcpSegmentBuffer *queue;   // Array of tXcpSegmentBuffer, each segment is a UDP payload (MAX_SEGMENT_SIZE)
-    uint32_t queue_rp;          // rp = read index
-    uint32_t queue_len;         // rp+len = write index (the next free entry), len=0 ist empty, len=XCPTL_QUEUE_SIZE is full
-    tXcpSegmentBuffer *msg_ptr; // current incomplete or not fully commited segment
+    tXcpSegmentBuffer *queue; // Array of tXcpSegmentBuffer, each segment is a UDP payload (MAX_SEGMENT_SIZE)
 
-    uint32_t packets_lost; // Number of packets lost since last call to queuePop
+#ifdef OPTION_QUEUE_NOTIFY
+    // Consumer wakeup, see queueNotify
+    atomic_uint_least32_t notify_seq; // Wakeup sequence counter, the consumer blocks on this value
+    atomic_uint_least32_t notified;   // Set by queueNotify, reset by the consumer in queueWait
+#endif
 
-    MUTEX Mutex_Queue;
+    tQueueStats stats; // Runtime statistics
 
 } tQueue;
 
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 
-// Allocate a new segment buffer (in queue->msg_ptr)
-// Not thread save!
-static void newSegmentBuffer(tQueue *queue) {
+// Maximum queue level in segments for a producer with the given priority
+static uint32_t getQueueLimit(const tQueue *queue, uint8_t priority) {
+    if (priority == QUEUE_PRIORITY_NORMAL)
+        return queue->queue_size - queue->headroom;
+    if (queue->policy == QUEUE_OVERFLOW_DROP_NEWEST)
+        return queue->queue_size;
+    return queue->queue_size - queue->headroom + (uint32_t)(((uint64_t)queue->headroom * priority) / QUEUE_PRIORITY_HIGH);
+}
 
-    tXcpSegmentBuffer *b;
+// Segment buffer and epoch of a sequence number
+static inline tXcpSegmentBuffer *getSegment(const tQueue *queue, uint_fast32_t seq) { return &queue->queue[seq & (queue->queue_size - 1)]; }
+static inline uint_fast32_t getEpoch(const tQueue *queue, uint_fast32_t seq) { return ((uint_fast32_t)(uint32_t)(seq >> queue->queue_shift) << SEGMENT_EPOCH_SHIFT) & SEGMENT_EPOCH_MASK; }
+
+// Open the next segment after the head segment has been closed by the caller
+// Only the producer or consumer which closed the head segment may call this
+// Returns false, if the queue level would exceed limit
+static bool openNextSegment(tQueue *queue, uint_fast32_t head, uint32_t limit) {
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if ((uint32_t)(head - tail) + 1 >= limit) {
+        return false; // Queue overflow
+    }
+    // The next segment has been reset by the consumer on release
+    assert(atomic_load_explicit(&getSegment(queue, head + 1)->state, memory_order_relaxed) == getEpoch(queue, head + 1));
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    DBG_PRINTF6("openNextSegment: head=%u, tail=%u\n", (uint32_t)(head + 1), (uint32_t)tail);
+    return true;
+}
 
-    /* Check if there is space in the queue */
-    if (queue->queue_len >= queue->queue_size) {
-        /* Queue overflow */
-        queue->msg_ptr = NULL;
-    } else {
-        unsigned int i = queue->queue_rp + queue->queue_len;
-        if (i >= queue->queue_size)
-            i -= queue->queue_size;
-        b = &queue->queue[i];
-        b->size = 0;
-        b->uncommitted = 0;
-        queue->msg_ptr = b;
-        queue->queue_len++;
-        assert(queue->msg_ptr->magic == 0x12345678); // Check magic number
-        DBG_PRINTF6("getSegmentBuffer: queue_rp=%" PRIu32 ", queue_len=%" PRIu32 ", msg_ptr=%p\n", queue->queue_rp, queue->queue_len, (void *)queue->msg_ptr);
+// Reserve size bytes for count messages in the head segment
+// Opens the next segment, if the head segment is full
+// Returns the segment and the offset of the reserved space in the segment, NULL on queue overflow
+static tXcpSegmentBuffer *reserveSegment(tQueue *queue, uint16_t size, uint16_t count, uint32_t limit, uint16_t *offset, uint32_t *retries, uint32_t *level) {
+    assert(size <= XCPTL_MAX_SEGMENT_SIZE);
+    for (;;) {
+        uint_fast32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+        tXcpSegmentBuffer *b = getSegment(queue, head);
+        uint_fast32_t state = atomic_load_explicit(&b->state, memory_order_relaxed);
+
+        // The head has moved on and the segment is closed or has already been recycled, retry with the new head
+        if ((state & SEGMENT_CLOSED) != 0 || (state & SEGMENT_EPOCH_MASK) != getEpoch(queue, head)) {
+            (*retries)++;
+            continue;
+        }
+
+        // Reserve space in the head segment
+        uint16_t segment_size = (uint16_t)(state & SEGMENT_SIZE_MASK);
+        if (segment_size + size <= XCPTL_MAX_SEGMENT_SIZE) {
+            if (atomic_compare_exchange_weak_explicit(&b->state, &state, state + size + count * SEGMENT_UNCOMMITTED_ONE, memory_order_acq_rel, memory_order_relaxed)) {
+                *level = (uint32_t)(head - atomic_load_explicit(&queue->tail, memory_order_relaxed)) + 1;
+                *offset = segment_size;
+                return b;
+            }
+            (*retries)++;
+            continue;
+        }
+
+        // Head segment is full, close it and open the next segment
+        if (!atomic_compare_exchange_weak_explicit(&b->state, &state, state | SEGMENT_CLOSED, memory_order_acq_rel, memory_order_relaxed)) {
+            (*retries)++;
+            continue;
+        }
+        if (!openNextSegment(queue, head, limit)) {
+            // Queue overflow, reopen the head segment, other messages may still fit
+            atomic_fetch_sub_explicit(&b->state, SEGMENT_CLOSED, memory_order_acq_rel);
+            *level = (uint32_t)(head - atomic_load_explicit(&queue->tail, memory_order_relaxed)) + 1;
+            return NULL;
+        }
+    }
+}
+
+// Close the head segment, if it is not empty, and open the next segment
+// Called on flush by producers or the consumer
+static void flushSegment(tQueue *queue) {
+    for (;;) {
+        uint_fast32_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+        tXcpSegmentBuffer *b = getSegment(queue, head);
+        uint_fast32_t state = atomic_load_explicit(&b->state, memory_order_relaxed);
+        if ((state & SEGMENT_CLOSED) != 0 || (state & SEGMENT_EPOCH_MASK) != getEpoch(queue, head)) {
+            return; // Already closed by another producer
+        }
+        if ((state & SEGMENT_SIZE_MASK) == 0) {
+            return; // Empty, nothing to flush
+        }
+        if (atomic_compare_exchange_weak_explicit(&b->state, &state, state | SEGMENT_CLOSED, memory_order_acq_rel, memory_order_relaxed)) {
+            if (!openNextSegment(queue, head, queue->queue_size)) {
+                atomic_fetch_sub_explicit(&b->state, SEGMENT_CLOSED, memory_order_acq_rel); // Queue full, the consumer will pick it up later
+            }
+            return;
+        }
     }
 }
 
 static void clearQueue(tQueue *queue) {
     assert(queue != NULL);
-    mutexLock(&queue->Mutex_Queue);
-    queue->queue_rp = 0;
-    queue->queue_len = 0;
-    queue->msg_ptr = NULL;
-    mutexUnlock(&queue->Mutex_Queue);
+    for (uint32_t i = 0; i < queue->queue_size; i++) {
+        atomic_store_explicit(&queue->queue[i].state, 0, memory_order_relaxed); // Epoch 0
+    }
+    atomic_store_explicit(&queue->packets_lost, 0, memory_order_relaxed);
+#ifdef OPTION_QUEUE_NOTIFY
+    atomic_store_explicit(&queue->notified, 0, memory_order_relaxed);
+#endif
+    atomic_store_explicit(&queue->tail, 0, memory_order_relaxed);
+    atomic_store_explicit(&queue->head, 0, memory_order_release);
+    queueStatsClear(&queue->stats);
 }
 
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 
 // Clear the queue
+// Not thread safe, producers must not be active
 void queueClear(tQueueHandle queue_handle) {
     tQueue *queue = (tQueue *)queue_handle;
     assert(queue != NULL);
@@ -131,43 +243,61 @@ void queueClear(tQueueHandle queue_handle) {
 }
 
 // Create and initialize a new queue with a given size in bytes
-// Will be rounded up to match alignment requirements
-tQueueHandle queueInit(size_t queue_buffer_size) {
+// The number of segments is rounded down to a power of 2, minimum 2
+tQueueHandle queueInitEx(size_t queue_buffer_size, bool huge_pages) {
 
     tQueue *queue = (tQueue *)malloc(sizeof(tQueue));
     assert(queue != NULL);
+    memset(queue, 0, sizeof(tQueue));
 
-    // Target size of the queue buffer in entries of type tXcpSegmentBuffer
+    // Target size of the queue buffer in entries of type tXcpSegmentBuffer, rounded down to a power of 2
     size_t queue_entries = queue_buffer_size / sizeof(tXcpSegmentBuffer) + 1;
+    queue->queue_shift = 1;
+    while (((size_t)2 << queue->queue_shift) <= queue_entries && queue->queue_shift < 24) {
+        queue->queue_shift++;
+    }
+    queue->queue_size = 1u << queue->queue_shift; // Number of segments in the queue
 
     // Size of the queue buffer in bytes (rounded up to cache line size)
-    queue->queue_buffer_size = ((queue_entries * sizeof(tXcpSegmentBuffer)) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1); // Align to cache line size
-    // queue->queue = (tXcpSegmentBuffer *)_aligned_alloc(CACHE_LINE_SIZE, queue->queue_buffer_size);
-    queue->queue = (tXcpSegmentBuffer *)malloc(queue->queue_buffer_size);
-    queue->queue_size = queue->queue_buffer_size / sizeof(tXcpSegmentBuffer); // Number of segments in the queue
-    assert(queue->queue != NULL);
-    for (uint32_t i = 0; i < queue->queue_size; i++) {
-        queue->queue[i].magic = 0x12345678; // Magic number to identify the segment buffer
-        queue->queue[i].uncommitted = 0;    // No uncommitted messages
-        queue->queue[i].size = 0;           // No data in this segment
+    queue->queue_buffer_size = (uint32_t)((queue->queue_size * sizeof(tXcpSegmentBuffer)) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1); // Align to cache line size
+    queue->huge_pages = huge_pages;
+    if (huge_pages) {
+        // Huge pages, rounded up to the huge page size
+        size_t memory_size = queue->queue_buffer_size;
+        queue->queue = (tXcpSegmentBuffer *)platformMemAllocHuge(&memory_size);
+        assert(queue->queue != NULL);
+        platformMemLock(queue->queue, memory_size);
+        queue->queue_buffer_size = (uint32_t)memory_size;
+    } else {
+        // queue->queue = (tXcpSegmentBuffer *)_aligned_alloc(CACHE_LINE_SIZE, queue->queue_buffer_size);
+        queue->queue = (tXcpSegmentBuffer *)malloc(queue->queue_buffer_size);
     }
+    queue->headroom = 0;
+    queue->policy = QUEUE_OVERFLOW_DROP_NEWEST;
+    assert(queue->queue != NULL);
 
     DBG_PRINT3("Init transport layer lockless queue (queue32)\n");
     DBG_PRINTF3("  buffer_size=%" PRIu32 ", queue_size=%" PRIu32 " (%" PRIu32 " Bytes)\n", queue->queue_buffer_size, queue->queue_size, queue->queue_buffer_size);
 
-    mutexInit(&queue->Mutex_Queue, false, 1000);
-
-    mutexLock(&queue->Mutex_Queue);
-    queue->queue_rp = 0;
-    queue->queue_len = 0;
-    queue->msg_ptr = NULL;
-    newSegmentBuffer(queue);
-    mutexUnlock(&queue->Mutex_Queue);
+    queueStatsInit(&queue->stats, true);
+    clearQueue(queue);
 
-    assert(queue->msg_ptr);
     return (tQueueHandle)queue;
 }
 
+tQueueHandle queueInit(size_t queue_buffer_size) { return queueInitEx(queue_buffer_size, QUEUE_HUGE_PAGES_DEFAULT); }
+
+void queueSetOverflowPolicy(tQueueHandle queue_handle, uint8_t policy, uint8_t headroom_percent) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(policy == QUEUE_OVERFLOW_DROP_NEWEST || policy == QUEUE_OVERFLOW_GRADED_HEADROOM);
+    assert(headroom_percent <= 50);
+
+    queue->policy = policy;
+    queue->headroom = (queue->queue_size * headroom_percent) / 100;
+    DBG_PRINTF3("Queue overflow policy %u, priority headroom %u%% (%u segments)\n", policy, headroom_percent, queue->headroom);
+}
+
 // Deinitialize and free the queue
 void queueDeinit(tQueueHandle queue_handle) {
 
@@ -178,11 +308,16 @@ void queueDeinit(tQueueHandle queue_handle) {
 
     clearQueue(queue); // Clear the queue
 
-    free(queue->queue);
+    if (queue->huge_pages) {
+        platformMemFree(queue->queue, queue->queue_buffer_size);
+    } else {
+        free(queue->queue);
+    }
     queue->queue = NULL;
     queue->queue_buffer_size = 0;
     queue->queue_size = 0;
-    mutexDestroy(&queue->Mutex_Queue);
+    queueStatsFree(&queue->stats);
+    free(queue);
 }
 
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -190,7 +325,7 @@ void queueDeinit(tQueueHandle queue_handle) {
 // For multiple producers !!
 
 // Get a buffer for a message with size
-tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_size) {
+tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_size, uint8_t priority) {
 
     tQueue *queue = (tQueue *)queue_handle;
     tXcpMessage *p = NULL;
@@ -218,31 +353,27 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_size) {
 
     msg_size = (uint16_t)(packet_size + XCPTL_TRANSPORT_LAYER_HEADER_SIZE);
 
-    mutexLock(&queue->Mutex_Queue);
-
-    // Get another message buffer from queue, when active buffer ist full
-    b = queue->msg_ptr;
-    if (b == NULL || (uint16_t)(b->size + msg_size) > XCPTL_MAX_SEGMENT_SIZE) {
-        newSegmentBuffer(queue);
-        b = queue->msg_ptr;
-    }
+    tQueueStatsProducer *stats = queueStatsGetProducer(&queue->stats);
+    uint64_t stats_start = queueStatsBegin();
+    uint32_t retries = 0;
+    uint32_t level = 0;
+    uint16_t offset = 0;
 
+    b = reserveSegment(queue, msg_size, 1, getQueueLimit(queue, priority), &offset, &retries, &level);
     if (b != NULL) {
 
         // Build XCP message header (ctr+dlc) and store in DTO buffer
-        p = (tXcpMessage *)&b->msg_buffer[b->size];
+        p = (tXcpMessage *)&b->msg_buffer[offset];
         p->ctr = 0xEEEE; // Reserved value, indicates that this message is not yet commited
         p->dlc = (uint16_t)packet_size;
-        b->size = (uint16_t)(b->size + msg_size);
-        b->uncommitted++;
-        DBG_PRINTF6("queueAcquire: size=%u, uncommitted=%u\n", b->size, b->uncommitted);
+        DBG_PRINTF6("queueAcquire: offset=%u, size=%u\n", offset, msg_size);
     } else {
         // No segment buffer available, queue overflow
-        queue->packets_lost++;
-        DBG_PRINTF_ERROR("queueAcquire: queue overflow, packet_size=%u, msg_size=%u, queue_len=%u\n", packet_size, msg_size, queue->queue_len);
+        atomic_fetch_add_explicit(&queue->packets_lost, 1, memory_order_relaxed);
+        DBG_PRINTF_ERROR("queueAcquire: queue overflow, packet_size=%u, msg_size=%u, queue_len=%u\n", packet_size, msg_size, level);
     }
 
-    mutexUnlock(&queue->Mutex_Queue);
+    queueStatsAcquire(&queue->stats, stats, stats_start, retries, level, 1, p != NULL);
 
     if (p == NULL) {
 
@@ -263,23 +394,169 @@ void queuePush(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer, bool
 
     tQueue *queue = (tQueue *)queue_handle;
 
-    DBG_PRINTF6("queuePush: size=%" PRIu16 ", uncommitted=%" PRIu16 "\n", queue_buffer->size, ((tXcpSegmentBuffer *)queue_buffer->handle)->uncommitted);
-
-    mutexLock(&queue->Mutex_Queue);
-
-    ((tXcpSegmentBuffer *)queue_buffer->handle)->uncommitted--;
+    DBG_PRINTF6("queuePush: size=%" PRIu16 "\n", queue_buffer->size);
 
     tXcpMessage *p = (tXcpMessage *)(queue_buffer->buffer - XCPTL_TRANSPORT_LAYER_HEADER_SIZE);
     assert(p->dlc > 0 && p->dlc <= XCPTL_MAX_DTO_SIZE);
     assert(p->ctr == 0xEEEE); // Check if the message is in reserved state
     p->ctr = 0xCCCC;          // Mark the message as commited, CTR value is not important yet, it will be set by the consumer
 
+    // Release the message to the consumer
+    atomic_fetch_sub_explicit(&((tXcpSegmentBuffer *)queue_buffer->handle)->state, SEGMENT_UNCOMMITTED_ONE, memory_order_release);
+
     // Flush (high priority data commited)
-    if (flush && queue->msg_ptr != NULL && queue->msg_ptr->size > 0) {
-        newSegmentBuffer(queue);
+    if (flush) {
+        flushSegment(queue);
     }
+}
 
-    mutexUnlock(&queue->Mutex_Queue);
+// Acquire multiple messages
+// Either all messages are acquired or none of them
+// If the messages fit into one segment, they are reserved with a single CAS in the head segment
+// Otherwise the head segment is closed and the messages are placed in consecutive new segments, which are published with the next head
+bool queueAcquireMulti(tQueueHandle queue_handle, const uint16_t *payload_sizes, uint16_t count, uint8_t priority, tQueueBuffer *queue_buffers) {
+
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(payload_sizes != NULL && queue_buffers != NULL && count > 0);
+
+    // Check and align the packet sizes
+    uint32_t total_size = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t packet_size = payload_sizes[i];
+        if (!(packet_size > 0 && packet_size <= XCPTL_MAX_DTO_SIZE)) {
+            DBG_PRINTF_ERROR("Invalid packet_len %u, must be between 1 and %u\n", packet_size, XCPTL_MAX_DTO_SIZE);
+            return false;
+        }
+        queue_buffers[i].size = (uint16_t)((packet_size + 3) & 0xFFFC); // Add fill %4
+        total_size += queue_buffers[i].size + XCPTL_TRANSPORT_LAYER_HEADER_SIZE;
+    }
+
+    tQueueStatsProducer *stats = queueStatsGetProducer(&queue->stats);
+    uint64_t stats_start = queueStatsBegin();
+    uint32_t limit = getQueueLimit(queue, priority);
+    uint32_t retries = 0;
+    uint32_t level = 0;
+
+    // All messages fit into one segment
+    if (total_size <= XCPTL_MAX_SEGMENT_SIZE) {
+        uint16_t offset = 0;
+        tXcpSegmentBuffer *b = reserveSegment(queue, (uint16_t)total_size, count, limit, &offset, &retries, &level);
+        if (b == NULL) {
+            atomic_fetch_add_explicit(&queue->packets_lost, count, memory_order_relaxed);
+            queueStatsAcquire(&queue->stats, stats, stats_start, retries, level, count, false);
+            DBG_PRINTF_ERROR("queueAcquireMulti: queue overflow, count=%u, queue_len=%u\n", count, level);
+            return false;
+        }
+        for (uint16_t i = 0; i < count; i++) {
+            tXcpMessage *p = (tXcpMessage *)&b->msg_buffer[offset];
+            p->ctr = 0xEEEE; // Reserved value, indicates that this message is not yet commited
+            p->dlc = queue_buffers[i].size;
+            queue_buffers[i].buffer = p->packet;
+            queue_buffers[i].handle = b;
+            offset = (uint16_t)(offset + queue_buffers[i].size + XCPTL_TRANSPORT_LAYER_HEADER_SIZE);
+        }
+        queueStatsAcquire(&queue->stats, stats, stats_start, retries, level, count, true);
+        return true;
+    }
+
+    // Messages need multiple segments
+    // Close the head segment, this producer is the only one allowed to open new segments, until it increments head
+    uint_fast32_t head;
+    tXcpSegmentBuffer *b;
+    for (;;) {
+        head = atomic_load_explicit(&queue->head, memory_order_acquire);
+        b = getSegment(queue, head);
+        uint_fast32_t state = atomic_load_explicit(&b->state, memory_order_relaxed);
+        if ((state & SEGMENT_CLOSED) != 0 || (state & SEGMENT_EPOCH_MASK) != getEpoch(queue, head)) {
+            retries++;
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&b->state, &state, state | SEGMENT_CLOSED, memory_order_acq_rel, memory_order_relaxed)) {
+            break;
+        }
+        retries++;
+    }
+
+    // Count the number of new segments needed
+    uint32_t segments_needed = 1;
+    uint32_t segment_size = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t msg_size = (uint16_t)(queue_buffers[i].size + XCPTL_TRANSPORT_LAYER_HEADER_SIZE);
+        if (segment_size + msg_size > XCPTL_MAX_SEGMENT_SIZE) {
+            segments_needed++;
+            segment_size = 0;
+        }
+        segment_size += msg_size;
+    }
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    level = (uint32_t)(head - tail) + 1;
+    if (level + segments_needed > limit) {
+        // Queue overflow, reopen the head segment
+        atomic_fetch_sub_explicit(&b->state, SEGMENT_CLOSED, memory_order_acq_rel);
+        atomic_fetch_add_explicit(&queue->packets_lost, count, memory_order_relaxed);
+        queueStatsAcquire(&queue->stats, stats, stats_start, retries, level, count, false);
+        DBG_PRINTF_ERROR("queueAcquireMulti: queue overflow, count=%u, queue_len=%u\n", count, level);
+        return false;
+    }
+
+    // Build the XCP message headers (ctr+dlc) in reserved state in the new segments, not visible to other producers or the consumer yet
+    uint_fast32_t seq = head + 1;
+    b = getSegment(queue, seq);
+    segment_size = 0;
+    uint32_t uncommitted = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t msg_size = (uint16_t)(queue_buffers[i].size + XCPTL_TRANSPORT_LAYER_HEADER_SIZE);
+        if (segment_size + msg_size > XCPTL_MAX_SEGMENT_SIZE) {
+            atomic_store_explicit(&b->state, getEpoch(queue, seq) | SEGMENT_CLOSED | (uncommitted * SEGMENT_UNCOMMITTED_ONE) | segment_size, memory_order_relaxed);
+            seq++;
+            b = getSegment(queue, seq);
+            segment_size = 0;
+            uncommitted = 0;
+        }
+        tXcpMessage *p = (tXcpMessage *)&b->msg_buffer[segment_size];
+        p->ctr = 0xEEEE; // Reserved value, indicates that this message is not yet commited
+        p->dlc = queue_buffers[i].size;
+        queue_buffers[i].buffer = p->packet;
+        queue_buffers[i].handle = b;
+        segment_size += msg_size;
+        uncommitted++;
+    }
+    // The last segment stays open for other producers
+    atomic_store_explicit(&b->state, getEpoch(queue, seq) | (uncommitted * SEGMENT_UNCOMMITTED_ONE) | segment_size, memory_order_relaxed);
+    atomic_store_explicit(&queue->head, seq, memory_order_release);
+
+    queueStatsAcquire(&queue->stats, stats, stats_start, retries, level, count, true);
+    return true;
+}
+
+// Commit multiple messages from queueAcquireMulti
+void queuePushMulti(tQueueHandle queue_handle, const tQueueBuffer *queue_buffers, uint16_t count, bool flush) {
+
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(queue_buffers != NULL && count > 0);
+
+    // Mark all messages as commited, count the messages per segment
+    tXcpSegmentBuffer *b = (tXcpSegmentBuffer *)queue_buffers[0].handle;
+    uint32_t n = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        tXcpMessage *p = (tXcpMessage *)(queue_buffers[i].buffer - XCPTL_TRANSPORT_LAYER_HEADER_SIZE);
+        assert(p->ctr == 0xEEEE); // Check if the message is in reserved state
+        p->ctr = 0xCCCC;          // Mark the message as commited
+        if (queue_buffers[i].handle != b) {
+            atomic_fetch_sub_explicit(&b->state, n * SEGMENT_UNCOMMITTED_ONE, memory_order_release);
+            b = (tXcpSegmentBuffer *)queue_buffers[i].handle;
+            n = 0;
+        }
+        n++;
+    }
+    atomic_fetch_sub_explicit(&b->state, n * SEGMENT_UNCOMMITTED_ONE, memory_order_release);
+
+    // Flush (high priority data commited)
+    if (flush) {
+        flushSegment(queue);
+    }
 }
 
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -288,7 +565,6 @@ void queuePush(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer, bool
 
 // Get transmit queue level in segments
 // This function is thread safe, any thread can ask for the queue level
-// Not used by the queue implementation itself
 uint32_t queueLevel(tQueueHandle queue_handle, uint32_t *queue_max_level) {
     tQueue *queue = (tQueue *)queue_handle;
     if (queue == NULL) {
@@ -298,8 +574,11 @@ uint32_t queueLevel(tQueueHandle queue_handle, uint32_t *queue_max_level) {
     }
     if (queue_max_level != NULL)
         *queue_max_level = queue->queue_size;
-    if (queue->queue_len > 1 || (queue->queue_len == 1 && queue->msg_ptr != NULL && queue->msg_ptr->size > 0)) {
-        return queue->queue_len;
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    uint_fast32_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint32_t queue_len = (uint32_t)(head - tail) + 1;
+    if (queue_len > 1 || (atomic_load_explicit(&getSegment(queue, head)->state, memory_order_relaxed) & SEGMENT_SIZE_MASK) > 0) {
+        return queue_len;
     }
     return 0;
 }
@@ -315,35 +594,43 @@ tQueueBuffer queuePop(tQueueHandle queue_handle, bool accumulate, bool flush, ui
     assert(accumulate == true);
 
     tXcpSegmentBuffer *b = NULL;
+    uint16_t size = 0;
 
     // Return the number of packets lost since the last call to queuePop
     if (packets_lost != NULL) {
-        *packets_lost = queue->packets_lost;
+        *packets_lost = (uint32_t)atomic_exchange_explicit(&queue->packets_lost, 0, memory_order_acq_rel);
         if (*packets_lost > 0)
             DBG_PRINTF6("queuePop: packets_lost=%" PRIu32 "\n", *packets_lost);
-        queue->packets_lost = 0; // Reset lost packets count
     }
 
-    // Check if there is a message segment ready in the transmit queue
-    mutexLock(&queue->Mutex_Queue);
+    uint64_t stats_start = queueStatsBegin();
 
-    if (queue->queue_len >= 1) {
-
-        b = &queue->queue[queue->queue_rp];
+    // Flush the head segment, if it is the only one and it is not empty
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (flush && atomic_load_explicit(&queue->head, memory_order_acquire) == tail) {
+        DBG_PRINT6("queuePop: flush\n");
+        flushSegment(queue);
+    }
 
-        // Flush tail segment buffer if it is not empty
-        if (queue->queue_len == 1 && b->size > 0 && flush) {
-            DBG_PRINT6("queuePop: flush\n");
-            newSegmentBuffer(queue);
+    // Return the tail segment, if it is closed, fully committed and not empty
+    // Empty segments closed by queueAcquireMulti are released immediately
+    while (tail != atomic_load_explicit(&queue->head, memory_order_acquire)) {
+        tXcpSegmentBuffer *t = getSegment(queue, tail);
+        uint_fast32_t state = atomic_load_explicit(&t->state, memory_order_acquire);
+        assert((state & SEGMENT_CLOSED) != 0);
+        if ((state & SEGMENT_UNCOMMITTED_MASK) != 0) {
+            break; // Not fully committed yet
         }
-
-        // Return tail segment buffer if it is not empty, fully committed and there are more segments in the queue
-        if (!(queue->queue_len > 1 && b->uncommitted == 0 && b->size > 0)) {
-            b = NULL;
+        size = (uint16_t)(state & SEGMENT_SIZE_MASK);
+        if (size > 0) {
+            b = t;
+            break;
         }
+        atomic_store_explicit(&t->state, getEpoch(queue, tail + queue->queue_size), memory_order_relaxed);
+        atomic_store_explicit(&queue->tail, ++tail, memory_order_release);
     }
 
-    mutexUnlock(&queue->Mutex_Queue);
+    queueStatsPeek(&queue->stats, stats_start, b != NULL ? 1 : 0);
 
     if (b == NULL) {
 
@@ -358,11 +645,11 @@ tQueueBuffer queuePop(tQueueHandle queue_handle, bool accumulate, bool flush, ui
 
     else {
 
-        DBG_PRINTF6("queuePop: flush=%d, packets_lost=%" PRIu32 ", size=%" PRIu32 "\n", flush, *packets_lost, b->size);
+        DBG_PRINTF6("queuePop: flush=%d, size=%" PRIu32 "\n", flush, size);
 
         // Update the transport layer message counters
         uint8_t *p = b->msg_buffer;
-        uint8_t *pl = &b->msg_buffer[b->size] - XCPTL_TRANSPORT_LAYER_HEADER_SIZE; // Pointer to the last possible byte in the segment buffer
+        uint8_t *pl = &b->msg_buffer[size] - XCPTL_TRANSPORT_LAYER_HEADER_SIZE; // Pointer to the last possible byte in the segment buffer
         while (p < pl) {
             tXcpMessage *m = (tXcpMessage *)p;                  // Pointer to the current message
             assert(m->dlc > 0 && m->dlc <= XCPTL_MAX_DTO_SIZE); // Check if the message length is valid
@@ -374,25 +661,75 @@ tQueueBuffer queuePop(tQueueHandle queue_handle, bool accumulate, bool flush, ui
 
         tQueueBuffer ret = {
             .buffer = b->msg_buffer,
-            .handle = NULL,
-            .size = b->size,
+            .handle = b,
+            .size = size,
         };
         return ret;
     }
 }
 
-// Advance the transmit queue tail by the message length obtained from the last queuePop call
+// Wait for new data, not supported, the consumer polls, queueNotify wakes it up
+bool queueWait(tQueueHandle queue_handle, uint32_t timeout_us) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    queueStatsWait(&queue->stats);
+    // Producers do not notify, poll with max 1ms sleep, queueNotify ends the sleep early
+#ifdef OPTION_QUEUE_NOTIFY
+    uint32_t seq = atomic_load_explicit(&queue->notify_seq, memory_order_acquire);
+    if (atomic_exchange_explicit(&queue->notified, 0, memory_order_acquire) != 0) {
+        return true;
+    }
+    // A queueNotify after the load of seq changed notify_seq, the wait returns immediately
+    platformWaitOnAddress(&queue->notify_seq, seq, timeout_us < 1000 ? timeout_us : 1000);
+#else
+    sleepUs(timeout_us < 1000 ? timeout_us : 1000);
+#endif
+    return true;
+}
+
+void queueNotify(tQueueHandle queue_handle) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+#ifdef OPTION_QUEUE_NOTIFY
+    atomic_store_explicit(&queue->notified, 1, memory_order_release);
+    atomic_fetch_add_explicit(&queue->notify_seq, 1, memory_order_release);
+    platformWakeOnAddress(&queue->notify_seq);
+#else
+    (void)queue; // The consumer polls
+#endif
+}
+
+// Release the segment obtained from the last queuePop call
+// Reset the segment state for its next use and advance the tail
 void queueRelease(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer) {
     tQueue *queue = (tQueue *)queue_handle;
 
     DBG_PRINTF6("queueRelease: size=%" PRIu16 "\n", queue_buffer->size);
 
-    // Free this segment buffer when successfully sent
-    mutexLock(&queue->Mutex_Queue);
-    if (++queue->queue_rp >= queue->queue_size)
-        queue->queue_rp = 0;
-    queue->queue_len--;
-    mutexUnlock(&queue->Mutex_Queue);
+    uint_fast32_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    tXcpSegmentBuffer *b = getSegment(queue, tail);
+    assert(queue_buffer->handle == b);
+    atomic_store_explicit(&b->state, getEpoch(queue, tail + queue->queue_size), memory_order_relaxed);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Statistics
+
+// Levels are in segments
+bool queueGetStatistics(tQueueHandle queue_handle, uint32_t producer, tQueueStatistics *statistics) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(statistics != NULL);
+
+    statistics->level = queueLevel(queue_handle, &statistics->queue_size);
+    return queueStatsGet(&queue->stats, producer, statistics);
+}
+
+void queueResetStatistics(tQueueHandle queue_handle) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    queueStatsClear(&queue->stats);
 }
 
 #endif
@@ -20,6 +20,7 @@
 #ifdef OPTION_QUEUE_64_FIX_SIZE
 
 #include "queue.h"
+#include "queue_stats.h"
 
 #include <assert.h>    // for assert
 #include <inttypes.h>  // for PRIu64
@@ -84,181 +85,22 @@ static_assert(sizeof(void *) == 8, "This implementation requires a 64 Bit platfo
 #error "(QUEUE_ENTRY_USER_PAYLOAD_SIZE+8) should be modulo CACHE_LINE_SIZE for optimal performance"
 #endif
 
-//-------------------------------------------------------------------------------------------------------------------------------------------------------
-// Test
-
-// Queue acquire lock timing and spin
-// For high contention test use example queue_test or daq_test with xcpclient --upload-a2l --udp --mea .  --dest-addr 192.168.0.206
-// Note that this tests have significant performance impact, do not turn on for production use !!!!!!!!!!!
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-
-static MUTEX lock_mutex = MUTEX_INTIALIZER;
-static uint64_t lock_time_max = 0;
-static uint64_t lock_time_sum = 0;
-static uint64_t lock_count = 0;
-static uint64_t lock_spin_count_max = 0;
-// Variable-width lock timing histogram
-// Fine granularity for short latencies, coarser for long-tail latencies
-// Bin[i] counts events where EDGES[i-1] <= t < EDGES[i]; bin[SIZE-1] is the overflow (>EDGES[SIZE-2])
-#define LOCK_TIME_HISTOGRAM_SIZE 26
-static const uint64_t LOCK_TIME_HISTOGRAM_EDGES[LOCK_TIME_HISTOGRAM_SIZE - 1] = {
-    40,    80,    120,   160,    200,    240, 280, 320, 360, 400, // 10 bins: 40ns steps
-    600,   800,   1000,  1500,   2000,                            //  5 bins: 200-500ns steps (up to 2us)
-    3000,  4000,  6000,  8000,   10000,                           //  5 bins: 1-2us steps (up to 10us)
-    20000, 40000, 80000, 160000, 320000,                          //  5 bins: 10-160us steps (up to 320us, preemption range)
-};
-static uint64_t lock_time_histogram[LOCK_TIME_HISTOGRAM_SIZE] = {0};
-
-// There should be better alternatives in your target specific environment than this portable reference
-// Select a clock mode appropriate for your platform, CLOCK_MONOTONIC_RAW is a good choice for high resolution and monotonicity
-static uint64_t get_timestamp_ns(void) {
-    static const uint64_t kNanosecondsPerSecond = 1000000000ULL;
-    struct timespec ts = {0};
-    clock_gettime(CLOCK_MONOTONIC_RAW, &ts); // NOLINT(missing-includes) // do **not** include internal "bits" headers directly.
-    return ((uint64_t)ts.tv_sec) * kNanosecondsPerSecond + ((uint64_t)ts.tv_nsec);
-}
-
-static void lock_test_add_sample(uint64_t d, uint32_t spin_count) {
-    mutexLock(&lock_mutex);
-    if (spin_count > lock_spin_count_max)
-        lock_spin_count_max = spin_count;
-    if (d > lock_time_max)
-        lock_time_max = d;
-    int i = 0;
-    while (i < LOCK_TIME_HISTOGRAM_SIZE - 1 && d >= LOCK_TIME_HISTOGRAM_EDGES[i])
-        i++;
-    lock_time_histogram[i]++;
-    lock_time_sum += d;
-    lock_count++;
-    mutexUnlock(&lock_mutex);
-}
-
-static void lock_test_print_results(void) {
-    printf("\nProducer acquire lock time statistics:\n");
-    printf("  count=%" PRIu64 "  max_spins=%" PRIu64 "  max=%" PRIu64 "ns  avg=%" PRIu64 "ns\n", lock_count, lock_spin_count_max, lock_time_max, lock_time_sum / lock_count);
-
-    uint64_t histogram_sum = 0;
-    for (int i = 0; i < LOCK_TIME_HISTOGRAM_SIZE; i++)
-        histogram_sum += lock_time_histogram[i];
-    uint64_t histogram_max = 0;
-    for (int i = 0; i < LOCK_TIME_HISTOGRAM_SIZE; i++)
-        if (lock_time_histogram[i] > histogram_max)
-            histogram_max = lock_time_histogram[i];
-
-    printf("\nLock time histogram (%" PRIu64 " events):\n", histogram_sum);
-    printf("  %-20s  %10s  %7s  %s\n", "Range", "Count", "%", "Bar");
-    printf("  %-20s  %10s  %7s  %s\n", "--------------------", "----------", "-------", "------------------------------");
-
-    for (int i = 0; i < LOCK_TIME_HISTOGRAM_SIZE; i++) {
-        if (!lock_time_histogram[i])
-            continue;
-        double pct = (double)lock_time_histogram[i] * 100.0 / (double)histogram_sum;
-
-        char range_str[32];
-        uint64_t lo = (i == 0) ? 0 : LOCK_TIME_HISTOGRAM_EDGES[i - 1];
-        if (i == LOCK_TIME_HISTOGRAM_SIZE - 1) {
-            snprintf(range_str, sizeof(range_str), ">%" PRIu64 "ns", lo);
-        } else {
-            snprintf(range_str, sizeof(range_str), "%" PRIu64 "-%" PRIu64 "ns", lo, LOCK_TIME_HISTOGRAM_EDGES[i]);
-        }
-
-        char bar[31];
-        int bar_len = (histogram_max > 0) ? (int)((double)lock_time_histogram[i] * 30.0 / (double)histogram_max) : 0;
-        if (bar_len > 30)
-            bar_len = 30;
-        for (int j = 0; j < bar_len; j++)
-            bar[j] = '#';
-        bar[bar_len] = '\0';
-
-        printf("  %-20s  %10" PRIu64 "  %6.2f%%  %s\n", range_str, lock_time_histogram[i], pct, bar);
-    }
-    printf("\n");
-}
-
-/*
-Results on MacBook Pro with Apple M3 (ARM64) with 32 producers
----------------------------------------------------------------------------
-
-Producer acquire lock time statistics:
-  count=8178646  max_spins=5  max=55417ns  avg=95ns
-
-Lock time histogram (8178646 events):
-  Range                      Count        %  Bar
-  --------------------  ----------  -------  ------------------------------
-  0-40ns                    442594    5.41%  ##
-  40-80ns                  4779332   58.44%  ##############################
-  80-120ns                 1637800   20.03%  ##########
-  120-160ns                 421861    5.16%  ##
-  160-200ns                 413763    5.06%  ##
-  200-240ns                 286929    3.51%  #
-  240-280ns                  77721    0.95%
-  280-320ns                  24987    0.31%
-  320-360ns                  10565    0.13%
-  360-400ns                   6956    0.09%
-  400-600ns                  40240    0.49%
-  600-800ns                   1853    0.02%
-  800-1000ns                  1132    0.01%
-  1000-1500ns                 3297    0.04%
-  1500-2000ns                 3155    0.04%
-  2000-3000ns                 4674    0.06%
-  3000-4000ns                 4387    0.05%
-  4000-6000ns                 3967    0.05%
-  6000-8000ns                 2245    0.03%
-  8000-10000ns                3315    0.04%
-  10000-20000ns               7418    0.09%
-  20000-40000ns                443    0.01%
-  40000-80000ns                 12    0.00%
-
-
-Results on Raspberry Pi 5 with 32 producers
----------------------------------------------------------------------------
-
-Producer acquire lock time statistics:
-  count=5453269  max_spins=2  max=134037ns  avg=127ns
-
-Lock time histogram (5453269 events):
-  Range                      Count        %  Bar
-  --------------------  ----------  -------  ------------------------------
-  40-80ns                  1910357   35.03%  ##############################
-  80-120ns                  820903   15.05%  ############
-  120-160ns                 456866    8.38%  #######
-  160-200ns                1899104   34.83%  #############################
-  200-240ns                 319835    5.87%  #####
-  240-280ns                  37519    0.69%
-  280-320ns                   5498    0.10%
-  320-360ns                   1512    0.03%
-  360-400ns                    373    0.01%
-  400-600ns                    272    0.00%
-  600-800ns                      7    0.00%
-  1000-1500ns                   68    0.00%
-  1500-2000ns                   49    0.00%
-  2000-3000ns                  227    0.00%
-  3000-4000ns                  143    0.00%
-  4000-6000ns                  152    0.00%
-  6000-8000ns                  357    0.01%
-  8000-10000ns                  13    0.00%
-  10000-20000ns                  3    0.00%
-  20000-40000ns                  8    0.00%
-  40000-80000ns                  2    0.00%
-  80000-160000ns                 1    0.00%
-*/
-#endif
-
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 // Types tQueueEntry, tQueueHeader, tQueue (tQueueBuffer defined in queue.h)
 
 // Queue entry states
 #define ENTRY_COMMITTED 0xCCCCUL // high word of the entry_header if entry is committed by the producer, otherwise always 0
 #define ENTRY_SIZE_MASK 0xFFFFUL // low word of the entry_header encodes the size of the payload in bytes
+#define ENTRY_RESERVED_MAX 0x7FFFUL // high word of the entry_header of an uncommitted entry is the producer tag (0 or 1..0x7FFF), see queueRegisterProducer
 
 // Queue entry
 // The atomic 32 bit entry_header is used for producer/consumer acq/rel synchronization
 // It encodes the entry commit state and the entry payload length in a single atomic value
-// The commit state must always be 0 (initial state of all entries) or ENTRY_COMMITTED
+// The commit state must always be 0 (initial state of all entries), the producer tag (reserved) or ENTRY_COMMITTED
 
 #pragma pack(push, 1)
 typedef struct {
-    atomic_uint_least32_t entry_header; // commit state (must be 0 or ENTRY_COMMITTED<<16) and user payload size in bytes
+    atomic_uint_least32_t entry_header; // commit state (must be 0, producer tag or ENTRY_COMMITTED<<16) and user payload size in bytes
     uint8_t data[];                     // user header + user payload
 } tQueueEntry;
 #pragma pack(pop)
@@ -278,23 +120,60 @@ typedef union QueueHeader {
         // Constant
         uint64_t magic;       // Magic value for sanity checks
         uint32_t buffer_size; // Exact size of queue data buffer in bytes
+        uint32_t headroom;    // Space in bytes reserved for producers with priority, multiple of QUEUE_ENTRY_SIZE, see queueSetOverflowPolicy
+        uint8_t policy;       // Overflow policy
         bool from_memory;     // Indicates whether the queue was initialized from user provided memory (true) or allocated by the queue implementation (false)
+        bool huge_pages;      // Queue memory allocated with platformMemAllocHuge
+        uint32_t memory_size; // Size of the allocated queue memory in bytes, for platformMemFree
     };
     uint8_t padding[CACHE_LINE_SIZE]; //  Padding to cache line size
 } tQueueHeader;
 
 static_assert(sizeof(tQueueHeader) == CACHE_LINE_SIZE, "QueueHeader size must be CACHE_LINE_SIZE");
 
+// Producer processes of a queue in shared memory
+// Rarely written, on producer registration and when a dead producer is detected
+typedef union QueueProducers {
+    struct {
+        atomic_uint_least32_t tag_counter;                          // Producer tag allocation counter
+        atomic_uint_least32_t dead_index;                           // Next slot in dead_tag
+        atomic_uint_least32_t dead_tag[QUEUE_DEAD_PRODUCER_COUNT]; // Tags of dead producers, ring buffer, 0 is unused
+    };
+    uint8_t padding[CACHE_LINE_SIZE]; //  Padding to cache line size
+} tQueueProducers;
+
+static_assert(sizeof(tQueueProducers) == CACHE_LINE_SIZE, "QueueProducers size must be CACHE_LINE_SIZE");
+
+#ifdef OPTION_QUEUE_NOTIFY
+// Consumer wakeup, see queueNotify
+typedef union QueueConsumer {
+    struct {
+        atomic_uint_least32_t notify_seq; // Wakeup sequence counter, the consumer blocks on this value
+        atomic_uint_least32_t notified;   // Set by queueNotify, reset by the consumer in queueWait
+    };
+    uint8_t padding[CACHE_LINE_SIZE]; //  Padding to cache line size
+} tQueueConsumer;
+
+static_assert(sizeof(tQueueConsumer) == CACHE_LINE_SIZE, "QueueConsumer size must be CACHE_LINE_SIZE");
+#endif
+
 // Queue
 typedef struct Queue {
     tQueueHeader h;
+    tQueueProducers r;
+#ifdef OPTION_QUEUE_NOTIFY
+    tQueueConsumer c;
+#endif
+    tQueueStats stats; // Runtime statistics
     uint8_t buffer[];
 } tQueue;
 
+static_assert(sizeof(tQueue) % CACHE_LINE_SIZE == 0, "Queue data buffer must be aligned to CACHE_LINE_SIZE");
+
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 // Implementation
 
-tQueueHandle queueInitFromMemory(void *queue_memory, size_t queue_memory_size, bool clear_queue, uint64_t *out_buffer_size) {
+tQueueHandle queueInitFromMemoryEx(void *queue_memory, size_t queue_memory_size, bool clear_queue, uint64_t *out_buffer_size, bool huge_pages) {
 
     tQueue *queue = NULL;
 
@@ -306,18 +185,29 @@ tQueueHandle queueInitFromMemory(void *queue_memory, size_t queue_memory_size, b
         // Allocate the queue memory, rounded up to (QUEUE_ENTRY_USER_PAYLOAD_SIZE+8) size
         // Allocated memory includes the queue descriptor
         size_t aligned_memory_size =
-            sizeof(tQueueHeader) + ((queue_memory_size / QUEUE_ENTRY_SIZE) * QUEUE_ENTRY_SIZE); // Round down to multiple of QUEUE_ENTRY_SIZE size plus header size
+            sizeof(tQueue) + ((queue_memory_size / QUEUE_ENTRY_SIZE) * QUEUE_ENTRY_SIZE); // Round down to multiple of QUEUE_ENTRY_SIZE size plus header size
         assert(aligned_memory_size <=
                100ULL * 1024 * 1024); // Sanity check for size, 100 MiB should be more than enough for a queue, if you need more, increase this limit or remove it
         assert(aligned_memory_size % (CACHE_LINE_SIZE) == 0); // Check that the aligned size is a multiple of the cache line size
-        queue = (tQueue *)aligned_alloc(CACHE_LINE_SIZE, aligned_memory_size);
-        assert(queue != NULL);
+        size_t memory_size = aligned_memory_size;
+        if (huge_pages) {
+            // Huge pages, rounded up to the huge page size, the queue buffer uses the complete allocation
+            queue = (tQueue *)platformMemAllocHuge(&memory_size);
+            assert(queue != NULL);
+            aligned_memory_size = sizeof(tQueue) + (((memory_size - sizeof(tQueue)) / QUEUE_ENTRY_SIZE) * QUEUE_ENTRY_SIZE);
+            platformMemLock(queue, memory_size);
+        } else {
+            queue = (tQueue *)aligned_alloc(CACHE_LINE_SIZE, aligned_memory_size);
+            assert(queue != NULL);
+        }
         assert(((uint64_t)queue % CACHE_LINE_SIZE) == 0);         // Check alignment of the allocated memory
         assert(((uint64_t)queue->buffer % CACHE_LINE_SIZE) == 0); // Check alignment of the buffer memory
         memset(queue, 0, aligned_memory_size);                    // Clear complete queue memory
         queue->h.from_memory = false;
+        queue->h.huge_pages = huge_pages;
+        queue->h.memory_size = (uint32_t)memory_size;
         queue->h.magic = QUEUE_MAGIC;
-        queue->h.buffer_size = aligned_memory_size - (uint32_t)sizeof(tQueueHeader); // Set the queue buffer size (excluding the queue descriptor)
+        queue->h.buffer_size = aligned_memory_size - (uint32_t)sizeof(tQueue); // Set the queue buffer size (excluding the queue descriptor)
         assert((queue->h.buffer_size % QUEUE_ENTRY_SIZE) == 0);                      // Check that the queue buffer size is a multiple of the entry size
         assert((queue->h.buffer_size % CACHE_LINE_SIZE) == 0);                       // Check that the queue buffer size is a multiple of the cache line size
         assert((queue->h.buffer_size % QUEUE_PAYLOAD_SIZE_ALIGNMENT) == 0);          // Check that the queue buffer size is a multiple of the required alignment
@@ -331,19 +221,24 @@ tQueueHandle queueInitFromMemory(void *queue_memory, size_t queue_memory_size, b
     // Queue memory is provided by the caller and should be initialized
     else if (clear_queue) {
         queue = (tQueue *)queue_memory;
+        if (huge_pages)
+            platformMemLock(queue, queue_memory_size);
         memset(queue, 0, queue_memory_size);
         queue->h.from_memory = true;
         queue->h.magic = QUEUE_MAGIC;
-        queue->h.buffer_size = (((queue_memory_size - sizeof(tQueueHeader)) / QUEUE_ENTRY_SIZE) * QUEUE_ENTRY_SIZE);
+        queue->h.buffer_size = (((queue_memory_size - sizeof(tQueue)) / QUEUE_ENTRY_SIZE) * QUEUE_ENTRY_SIZE);
     }
 
     // Queue is provided by the caller and already initialized
     else {
         queue = (tQueue *)queue_memory;
         assert(queue->h.magic == QUEUE_MAGIC);
+        if (huge_pages)
+            platformMemLock(queue, queue_memory_size);
     }
 
     if (clear_queue) {
+        queueStatsInit(&queue->stats, !queue->h.from_memory);
         queueClear((tQueueHandle)queue); // Clear the queue
     }
 
@@ -364,23 +259,46 @@ void queueClear(tQueueHandle queue_handle) {
     atomic_store_explicit(&queue->h.tail, 0, memory_order_relaxed);
     atomic_store_explicit(&queue->h.packets_lost, 0, memory_order_relaxed);
     atomic_store_explicit(&queue->h.flush_offset, 0xFFFFFFFFFFFFFFFFULL, memory_order_relaxed);
+#ifdef OPTION_QUEUE_NOTIFY
+    atomic_store_explicit(&queue->c.notified, 0, memory_order_relaxed);
+#endif
     memset(queue->buffer, 0, queue->h.buffer_size); // Clear queue buffer memory
+    queueStatsClear(&queue->stats);
     DBG_PRINT6("queueClear\n");
 }
 
-tQueueHandle queueInit(size_t queue_buffer_size) { return queueInitFromMemory(NULL, queue_buffer_size + sizeof(tQueueHeader), true, NULL); }
+void queueSetOverflowPolicy(tQueueHandle queue_handle, uint8_t policy, uint8_t headroom_percent) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(policy == QUEUE_OVERFLOW_DROP_NEWEST || policy == QUEUE_OVERFLOW_GRADED_HEADROOM);
+    assert(headroom_percent <= 50);
+
+    queue->h.policy = policy;
+    queue->h.headroom = (uint32_t)((((uint64_t)queue->h.buffer_size * headroom_percent) / 100) / QUEUE_ENTRY_SIZE) * QUEUE_ENTRY_SIZE;
+    DBG_PRINTF3("Queue overflow policy %u, priority headroom %u%% (%u entries)\n", policy, headroom_percent, queue->h.headroom / QUEUE_ENTRY_SIZE);
+}
+
+tQueueHandle queueInitFromMemory(void *queue_memory, size_t queue_memory_size, bool clear_queue, uint64_t *out_buffer_size) {
+    return queueInitFromMemoryEx(queue_memory, queue_memory_size, clear_queue, out_buffer_size, QUEUE_HUGE_PAGES_DEFAULT);
+}
+
+tQueueHandle queueInitEx(size_t queue_buffer_size, bool huge_pages) { return queueInitFromMemoryEx(NULL, queue_buffer_size + sizeof(tQueue), true, NULL, huge_pages); }
+
+tQueueHandle queueInit(size_t queue_buffer_size) { return queueInitEx(queue_buffer_size, QUEUE_HUGE_PAGES_DEFAULT); }
 
 void queueDeinit(tQueueHandle queue_handle) {
     tQueue *queue = (tQueue *)queue_handle;
     assert(queue != NULL);
 
-    // Print statistics
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-    lock_test_print_results();
-#endif
-
     queueClear(queue_handle);
-    free(queue);
+    if (!queue->h.from_memory) {
+        queueStatsFree(&queue->stats);
+        if (queue->h.huge_pages) {
+            platformMemFree(queue, queue->h.memory_size);
+        } else {
+            free(queue);
+        }
+    }
     DBG_PRINT6("QueueDeInit\n");
 }
 
@@ -390,7 +308,16 @@ void queueDeinit(tQueueHandle queue_handle) {
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 // For multiple producers !!
 
-tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
+// Maximum queue level for a producer with the given priority
+static inline uint32_t get_queue_limit(const tQueue *queue, uint8_t priority) {
+    if (priority == QUEUE_PRIORITY_NORMAL)
+        return queue->h.buffer_size - queue->h.headroom;
+    if (queue->h.policy == QUEUE_OVERFLOW_DROP_NEWEST)
+        return queue->h.buffer_size;
+    return queue->h.buffer_size - queue->h.headroom + (uint32_t)(((uint64_t)queue->h.headroom * priority) / QUEUE_PRIORITY_HIGH);
+}
+
+tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len, uint8_t priority) {
 
     tQueue *queue = (tQueue *)queue_handle;
     assert(queue != NULL);
@@ -422,10 +349,9 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
     uint16_t msg_len = aligned_packet_len + QUEUE_ENTRY_USER_HEADER_SIZE;
     assert(msg_len <= QUEUE_ENTRY_USER_SIZE);
 
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-    uint64_t spin_start = get_timestamp_ns();
-    uint32_t spin_count = 0;
-#endif
+    tQueueStatsProducer *stats = queueStatsGetProducer(&queue->stats);
+    uint64_t stats_start = queueStatsBegin();
+    uint32_t retries = 0;
 
     // Prepare a new entry in reserved state
     tQueueEntry *entry = NULL;
@@ -434,6 +360,10 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
     // The tail is read relaxed, head and tail are in the same cache line, but even if the tail could be stale, it is no problem
     uint64_t head = atomic_load_explicit(&queue->h.head, memory_order_acquire);
     uint64_t tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed);
+    if (tail > head) {
+        tail = head; // The consumer released entries after the head was loaded, the head is stale and the CAS will fail and reload it
+    }
+    uint32_t limit = get_queue_limit(queue, priority);
     uint32_t level;
 
     // Spin loop
@@ -445,7 +375,7 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
         level = (uint32_t)(head - tail);
         assert(queue->h.buffer_size >= level);
         assert((level % QUEUE_ENTRY_SIZE) == 0);
-        if (queue->h.buffer_size == level) {
+        if (limit < level + QUEUE_ENTRY_SIZE) {
             break; // Overrun
         }
 
@@ -454,18 +384,21 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
         if (atomic_compare_exchange_weak_explicit(&queue->h.head, &head, head + QUEUE_ENTRY_SIZE, memory_order_acq_rel, memory_order_acquire)) {
             entry = (tQueueEntry *)(queue->buffer + (head % queue->h.buffer_size));
             // Store the overall user length (header+payload) (msg_len) in the entry_header
-            // High word is still 0, which is the reserved state, not committed yet
-            atomic_store_explicit(&entry->entry_header, (uint32_t)msg_len, memory_order_release);
+            // High word is the producer tag, which is the reserved state, not committed yet
+            uint16_t producer_tag = queueGetProducerTag(queue, queue->stats.h.generation);
+            atomic_store_explicit(&entry->entry_header, ((uint32_t)producer_tag << 16) | (uint32_t)msg_len, memory_order_release);
             break;
         }
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-        spin_count++;
-#endif
+        retries++;
+
+        // The CAS reloaded the head, reload the tail as well, a tail older than the head would overestimate the level
+        tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed);
+        if (tail > head) {
+            tail = head;
+        }
     } // for (;;)
 
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-    lock_test_add_sample(get_timestamp_ns() - spin_start, spin_count);
-#endif
+    queueStatsAcquire(&queue->stats, stats, stats_start, retries, level / QUEUE_ENTRY_SIZE, 1, entry != NULL);
 
     if (entry == NULL) { // Overflow
         uint32_t lost = (uint32_t)atomic_fetch_add_explicit(&queue->h.packets_lost, 1, memory_order_acq_rel);
@@ -515,6 +448,104 @@ void queuePush(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer, bool
     DBG_PRINTF6("queuePush: committed entry %u with size %u\n", (uint32_t)((uint8_t *)entry - queue->buffer) / QUEUE_ENTRY_SIZE, queue_buffer->size);
 }
 
+// Acquire multiple consecutive entries with one CAS on the head
+// The consumer peeks entries in sequential order and stops at the first entry not committed
+bool queueAcquireMulti(tQueueHandle queue_handle, const uint16_t *payload_sizes, uint16_t count, uint8_t priority, tQueueBuffer *queue_buffers) {
+
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(payload_sizes != NULL && queue_buffers != NULL && count > 0);
+
+    // Check and align the packet lengths
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t packet_len = payload_sizes[i];
+        if (!(packet_len > 0 && packet_len <= QUEUE_ENTRY_USER_PAYLOAD_SIZE)) {
+            DBG_PRINTF_ERROR("Invalid packet_len %u, must be between 1 and %u\n", packet_len, QUEUE_ENTRY_USER_PAYLOAD_SIZE);
+            return false;
+        }
+        queue_buffers[i].size = (uint16_t)((packet_len + QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1) & ~(QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1));
+    }
+    uint32_t reserve_len = (uint32_t)count * QUEUE_ENTRY_SIZE;
+
+    tQueueStatsProducer *stats = queueStatsGetProducer(&queue->stats);
+    uint64_t stats_start = queueStatsBegin();
+    uint32_t retries = 0;
+
+    uint64_t head = atomic_load_explicit(&queue->h.head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed);
+    if (tail > head) {
+        tail = head; // The consumer released entries after the head was loaded, the head is stale and the CAS will fail and reload it
+    }
+    uint32_t limit = get_queue_limit(queue, priority);
+    uint32_t level = 0;
+    bool acquired = false;
+
+    // Spin loop, same as in queueAcquire, but for count entries
+    for (;;) {
+
+        // Check for overrun
+        level = (uint32_t)(head - tail);
+        assert(queue->h.buffer_size >= level);
+        if (limit < level + reserve_len) {
+            break; // Overrun
+        }
+
+        // Try to increment the head by count entries
+        if (atomic_compare_exchange_weak_explicit(&queue->h.head, &head, head + reserve_len, memory_order_acq_rel, memory_order_acquire)) {
+            acquired = true;
+            break;
+        }
+        retries++;
+
+        // The CAS reloaded the head, reload the tail as well, see queueAcquire
+        tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed);
+        if (tail > head) {
+            tail = head;
+        }
+    } // for (;;)
+
+    queueStatsAcquire(&queue->stats, stats, stats_start, retries, level / QUEUE_ENTRY_SIZE, count, acquired);
+
+    if (!acquired) { // Overflow
+        uint32_t lost = (uint32_t)atomic_fetch_add_explicit(&queue->h.packets_lost, count, memory_order_acq_rel);
+        if (lost == 0)
+            DBG_PRINTF6("Queue overrun, count=%u, h=%" PRIu64 ", t=%" PRIu64 ", level=%u, size=%u\n", count, head, tail, level / QUEUE_ENTRY_SIZE, queue->h.buffer_size);
+        return false;
+    }
+
+    // Store the user length in the entry headers, high word is the producer tag, which is the reserved state
+    uint16_t producer_tag = queueGetProducerTag(queue, queue->stats.h.generation);
+    for (uint16_t i = 0; i < count; i++) {
+        tQueueEntry *entry = (tQueueEntry *)(queue->buffer + (head % queue->h.buffer_size));
+        atomic_store_explicit(&entry->entry_header, ((uint32_t)producer_tag << 16) | (uint32_t)(queue_buffers[i].size + QUEUE_ENTRY_USER_HEADER_SIZE), i == 0 ? memory_order_release : memory_order_relaxed);
+        queue_buffers[i].buffer = entry->data + QUEUE_ENTRY_USER_HEADER_SIZE;
+        head += QUEUE_ENTRY_SIZE;
+    }
+    return true;
+}
+
+// Commit multiple entries from queueAcquireMulti with one release store
+void queuePushMulti(tQueueHandle queue_handle, const tQueueBuffer *queue_buffers, uint16_t count, bool flush) {
+
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(queue_buffers != NULL && count > 0);
+
+    // Set flush request on the last entry
+    if (flush) {
+        uint64_t flush_offset = queue_buffers[count - 1].buffer - QUEUE_ENTRY_USER_HEADER_SIZE - 4 - queue->buffer;
+        atomic_store_explicit(&queue->h.flush_offset, flush_offset, memory_order_relaxed);
+    }
+
+    // Commit all entries except the first one with relaxed stores
+    // Then commit the first entry with a release store, which makes the data of all entries visible to the consumer
+    for (uint16_t i = count; i-- > 0;) {
+        tQueueEntry *entry = (tQueueEntry *)(queue_buffers[i].buffer - QUEUE_ENTRY_USER_HEADER_SIZE - 4);
+        atomic_store_explicit(&entry->entry_header, (ENTRY_COMMITTED << 16) | (uint32_t)(queue_buffers[i].size + QUEUE_ENTRY_USER_HEADER_SIZE),
+                              i == 0 ? memory_order_release : memory_order_relaxed);
+    }
+}
+
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 // Consumer functions
@@ -542,6 +573,29 @@ uint32_t queueLevel(tQueueHandle queue_handle, uint32_t *queue_max_level) {
 
 // Check if there is a packet in the transmit queue at index
 // Return the packet length and a pointer to the message
+// Check if a producer tag is in the list of dead producers
+static bool is_dead_producer(tQueue *queue, uint16_t producer_tag) {
+    for (uint32_t i = 0; i < QUEUE_DEAD_PRODUCER_COUNT; i++) {
+        if (atomic_load_explicit(&queue->r.dead_tag[i], memory_order_relaxed) == producer_tag)
+            return true;
+    }
+    return false;
+}
+
+// Release the uncommitted entry at the tail, if it was reserved by a producer process, which died before committing it
+static bool reclaim_entry(tQueue *queue, tQueueEntry *entry, uint32_t entry_header) {
+    uint16_t producer_tag = (uint16_t)(entry_header >> 16);
+    uint16_t msg_len = (uint16_t)(entry_header & ENTRY_SIZE_MASK);
+    if (producer_tag == 0 || msg_len == 0 || !is_dead_producer(queue, producer_tag)) {
+        return false;
+    }
+    DBG_PRINTF_WARNING("queuePeek: reclaimed uncommitted entry %u of dead producer %u\n", (uint32_t)((uint8_t *)entry - queue->buffer) / QUEUE_ENTRY_SIZE, producer_tag);
+    atomic_store_explicit(&entry->entry_header, 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&queue->h.tail, QUEUE_ENTRY_SIZE, memory_order_release);
+    atomic_fetch_add_explicit(&queue->h.packets_lost, 1, memory_order_relaxed);
+    return true;
+}
+
 // Returns the number of packets lost since the last call
 // May be called multiple times, even with the same index, but the entries obtained must be released in sequential index order
 // Not thread safe, queuePeek and queueRelease must be called from one single consumer thread only
@@ -558,11 +612,14 @@ tQueueBuffer queuePeek(tQueueHandle queue_handle, uint32_t index, uint32_t *pack
         }
     }
 
+    uint64_t stats_start = queueStatsBegin();
+
     uint64_t tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed) + (index * QUEUE_ENTRY_SIZE);
     uint64_t head = atomic_load_explicit(&queue->h.head, memory_order_relaxed);
 
     // Check if there is data in the queue at index
     if (head <= tail) {
+        queueStatsPeek(&queue->stats, stats_start, 0);
         tQueueBuffer ret = {
             .buffer = NULL,
             .size = 0,
@@ -584,13 +641,19 @@ tQueueBuffer queuePeek(tQueueHandle queue_handle, uint32_t index, uint32_t *pack
     if (commit_state != ENTRY_COMMITTED) {
 
         // This should never happen
-        // An entry is consistent, if it is either in initial or committed state
-        if (commit_state != 0) {
+        // An entry is consistent, if it is either in initial, reserved or committed state
+        if (commit_state > ENTRY_RESERVED_MAX) {
             DBG_PRINTF_ERROR("queuePeek inconsistent reserved - h=%" PRIu64 ", t=%" PRIu64 ", level=%u, entry: (entry_header=%" PRIx32 ")\n", head, tail, level, entry_header);
             assert(false); // Fatal error, inconsistent state
         }
 
+        // Skip the entry at the tail, if its producer process died before committing it
+        if (index == 0 && reclaim_entry(queue, entry, entry_header)) {
+            return queuePeek(queue_handle, 0, NULL, flush_requested);
+        }
+
         // Nothing to read, the entry is still in reserved state, currently being written by the producer
+        queueStatsPeek(&queue->stats, stats_start, 0);
         tQueueBuffer ret = {
             .buffer = NULL,
             .size = 0,
@@ -627,10 +690,110 @@ tQueueBuffer queuePeek(tQueueHandle queue_handle, uint32_t index, uint32_t *pack
         }
     }
 
+    queueStatsPeek(&queue->stats, stats_start, 1);
     DBG_PRINTF6("queuePeek: returning entry %u with payload size %u\n", (uint32_t)((uint8_t *)entry - queue->buffer) / QUEUE_ENTRY_SIZE, ret.size);
     return ret;
 }
 
+// Get all committed entries from index on, which fit into max_bytes, with a single load of head and tail
+uint32_t queuePeekBatch(tQueueHandle queue_handle, uint32_t index, uint32_t max_bytes, tQueueBuffer *queue_buffers, uint32_t max_count, uint32_t *packets_lost,
+                        bool *flush_requested) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(queue_buffers != NULL);
+
+    if (packets_lost != NULL) {
+        uint32_t lost = (uint32_t)atomic_exchange_explicit(&queue->h.packets_lost, 0, memory_order_acq_rel);
+        *packets_lost = lost;
+        if (lost) {
+            DBG_PRINTF6("queuePeekBatch: packets lost since last call: %u\n", lost);
+        }
+    }
+
+    uint64_t stats_start = queueStatsBegin();
+
+    uint64_t tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed) + (index * QUEUE_ENTRY_SIZE);
+    uint64_t head = atomic_load_explicit(&queue->h.head, memory_order_relaxed);
+    uint64_t flush_offset = atomic_load_explicit(&queue->h.flush_offset, memory_order_relaxed);
+
+    uint32_t count = 0;
+    uint32_t bytes = 0;
+    while (count < max_count && tail < head) {
+        assert(head - tail <= queue->h.buffer_size);
+        tQueueEntry *entry = (tQueueEntry *)(queue->buffer + (tail % queue->h.buffer_size));
+
+        //  Check the entry commit state
+        uint32_t entry_header = atomic_load_explicit(&entry->entry_header, memory_order_acquire);
+        uint16_t payload_length = (uint16_t)(entry_header & 0xFFFF); // Payload length
+        uint16_t commit_state = (uint16_t)(entry_header >> 16);      // Commit state
+        if (commit_state != ENTRY_COMMITTED) {
+            if (commit_state > ENTRY_RESERVED_MAX) {
+                DBG_PRINTF_ERROR("queuePeekBatch inconsistent reserved - h=%" PRIu64 ", t=%" PRIu64 ", entry: (entry_header=%" PRIx32 ")\n", head, tail, entry_header);
+                assert(false); // Fatal error, inconsistent state
+            }
+            if (index == 0 && count == 0 && reclaim_entry(queue, entry, entry_header)) {
+                tail += QUEUE_ENTRY_SIZE;
+                continue; // Entry at the tail of a dead producer skipped
+            }
+            break; // Entry is still in reserved state
+        }
+        if (!((payload_length > 0) && (payload_length <= QUEUE_ENTRY_USER_SIZE))) {
+            DBG_PRINTF_ERROR("queuePeekBatch: inconsistent commit - h=%" PRIu64 ", t=%" PRIu64 ", entry: (entry_header=%" PRIx32 ")\n", head, tail, entry_header);
+            assert(false); // Fatal error, corrupt committed state
+            break;
+        }
+        if (bytes + payload_length > max_bytes) {
+            break;
+        }
+
+        queue_buffers[count].buffer = (uint8_t *)entry + 4; // Byte pointer to the user header of this message entry
+        queue_buffers[count].size = payload_length;         // Includes the user header size
+        bytes += payload_length;
+        count++;
+        tail += QUEUE_ENTRY_SIZE;
+
+        if (flush_offset == (uint64_t)((uint8_t *)entry - queue->buffer)) {
+            if (flush_requested != NULL) {
+                *flush_requested = true;
+            }
+            break;
+        }
+    }
+
+    queueStatsPeek(&queue->stats, stats_start, count);
+    return count;
+}
+
+bool queueWait(tQueueHandle queue_handle, uint32_t timeout_us) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    queueStatsWait(&queue->stats);
+    // Producers do not notify, poll with max 1ms sleep, queueNotify ends the sleep early
+#ifdef OPTION_QUEUE_NOTIFY
+    uint32_t seq = atomic_load_explicit(&queue->c.notify_seq, memory_order_acquire);
+    if (atomic_exchange_explicit(&queue->c.notified, 0, memory_order_acquire) != 0) {
+        return true;
+    }
+    // A queueNotify after the load of seq changed notify_seq, the wait returns immediately
+    platformWaitOnAddress(&queue->c.notify_seq, seq, timeout_us < 1000 ? timeout_us : 1000);
+#else
+    sleepUs(timeout_us < 1000 ? timeout_us : 1000);
+#endif
+    return true;
+}
+
+void queueNotify(tQueueHandle queue_handle) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+#ifdef OPTION_QUEUE_NOTIFY
+    atomic_store_explicit(&queue->c.notified, 1, memory_order_release);
+    atomic_fetch_add_explicit(&queue->c.notify_seq, 1, memory_order_release);
+    platformWakeOnAddress(&queue->c.notify_seq);
+#else
+    (void)queue; // The consumer polls
+#endif
+}
+
 void queueRelease(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer) {
     tQueue *queue = (tQueue *)queue_handle;
     assert(queue != NULL);
@@ -650,5 +813,75 @@ void queueRelease(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer) {
     atomic_fetch_add_explicit(&queue->h.tail, QUEUE_ENTRY_SIZE, memory_order_release);
 }
 
+void queueReleaseBatch(tQueueHandle queue_handle, const tQueueBuffer *queue_buffers, uint32_t count) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(queue_buffers != NULL);
+    if (count == 0)
+        return;
+
+    // Clear the entries commit states and increment the tail once
+    for (uint32_t i = 0; i < count; i++) {
+        assert(queue_buffers[i].buffer != NULL);
+        tQueueEntry *entry = (tQueueEntry *)(queue_buffers[i].buffer - 4);
+        assert((uint32_t)((uint8_t *)entry - queue->buffer) % QUEUE_ENTRY_SIZE == 0);
+        atomic_store_explicit(&entry->entry_header, 0, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&queue->h.tail, (uint64_t)count * QUEUE_ENTRY_SIZE, memory_order_release);
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Producer processes
+
+uint16_t queueRegisterProducer(tQueueHandle queue_handle) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+
+    // Tags are never reused before the counter wraps around, a restarted process gets a new tag
+    uint16_t producer_tag = (uint16_t)(atomic_fetch_add_explicit(&queue->r.tag_counter, 1, memory_order_relaxed) % ENTRY_RESERVED_MAX + 1);
+
+    // A tag reissued after the counter wrapped around must not be reclaimed
+    for (uint32_t i = 0; i < QUEUE_DEAD_PRODUCER_COUNT; i++) {
+        uint_least32_t dead_tag = producer_tag;
+        atomic_compare_exchange_strong_explicit(&queue->r.dead_tag[i], &dead_tag, 0, memory_order_relaxed, memory_order_relaxed);
+    }
+
+    // The tag is kept per process and queue instance
+    queueSetProducerTag(queue, queue->stats.h.generation, producer_tag);
+    DBG_PRINTF3("queueRegisterProducer: producer_tag=%u\n", producer_tag);
+    return producer_tag;
+}
+
+void queueReclaimProducer(tQueueHandle queue_handle, uint16_t producer_tag) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+
+    if (producer_tag == 0 || producer_tag > ENTRY_RESERVED_MAX)
+        return;
+    if (is_dead_producer(queue, producer_tag))
+        return;
+    uint32_t index = (uint32_t)atomic_fetch_add_explicit(&queue->r.dead_index, 1, memory_order_relaxed) % QUEUE_DEAD_PRODUCER_COUNT;
+    atomic_store_explicit(&queue->r.dead_tag[index], producer_tag, memory_order_relaxed);
+    DBG_PRINTF3("queueReclaimProducer: producer_tag=%u\n", producer_tag);
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Statistics
+
+bool queueGetStatistics(tQueueHandle queue_handle, uint32_t producer, tQueueStatistics *statistics) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(statistics != NULL);
+
+    statistics->level = queueLevel(queue_handle, &statistics->queue_size);
+    return queueStatsGet(&queue->stats, producer, statistics);
+}
+
+void queueResetStatistics(tQueueHandle queue_handle) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    queueStatsClear(&queue->stats);
+}
+
 #endif // OPTION_QUEUE_64_FIX_SIZE
 #endif // PLATFORM_64BIT && !defined(_WIN) && !defined(OPTION_ATOMIC_EMULATION)
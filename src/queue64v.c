@@ -5,6 +5,7 @@
 | Description:
 |   Lockless, variable entry size queue
 |   Multi producer single consumer (producer side is thread safe and lockless)
+|   Optional sharded producer lanes (OPTION_QUEUE_64_VAR_SIZE_LANES), merged by the consumer
 |   Designed for x86 strong and ARM weak memory model
 |
 | Copyright (c) Vector Informatik GmbH. All rights reserved.
@@ -20,6 +21,7 @@
 #ifdef OPTION_QUEUE_64_VAR_SIZE
 
 #include "queue.h"
+#include "queue_stats.h"
 
 #include <assert.h>    // for assert
 #include <inttypes.h>  // for PRIu64
@@ -70,105 +72,25 @@ static_assert(sizeof(void *) == 8, "This implementation requires a 64 Bit platfo
 // Test atomic_uint_least32_t availability
 static_assert(sizeof(atomic_uint_least32_t) == 4, "atomic_uint_least32_t must be 4 bytes");
 
-//-------------------------------------------------------------------------------------------------------------------------------------------------------
-// Test
-
-// Queue acquire lock timing and spin
-// For high contention use test queue_test or example daq_test with xcpclient --upload-a2l --udp --mea .  --dest-addr 192.168.0.206
-// Note that this tests have significant performance impact, do not turn on for production use !!!!!!!!!!!
-
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-
-static MUTEX lock_mutex = MUTEX_INTIALIZER;
-static uint64_t lock_time_max = 0;
-static uint64_t lock_time_sum = 0;
-static uint64_t lock_count = 0;
-static uint64_t lock_spin_count_max = 0;
-// Variable-width lock timing histogram
-// Fine granularity for short latencies, coarser for long-tail latencies
-// Bin[i] counts events where EDGES[i-1] <= t < EDGES[i]; bin[SIZE-1] is the overflow (>EDGES[SIZE-2])
-#define LOCK_TIME_HISTOGRAM_SIZE 26
-static const uint64_t LOCK_TIME_HISTOGRAM_EDGES[LOCK_TIME_HISTOGRAM_SIZE - 1] = {
-    40,    80,    120,   160,    200,    240, 280, 320, 360, 400, // 10 bins: 40ns steps
-    600,   800,   1000,  1500,   2000,                            //  5 bins: 200-500ns steps (up to 2us)
-    3000,  4000,  6000,  8000,   10000,                           //  5 bins: 1-2us steps (up to 10us)
-    20000, 40000, 80000, 160000, 320000,                          //  5 bins: 10-160us steps (up to 320us, preemption range)
-};
-static uint64_t lock_time_histogram[LOCK_TIME_HISTOGRAM_SIZE] = {0};
-
-// There should be better alternatives in your target specific environment than this portable reference
-// Select a clock mode appropriate for your platform, CLOCK_MONOTONIC_RAW is a good choice for high resolution and monotonicity
-static uint64_t get_timestamp_ns(void) {
-    static const uint64_t kNanosecondsPerSecond = 1000000000ULL;
-    struct timespec ts = {0};
-    clock_gettime(CLOCK_MONOTONIC_RAW, &ts); // NOLINT(missing-includes) // do **not** include internal "bits" headers directly.
-    return ((uint64_t)ts.tv_sec) * kNanosecondsPerSecond + ((uint64_t)ts.tv_nsec);
-}
-
-static void lock_test_add_sample(uint64_t d, uint32_t spin_count) {
-    mutexLock(&lock_mutex);
-    if (spin_count > lock_spin_count_max)
-        lock_spin_count_max = spin_count;
-    if (d > lock_time_max)
-        lock_time_max = d;
-    int i = 0;
-    while (i < LOCK_TIME_HISTOGRAM_SIZE - 1 && d >= LOCK_TIME_HISTOGRAM_EDGES[i])
-        i++;
-    lock_time_histogram[i]++;
-    lock_time_sum += d;
-    lock_count++;
-    mutexUnlock(&lock_mutex);
-}
-
-static void lock_test_print_results(void) {
-    printf("\nProducer acquire lock time statistics:\n");
-    printf("  count=%" PRIu64 "  max_spins=%" PRIu64 "  max=%" PRIu64 "ns  avg=%" PRIu64 "ns\n", lock_count, lock_spin_count_max, lock_time_max, lock_time_sum / lock_count);
-
-    uint64_t histogram_sum = 0;
-    for (int i = 0; i < LOCK_TIME_HISTOGRAM_SIZE; i++)
-        histogram_sum += lock_time_histogram[i];
-    uint64_t histogram_max = 0;
-    for (int i = 0; i < LOCK_TIME_HISTOGRAM_SIZE; i++)
-        if (lock_time_histogram[i] > histogram_max)
-            histogram_max = lock_time_histogram[i];
-
-    printf("\nLock time histogram (%" PRIu64 " events):\n", histogram_sum);
-    printf("  %-20s  %10s  %7s  %s\n", "Range", "Count", "%", "Bar");
-    printf("  %-20s  %10s  %7s  %s\n", "--------------------", "----------", "-------", "------------------------------");
-
-    for (int i = 0; i < LOCK_TIME_HISTOGRAM_SIZE; i++) {
-        if (!lock_time_histogram[i])
-            continue;
-        double pct = (double)lock_time_histogram[i] * 100.0 / (double)histogram_sum;
+// Entry size is stored in 16 bit of the entry header
+static_assert(QUEUE_MAX_ENTRY_SIZE <= 0xFFFF, "QUEUE_MAX_ENTRY_SIZE must fit into 16 bit");
 
-        char range_str[32];
-        uint64_t lo = (i == 0) ? 0 : LOCK_TIME_HISTOGRAM_EDGES[i - 1];
-        if (i == LOCK_TIME_HISTOGRAM_SIZE - 1) {
-            snprintf(range_str, sizeof(range_str), ">%" PRIu64 "ns", lo);
-        } else {
-            snprintf(range_str, sizeof(range_str), "%" PRIu64 "-%" PRIu64 "ns", lo, LOCK_TIME_HISTOGRAM_EDGES[i]);
-        }
-
-        char bar[31];
-        int bar_len = (histogram_max > 0) ? (int)((double)lock_time_histogram[i] * 30.0 / (double)histogram_max) : 0;
-        if (bar_len > 30)
-            bar_len = 30;
-        for (int j = 0; j < bar_len; j++)
-            bar[j] = '#';
-        bar[bar_len] = '\0';
-
-        printf("  %-20s  %10" PRIu64 "  %6.2f%%  %s\n", range_str, lock_time_histogram[i], pct, bar);
-    }
-    printf("\n");
-}
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
 
+// Number of producer lanes
+// Each producer thread is assigned to one lane on its first acquire, the lanes are merged by the consumer
+#ifdef OPTION_QUEUE_64_VAR_SIZE_LANES
+#define QUEUE_LANE_COUNT (OPTION_QUEUE_64_VAR_SIZE_LANES)
+#else
+#define QUEUE_LANE_COUNT 1
 #endif
-
-//-------------------------------------------------------------------------------------------------------------------------------------------------------
+static_assert(QUEUE_LANE_COUNT >= 1 && QUEUE_LANE_COUNT <= 64, "QUEUE_LANE_COUNT must be between 1 and 64");
 
 // Queue entry states (higher 16 bit of header, lower 16 bit is used for payload size)
-#define CTR_RESERVED 0x0000u  // Reserved by producer, must be 0 because consumer clears the memory before releasing the entry
-#define CTR_COMMITTED 0xCCCCu // Committed by producer
+#define CTR_RESERVED 0x0000u        // Reserved by producer, must be 0 because consumer clears the memory before releasing the entry
+#define CTR_RESERVED_MAX 0x7FFFu    // Reserved by a registered producer, the state is the producer tag (1..0x7FFF), see queueRegisterProducer
+#define CTR_COMMITTED 0xCCCCu       // Committed by producer
+#define CTR_COMMITTED_FLUSH 0xCCCFu // Committed by producer with flush request, the consumer should prioritize this packet
 
 // Queue entry with header and payload
 // Header is used for synchronization and state management, payload is used for user payload and optional user header data
@@ -187,51 +109,189 @@ typedef struct {
 typedef union QueueHeader {
     struct {
         // Shared state
-        atomic_uint_fast64_t head;         // Consumer reads from head
-        atomic_uint_fast64_t tail;         // Producers write to tail
-        atomic_uint_fast32_t packets_lost; // Packet lost counter, incremented by producers when a queue entry could not be acquired
-        atomic_uint_fast64_t flush_offset; // Flush request head, set by producers to request the consumer to prioritize packets
-
-        // Consumer state for optimized peek loop
-        uint32_t cached_peek_index; // Cached index for optimized peek loop
-        uint64_t cached_peek_tail;  // Cached offset for optimized peek loop
+        atomic_uint_fast32_t lane_ticket; // Lane assignment counter, incremented once by each new producer thread
+        uint32_t generation;              // Queue instance, see queueGetTicket
 
         // Constant
-        uint64_t magic;      // Magic value for sanity checks
-        uint32_t queue_size; // Size of queue data buffer in bytes (for entry offset wrapping, with wrap around space at the end)
-        bool from_memory;    // Indicates whether the queue was initialized from user provided memory (true) or allocated by the queue implementation (false)
+        uint64_t magic;        // Magic value for sanity checks
+        uint32_t queue_size;   // Size of all lane data buffers in bytes (without wrap around space)
+        uint32_t lane_size;    // Size of a lane data buffer in bytes (for entry offset wrapping, with wrap around space at the end)
+        uint32_t lane_stride;  // Distance between the data buffers of two lanes in bytes (lane_size + wrap around space)
+        uint32_t notify_level; // Lane level in bytes, which wakes up a waiting consumer
+        uint32_t headroom;     // Lane space in bytes reserved for producers with priority, see queueSetOverflowPolicy
+        uint8_t policy;        // Overflow policy
+        uint16_t lane_count;   // Number of lanes, sanity check for queues in shared memory
+        bool from_memory;      // Indicates whether the queue was initialized from user provided memory (true) or allocated by the queue implementation (false)
+        bool huge_pages;       // Queue memory allocated with platformMemAllocHuge
+        uint32_t memory_size;  // Size of the allocated queue memory in bytes, for platformMemFree
     };
     uint8_t padding[CACHE_LINE_SIZE]; //  Padding to cache line size
 } tQueueHeader;
 
 static_assert(sizeof(tQueueHeader) == CACHE_LINE_SIZE, "QueueHeader size must be CACHE_LINE_SIZE");
 
+// Consumer state
+// Separate cache line, the header is read by the producers on each acquire
+typedef union QueueConsumer {
+    struct {
+        // Peek order of the lanes
+        uint32_t peek_first;     // Index of the oldest peeked and not yet released entry in peek_offset
+        uint32_t peek_count;     // Number of peeked and not yet released entries
+        uint32_t peek_next_lane; // Lane to start with on the next peek, round robin
+
+        // Consumer wakeup
+        atomic_uint_least32_t waiting;    // Consumer is blocked in queueWait, reset by the producer which wakes it up
+        atomic_uint_least32_t notify_seq; // Wakeup sequence counter, the consumer blocks on this value
+        atomic_uint_least32_t notified;   // Set by queueNotify, reset by the consumer in queueWait
+    };
+    uint8_t padding[CACHE_LINE_SIZE]; //  Padding to cache line size
+} tQueueConsumer;
+
+static_assert(sizeof(tQueueConsumer) == CACHE_LINE_SIZE, "QueueConsumer size must be CACHE_LINE_SIZE");
+
+// Producer processes of a queue in shared memory
+// Rarely written, on producer registration and when a dead producer is detected
+typedef union QueueProducers {
+    struct {
+        atomic_uint_least32_t tag_counter;                          // Producer tag allocation counter
+        atomic_uint_least32_t dead_index;                           // Next slot in dead_tag
+        atomic_uint_least32_t dead_tag[QUEUE_DEAD_PRODUCER_COUNT]; // Tags of dead producers, ring buffer, 0 is unused
+    };
+    uint8_t padding[CACHE_LINE_SIZE]; //  Padding to cache line size
+} tQueueProducers;
+
+static_assert(sizeof(tQueueProducers) == CACHE_LINE_SIZE, "QueueProducers size must be CACHE_LINE_SIZE");
+
+// Producer lane
+// Producer and consumer state are in separate cache lines
+// The producer cache line is only written by the producers of this lane and never touched by the consumer
+// The consumer cache line is read by the producers (tail), but only written by the consumer once per release and by producers on overflow
+typedef struct QueueLane {
+    union {
+        struct {
+            atomic_uint_fast64_t head; // Producers write to head
+        };
+        uint8_t padding[CACHE_LINE_SIZE];
+    } p;
+    union {
+        struct {
+            atomic_uint_fast64_t tail;         // Consumer reads from tail
+            atomic_uint_fast32_t packets_lost; // Packet lost counter, incremented by producers when a queue entry could not be acquired
+            uint64_t peek_tail;                // Consumer state, offset of the next entry not peeked yet
+        };
+        uint8_t padding[CACHE_LINE_SIZE];
+    } c;
+} tQueueLane;
+
+static_assert(sizeof(tQueueLane) == 2 * CACHE_LINE_SIZE, "QueueLane size must be 2*CACHE_LINE_SIZE");
+
 // Queue
 typedef struct Queue {
     tQueueHeader h;
+    tQueueConsumer c;
+    tQueueProducers r;
+    tQueueLane lane[QUEUE_LANE_COUNT];
+    tQueueStats stats;                          // Runtime statistics
+    uint32_t peek_offset[QUEUE_PEEK_MAX_COUNT]; // Buffer offsets of the peeked entries in peek order (ring buffer), the lane is peek_offset/lane_stride
     uint8_t buffer[];
 } tQueue;
 
+static_assert(sizeof(tQueue) % CACHE_LINE_SIZE == 0, "Queue data buffer must be aligned to CACHE_LINE_SIZE");
+
+// Lane tickets of the current producer thread, assigned on the first acquire to a queue
+#if QUEUE_LANE_COUNT > 1
+static THREAD_LOCAL tQueueTicketCache producer_lane_tickets;
+#endif
+
+static inline uint32_t get_producer_lane(tQueue *queue) {
+#if QUEUE_LANE_COUNT > 1
+    return queueGetTicket(&producer_lane_tickets, queue, queue->h.generation, &queue->h.lane_ticket) % QUEUE_LANE_COUNT;
+#else
+    (void)queue;
+    return 0;
+#endif
+}
+
+static inline uint8_t *get_lane_buffer(tQueue *queue, uint32_t lane) { return queue->buffer + (size_t)lane * queue->h.lane_stride; }
+
+// Maximum lane level for a producer with the given priority
+static inline uint32_t get_lane_limit(const tQueue *queue, uint8_t priority) {
+    if (priority == QUEUE_PRIORITY_NORMAL)
+        return queue->h.lane_size - queue->h.headroom;
+    if (queue->h.policy == QUEUE_OVERFLOW_DROP_NEWEST)
+        return queue->h.lane_size;
+    return queue->h.lane_size - queue->h.headroom + (uint32_t)(((uint64_t)queue->h.headroom * priority) / QUEUE_PRIORITY_HIGH);
+}
+
+#ifdef OPTION_QUEUE_NOTIFY
+
+// Wake up the consumer, if it is blocked in queueWait and there is a flush request or the level of the lane exceeds the notification level
+// Called by the producer after an entry has been committed
+static inline void notify_consumer(tQueue *queue, const tQueueEntry *entry, bool flush) {
+    if (!flush) {
+        tQueueLane *lane = &queue->lane[(uint32_t)((const uint8_t *)entry - queue->buffer) / queue->h.lane_stride];
+        uint64_t head = atomic_load_explicit(&lane->p.head, memory_order_relaxed);
+        uint64_t tail = atomic_load_explicit(&lane->c.tail, memory_order_relaxed);
+        if (head - tail < queue->h.notify_level) {
+            return;
+        }
+    }
+
+    // Order the commit store before the load of the waiting flag, the consumer does the same in the opposite direction
+    // Either the consumer sees the committed entry before it blocks, or this producer sees the consumer waiting
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->c.waiting, memory_order_relaxed) != 0) {
+        // Only one producer does the wakeup system call
+        if (atomic_exchange_explicit(&queue->c.waiting, 0, memory_order_relaxed) != 0) {
+            atomic_fetch_add_explicit(&queue->c.notify_seq, 1, memory_order_release);
+            platformWakeOnAddress(&queue->c.notify_seq);
+        }
+    }
+}
+
+#endif
+
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 
-tQueueHandle queueInitFromMemory(void *queue_memory, size_t queue_memory_size, bool clear_queue, uint64_t *out_buffer_size) {
+// Distance between the data buffers of two lanes for a given queue memory size
+static uint32_t get_lane_stride(size_t queue_memory_size) {
+    return (uint32_t)((queue_memory_size - sizeof(tQueue)) / QUEUE_LANE_COUNT) & ~(QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1);
+}
+
+tQueueHandle queueInitFromMemoryEx(void *queue_memory, size_t queue_memory_size, bool clear_queue, uint64_t *out_buffer_size, bool huge_pages) {
 
     tQueue *queue = NULL;
 
     DBG_PRINTF6("queueInitFromMemory: queue_memory=%p, queue_memory_size=%zu, clear_queue=%d\n", queue_memory, queue_memory_size, clear_queue);
+
+    // Check the queue size, each lane must fit at least 2 entries of maximum size
+    if ((queue_memory == NULL || clear_queue) &&
+        (queue_memory_size <= sizeof(tQueue) || queue_memory_size > 100ULL * 1024 * 1024 || get_lane_stride(queue_memory_size) < 2 * (QUEUE_MAX_ENTRY_SIZE + QUEUE_ENTRY_HEADER_SIZE))) {
+        DBG_PRINTF_ERROR("queueInitFromMemory: invalid queue size %zu, %u lanes need at least %u bytes\n", queue_memory_size, QUEUE_LANE_COUNT,
+                         (uint32_t)(sizeof(tQueue) + QUEUE_LANE_COUNT * (2 * (QUEUE_MAX_ENTRY_SIZE + QUEUE_ENTRY_HEADER_SIZE) + QUEUE_PAYLOAD_SIZE_ALIGNMENT)));
+        return NULL;
+    }
+
     // Allocate the queue memory
     if (queue_memory == NULL) {
         assert(queue_memory_size > 0);
         size_t aligned_size = (queue_memory_size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1); // Align to cache line size
-        assert(aligned_size <= 100ULL * 1024 * 1024); // Sanity check for size, 100 MiB should be enough for a queue, if you need more, increase this limit or remove it
-        queue = (tQueue *)aligned_alloc(CACHE_LINE_SIZE, aligned_size);
-        assert(queue != NULL);
+        if (huge_pages) {
+            // Huge pages, rounded up to the huge page size, the lanes use the complete allocation
+            queue = (tQueue *)platformMemAllocHuge(&aligned_size);
+            assert(queue != NULL);
+            memset(queue, 0, aligned_size);
+            platformMemLock(queue, aligned_size);
+        } else {
+            queue = (tQueue *)aligned_alloc(CACHE_LINE_SIZE, aligned_size);
+            assert(queue != NULL);
+            memset(queue, 0, aligned_size);
+        }
         assert(queue && ((uint64_t)queue % CACHE_LINE_SIZE) == 0);
-        memset(queue, 0, aligned_size);
         queue->h.from_memory = false;
-        queue->h.magic = QUEUE_MAGIC;
-        // Reserve header and entry wrap around space at the end of the buffer for maximum entry size QUEUE_MAX_ENTRY_SIZE
-        queue->h.queue_size = ((aligned_size - sizeof(tQueueHeader)) - (QUEUE_MAX_ENTRY_SIZE + QUEUE_ENTRY_HEADER_SIZE)) & ~(QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1);
+        queue->h.huge_pages = huge_pages;
+        queue->h.memory_size = (uint32_t)aligned_size;
+        queue_memory_size = aligned_size;
         clear_queue = true;
     }
 
@@ -239,40 +299,55 @@ tQueueHandle queueInitFromMemory(void *queue_memory, size_t queue_memory_size, b
     else if (clear_queue) {
         assert(queue_memory != NULL);
         queue = (tQueue *)queue_memory;
-        assert(queue_memory_size > 0);
-        assert(queue_memory_size <= 100ULL * 1024 * 1024); // Sanity check for size, 100 MiB should be enough for a queue, if you need more, increase this limit or remove it
+        if (huge_pages)
+            platformMemLock(queue, queue_memory_size);
         memset(queue, 0, queue_memory_size);
         queue->h.from_memory = true;
-        queue->h.magic = QUEUE_MAGIC;
-        // Reserve header and entry wrap around space at the end of the buffer for maximum entry size QUEUE_MAX_ENTRY_SIZE
-        queue->h.queue_size = ((queue_memory_size - sizeof(tQueueHeader)) - (QUEUE_MAX_ENTRY_SIZE + QUEUE_ENTRY_HEADER_SIZE)) & ~(QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1);
     }
 
     // Queue is provided by the caller and is already initialized
     else {
         queue = (tQueue *)queue_memory;
-        if (queue->h.magic != QUEUE_MAGIC)
+        if (queue->h.magic != QUEUE_MAGIC || queue->h.lane_count != QUEUE_LANE_COUNT)
             return NULL; // Invalid queue
+        if (huge_pages)
+            platformMemLock(queue, queue_memory_size);
+    }
+
+    if (clear_queue) {
+        // Split the data buffer into equal lanes
+        // Reserve entry wrap around space at the end of each lane for maximum entry size QUEUE_MAX_ENTRY_SIZE
+        queue->h.magic = QUEUE_MAGIC;
+        queue->h.lane_count = QUEUE_LANE_COUNT;
+        queue->h.lane_stride = get_lane_stride(queue_memory_size);
+        assert(queue->h.lane_stride >= 2 * (QUEUE_MAX_ENTRY_SIZE + QUEUE_ENTRY_HEADER_SIZE)); // Checked above
+        queue->h.lane_size = (queue->h.lane_stride - (QUEUE_MAX_ENTRY_SIZE + QUEUE_ENTRY_HEADER_SIZE)) & ~(QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1);
+        queue->h.queue_size = queue->h.lane_size * QUEUE_LANE_COUNT;
+#ifdef OPTION_QUEUE_NOTIFY_LEVEL
+        queue->h.notify_level = (uint32_t)(((uint64_t)queue->h.lane_size * OPTION_QUEUE_NOTIFY_LEVEL) / 100);
+#else
+        queue->h.notify_level = queue->h.lane_size;
+#endif
     }
 
     DBG_PRINT3("Init transport layer lockless queue (queue64v)\n");
-    DBG_PRINTF3("  alignment=%u, data buffer size=%u, max payload %u bytes, overall %uKiB used\n", //
-                QUEUE_PAYLOAD_SIZE_ALIGNMENT, queue->h.queue_size, QUEUE_MAX_ENTRY_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE,
-                (uint32_t)((queue->h.queue_size + sizeof(tQueueHeader)) / 1024));
+    DBG_PRINTF3("  alignment=%u, lanes=%u, data buffer size=%u, max payload %u bytes, overall %uKiB used\n", //
+                QUEUE_PAYLOAD_SIZE_ALIGNMENT, QUEUE_LANE_COUNT, queue->h.queue_size, QUEUE_MAX_ENTRY_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE,
+                (uint32_t)((queue->h.lane_stride * QUEUE_LANE_COUNT + sizeof(tQueue)) / 1024));
 
     if (clear_queue) {
+        queue->h.generation = queueNewGeneration();
+        queueStatsInit(&queue->stats, !queue->h.from_memory);
         queueClear((tQueueHandle)queue); // Clear the queue
     }
-    queue->h.cached_peek_index = 0;
-    queue->h.cached_peek_tail = 0;
 
     if (out_buffer_size) {
         *out_buffer_size = 0;
     }
 
     // Checks
-    assert(atomic_is_lock_free(&((tQueue *)queue_memory)->h.head));
-    assert((queue->h.queue_size & (QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1)) == 0);
+    assert(atomic_is_lock_free(&queue->lane[0].p.head));
+    assert((queue->h.lane_size & (QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1)) == 0);
 
     return (tQueueHandle)queue;
 }
@@ -281,30 +356,54 @@ void queueClear(tQueueHandle queue_handle) {
     tQueue *queue = (tQueue *)queue_handle;
     assert(queue != NULL);
 
-    atomic_store_explicit(&queue->h.head, 0, memory_order_relaxed);
-    atomic_store_explicit(&queue->h.tail, 0, memory_order_relaxed);
-    atomic_store_explicit(&queue->h.packets_lost, 0, memory_order_relaxed);
-    atomic_store_explicit(&queue->h.flush_offset, 0xFFFFFFFFFFFFFFFFULL, memory_order_relaxed);
-    queue->h.cached_peek_index = 0;
-    queue->h.cached_peek_tail = 0;
+    for (uint32_t i = 0; i < QUEUE_LANE_COUNT; i++) {
+        tQueueLane *lane = &queue->lane[i];
+        atomic_store_explicit(&lane->p.head, 0, memory_order_relaxed);
+        atomic_store_explicit(&lane->c.tail, 0, memory_order_relaxed);
+        atomic_store_explicit(&lane->c.packets_lost, 0, memory_order_relaxed);
+        lane->c.peek_tail = 0;
+    }
+    queue->c.peek_first = 0;
+    queue->c.peek_count = 0;
+    queue->c.peek_next_lane = 0;
+    atomic_store_explicit(&queue->c.waiting, 0, memory_order_relaxed);
+    atomic_store_explicit(&queue->c.notified, 0, memory_order_relaxed);
+    queueStatsClear(&queue->stats);
     DBG_PRINT6("queueClear\n");
 }
 
-tQueueHandle queueInit(size_t queue_buffer_size) { return queueInitFromMemory(NULL, queue_buffer_size + sizeof(tQueueHeader), true, NULL); }
+void queueSetOverflowPolicy(tQueueHandle queue_handle, uint8_t policy, uint8_t headroom_percent) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(policy == QUEUE_OVERFLOW_DROP_NEWEST || policy == QUEUE_OVERFLOW_GRADED_HEADROOM);
+    assert(headroom_percent <= 50);
+
+    queue->h.policy = policy;
+    queue->h.headroom = (uint32_t)(((uint64_t)queue->h.lane_size * headroom_percent) / 100) & ~(QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1);
+    DBG_PRINTF3("Queue overflow policy %u, priority headroom %u%% (%u bytes per lane)\n", policy, headroom_percent, queue->h.headroom);
+}
+
+tQueueHandle queueInitFromMemory(void *queue_memory, size_t queue_memory_size, bool clear_queue, uint64_t *out_buffer_size) {
+    return queueInitFromMemoryEx(queue_memory, queue_memory_size, clear_queue, out_buffer_size, QUEUE_HUGE_PAGES_DEFAULT);
+}
+
+tQueueHandle queueInitEx(size_t queue_buffer_size, bool huge_pages) { return queueInitFromMemoryEx(NULL, queue_buffer_size + sizeof(tQueue), true, NULL, huge_pages); }
+
+tQueueHandle queueInit(size_t queue_buffer_size) { return queueInitEx(queue_buffer_size, QUEUE_HUGE_PAGES_DEFAULT); }
 
 void queueDeinit(tQueueHandle queue_handle) {
     tQueue *queue = (tQueue *)queue_handle;
     assert(queue != NULL);
 
-    // Print statistics
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-    lock_test_print_results();
-#endif
-
     queueClear(queue_handle);
 
     if (!queue->h.from_memory) {
-        free(queue);
+        queueStatsFree(&queue->stats);
+        if (queue->h.huge_pages) {
+            platformMemFree(queue, queue->h.memory_size);
+        } else {
+            free(queue);
+        }
     }
 
     DBG_PRINT6("QueueDeInit\n");
@@ -315,14 +414,15 @@ void queueDeinit(tQueueHandle queue_handle) {
 // Producer functions
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 // For multiple producers !!
+// Producers assigned to different lanes never contend, producers sharing a lane serialize with a CAS loop on the lane head
 
-tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
+tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len, uint8_t priority) {
 
     tQueue *queue = (tQueue *)queue_handle;
     assert(queue != NULL);
 
-    if (!(packet_len > 0 && packet_len <= QUEUE_ENTRY_USER_PAYLOAD_SIZE)) {
-        DBG_PRINTF_ERROR("Invalid packet_len %u, must be between 1 and %u\n", packet_len, QUEUE_ENTRY_USER_PAYLOAD_SIZE);
+    if (!(packet_len > 0 && packet_len <= QUEUE_MAX_ENTRY_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE)) {
+        DBG_PRINTF_ERROR("Invalid packet_len %u, must be between 1 and %u\n", packet_len, QUEUE_MAX_ENTRY_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE);
         tQueueBuffer ret = {
             .buffer = NULL,
             .size = 0,
@@ -346,18 +446,24 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
 #endif
     assert(entry_len <= QUEUE_MAX_ENTRY_SIZE);
 
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-    uint64_t spin_start = get_timestamp_ns();
-    uint32_t spin_count = 0;
-#endif
+    tQueueStatsProducer *stats = queueStatsGetProducer(&queue->stats);
+    uint64_t stats_start = queueStatsBegin();
+    uint32_t retries = 0;
 
     // Prepare a new entry in reserved state
     tQueueEntry *entry = NULL;
 
-    // Load the head first will synchronize the queue header cache line
-    // The tail is read relaxed, head and tail are in the same cache line, but even if the tail could be stale, it is no problem
-    uint64_t head = atomic_load_explicit(&queue->h.head, memory_order_acquire);
-    uint64_t tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed);
+    // Get the lane of this producer thread and the maximum lane level for this priority
+    tQueueLane *lane = &queue->lane[get_producer_lane(queue)];
+    uint32_t limit = get_lane_limit(queue, priority);
+
+    // Load the head first will synchronize the lane producer cache line
+    // The tail is read relaxed from the lane consumer cache line, even if the tail could be stale, it is no problem
+    uint64_t head = atomic_load_explicit(&lane->p.head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&lane->c.tail, memory_order_relaxed);
+    if (tail > head) {
+        tail = head; // The consumer released entries after the head was loaded, the head is stale and the CAS will fail and reload it
+    }
 
     // CAS loop
     // In reserved state, the message entry is between tail and head, has valid dlc and ctr must be 0
@@ -365,15 +471,16 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
     for (;;) {
 
         // Check for overrun
-        if (queue->h.queue_size - (entry_len + QUEUE_ENTRY_HEADER_SIZE) < (head - tail)) {
+        if (limit < (head - tail) + (entry_len + QUEUE_ENTRY_HEADER_SIZE)) {
             break; // Overrun
         }
 
         // Try to increment the head
-        // Compare exchange weak in acq_rel/acq mode serializes with other producers, false negatives will spin
-        if (atomic_compare_exchange_weak_explicit(&queue->h.head, &head, head + (entry_len + QUEUE_ENTRY_HEADER_SIZE), memory_order_acq_rel, memory_order_acquire)) {
-            entry = (tQueueEntry *)(queue->buffer + (head % queue->h.queue_size));
-            atomic_store_explicit(&entry->header, (CTR_RESERVED << 16) | (uint32_t)entry_len, memory_order_release);
+        // Compare exchange weak in acq_rel/acq mode serializes with other producers on this lane, false negatives will spin
+        if (atomic_compare_exchange_weak_explicit(&lane->p.head, &head, head + (entry_len + QUEUE_ENTRY_HEADER_SIZE), memory_order_acq_rel, memory_order_acquire)) {
+            entry = (tQueueEntry *)(get_lane_buffer(queue, (uint32_t)(lane - queue->lane)) + (head % queue->h.lane_size));
+            uint16_t producer_tag = queueGetProducerTag(queue, queue->stats.h.generation);
+            atomic_store_explicit(&entry->header, ((uint32_t)producer_tag << 16) | (uint32_t)entry_len, memory_order_release);
             break;
         }
 
@@ -384,22 +491,17 @@ tQueueBuffer queueAcquire(tQueueHandle queue_handle, uint16_t packet_len) {
         // No hint, spin count is usually very low and we prefer the locked sequence as fast as possible
         // spin_loop_hint();
 
-        // Get spin count statistics
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-        spin_count++;
-        // assert(spin_count < 100); // No reason to be afraid about the spin count, enable spin count statistics to check
-#endif
+        // Count the retries, check the statistics for the spin count
+        retries++;
 
     } // for (;;)
 
-#ifdef TEST_ACQUIRE_LOCK_TIMING
-    lock_test_add_sample(get_timestamp_ns() - spin_start, spin_count);
-#endif
+    queueStatsAcquire(&queue->stats, stats, stats_start, retries, (uint32_t)(head - tail), 1, entry != NULL);
 
     if (entry == NULL) {
-        uint32_t lost = (uint32_t)atomic_fetch_add_explicit(&queue->h.packets_lost, 1, memory_order_acq_rel);
+        uint32_t lost = (uint32_t)atomic_fetch_add_explicit(&lane->c.packets_lost, 1, memory_order_acq_rel);
         if (lost == 0) {
-            DBG_PRINTF6("Queue overrun, len=%u, head=%" PRIu64 ", tail=%" PRIu64 ", level=%u, size=%u\n", entry_len, head, tail, (uint32_t)(head - tail), queue->h.queue_size);
+            DBG_PRINTF6("Queue overrun, len=%u, head=%" PRIu64 ", tail=%" PRIu64 ", level=%u, size=%u\n", entry_len, head, tail, (uint32_t)(head - tail), queue->h.lane_size);
         }
         tQueueBuffer ret = {
             .buffer = NULL,
@@ -426,15 +528,170 @@ void queuePush(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer, bool
     assert(queue_buffer->buffer != NULL);
     tQueueEntry *entry = (tQueueEntry *)(queue_buffer->buffer - QUEUE_ENTRY_HEADER_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE); // Get the entry pointer from the user buffer pointer
 
-    // Set flush request
-    if (flush) {
-        uint64_t flush_offset = (uint8_t *)entry - queue->buffer;                          // Get the entry offset from the buffer pointer
-        atomic_store_explicit(&queue->h.flush_offset, flush_offset, memory_order_relaxed); // Set flush offset, used by the consumer to prioritize packets
-    }
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+    // Store the message size in the user header, single message entry
+    *(uint16_t *)entry->data = queue_buffer->size;
+#endif
 
-    // Set commit state and the complete user payload size (header+payload) in the entry_header
+    // Set commit state (with optional flush request) and the complete user payload size (header+payload) in the entry_header
     // Release store - complete data is then visible to the consumer
-    atomic_store_explicit(&entry->header, (CTR_COMMITTED << 16) | (uint32_t)(queue_buffer->size + QUEUE_ENTRY_USER_HEADER_SIZE), memory_order_release);
+    uint32_t state = flush ? CTR_COMMITTED_FLUSH : CTR_COMMITTED;
+    atomic_store_explicit(&entry->header, (state << 16) | (uint32_t)(queue_buffer->size + QUEUE_ENTRY_USER_HEADER_SIZE), memory_order_release);
+
+#ifdef OPTION_QUEUE_NOTIFY
+    notify_consumer(queue, entry, flush);
+#else
+    (void)queue;
+#endif
+}
+
+// Acquire multiple entries with one CAS on the lane head
+// The entries are consecutive in the lane, the consumer scans entries in order and stops at the first entry not committed
+bool queueAcquireMulti(tQueueHandle queue_handle, const uint16_t *payload_sizes, uint16_t count, uint8_t priority, tQueueBuffer *queue_buffers) {
+
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(payload_sizes != NULL && queue_buffers != NULL && count > 0);
+
+    // Calculate the aligned entry lengths and the overall reservation length
+    uint32_t reserve_len = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t packet_len = payload_sizes[i];
+        if (!(packet_len > 0 && packet_len <= QUEUE_MAX_ENTRY_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE)) {
+            DBG_PRINTF_ERROR("Invalid packet_len %u, must be between 1 and %u\n", packet_len, QUEUE_MAX_ENTRY_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE);
+            return false;
+        }
+        uint16_t entry_len = (uint16_t)((packet_len + QUEUE_ENTRY_USER_HEADER_SIZE + QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1) & ~(QUEUE_PAYLOAD_SIZE_ALIGNMENT - 1));
+        queue_buffers[i].size = entry_len - QUEUE_ENTRY_USER_HEADER_SIZE;
+        reserve_len += entry_len + QUEUE_ENTRY_HEADER_SIZE;
+    }
+
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+    // Pack all buffers into one large entry, if they fit into the maximum entry size
+    // Saves the entry header and the commit of each buffer, the consumer gets all of them with a single peek
+    bool large = (count > 1) && (reserve_len - (uint32_t)count * QUEUE_ENTRY_HEADER_SIZE <= QUEUE_MAX_ENTRY_SIZE);
+    if (large) {
+        reserve_len -= (uint32_t)(count - 1) * QUEUE_ENTRY_HEADER_SIZE;
+    }
+#endif
+
+    DBG_PRINTF6("queueAcquireMulti: acquire %u entries of overall size %u\n", count, reserve_len);
+
+    tQueueStatsProducer *stats = queueStatsGetProducer(&queue->stats);
+    uint64_t stats_start = queueStatsBegin();
+    uint32_t retries = 0;
+
+    uint32_t lane_index = get_producer_lane(queue);
+    tQueueLane *lane = &queue->lane[lane_index];
+    uint32_t limit = get_lane_limit(queue, priority);
+    uint64_t head = atomic_load_explicit(&lane->p.head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&lane->c.tail, memory_order_relaxed);
+    if (tail > head) {
+        tail = head; // The consumer released entries after the head was loaded, the head is stale and the CAS will fail and reload it
+    }
+    bool acquired = false;
+
+    // CAS loop, same as in queueAcquire, but for the overall reservation length
+    for (;;) {
+
+        // Check for overrun
+        if (limit < (head - tail) + reserve_len) {
+            break; // Overrun
+        }
+
+        // Try to increment the head by the overall reservation length
+        if (atomic_compare_exchange_weak_explicit(&lane->p.head, &head, head + reserve_len, memory_order_acq_rel, memory_order_acquire)) {
+            acquired = true;
+            break;
+        }
+
+        retries++;
+
+    } // for (;;)
+
+    queueStatsAcquire(&queue->stats, stats, stats_start, retries, (uint32_t)(head - tail), count, acquired);
+
+    if (!acquired) {
+        uint32_t lost = (uint32_t)atomic_fetch_add_explicit(&lane->c.packets_lost, count, memory_order_acq_rel);
+        if (lost == 0) {
+            DBG_PRINTF6("Queue overrun, count=%u, len=%u, head=%" PRIu64 ", tail=%" PRIu64 ", level=%u, size=%u\n", count, reserve_len, head, tail, (uint32_t)(head - tail),
+                        queue->h.lane_size);
+        }
+        return false;
+    }
+
+    uint8_t *lane_buffer = get_lane_buffer(queue, lane_index);
+    uint16_t producer_tag = queueGetProducerTag(queue, queue->stats.h.generation);
+
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+    // Set the large entry to reserved state with the overall length
+    // The buffers are consecutive in the entry, the size of each message is stored in its user header
+    if (large) {
+        tQueueEntry *entry = (tQueueEntry *)(lane_buffer + (head % queue->h.lane_size));
+        atomic_store_explicit(&entry->header, ((uint32_t)producer_tag << 16) | (reserve_len - QUEUE_ENTRY_HEADER_SIZE), memory_order_release);
+        uint8_t *message = entry->data;
+        for (uint16_t i = 0; i < count; i++) {
+            *(uint16_t *)message = queue_buffers[i].size;
+            queue_buffers[i].buffer = message + QUEUE_ENTRY_USER_HEADER_SIZE;
+            message += QUEUE_ENTRY_USER_HEADER_SIZE + queue_buffers[i].size;
+        }
+        return true;
+    }
+#endif
+
+    // Set all entries to reserved state
+    // The first entry is stored with release semantics, the others are not visible to the consumer before the first entry has been committed
+    for (uint16_t i = 0; i < count; i++) {
+        tQueueEntry *entry = (tQueueEntry *)(lane_buffer + (head % queue->h.lane_size));
+        uint32_t entry_len = queue_buffers[i].size + QUEUE_ENTRY_USER_HEADER_SIZE;
+        atomic_store_explicit(&entry->header, ((uint32_t)producer_tag << 16) | entry_len, i == 0 ? memory_order_release : memory_order_relaxed);
+        queue_buffers[i].buffer = entry->data + QUEUE_ENTRY_USER_HEADER_SIZE;
+        head += entry_len + QUEUE_ENTRY_HEADER_SIZE;
+    }
+    return true;
+}
+
+// Commit multiple entries from queueAcquireMulti with one release store
+void queuePushMulti(tQueueHandle queue_handle, const tQueueBuffer *queue_buffers, uint16_t count, bool flush) {
+
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(queue_buffers != NULL && count > 0);
+
+    DBG_PRINTF6("queuePushMulti: push %u entries\n", count);
+
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+    // Buffers packed into a large entry by queueAcquireMulti are consecutive, without entry headers in between
+    // Commit the large entry with its overall length from the reserved state
+    if (count > 1 && queue_buffers[1].buffer == queue_buffers[0].buffer + queue_buffers[0].size + QUEUE_ENTRY_USER_HEADER_SIZE) {
+        tQueueEntry *entry = (tQueueEntry *)(queue_buffers[0].buffer - QUEUE_ENTRY_HEADER_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE);
+        uint32_t entry_len = atomic_load_explicit(&entry->header, memory_order_relaxed) & 0xFFFF;
+        uint32_t state = flush ? CTR_COMMITTED_FLUSH : CTR_COMMITTED;
+        atomic_store_explicit(&entry->header, (state << 16) | entry_len, memory_order_release);
+#ifdef OPTION_QUEUE_NOTIFY
+        notify_consumer(queue, entry, flush);
+#endif
+        return;
+    }
+#endif
+
+    // Commit all entries except the first one with relaxed stores, the flush request is set on the last entry
+    // Then commit the first entry with a release store, which makes the data of all entries visible to the consumer
+    for (uint16_t i = count; i-- > 0;) {
+        tQueueEntry *entry = (tQueueEntry *)(queue_buffers[i].buffer - QUEUE_ENTRY_HEADER_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE);
+        uint32_t state = (flush && i == count - 1) ? CTR_COMMITTED_FLUSH : CTR_COMMITTED;
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+        *(uint16_t *)entry->data = queue_buffers[i].size; // Store the message size in the user header, single message entry
+#endif
+        atomic_store_explicit(&entry->header, (state << 16) | (uint32_t)(queue_buffers[i].size + QUEUE_ENTRY_USER_HEADER_SIZE),
+                              i == 0 ? memory_order_release : memory_order_relaxed);
+    }
+
+#ifdef OPTION_QUEUE_NOTIFY
+    notify_consumer(queue, (const tQueueEntry *)(queue_buffers[0].buffer - QUEUE_ENTRY_HEADER_SIZE - QUEUE_ENTRY_USER_HEADER_SIZE), flush);
+#else
+    (void)queue;
+#endif
 }
 
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -443,6 +700,7 @@ void queuePush(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer, bool
 //-------------------------------------------------------------------------------------------------------------------------------------------------------
 // Single consumer thread !!!!!!!!!!
 // The consumer does not contend against the providers
+// It does not write to the producer cache lines and it detects new entries only by their entry header state
 
 uint32_t queueLevel(tQueueHandle queue_handle, uint32_t *queue_max_level) {
     tQueue *queue = (tQueue *)queue_handle;
@@ -453,11 +711,124 @@ uint32_t queueLevel(tQueueHandle queue_handle, uint32_t *queue_max_level) {
     }
     if (queue_max_level != NULL)
         *queue_max_level = queue->h.queue_size;
-    uint64_t head = atomic_load_explicit(&queue->h.head, memory_order_relaxed);
-    uint64_t tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed);
-    assert(head >= tail);
-    assert(head - tail <= queue->h.queue_size);
-    return (uint32_t)(head - tail);
+    uint32_t level = 0;
+    for (uint32_t i = 0; i < QUEUE_LANE_COUNT; i++) {
+        uint64_t head = atomic_load_explicit(&queue->lane[i].p.head, memory_order_relaxed);
+        uint64_t tail = atomic_load_explicit(&queue->lane[i].c.tail, memory_order_relaxed);
+        assert(head >= tail);
+        assert(head - tail <= queue->h.lane_size);
+        level += (uint32_t)(head - tail);
+    }
+    return level;
+}
+
+// Check if a producer tag is in the list of dead producers
+static bool is_dead_producer(tQueue *queue, uint16_t producer_tag) {
+    for (uint32_t i = 0; i < QUEUE_DEAD_PRODUCER_COUNT; i++) {
+        if (atomic_load_explicit(&queue->r.dead_tag[i], memory_order_relaxed) == producer_tag)
+            return true;
+    }
+    return false;
+}
+
+// Get the next committed and not yet peeked entry of a lane, NULL if there is none
+static tQueueEntry *peek_lane(tQueue *queue, uint32_t lane_index) {
+    tQueueLane *lane = &queue->lane[lane_index];
+
+    // Check if the lane is completely peeked
+    uint64_t peek_tail = lane->c.peek_tail;
+    if (peek_tail - atomic_load_explicit(&lane->c.tail, memory_order_relaxed) >= queue->h.lane_size) {
+        return NULL;
+    }
+
+    // Check if the entry is in commit state
+    // Memory beyond the head is always cleared by the consumer, so an entry in reserved state with size 0 indicates the head has not been reached
+    tQueueEntry *entry = (tQueueEntry *)(get_lane_buffer(queue, lane_index) + peek_tail % queue->h.lane_size);
+    uint32_t header = atomic_load_explicit(&entry->header, memory_order_acquire);
+    uint16_t entry_size = header & 0xFFFF;           // Entry size (excluding the entry header, but including the optional user header)
+    uint16_t entry_state = (uint16_t)(header >> 16); // Commit state
+    if (entry_state != CTR_COMMITTED && entry_state != CTR_COMMITTED_FLUSH) {
+
+        // This should never happen
+        // An entry is consistent, if it is neither in reserved or committed state
+        if (entry_state > CTR_RESERVED_MAX) {
+            DBG_PRINTF_ERROR("queuePeek: inconsistent reserved - lane=%u, t=%" PRIu64 ", entry: (entry_size=0x%04X, entry_state=0x%04X)\n", lane_index, peek_tail, entry_size,
+                             entry_state);
+            assert(false); // Fatal error, inconsistent state
+        }
+
+        // The entry was reserved by a producer process, which died before committing it
+        // Skip it, when it is the oldest entry of the lane, the tail can not pass entries which are peeked and not released yet
+        if (entry_state != CTR_RESERVED && entry_size > 0 && entry_size <= QUEUE_MAX_ENTRY_SIZE && peek_tail == atomic_load_explicit(&lane->c.tail, memory_order_relaxed) &&
+            is_dead_producer(queue, entry_state)) {
+            DBG_PRINTF_WARNING("queuePeek: reclaimed uncommitted entry of dead producer %u - lane=%u, t=%" PRIu64 ", entry_size=%u\n", entry_state, lane_index, peek_tail,
+                               entry_size);
+            memset(entry, 0, entry_size + QUEUE_ENTRY_HEADER_SIZE);
+            lane->c.peek_tail = peek_tail + (entry_size + QUEUE_ENTRY_HEADER_SIZE);
+            atomic_fetch_add_explicit(&lane->c.tail, entry_size + QUEUE_ENTRY_HEADER_SIZE, memory_order_relaxed); // Write access to tail is single threaded
+            atomic_fetch_add_explicit(&lane->c.packets_lost, 1, memory_order_relaxed);
+            return peek_lane(queue, lane_index);
+        }
+
+        // Nothing to read, the entry is empty or still in reserved state
+        return NULL;
+    }
+
+    // This should never fail
+    // An committed entry must have a valid length
+    if (!((entry_size > 0) && (entry_size <= QUEUE_MAX_ENTRY_SIZE))) {
+        DBG_PRINTF_ERROR("queuePeek: inconsistent commit - lane=%u, t=%" PRIu64 ",  entry: (entry_size=0x%04X, entry_state=0x%04X)\n", //
+                         lane_index, peek_tail, entry_size, entry_state);
+        assert(false); // Fatal error, corrupt committed state
+        return NULL;
+    }
+
+    // Advance the lane peek tail
+    lane->c.peek_tail = peek_tail + (entry_size + QUEUE_ENTRY_HEADER_SIZE);
+    return entry;
+}
+
+// Peek the next committed entry, lanes are merged round robin, the order within a lane is preserved
+// The peek order is recorded, so entries can be peeked again with the same index until they are released
+static tQueueEntry *peek_next(tQueue *queue) {
+    tQueueEntry *entry = NULL;
+    uint32_t lane_index = queue->c.peek_next_lane;
+    for (uint32_t i = 0; i < QUEUE_LANE_COUNT; i++) {
+        entry = peek_lane(queue, lane_index);
+        if (++lane_index >= QUEUE_LANE_COUNT)
+            lane_index = 0;
+        if (entry != NULL)
+            break;
+    }
+    if (entry == NULL) {
+        return NULL;
+    }
+    queue->c.peek_next_lane = lane_index;
+    queue->peek_offset[(queue->c.peek_first + queue->c.peek_count) % QUEUE_PEEK_MAX_COUNT] = (uint32_t)((uint8_t *)entry - queue->buffer);
+    queue->c.peek_count++;
+    return entry;
+}
+
+// Get the entry at a peek index, peek_index <= peek_count, NULL if there is no committed entry
+static inline tQueueEntry *peek_index_entry(tQueue *queue, uint32_t peek_index) {
+    if (peek_index < queue->c.peek_count) {
+        return (tQueueEntry *)(queue->buffer + queue->peek_offset[(queue->c.peek_first + peek_index) % QUEUE_PEEK_MAX_COUNT]);
+    }
+    return peek_next(queue);
+}
+
+// Get and reset the number of packets lost in all lanes
+static uint32_t get_packets_lost(tQueue *queue) {
+    uint32_t lost = 0;
+    for (uint32_t i = 0; i < QUEUE_LANE_COUNT; i++) {
+        if (atomic_load_explicit(&queue->lane[i].c.packets_lost, memory_order_relaxed) != 0) {
+            lost += (uint32_t)atomic_exchange_explicit(&queue->lane[i].c.packets_lost, 0, memory_order_acq_rel);
+        }
+    }
+    if (lost) {
+        DBG_PRINTF6("queuePeek: packets lost since last call: %u\n", lost);
+    }
+    return lost;
 }
 
 tQueueBuffer queuePeek(tQueueHandle queue_handle, uint32_t peek_index, uint32_t *packets_lost, bool *flush_requested) {
@@ -468,141 +839,262 @@ tQueueBuffer queuePeek(tQueueHandle queue_handle, uint32_t peek_index, uint32_t
 
     // Return the number of packets lost since the last call
     if (packets_lost != NULL) {
-        uint32_t lost = (uint32_t)atomic_exchange_explicit(&queue->h.packets_lost, 0, memory_order_acq_rel);
-        *packets_lost = lost;
-        if (lost) {
-            DBG_PRINTF6("queuePeek: packets lost since last call: %u\n", lost);
-        }
+        *packets_lost = get_packets_lost(queue);
     }
 
-    uint16_t entry_size;
-    tQueueEntry *entry;
-    uint64_t peek_tail;
-    uint32_t index;
-
-    // Get the head which synchronizes the queue header cache line
-    uint64_t head = atomic_load_explicit(&queue->h.head, memory_order_acquire);
+    uint64_t stats_start = queueStatsBegin();
 
-    // Start at index 0 or with the cached peek index and tail if feasible, to optimize the common case of sequential peeks without releases
-    // Cache will be reset if a release happens
-    if (peek_index > 0 && peek_index >= queue->h.cached_peek_index) {
-        peek_tail = queue->h.cached_peek_tail; // Use cached tail for optimized peek loop
-        index = queue->h.cached_peek_index;
-        // DBG_PRINTF6("queuePeek: using cached peek_index=%u\n", index);
-    } else {
-        peek_tail = atomic_load_explicit(&queue->h.tail, memory_order_relaxed);
-        index = 0;
+    if (peek_index >= QUEUE_PEEK_MAX_COUNT) {
+        queueStatsPeek(&queue->stats, stats_start, 0);
+        tQueueBuffer ret = {
+            .buffer = NULL,
+            .size = 0,
+        };
+        return ret;
     }
 
-    for (;;) {
-
-        // Check if there is data in the queue at peek_tail
-        if (head <= peek_tail) {
-            queue->h.cached_peek_index = index;
-            queue->h.cached_peek_tail = peek_tail;
+    // Peek new entries from the lanes until the peek index is reached
+    while (queue->c.peek_count <= peek_index) {
+        if (peek_next(queue) == NULL) {
+            queueStatsPeek(&queue->stats, stats_start, 0);
             tQueueBuffer ret = {
                 .buffer = NULL,
                 .size = 0,
             };
             return ret;
         }
+    }
 
-        entry = (tQueueEntry *)(queue->buffer + peek_tail % queue->h.queue_size);
-
-        // Check if the entry is in commit state
-        uint32_t header = atomic_load_explicit(&entry->header, memory_order_acquire);
-        entry_size = header & 0xFFFF;                    // Entry size (excluding the entry header, but including the optional user header)
-        uint16_t entry_state = (uint16_t)(header >> 16); // Commit state
-        if (entry_state != CTR_COMMITTED) {
-
-            // This should never happen
-            // An entry is consistent, if it is neither in reserved or committed state
-            if (entry_state != CTR_RESERVED) {
-                DBG_PRINTF_ERROR("queuePeek: inconsistent reserved - h=%" PRIu64 ", t=%" PRIu64 ", entry: (entry_size=0x%04X, entry_state=0x%04X)\n", head, peek_tail, entry_size,
-                                 entry_state);
-                assert(false); // Fatal error, inconsistent state
-                tQueueBuffer ret = {
-                    .buffer = NULL,
-                    .size = 0,
-                };
-                return ret;
-            }
-
-            // Nothing to read, the first entry is still in reserved state
-            queue->h.cached_peek_index = index;
-            queue->h.cached_peek_tail = peek_tail;
+    // Found the entry at the peek index, return it
+    // The consumer already synchronized with the commit of this entry
+    tQueueEntry *entry = (tQueueEntry *)(queue->buffer + queue->peek_offset[(queue->c.peek_first + peek_index) % QUEUE_PEEK_MAX_COUNT]);
+    uint32_t header = atomic_load_explicit(&entry->header, memory_order_relaxed);
+    tQueueBuffer ret = {
+        .buffer = (uint8_t *)entry + QUEUE_ENTRY_HEADER_SIZE,
+        .size = (uint16_t)(header & 0xFFFF),
+    };
 
-            // @@@@ TODO Add a timeout
-            // Maybe add a timeout parameter to the peek function and return an error if the entry is in reserved state for too long, this would allow the consumer to detect
-            // stalled producers and recover from it, e.g. by skipping the entry or resetting the queue A stalled producer is a producer that has reserved an entry but never
-            // commits it, this can happen if the producer thread is stalled or crashes after reserving an entry, this would lead to a permanent stall of the consumer if the
-            // consumer is waiting for the entry to be committed
-            tQueueBuffer ret = {
-                .buffer = NULL,
-                .size = 0,
-            };
-            return ret;
+    // Return whether a flush request is pending on this entry
+    if (flush_requested != NULL) {
+        if ((header >> 16) == CTR_COMMITTED_FLUSH) {
+            *flush_requested = true;
         }
+    }
 
-        // This should never fail
-        // An committed entry must have a valid length
-        if (!((entry_state == CTR_COMMITTED) && (entry_size > 0) && (entry_size <= QUEUE_ENTRY_USER_SIZE))) {
-            DBG_PRINTF_ERROR("queuePeek: inconsistent commit - h=%" PRIu64 ", t=%" PRIu64 ",  entry: (entry_size=0x%04X, entry_state=0x%04X)\n", //
-                             head, peek_tail, entry_size, entry_state);
-            assert(false); // Fatal error, corrupt committed state
-            tQueueBuffer ret = {
-                .buffer = NULL,
-                .size = 0,
-            };
-            return ret;
-        }
+    queueStatsPeek(&queue->stats, stats_start, 1);
+    return ret;
+}
 
-        // Found the entry at the peek index, return it
-        if (index == peek_index) {
-            tQueueBuffer ret = {
-                .buffer = (uint8_t *)entry + QUEUE_ENTRY_HEADER_SIZE,
-                .size = entry_size,
+uint32_t queuePeekBatch(tQueueHandle queue_handle, uint32_t peek_index, uint32_t max_bytes, tQueueBuffer *queue_buffers, uint32_t max_count, uint32_t *packets_lost,
+                        bool *flush_requested) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(queue_buffers != NULL);
+    assert(peek_index <= queue->c.peek_count);
 
-            };
+    if (packets_lost != NULL) {
+        *packets_lost = get_packets_lost(queue);
+    }
 
-            // Advance the cached peek index and tail for optimized peek loop
-            // The consumer can savely overwrite the header
-            queue->h.cached_peek_index = index + 1;
-            queue->h.cached_peek_tail = peek_tail + (entry_size + QUEUE_ENTRY_HEADER_SIZE);
+    uint64_t stats_start = queueStatsBegin();
 
-            // Return whether a flush request is pending on this entry
+    // Collect entries until max_bytes or max_count is reached, there are no more committed entries or a flush is requested
+    // An entry which does not fit stays peeked and is the first entry of the next batch
+    uint32_t count = 0;
+    uint32_t bytes = 0;
+    while (count < max_count && peek_index + count < QUEUE_PEEK_MAX_COUNT) {
+        tQueueEntry *entry = peek_index_entry(queue, peek_index + count);
+        if (entry == NULL) {
+            break;
+        }
+        uint32_t header = atomic_load_explicit(&entry->header, memory_order_relaxed);
+        uint16_t size = (uint16_t)(header & 0xFFFF);
+        if (bytes + size > max_bytes) {
+            break;
+        }
+        queue_buffers[count].buffer = (uint8_t *)entry + QUEUE_ENTRY_HEADER_SIZE;
+        queue_buffers[count].size = size;
+        bytes += size;
+        count++;
+        if ((header >> 16) == CTR_COMMITTED_FLUSH) {
             if (flush_requested != NULL) {
-                uint64_t flush_offset = atomic_load_explicit(&queue->h.flush_offset, memory_order_relaxed); // We use relaxed, assuming the cache line is already up to date
-                if (flush_offset == (uint64_t)((uint8_t *)entry - queue->buffer)) {
-                    *flush_requested = true;
-                    // Don't clear the flush offset, to avoid overwriting an updated flush offset, false flushes are less problem than missing flushes
-                }
+                *flush_requested = true;
             }
+            break;
+        }
+    }
 
-            return ret;
+    queueStatsPeek(&queue->stats, stats_start, count);
+    return count;
+}
+
+bool queueWait(tQueueHandle queue_handle, uint32_t timeout_us) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+
+    queueStatsWait(&queue->stats);
+
+#ifdef OPTION_QUEUE_NOTIFY
+
+    uint32_t seq = (uint32_t)atomic_load_explicit(&queue->c.notify_seq, memory_order_acquire);
+    atomic_store_explicit(&queue->c.waiting, 1, memory_order_relaxed);
+
+    // Order the store of the waiting flag before checking for committed entries, see notify_consumer
+    atomic_thread_fence(memory_order_seq_cst);
+
+    // Don't block, if queueNotify has been called since the last wait
+    if (atomic_exchange_explicit(&queue->c.notified, 0, memory_order_acquire) != 0) {
+        atomic_store_explicit(&queue->c.waiting, 0, memory_order_relaxed);
+        return true;
+    }
+
+    // Don't block, if there are committed entries not peeked yet
+    for (uint32_t i = 0; i < QUEUE_LANE_COUNT; i++) {
+        tQueueLane *lane = &queue->lane[i];
+        if (lane->c.peek_tail - atomic_load_explicit(&lane->c.tail, memory_order_relaxed) >= queue->h.lane_size) {
+            continue;
         }
+        const tQueueEntry *entry = (const tQueueEntry *)(get_lane_buffer(queue, i) + lane->c.peek_tail % queue->h.lane_size);
+        uint16_t entry_state = (uint16_t)(atomic_load_explicit(&entry->header, memory_order_relaxed) >> 16);
+        if (entry_state == CTR_COMMITTED || entry_state == CTR_COMMITTED_FLUSH) {
+            atomic_store_explicit(&queue->c.waiting, 0, memory_order_relaxed);
+            return true;
+        }
+    }
+
+    bool res = platformWaitOnAddress(&queue->c.notify_seq, seq, timeout_us);
+    atomic_store_explicit(&queue->c.waiting, 0, memory_order_relaxed);
+    return res;
+
+#else
+
+    // No notification support, poll with max 1ms sleep
+    sleepUs(timeout_us < 1000 ? timeout_us : 1000);
+    return true;
 
-        // Move peek_tail to the next entry and increment index
-        index++;
-        peek_tail += (entry_size + QUEUE_ENTRY_HEADER_SIZE);
+#endif
+}
+
+void queueNotify(tQueueHandle queue_handle) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+
+#ifdef OPTION_QUEUE_NOTIFY
+    // Either the consumer sees the notified flag before it blocks, or this thread sees the consumer waiting, see queueWait
+    atomic_store_explicit(&queue->c.notified, 1, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_exchange_explicit(&queue->c.waiting, 0, memory_order_relaxed) != 0) {
+        atomic_fetch_add_explicit(&queue->c.notify_seq, 1, memory_order_release);
+        platformWakeOnAddress(&queue->c.notify_seq);
     }
+#else
+    (void)queue; // The consumer polls
+#endif
 }
 
 void queueRelease(tQueueHandle queue_handle, const tQueueBuffer *queue_buffer) {
     tQueue *queue = (tQueue *)queue_handle;
     assert(queue != NULL);
-    assert(queue_buffer->size > 0 && queue_buffer->size <= QUEUE_ENTRY_USER_SIZE);
+    assert(queue_buffer->size > 0 && queue_buffer->size <= QUEUE_MAX_ENTRY_SIZE);
 
     DBG_PRINTF6("queueRelease: release entry of size %u\n", queue_buffer->size);
 
+    // Entries must be released in peek order, which is FIFO order within each lane
+    uint32_t offset = (uint32_t)(queue_buffer->buffer - QUEUE_ENTRY_HEADER_SIZE - queue->buffer);
+    assert(queue->c.peek_count > 0);
+    assert(queue->peek_offset[queue->c.peek_first] == offset);
+    uint32_t lane_index = offset / queue->h.lane_stride;
+    assert(lane_index < QUEUE_LANE_COUNT);
+
     // Clear the entire memory completely, to avoid inconsistent reserved states after incrementing the head in the producer
     // This is the tradeoff of not using a fixed entry size, this approach might be optimal for medium data throughput,
     memset(queue_buffer->buffer - QUEUE_ENTRY_HEADER_SIZE, 0, queue_buffer->size + QUEUE_ENTRY_HEADER_SIZE);
-    atomic_fetch_add_explicit(&queue->h.tail, queue_buffer->size + QUEUE_ENTRY_HEADER_SIZE, memory_order_relaxed); // Write access to tail is single threaded
+    atomic_fetch_add_explicit(&queue->lane[lane_index].c.tail, queue_buffer->size + QUEUE_ENTRY_HEADER_SIZE, memory_order_relaxed); // Write access to tail is single threaded
+
+    if (++queue->c.peek_first >= QUEUE_PEEK_MAX_COUNT)
+        queue->c.peek_first = 0;
+    queue->c.peek_count--;
+}
+
+void queueReleaseBatch(tQueueHandle queue_handle, const tQueueBuffer *queue_buffers, uint32_t count) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(queue_buffers != NULL);
+    assert(count <= queue->c.peek_count);
+
+    // Clear the entries in peek order and advance the tail of each lane once
+    uint32_t released[QUEUE_LANE_COUNT] = {0};
+    for (uint32_t i = 0; i < count; i++) {
+        const tQueueBuffer *queue_buffer = &queue_buffers[i];
+        assert(queue_buffer->size > 0 && queue_buffer->size <= QUEUE_MAX_ENTRY_SIZE);
+        uint32_t offset = (uint32_t)(queue_buffer->buffer - QUEUE_ENTRY_HEADER_SIZE - queue->buffer);
+        assert(queue->peek_offset[queue->c.peek_first] == offset);
+        uint32_t lane_index = offset / queue->h.lane_stride;
+        assert(lane_index < QUEUE_LANE_COUNT);
+        memset(queue_buffer->buffer - QUEUE_ENTRY_HEADER_SIZE, 0, queue_buffer->size + QUEUE_ENTRY_HEADER_SIZE);
+        released[lane_index] += queue_buffer->size + QUEUE_ENTRY_HEADER_SIZE;
+        if (++queue->c.peek_first >= QUEUE_PEEK_MAX_COUNT)
+            queue->c.peek_first = 0;
+    }
+    queue->c.peek_count -= count;
+    for (uint32_t i = 0; i < QUEUE_LANE_COUNT; i++) {
+        if (released[i] > 0) {
+            atomic_fetch_add_explicit(&queue->lane[i].c.tail, released[i], memory_order_relaxed); // Write access to tail is single threaded
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Producer processes
+
+uint16_t queueRegisterProducer(tQueueHandle queue_handle) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+
+    // Tags are never reused before the counter wraps around, a restarted process gets a new tag
+    uint16_t producer_tag = (uint16_t)(atomic_fetch_add_explicit(&queue->r.tag_counter, 1, memory_order_relaxed) % CTR_RESERVED_MAX + 1);
+
+    // A tag reissued after the counter wrapped around must not be reclaimed
+    for (uint32_t i = 0; i < QUEUE_DEAD_PRODUCER_COUNT; i++) {
+        uint_least32_t dead_tag = producer_tag;
+        atomic_compare_exchange_strong_explicit(&queue->r.dead_tag[i], &dead_tag, 0, memory_order_relaxed, memory_order_relaxed);
+    }
+
+    // The tag is kept per process and queue instance
+    queueSetProducerTag(queue, queue->stats.h.generation, producer_tag);
+    DBG_PRINTF3("queueRegisterProducer: producer_tag=%u\n", producer_tag);
+    return producer_tag;
+}
 
-    // Reset cached index and tail for optimized peek
-    queue->h.cached_peek_index = 0;
-    queue->h.cached_peek_tail = 0;
+void queueReclaimProducer(tQueueHandle queue_handle, uint16_t producer_tag) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+
+    if (producer_tag == CTR_RESERVED || producer_tag > CTR_RESERVED_MAX)
+        return;
+    if (is_dead_producer(queue, producer_tag))
+        return;
+    uint32_t index = (uint32_t)atomic_fetch_add_explicit(&queue->r.dead_index, 1, memory_order_relaxed) % QUEUE_DEAD_PRODUCER_COUNT;
+    atomic_store_explicit(&queue->r.dead_tag[index], producer_tag, memory_order_relaxed);
+    DBG_PRINTF3("queueReclaimProducer: producer_tag=%u\n", producer_tag);
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Statistics
+
+bool queueGetStatistics(tQueueHandle queue_handle, uint32_t producer, tQueueStatistics *statistics) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    assert(statistics != NULL);
+
+    statistics->level = queueLevel(queue_handle, &statistics->queue_size);
+    return queueStatsGet(&queue->stats, producer, statistics);
+}
+
+void queueResetStatistics(tQueueHandle queue_handle) {
+    tQueue *queue = (tQueue *)queue_handle;
+    assert(queue != NULL);
+    queueStatsClear(&queue->stats);
 }
 
 #endif // OPTION_QUEUE_64_VAR_SIZE
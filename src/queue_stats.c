@@ -0,0 +1,179 @@
+/*----------------------------------------------------------------------------
+| File:
+|   queue_stats.c
+|
+| Description:
+|   Queue runtime statistics
+|   Aggregation of the per producer thread counters and of the sampled latency histograms (OPTION_QUEUE_STATISTICS)
+|
+| Copyright (c) Vector Informatik GmbH. All rights reserved.
+| See LICENSE file in the project root for details.
+|
+ ----------------------------------------------------------------------------*/
+
+#include "queue_stats.h"
+
+#include <assert.h>  // for assert
+#include <stdbool.h> // for bool
+#include <stdint.h>  // for uintxx_t
+#include <stdlib.h>  // for calloc, free
+#include <string.h>  // for memset
+
+#include "platform.h" // for atomic_xxx, THREAD_LOCAL
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Per process producer tags
+
+tQueueProducerTag gQueueProducerTag[QUEUE_PRODUCER_TAG_COUNT];
+atomic_uint_fast32_t gQueueProducerTagCount = 0;
+
+void queueSetProducerTag(const void *queue, uint32_t generation, uint16_t tag) {
+    assert(queue != NULL);
+    uint64_t value = ((uint64_t)generation << 16) | tag;
+
+    // Update the registration of the queue, a reinitialized queue at the same address has a new generation
+    for (uint32_t i = 0; i < QUEUE_PRODUCER_TAG_COUNT; i++) {
+        if (atomic_load_explicit(&gQueueProducerTag[i].queue, memory_order_relaxed) == (uint64_t)(uintptr_t)queue) {
+            atomic_store_explicit(&gQueueProducerTag[i].tag, value, memory_order_relaxed);
+            return;
+        }
+    }
+
+    // New registration, the tag is stored before the queue address is published
+    uint32_t i = (uint32_t)atomic_fetch_add_explicit(&gQueueProducerTagCount, 1, memory_order_relaxed) % QUEUE_PRODUCER_TAG_COUNT;
+    atomic_store_explicit(&gQueueProducerTag[i].queue, 0, memory_order_relaxed);
+    atomic_store_explicit(&gQueueProducerTag[i].tag, value, memory_order_relaxed);
+    atomic_store_explicit(&gQueueProducerTag[i].queue, (uint64_t)(uintptr_t)queue, memory_order_release);
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Statistics
+
+void queueStatsInit(tQueueStats *stats, bool local) {
+    assert(stats != NULL);
+    atomic_store_explicit(&stats->h.producer_ticket, 0, memory_order_relaxed);
+    stats->h.generation = queueNewGeneration();
+    stats->h.latency = NULL;
+#ifdef OPTION_QUEUE_STATISTICS
+    if (local) {
+        stats->h.latency = (tQueueStatsLatencies *)calloc(1, sizeof(tQueueStatsLatencies)); // No latencies, if out of memory
+    }
+#else
+    (void)local;
+#endif
+    queueStatsClear(stats);
+}
+
+void queueStatsFree(tQueueStats *stats) {
+    assert(stats != NULL);
+    free(stats->h.latency);
+    stats->h.latency = NULL;
+}
+
+void queueStatsClear(tQueueStats *stats) {
+    assert(stats != NULL);
+    memset(&stats->c, 0, sizeof(stats->c));
+    memset(stats->p, 0, sizeof(stats->p));
+    if (stats->h.latency != NULL) {
+        memset(stats->h.latency, 0, sizeof(tQueueStatsLatencies));
+    }
+}
+
+#ifdef OPTION_QUEUE_STATISTICS
+
+// Get a percentile in ns from a latency histogram
+// Returns the upper bound of the bin, limited to the maximum latency measured
+static uint32_t getPercentile(const uint64_t *histogram, uint32_t percent, uint32_t max) {
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < QUEUE_STATS_HISTOGRAM_SIZE; i++) {
+        count += histogram[i];
+    }
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t limit = (count * percent + 99) / 100;
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < QUEUE_STATS_HISTOGRAM_SIZE - 1; i++) {
+        sum += histogram[i];
+        if (sum >= limit) {
+            uint32_t upper = 32u << i;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+// Get the maximum and the percentiles of the aggregated latency histograms of count slots
+static void getLatency(const tQueueStatsLatency *l, uint32_t count, uint32_t *p50, uint32_t *p99, uint32_t *max) {
+    uint64_t histogram[QUEUE_STATS_HISTOGRAM_SIZE] = {0};
+    *max = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t time_max = (uint32_t)atomic_load_explicit(&l[i].time_max, memory_order_relaxed);
+        if (time_max > *max)
+            *max = time_max;
+        for (uint32_t j = 0; j < QUEUE_STATS_HISTOGRAM_SIZE; j++) {
+            histogram[j] += atomic_load_explicit(&l[i].time[j], memory_order_relaxed);
+        }
+    }
+    *p50 = getPercentile(histogram, 50, *max);
+    *p99 = getPercentile(histogram, 99, *max);
+}
+
+#endif // OPTION_QUEUE_STATISTICS
+
+bool queueStatsGet(tQueueStats *stats, uint32_t producer, tQueueStatistics *statistics) {
+    assert(stats != NULL);
+    assert(statistics != NULL);
+
+    uint32_t producer_count = (uint32_t)atomic_load_explicit(&stats->h.producer_ticket, memory_order_relaxed);
+    if (producer != QUEUE_STATISTICS_ALL_PRODUCERS && producer >= producer_count) {
+        return false;
+    }
+    statistics->producer_count = producer_count;
+
+    // Aggregate the producer slots
+    statistics->level_max = 0;
+    statistics->acquire_count = 0;
+    statistics->acquire_retries = 0;
+    statistics->acquire_retries_max = 0;
+    statistics->overflow_bursts = 0;
+    statistics->packets_lost = 0;
+    uint32_t slot = producer < QUEUE_STATS_PRODUCER_COUNT ? producer : QUEUE_STATS_PRODUCER_COUNT - 1;
+    for (uint32_t i = 0; i < QUEUE_STATS_PRODUCER_COUNT; i++) {
+        if (producer != QUEUE_STATISTICS_ALL_PRODUCERS && i != slot) {
+            continue;
+        }
+        tQueueStatsProducer *p = &stats->p[i];
+        uint32_t level_max = (uint32_t)atomic_load_explicit(&p->level_max, memory_order_relaxed);
+        if (level_max > statistics->level_max)
+            statistics->level_max = level_max;
+        statistics->acquire_count += atomic_load_explicit(&p->acquire_count, memory_order_relaxed);
+        statistics->acquire_retries += atomic_load_explicit(&p->acquire_retries, memory_order_relaxed);
+        uint32_t retries_max = (uint32_t)atomic_load_explicit(&p->acquire_retries_max, memory_order_relaxed);
+        if (retries_max > statistics->acquire_retries_max)
+            statistics->acquire_retries_max = retries_max;
+        statistics->overflow_bursts += (uint32_t)atomic_load_explicit(&p->overflow_bursts, memory_order_relaxed);
+        statistics->packets_lost += atomic_load_explicit(&p->packets_lost, memory_order_relaxed);
+    }
+
+    // Consumer
+    statistics->peek_count = atomic_load_explicit(&stats->c.peek_count, memory_order_relaxed);
+    statistics->wait_count = atomic_load_explicit(&stats->c.wait_count, memory_order_relaxed);
+
+    // Latencies
+    statistics->acquire_time_p50 = statistics->acquire_time_p99 = statistics->acquire_time_max = 0;
+    statistics->peek_time_p50 = statistics->peek_time_p99 = statistics->peek_time_max = 0;
+#ifdef OPTION_QUEUE_STATISTICS
+    tQueueStatsLatencies *l = stats->h.latency;
+    if (l != NULL) {
+        if (producer == QUEUE_STATISTICS_ALL_PRODUCERS) {
+            getLatency(l->acquire, QUEUE_STATS_PRODUCER_COUNT, &statistics->acquire_time_p50, &statistics->acquire_time_p99, &statistics->acquire_time_max);
+        } else {
+            getLatency(&l->acquire[slot], 1, &statistics->acquire_time_p50, &statistics->acquire_time_p99, &statistics->acquire_time_max);
+        }
+        getLatency(&l->peek, 1, &statistics->peek_time_p50, &statistics->peek_time_p99, &statistics->peek_time_max);
+    }
+#endif
+
+    return true;
+}
@@ -0,0 +1,280 @@
+#pragma once
+#define __QUEUE_STATS_H__
+
+/*----------------------------------------------------------------------------
+| File:
+|   queue_stats.h
+|
+| Description:
+|   XCPlite internal header file for the queue runtime statistics, the per thread producer tickets and the per process producer tags
+|   Used by all queue implementations
+|   Counters are kept per producer thread in separate cache lines, updated without locks and aggregated on read
+|
+| Copyright (c) Vector Informatik GmbH. All rights reserved.
+| See LICENSE file in the project root for details.
+|
+ ----------------------------------------------------------------------------*/
+
+#include <assert.h>  // for static_assert
+#include <stdbool.h> // for bool
+#include <stdint.h>  // for uintxx_t
+
+#include "platform.h" // for atomic_xxx, THREAD_LOCAL, clockGetMonotonicNs
+#include "queue.h"    // for tQueueStatistics
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Per thread producer tickets
+
+// A producer thread draws a ticket from a counter in the queue on its first acquire, the ticket selects its lane or statistics slot
+// Tickets are cached per thread and queue instance, the generation identifies the queue instance, a queue reinitialized at the same address gets new tickets
+#define QUEUE_TICKET_CACHE_SIZE 4 // Number of queues a thread keeps tickets for, the oldest ticket is replaced, when a thread produces into more queues
+
+typedef struct QueueTicketCache {
+    const void *queue[QUEUE_TICKET_CACHE_SIZE];
+    uint32_t generation[QUEUE_TICKET_CACHE_SIZE];
+    uint32_t ticket[QUEUE_TICKET_CACHE_SIZE];
+    uint32_t next; // Next entry to replace
+} tQueueTicketCache;
+
+// Generation of a new queue instance
+static inline uint32_t queueNewGeneration(void) { return (uint32_t)clockGetMonotonicNs(); }
+
+// Get the ticket of the calling thread for a queue instance, draw a new one from counter on the first call
+static inline uint32_t queueGetTicket(tQueueTicketCache *cache, const void *queue, uint32_t generation, atomic_uint_fast32_t *counter) {
+    for (uint32_t i = 0; i < QUEUE_TICKET_CACHE_SIZE; i++) {
+        if (cache->queue[i] == queue && cache->generation[i] == generation)
+            return cache->ticket[i];
+    }
+    uint32_t i = cache->next++ % QUEUE_TICKET_CACHE_SIZE;
+    cache->queue[i] = queue;
+    cache->generation[i] = generation;
+    cache->ticket[i] = (uint32_t)atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+    return cache->ticket[i];
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Per process producer tags
+
+// A process registered as producer of a queue in shared memory records its producer tag in each entry it reserves, see queueRegisterProducer
+// Tags are kept per process and queue instance, the generation identifies the queue instance
+#define QUEUE_PRODUCER_TAG_COUNT 4 // Number of queues a process can be registered to, the oldest registration is replaced, when a process registers to more queues
+
+typedef struct QueueProducerTag {
+    atomic_uint_fast64_t queue; // Queue address, 0 if unused
+    atomic_uint_fast64_t tag;   // Generation << 16 | producer tag
+} tQueueProducerTag;
+
+extern tQueueProducerTag gQueueProducerTag[QUEUE_PRODUCER_TAG_COUNT];
+extern atomic_uint_fast32_t gQueueProducerTagCount; // Number of registrations of this process
+
+// Set the producer tag of this process for a queue instance
+void queueSetProducerTag(const void *queue, uint32_t generation, uint16_t tag);
+
+// Get the producer tag of this process for a queue instance, 0 if the process is not registered
+static inline uint16_t queueGetProducerTag(const void *queue, uint32_t generation) {
+    if (atomic_load_explicit(&gQueueProducerTagCount, memory_order_relaxed) == 0)
+        return 0; // Fast path for single process queues
+    for (uint32_t i = 0; i < QUEUE_PRODUCER_TAG_COUNT; i++) {
+        if (atomic_load_explicit(&gQueueProducerTag[i].queue, memory_order_acquire) == (uint64_t)(uintptr_t)queue) {
+            uint64_t tag = atomic_load_explicit(&gQueueProducerTag[i].tag, memory_order_relaxed);
+            if ((uint32_t)(tag >> 16) == generation)
+                return (uint16_t)tag;
+        }
+    }
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------------------------------------------------------------------
+// Statistics
+
+#define QUEUE_STATS_PRODUCER_COUNT 32 // Number of statistics slots, the last slot is shared by all additional producer threads
+#define QUEUE_STATS_HISTOGRAM_SIZE 16 // Number of logarithmic latency histogram bins, bin i counts latencies < 32ns<<i, the last bin counts the rest
+#define QUEUE_STATS_SAMPLE_RATE 16    // Measure the latency of every 16th operation of a thread only, to keep the clock overhead low
+
+#define QUEUE_STATS_SLOT_SIZE 64 // Counters of a producer thread, also with emulated 64 bit atomics
+#ifdef OPTION_ATOMIC_EMULATION
+#define QUEUE_STATS_LATENCY_SLOT_SIZE 256 // Emulated atomics are 64 bit
+#else
+#define QUEUE_STATS_LATENCY_SLOT_SIZE 128
+#endif
+
+// Counters of a producer thread
+// A private slot is only written by its owning producer thread, relaxed load and store is sufficient
+// The last slot is shared by all producer threads beyond QUEUE_STATS_PRODUCER_COUNT-1, it is updated with atomic read modify write
+typedef union QueueStatsProducer {
+    struct {
+        atomic_uint_fast64_t acquire_count;        // Number of buffers acquired
+        atomic_uint_fast64_t acquire_retries;      // Number of CAS retries
+        atomic_uint_fast64_t packets_lost;         // Number of buffers lost
+        atomic_uint_least32_t acquire_retries_max; // Maximum retries of a single acquire
+        atomic_uint_least32_t overflow_bursts;     // Number of overflow bursts
+        atomic_uint_least32_t overflow;            // The last acquire failed
+        atomic_uint_least32_t level_max;           // Maximum level seen on acquire
+    };
+    uint8_t padding[QUEUE_STATS_SLOT_SIZE];
+} tQueueStatsProducer;
+
+// Counters of the consumer thread
+// Only written by the consumer thread, relaxed load and store is sufficient
+typedef union QueueStatsConsumer {
+    struct {
+        atomic_uint_fast64_t peek_count; // Number of buffers obtained
+        atomic_uint_fast64_t wait_count; // Number of waits for new data
+    };
+    uint8_t padding[QUEUE_STATS_SLOT_SIZE];
+} tQueueStatsConsumer;
+
+static_assert(sizeof(tQueueStatsProducer) == QUEUE_STATS_SLOT_SIZE, "tQueueStatsProducer size must be QUEUE_STATS_SLOT_SIZE");
+
+// Sampled latency histogram of a producer thread or of the consumer thread
+typedef union QueueStatsLatency {
+    struct {
+        atomic_uint_least32_t time_max;                         // Maximum sampled latency in ns
+        atomic_uint_least32_t time[QUEUE_STATS_HISTOGRAM_SIZE]; // Sampled latency histogram
+    };
+    uint8_t padding[QUEUE_STATS_LATENCY_SLOT_SIZE];
+} tQueueStatsLatency;
+
+// Sampled latency histograms of a queue (OPTION_QUEUE_STATISTICS)
+// Allocated in process local heap memory for queues created with queueInit, not part of the queue memory
+typedef struct QueueStatsLatencies {
+    tQueueStatsLatency peek;
+    tQueueStatsLatency acquire[QUEUE_STATS_PRODUCER_COUNT];
+} tQueueStatsLatencies;
+
+// Queue statistics
+// Part of the queue memory, to make the counters of all producers visible in shared memory
+// The layout does not depend on OPTION_QUEUE_STATISTICS
+typedef struct QueueStats {
+    union {
+        struct {
+            atomic_uint_fast32_t producer_ticket; // Slot assignment counter, incremented once by each new producer thread
+            uint32_t generation;                  // Queue instance, see queueGetTicket
+            tQueueStatsLatencies *latency;        // Process local latency histograms or NULL
+        };
+        uint8_t padding[64];
+    } h;
+    tQueueStatsConsumer c;
+    tQueueStatsProducer p[QUEUE_STATS_PRODUCER_COUNT];
+} tQueueStats;
+
+static_assert(sizeof(tQueueStats) % 64 == 0, "tQueueStats size must be a multiple of the cache line size");
+
+// Initialize the statistics of a new queue instance, assigns a new generation
+// With OPTION_QUEUE_STATISTICS and local, the latency histograms are allocated, local must be false for a queue in shared memory
+void queueStatsInit(tQueueStats *stats, bool local);
+
+// Free the latency histograms of a queue initialized with local
+void queueStatsFree(tQueueStats *stats);
+
+// Clear all statistics, producer slot assignments are kept
+// Updates of producers running concurrently may be lost
+void queueStatsClear(tQueueStats *stats);
+
+// Get the aggregated statistics of all producers or of a single producer
+// Fields owned by the queue implementation (queue_size, level) are not touched
+bool queueStatsGet(tQueueStats *stats, uint32_t producer, tQueueStatistics *statistics);
+
+// Get the statistics slot of the calling producer thread
+static inline tQueueStatsProducer *queueStatsGetProducer(tQueueStats *stats) {
+    static THREAD_LOCAL tQueueTicketCache ticket_cache;
+    uint32_t ticket = queueGetTicket(&ticket_cache, stats, stats->h.generation, &stats->h.producer_ticket);
+    return &stats->p[ticket < QUEUE_STATS_PRODUCER_COUNT ? ticket : QUEUE_STATS_PRODUCER_COUNT - 1];
+}
+
+// Add to a counter, with a plain load and store in a private slot
+static inline void queueStatsAdd64(atomic_uint_fast64_t *counter, uint64_t value, bool shared) {
+    if (shared)
+        atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+    else
+        atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+static inline void queueStatsAdd32(atomic_uint_least32_t *counter, uint32_t value, bool shared) {
+    if (shared)
+        atomic_fetch_add_explicit(counter, value, memory_order_relaxed);
+    else
+        atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+// Update a maximum, concurrent updates of a shared slot may lose a maximum
+static inline void queueStatsMax32(atomic_uint_least32_t *max, uint32_t value) {
+    if (value > (uint32_t)atomic_load_explicit(max, memory_order_relaxed))
+        atomic_store_explicit(max, value, memory_order_relaxed);
+}
+
+#ifdef OPTION_QUEUE_STATISTICS
+
+// Histogram bin of a latency in ns
+static inline uint32_t queueStatsGetBin(uint64_t t) {
+    uint32_t bin = 0;
+    t >>= 5;
+    while (t != 0 && bin < QUEUE_STATS_HISTOGRAM_SIZE - 1) {
+        t >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+// Start a latency measurement, returns 0, if this operation is not sampled
+static inline uint64_t queueStatsBegin(void) {
+    static THREAD_LOCAL uint32_t sample_counter = 0;
+    if ((sample_counter++ % QUEUE_STATS_SAMPLE_RATE) != 0)
+        return 0;
+    return clockGetMonotonicNs();
+}
+
+// Add a latency sample, start is from queueStatsBegin
+static inline void queueStatsLatency(tQueueStatsLatency *l, uint64_t start, bool shared) {
+    uint64_t t = clockGetMonotonicNs() - start;
+    queueStatsMax32(&l->time_max, t > UINT32_MAX ? UINT32_MAX : (uint32_t)t);
+    queueStatsAdd32(&l->time[queueStatsGetBin(t)], 1, shared);
+}
+
+#else
+
+// Latency statistics disabled, no clock read
+static inline uint64_t queueStatsBegin(void) { return 0; }
+static inline void queueStatsLatency(tQueueStatsLatency *l, uint64_t start, bool shared) {
+    (void)l;
+    (void)start;
+    (void)shared;
+}
+
+#endif // OPTION_QUEUE_STATISTICS
+
+// Producer statistics update after acquiring count buffers
+// start is from queueStatsBegin, level is the queue level seen by this producer before the acquire
+static inline void queueStatsAcquire(tQueueStats *stats, tQueueStatsProducer *p, uint64_t start, uint32_t retries, uint32_t level, uint32_t count, bool acquired) {
+    bool shared = (p == &stats->p[QUEUE_STATS_PRODUCER_COUNT - 1]);
+    if (acquired) {
+        queueStatsAdd64(&p->acquire_count, count, shared);
+        if (atomic_load_explicit(&p->overflow, memory_order_relaxed) != 0)
+            atomic_store_explicit(&p->overflow, 0, memory_order_relaxed);
+    } else {
+        queueStatsAdd64(&p->packets_lost, count, shared);
+        if (atomic_load_explicit(&p->overflow, memory_order_relaxed) == 0) {
+            atomic_store_explicit(&p->overflow, 1, memory_order_relaxed);
+            queueStatsAdd32(&p->overflow_bursts, 1, shared);
+        }
+    }
+    if (retries > 0) {
+        queueStatsAdd64(&p->acquire_retries, retries, shared);
+        queueStatsMax32(&p->acquire_retries_max, retries);
+    }
+    queueStatsMax32(&p->level_max, level);
+    if (start != 0 && stats->h.latency != NULL) {
+        queueStatsLatency(&stats->h.latency->acquire[p - stats->p], start, shared);
+    }
+}
+
+// Consumer statistics update after a peek of count buffers, start is from queueStatsBegin
+static inline void queueStatsPeek(tQueueStats *stats, uint64_t start, uint32_t count) {
+    if (count > 0)
+        queueStatsAdd64(&stats->c.peek_count, count, false);
+    if (start != 0 && stats->h.latency != NULL) {
+        queueStatsLatency(&stats->h.latency->peek, start, false);
+    }
+}
+
+// Consumer statistics update on wait
+static inline void queueStatsWait(tQueueStats *stats) { queueStatsAdd64(&stats->c.wait_count, 1, false); }
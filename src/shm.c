@@ -449,7 +449,10 @@ uint32_t XcpShmGetAliveCounter(uint8_t app_id) {
 
 // Check the alive counter and set application states accordingly
 // This should be called periodically by any process to detect stale applications that died without notifying
-void XcpShmCheckAliveCounters(void) {
+// Returns a bit mask of the applications detected as stale and reset in this check
+uint32_t XcpShmCheckAliveCounters(void) {
+
+    uint32_t stale_apps = 0;
 
     // Reset inactive applications
     for (uint32_t i = 0; i < SHM_MAX_APP_COUNT; i++) {
@@ -480,6 +483,7 @@ void XcpShmCheckAliveCounters(void) {
             // app->u.a2l_name[0] = '\0';
             // app->u.xcp_init_mode = 0;
             DBG_PRINTF_WARNING("XcpShmCheckAliveCounters: Detected stale application %u:'%s', resetting slot\n", i, app->u.project_name);
+            stale_apps |= 1U << i;
         }
     }
 
@@ -500,6 +504,24 @@ void XcpShmCheckAliveCounters(void) {
 
     // Reset alive counters, so applications must increment them to prove they are alive
     XcpShmResetAliveCounters_();
+
+    return stale_apps;
+}
+
+// Set the transmit queue producer tag of this process
+void XcpShmSetQueueProducerTag(uint16_t producer_tag) {
+    assert(isActivated_(gXcpData));
+    tApp *app = &gXcpData->shm_header.app_list[local.shm_app_id];
+    atomic_store(&app->u.queue_producer_tag, producer_tag);
+}
+
+// Get the transmit queue producer tag of an app slot
+uint16_t XcpShmGetQueueProducerTag(uint8_t app_id) {
+    if (!isInitialized_(gXcpData))
+        return 0;
+    if (app_id >= SHM_MAX_APP_COUNT)
+        return 0;
+    return (uint16_t)atomic_load(&gXcpData->shm_header.app_list[app_id].u.queue_producer_tag);
 }
 
 /**************************************************************************/
@@ -56,6 +56,7 @@ typedef union {
         uint8_t reserved[1];                                // reserved
         atomic_uint_least32_t alive_counter;                // incremented periodically by each process's background thread; allows the leader to detect stale/dead followers
         atomic_uint_least32_t a2l_finalized;                // 1 when this app's A2L file is completely generated and 'a2l_name' is valid
+        atomic_uint_least32_t queue_producer_tag;           // transmit queue producer tag of this process (queueRegisterProducer); allows the server to reclaim its uncommitted queue entries
     } u;
     uint8_t b[512]; // pad slot to 512 bytes for future extensions
 } tApp;
@@ -117,8 +118,11 @@ bool XcpShmIsMainA2lFinalized(void);                              // true when t
 void XcpShmSetA2lFinalized(uint8_t app_id, const char *a2l_name); // Set A2L finalized flag and A2L filename for an app slot by app_id index
 bool XcpShmIsA2lFinalized(uint8_t app_id);                        // true when this app process has finalized its A2L file and set its a2l_finalized flag in the app list
 
-void XcpShmIncrementAliveCounter(void); // Called from SHM background thread for XCP server receive thread to prove the application is still alive
-void XcpShmCheckAliveCounters(void);    // Called from the XCP server every second to check for stale applications
+void XcpShmIncrementAliveCounter(void);  // Called from SHM background thread for XCP server receive thread to prove the application is still alive
+uint32_t XcpShmCheckAliveCounters(void); // Called from the XCP server every second to check for stale applications, returns a bit mask of the app slots detected as stale
+
+void XcpShmSetQueueProducerTag(uint16_t producer_tag); // Set the transmit queue producer tag of this process
+uint16_t XcpShmGetQueueProducerTag(uint8_t app_id);    // Get the transmit queue producer tag of an app slot by app_id index
 
 void XcpShmDebugPrint(void); // Print the status and information in tXcpData, for debugging purposes.
 
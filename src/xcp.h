@@ -325,14 +325,14 @@
 /* DAQ list flags (from GET_DAQ_LIST_MODE, SET_DAQ_LIST_MODE) */
 
 // DAQ list mode bit mask coding
-#define DAQ_MODE_ALTERNATING ((uint8_t)0x01) /* Bit0 - Enable/disable alternating display mode */
-#define DAQ_MODE_DIRECTION ((uint8_t)0x02)   /* Bit1 - DAQ list stim mode */
-#define DAQ_MODE_RESERVED2 ((uint8_t)0x04)   /* Bit2 - Not used */
-#define DAQ_MODE_DTO_CTR ((uint8_t)0x08)     /* Bit3 - Use DTO CTR field */
-#define DAQ_MODE_TIMESTAMP ((uint8_t)0x10)   /* Bit4 - Enable timestamp */
-#define DAQ_MODE_PID_OFF ((uint8_t)0x20)     /* Bit5 - Disable PID */
-#define DAQ_MODE_RESERVED6 ((uint8_t)0x40)   /* Bit6 - Not used */
-#define DAQ_MODE_RESERVED7 ((uint8_t)0x80)   /* Bit7 - Not used */
+#define DAQ_MODE_ALTERNATING ((uint8_t)0x01)    /* Bit0 - Enable/disable alternating display mode */
+#define DAQ_MODE_DIRECTION ((uint8_t)0x02)      /* Bit1 - DAQ list stim mode */
+#define DAQ_MODE_RESERVED2 ((uint8_t)0x04)      /* Bit2 - Not used */
+#define DAQ_MODE_DTO_CTR ((uint8_t)0x08)        /* Bit3 - Use DTO CTR field */
+#define DAQ_MODE_TIMESTAMP ((uint8_t)0x10)      /* Bit4 - Enable timestamp */
+#define DAQ_MODE_PID_OFF ((uint8_t)0x20)        /* Bit5 - Disable PID */
+#define DAQ_MODE_SEND_ON_CHANGE ((uint8_t)0x40) /* Bit6 - Reserved in the XCP standard, reused by XCPlite to send only changed samples and a periodic keep alive */
+#define DAQ_MODE_RESERVED7 ((uint8_t)0x80)      /* Bit7 - Not used */
 
 /*-------------------------------------------------------------------------*/
 /* DAQ list state */
@@ -497,6 +497,14 @@
 #define CRO_USER_CMD_SUBCOMMAND CRO_BYTE(1)
 #define CRO_USER_CMD_PAR1 CRO_BYTE(2)
 #define CRO_USER_CMD_PAR2 CRO_BYTE(3)
+#define CRO_USER_CMD_PAR_WORD CRO_WORD(1)
+
+/* USER_CMD sub commands (XCPlite specific) */
+#define USER_CMD_BEGIN_ATOMIC_CAL 0x01 // Begin an atomic calibration transaction
+#define USER_CMD_END_ATOMIC_CAL 0x02   // End an atomic calibration transaction
+#define USER_CMD_RECORDER_START 0x10   // Arm the DAQ recorder, PAR_WORD = pre-trigger time in ms, 0 = whole recorder ring
+#define USER_CMD_RECORDER_TRIGGER 0x11 // Freeze the DAQ recorder and stream the pre-trigger samples to the client
+#define USER_CMD_RECORDER_STOP 0x12    // Stop the DAQ recorder, DAQ lists write into the transmit queue again
 
 /* SYNCH */
 #define CRO_SYNCH_LEN 1
@@ -1117,8 +1125,19 @@ typedef struct {
 #define CC_TL_GET_SERVER_ID_EXTENDED 0xFD
 #define CC_TL_SET_SERVER_IP 0xFC
 #define CC_TL_GET_DAQ_CLOCK_MULTICAST 0xFA
+#define CC_TL_SET_COMPRESSION 0xF0 // XCPlite specific
 #define CRO_TL_SUBCOMMAND CRO_BYTE(1)
 
+/* SET_COMPRESSION (XCPlite specific) */
+#define CRO_TL_SET_COMPRESSION_LEN 3
+#define CRO_TL_SET_COMPRESSION_MODE CRO_BYTE(2)
+#define TL_COMPRESSION_NONE 0x00 // Segments are sent uncompressed
+#define TL_COMPRESSION_LZ4 0x01  // Segments are sent as LZ4 blocks
+// A compressed segment is a single transport layer message with TL_COMPRESSED_SEGMENT_FLAG set in the length and counter 0
+// Its payload is the uncompressed segment size (WORD), the compression mode (WORD) and the compressed segment
+#define TL_COMPRESSED_SEGMENT_FLAG 0x8000
+#define TL_COMPRESSED_SEGMENT_HEADER_SIZE 4
+
 /* GET_SERVER_ID and GET_SERVER_ID_EXTENDED */
 #define CRO_TL_GET_SERVER_ID_LEN 21
 #define CRO_TL_GET_SERVER_ID_PORT CRO_WORD(1)
@@ -344,16 +344,40 @@ XCPlite multi application absolute addressing: XCP_ADDRESS_MODE_XCPLITE__CXSDD (
 #define XCP_ENABLE_DAQ_ADDREXT
 
 // Static allocated memory for DAQ tables
-// Amount of memory for DAQ tables, each ODT entry (e.g. measurement variable) needs 5 bytes, each DAQ list 12 bytes and
+// Amount of memory for DAQ tables, each ODT entry (e.g. measurement variable) needs 6 bytes (5 bytes without XCP_ENABLE_DAQ_ADDREXT), each DAQ list 12 bytes and
 // each ODT 8 bytes
+// The tables computed on DAQ list start (DTO sizes, copy plan, send on change shadows) are allocated in addition, see XCP_DAQ_MEM_DERIVED_SIZE
 #ifdef OPTION_DAQ_MEM_SIZE
 #define XCP_DAQ_MEM_SIZE OPTION_DAQ_MEM_SIZE
 #else
-#define XCP_DAQ_MEM_SIZE (1024 * 6) // Amount of memory for DAQ tables, each ODT entry (e.g. measurement variable or memory block) needs 5 bytes
+#define XCP_DAQ_MEM_SIZE (1024 * 6) // Amount of memory for DAQ tables, each ODT entry (e.g. measurement variable or memory block) needs 6 bytes
 #endif
 
-// Enable DAQ resume mode, requires XCP_ENABLE_DAQ_EVENT_LIST
-// #define XCP_ENABLE_DAQ_RESUME
+// Allocate the memory for DAQ tables from the heap, XCP_DAQ_MEM_SIZE is the default size, which may be changed at runtime with XcpSetDaqMemSize
+// Not in SHM mode, the DAQ tables are part of the shared memory segment with fixed size XCP_DAQ_MEM_SIZE
+#ifndef OPTION_SHM_MODE
+#define XCP_ENABLE_DAQ_MEM_ALLOC
+#endif
+
+// Compile the ODTs of a DAQ list into a copy plan on DAQ list start, adjacent ODT entries are copied with a single memcpy
+// The copy plan needs another 8 bytes per ODT entry, which are allocated in addition to XCP_DAQ_MEM_SIZE
+#define XCP_ENABLE_DAQ_COPY_PLAN
+
+// Build a flat table of the running DAQ lists of each event on DAQ list start and stop
+// Event processing iterates the running DAQ lists of an event without walking the DAQ list chain of the event
+// Off by default, it pays off only with many DAQ lists per event
+// Needs 2 * (2 * XCP_MAX_EVENT_COUNT + XCP_DAQ_MEM_SIZE / 6) bytes of memory
+// Event processing threads count themselves as readers of a table in per thread reader slots, a table is only rebuilt when it has no readers
+// If the inactive table has readers, event processing walks the DAQ list chains until one of both tables has no readers, XCP_DAQ_DISPATCH_WAIT_MS limits the wait
+// #define XCP_ENABLE_DAQ_DISPATCH
+#define XCP_DAQ_DISPATCH_WAIT_MS 100     // Maximum wait for a DAQ dispatch table without readers on DAQ list start and stop
+#define XCP_DAQ_DISPATCH_READER_SLOTS 32 // Reader slots of the event processing threads, additional threads share a slot
+
+// Enable DAQ resume mode, requires XCP_ENABLE_DAQ_EVENT_LIST and the binary persistence file (XCP_MODE_PERSISTENCE) for the DAQ setup, not available in SHM mode
+// SET_REQUEST STORE_DAQ_REQ stores the DAQ setup next to the calibration data, XcpStart(resumeMode=true) restarts it without client
+#if defined(OPTION_ENABLE_PERSISTENCE) && !defined(OPTION_SHM_MODE)
+#define XCP_ENABLE_DAQ_RESUME
+#endif
 
 // Enable prescaler for DAQ events, requires XCP_ENABLE_DAQ_EVENT_LIST
 // #define XCP_ENABLE_DAQ_PRESCALER
@@ -361,6 +385,41 @@ XCPlite multi application absolute addressing: XCP_ADDRESS_MODE_XCPLITE__CXSDD (
 // Enable event control for DAQ events (enable/disable), requires XCP_ENABLE_DAQ_EVENT_LIST
 #define XCP_ENABLE_DAQ_CONTROL
 
+// Enable a DAQ byte budget for events (XcpSetEventByteBudget), requires XCP_ENABLE_DAQ_EVENT_LIST
+// Off by default, it enlarges each event by the budget state and adds shared atomic accounting to the trigger of budgeted events
+// #define XCP_ENABLE_DAQ_EVENT_BUDGET
+#define XCP_DAQ_EVENT_BUDGET_WINDOW_MS 100 // Budget accounting window
+
+// Enable send on change DAQ lists, selected with DAQ_MODE_SEND_ON_CHANGE in SET_DAQ_LIST_MODE or with XcpSetEventSendOnChange
+// A DAQ list sample is only sent, when its data changed since the last sent sample or when the keep alive time expired
+// Needs a shadow copy of the payload of each send on change DAQ list in the unused part of the DAQ memory, DAQ start is rejected with CRC_MEMORY_OVERFLOW, if it does not fit
+// Off by default, DAQ_MODE_SEND_ON_CHANGE uses a mode bit, which is reserved in the XCP standard
+// #define XCP_ENABLE_DAQ_SEND_ON_CHANGE
+#define XCP_DAQ_SEND_ON_CHANGE_KEEP_ALIVE_MS 1000 // Maximum time between 2 samples of a send on change DAQ list
+
+// Enable the pre-trigger DAQ recorder (XcpRecorderXxx or USER_CMD_RECORDER_xxx), not available in SHM mode
+// While armed, running DAQ lists write into an overwrite-oldest ring of XCP_DAQ_RECORDER_SIZE bytes instead of the transmit queue, also after the client disconnected
+// Records are reserved in the ring with atomic operations like in the transmit queue, event processing never waits for a lock
+// On trigger, the ring is frozen and the pre-trigger samples can be dumped to a file or streamed to the connected client
+// Off by default, it adds a recorder check to each DAQ trigger and the ring memory
+// #define XCP_ENABLE_DAQ_RECORDER
+#define XCP_DAQ_RECORDER_SIZE (8 * 1024 * 1024) // Recorder ring size, allocated when the recorder is armed for the first time
+#if defined(XCP_ENABLE_DAQ_RECORDER) && defined(OPTION_SHM_MODE)
+#undef XCP_ENABLE_DAQ_RECORDER
+#endif
+
+// Enable the standalone DAQ logger (XcpDaqLoggerInit) and DAQ setup files (XcpSaveDaqConfig, XcpLoadDaqConfig), not available in SHM mode
+// The DAQ logger replaces the XCP on Ethernet server, it starts a saved DAQ setup without client and writes the transmit queue into MDF4 files
+// Requires one of the lockless queues with queuePeekBatch
+// Off by default, used by applications which log without XCP client
+// #define XCP_ENABLE_DAQ_LOGGER
+#define XCP_DAQ_LOGGER_WRITE_BUFFER_SIZE (4 * 1024 * 1024) // MDF4 records are collected and written to the file in chunks of this size
+#define XCP_DAQ_LOGGER_FILE_SIZE (1024 * 1024 * 1024)       // Start a new MDF4 file, when the file size exceeds this size
+#define XCP_DAQ_LOGGER_FILE_TIME_S 600                      // Start a new MDF4 file after this time in seconds
+#if defined(XCP_ENABLE_DAQ_LOGGER) && (defined(OPTION_SHM_MODE) || !(defined(OPTION_QUEUE_64_VAR_SIZE) || defined(OPTION_QUEUE_64_FIX_SIZE)))
+#undef XCP_ENABLE_DAQ_LOGGER
+#endif
+
 // Overrun indication via PID
 // Not needed for Ethernet, client detects data loss via transport layer counter gaps
 // #define XCP_ENABLE_OVERRUN_INDICATION_PID
@@ -15,12 +15,13 @@
 #include <stdio.h>   // for fclose, fopen, fread, fseek, ftell
 #include <string.h>  // for strncpy
 
-#include "dbg_print.h"  // for DBG_PRINTF3, DBG_PRINT4, DBG_PRINTF4, DBG...
-#include "platform.h"   // for platform defines (WIN_, LINUX_, MACOS_) and specific implementation of sockets, clock, thread, mutex
-#include "xcp.h"        // for CRC_XXX
-#include "xcp_cfg.h"    // for XCP_ENABLE_xxx
-#include "xcplib_cfg.h" // for OPTION_xxx
-#include "xcplite.h"    // for tXcpDaqLists, XcpXxx, ApplXcpXxx, ...
+#include "dbg_print.h"   // for DBG_PRINTF3, DBG_PRINT4, DBG_PRINTF4, DBG...
+#include "persistence.h" // for XcpBinStoreDaq, XcpBinClearDaq
+#include "platform.h"    // for platform defines (WIN_, LINUX_, MACOS_) and specific implementation of sockets, clock, thread, mutex
+#include "xcp.h"         // for CRC_XXX
+#include "xcp_cfg.h"     // for XCP_ENABLE_xxx
+#include "xcplib_cfg.h"  // for OPTION_xxx
+#include "xcplite.h"     // for tXcpDaqLists, XcpXxx, ApplXcpXxx, ...
 
 #if !defined(_WIN) && !defined(_LINUX) && !defined(_MACOS) && !defined(_QNX)
 #error "Please define platform _WIN, _MACOS or _LINUX or _QNX"
@@ -459,18 +460,24 @@ uint8_t ApplXcpCalFreeze(void) {
 /**************************************************************************/
 
 // Cold start data acquisition
-// Not implemented
+// The DAQ setup is stored in the binary persistence file and started by XcpStart in resume mode
 #ifdef XCP_ENABLE_DAQ_RESUME
 uint8_t ApplXcpDaqResumeStore(uint16_t config_id) {
 
     DBG_PRINTF3("ApplXcpResumeStore config-id=%u\n", config_id);
-    (void)config_id;
-    return CRC_CMD_IGNORED;
+    if ((XcpGetInitMode() & XCP_MODE_PERSISTENCE) == 0) {
+        return CRC_CMD_IGNORED;
+    }
+    return XcpBinStoreDaq() ? CRC_CMD_OK : CRC_DAQ_CONFIG;
 }
 uint8_t ApplXcpDaqResumeClear(void) {
 
     DBG_PRINT3("ApplXcpResumeClear\n");
-    return CRC_CMD_IGNORED;
+    if ((XcpGetInitMode() & XCP_MODE_PERSISTENCE) == 0) {
+        return CRC_CMD_IGNORED;
+    }
+    XcpBinClearDaq();
+    return CRC_CMD_OK;
 }
 #endif
 
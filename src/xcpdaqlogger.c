@@ -0,0 +1,1201 @@
+/*----------------------------------------------------------------------------
+| File:
+|   xcpdaqlogger.c
+|
+| Description:
+|   Standalone DAQ logger
+|   Starts a saved DAQ setup without XCP client and writes the DAQ data from the transmit queue into MDF4 files
+|   Creates a thread for the protocol layer background tasks and the MDF4 writer
+|
+|   MDF4 file layout:
+|     Unsorted, one data group with a 2 byte record id (the DAQ list number) and one channel group per running DAQ list
+|     Each record contains a 64 bit time master channel (DAQ clock ticks since DAQ start) and the payload of all ODTs of the DAQ list
+|     Channel names, types and linear conversions are taken from the MEASUREMENTs in the A2L file, the A2L file is embedded as attachment
+|     The file is written unfinalized, the DT block length and the cycle counters are updated when the file is closed
+|
+| Copyright (c) Vector Informatik GmbH. All rights reserved.
+| Licensed under the MIT license. See LICENSE file in the project root for details.
+|
+-----------------------------------------------------------------------------*/
+
+#include "xcpdaqlogger.h"
+
+#include <assert.h>   // for assert
+#include <inttypes.h> // for PRIu64
+#include <stdbool.h>  // for bool
+#include <stdint.h>   // for uintxx_t
+#include <stdio.h>    // for FILE, fopen, fwrite, ...
+#include <stdlib.h>   // for malloc, free, qsort, bsearch
+#include <string.h>   // for memcpy, memset, strlen, strstr
+#include <time.h>     // for time
+
+#include "a2l.h"        // for A2lFinalize, A2lGetFilename
+#include "dbg_print.h"  // for DBG_LEVEL, DBG_PRINT3, DBG_PRINTF4, DBG...
+#include "platform.h"   // for THREAD_HANDLE, create_thread, join_thread, clockGetMonotonicNs, CLOCK_TICKS_PER_S
+#include "queue.h"      // for tQueueHandle, queueInit, queuePeekBatch, ...
+#include "xcp_cfg.h"    // for XCP_ENABLE_DAQ_LOGGER, XCP_DAQ_LOGGER_xxx
+#include "xcplib_cfg.h" // for OPTION_xxx
+#include "xcplite.h"    // for XcpStart, XcpLoadDaqConfig, XcpGetOdtEntry, ...
+
+#ifdef XCP_ENABLE_DAQ_LOGGER
+
+#if defined(_WIN) // Windows
+static DWORD WINAPI XcpDaqLoggerThread(LPVOID lpParameter);
+#else
+static void *XcpDaqLoggerThread(void *par);
+#endif
+
+#if defined(OPTION_QUEUE_PRIORITY_HEADROOM) && !defined(OPTION_QUEUE_OVERFLOW_POLICY)
+#define OPTION_QUEUE_OVERFLOW_POLICY QUEUE_OVERFLOW_DROP_NEWEST
+#endif
+
+#define MAX_BUFFERS 256                 // Max number of queue buffers peeked at once
+#define BACKGROUND_TASKS_CYCLE_MS 10ULL // Cycle time of XcpBackgroundTasks in the logger thread
+#define QUEUE_WAIT_TIME_US 10000        // Wait time for more data in the queue
+
+#define DAQ_LOGGER_RECORD_HEADER_SIZE 10 // Record id (DAQ list number) and time master channel
+
+//-------------------------------------------------------------------------------------------------------
+// MDF4 blocks
+
+#define MDF_UNFIN_CG_CYCLE_COUNT 0x0001 // Cycle counters of the channel groups are not valid
+#define MDF_UNFIN_DT_LENGTH 0x0004      // Length of the last DT block is not valid
+
+#define MDF_DATA_TYPE_UINT_LE 0
+#define MDF_DATA_TYPE_INT_LE 2
+#define MDF_DATA_TYPE_FLOAT_LE 4
+#define MDF_DATA_TYPE_BYTE_ARRAY 10
+
+#pragma pack(push, 1)
+
+typedef struct {
+    char file_id[8];
+    char format_id[8];
+    char program_id[8];
+    uint8_t res1[4];
+    uint16_t version;
+    uint8_t res2[30];
+    uint16_t unfin_flags;
+    uint16_t custom_unfin_flags;
+} tMdfId;
+
+typedef struct {
+    char id[4];
+    uint32_t res;
+    uint64_t length;
+    uint64_t link_count;
+} tMdfBlockHeader;
+
+typedef struct {
+    uint64_t start_time_ns;
+    int16_t tz_offset_min;
+    int16_t dst_offset_min;
+    uint8_t time_flags;
+    uint8_t time_class;
+    uint8_t flags;
+    uint8_t res;
+    double start_angle_rad;
+    double start_distance_m;
+} tMdfHdData;
+
+typedef struct {
+    uint64_t time_ns;
+    int16_t tz_offset_min;
+    int16_t dst_offset_min;
+    uint8_t time_flags;
+    uint8_t res[3];
+} tMdfFhData;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t creator_index;
+    uint8_t res[4];
+    uint8_t md5_checksum[16];
+    uint64_t original_size;
+    uint64_t embedded_size;
+} tMdfAtData;
+
+typedef struct {
+    uint8_t rec_id_size;
+    uint8_t res[7];
+} tMdfDgData;
+
+typedef struct {
+    uint64_t record_id;
+    uint64_t cycle_count;
+    uint16_t flags;
+    uint16_t path_separator;
+    uint8_t res[4];
+    uint32_t data_bytes;
+    uint32_t inval_bytes;
+} tMdfCgData;
+
+typedef struct {
+    uint8_t type;
+    uint8_t sync_type;
+    uint8_t data_type;
+    uint8_t bit_offset;
+    uint32_t byte_offset;
+    uint32_t bit_count;
+    uint32_t flags;
+    uint32_t inval_bit_pos;
+    uint8_t precision;
+    uint8_t res;
+    uint16_t attachment_count;
+    double val_range_min;
+    double val_range_max;
+    double limit_min;
+    double limit_max;
+    double limit_ext_min;
+    double limit_ext_max;
+} tMdfCnData;
+
+typedef struct {
+    uint8_t type;
+    uint8_t precision;
+    uint16_t flags;
+    uint16_t ref_count;
+    uint16_t val_count;
+    double phy_range_min;
+    double phy_range_max;
+    double val[2];
+} tMdfCcData;
+
+#pragma pack(pop)
+
+static_assert(sizeof(tMdfId) == 64, "Error: size of tMdfId is not equal to 64");
+static_assert(sizeof(tMdfBlockHeader) == 24, "Error: size of tMdfBlockHeader is not equal to 24");
+static_assert(sizeof(tMdfHdData) == 32, "Error: size of tMdfHdData is not equal to 32");
+static_assert(sizeof(tMdfCgData) == 32, "Error: size of tMdfCgData is not equal to 32");
+static_assert(sizeof(tMdfCnData) == 72, "Error: size of tMdfCnData is not equal to 72");
+static_assert(sizeof(tMdfCcData) == 40, "Error: size of tMdfCcData is not equal to 40");
+
+#define MDF_HD_POS 64                                                 // HD block immediately follows the ID block
+#define MDF_HD_LINK_COUNT 6                                           // dg_first, fh_first, ch_first, at_first, ev_first, md_comment
+#define MDF_CG_CYCLE_COUNT_OFFSET (sizeof(tMdfBlockHeader) + 6 * 8 + 8) // Offset of cg_cycle_count in the CG block
+
+//-------------------------------------------------------------------------------------------------------
+// Logger state
+
+// A2L measurement, which is referenced by ODT entries
+typedef struct {
+    char *name;
+    char *unit;        // Physical unit or NULL
+    char *conv;        // Conversion name or NULL
+    uint8_t data_type; // MDF4 data type
+    uint8_t size;      // Element size
+    uint16_t dim;      // Number of elements
+} tDaqLoggerMeasurement;
+
+// A2L linear conversion
+typedef struct {
+    char *name;
+    char *unit;
+    double factor;
+    double offset;
+} tDaqLoggerConversion;
+
+// ODT entry of a running DAQ list
+typedef struct {
+    uint32_t addr;
+    uint32_t offset; // Byte offset in the record data after the record id
+    uint16_t daq;
+    uint8_t ext;
+    uint8_t size;
+    int32_t measurement; // Index of the A2L measurement or -1
+    uint16_t index;      // First element of the A2L measurement
+} tDaqLoggerEntry;
+
+// DAQ list
+typedef struct {
+    uint16_t odt_count;    // Number of ODTs, 0 = DAQ list not running
+    uint16_t odt;          // Next expected ODT of the record under assembly
+    uint16_t *odt_size;    // Payload size of each ODT
+    uint32_t record_size;  // Record size including record id, time and payload
+    uint32_t fill;         // Bytes of the record under assembly
+    uint8_t *record;       // Record under assembly, in the write buffer or in buffer
+    uint8_t *buffer;       // Assembly buffer for DAQ lists with multiple ODTs
+    uint32_t first_entry;  // First ODT entry in entries
+    uint32_t entry_count;  // Number of ODT entries
+    uint64_t cycle_count;  // Records in the current file
+    uint64_t cg_pos;       // Position of the CG block in the current file
+} tDaqLoggerDaqList;
+
+static struct {
+
+    bool is_init;
+
+    // Thread
+    THREAD_HANDLE thread_handle;
+    volatile bool thread_running;
+    volatile bool thread_started;
+
+    // Queue
+    tQueueHandle queue;
+
+    // Parameters
+    char *daq_config_file;
+    char *mdf_file_prefix;
+
+    // DAQ lists and ODT entries
+    uint16_t daq_count;
+    tDaqLoggerDaqList *daq_lists;
+    tDaqLoggerEntry *entries;
+    uint32_t entry_count;
+
+    // A2L metadata
+    tDaqLoggerMeasurement *measurements;
+    uint32_t measurement_count;
+    tDaqLoggerConversion *conversions;
+    uint32_t conversion_count;
+
+    // Clock
+    uint64_t daq_start_clock; // DAQ clock at DAQ start, time master channel origin
+    uint64_t start_time_ns;   // Wall clock time of DAQ start
+
+    // File
+    FILE *file;
+    uint32_t file_index;
+    uint64_t file_pos;        // Current file position
+    uint64_t file_start_time; // Monotonic time the file was opened
+    uint64_t dt_pos;          // Position of the DT block
+    bool file_error;
+
+    // Write buffer
+    uint8_t *buffer;
+    uint32_t buffer_level;
+
+    // Statistics
+    uint64_t record_count;
+    uint64_t byte_count;
+    uint32_t lost_count;
+
+} gXcpDaqLogger;
+
+//-------------------------------------------------------------------------------------------------------
+// Helpers
+
+static char *XcpDaqLoggerStrDup(const char *s, size_t n) {
+    char *d = (char *)malloc(n + 1);
+    if (d != NULL) {
+        memcpy(d, s, n);
+        d[n] = 0;
+    }
+    return d;
+}
+
+// Get a quoted string at s, returns the position after the closing quote or NULL
+static const char *XcpDaqLoggerGetQuoted(const char *s, char **value) {
+    s = strchr(s, '"');
+    if (s == NULL)
+        return NULL;
+    const char *e = strchr(s + 1, '"');
+    if (e == NULL)
+        return NULL;
+    if (value != NULL)
+        *value = XcpDaqLoggerStrDup(s + 1, (size_t)(e - s - 1));
+    return e + 1;
+}
+
+// Get the MDF4 data type and size of an A2L type or record layout name, returns 0 if unknown
+static uint8_t XcpDaqLoggerGetType(const char *type, uint8_t *data_type) {
+    static const struct {
+        const char *name;
+        uint8_t data_type;
+        uint8_t size;
+    } types[] = {{"UBYTE", MDF_DATA_TYPE_UINT_LE, 1},  {"SBYTE", MDF_DATA_TYPE_INT_LE, 1},   {"UWORD", MDF_DATA_TYPE_UINT_LE, 2},
+                 {"SWORD", MDF_DATA_TYPE_INT_LE, 2},   {"ULONG", MDF_DATA_TYPE_UINT_LE, 4},  {"SLONG", MDF_DATA_TYPE_INT_LE, 4},
+                 {"A_UINT64", MDF_DATA_TYPE_UINT_LE, 8}, {"A_INT64", MDF_DATA_TYPE_INT_LE, 8}, {"FLOAT32_IEEE", MDF_DATA_TYPE_FLOAT_LE, 4},
+                 {"FLOAT64_IEEE", MDF_DATA_TYPE_FLOAT_LE, 8}, {"U8", MDF_DATA_TYPE_UINT_LE, 1},     {"I8", MDF_DATA_TYPE_INT_LE, 1},
+                 {"U16", MDF_DATA_TYPE_UINT_LE, 2},      {"I16", MDF_DATA_TYPE_INT_LE, 2},    {"U32", MDF_DATA_TYPE_UINT_LE, 4},
+                 {"I32", MDF_DATA_TYPE_INT_LE, 4},       {"U64", MDF_DATA_TYPE_UINT_LE, 8},   {"I64", MDF_DATA_TYPE_INT_LE, 8},
+                 {"F32", MDF_DATA_TYPE_FLOAT_LE, 4},     {"F64", MDF_DATA_TYPE_FLOAT_LE, 8}};
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (strcmp(type, types[i].name) == 0) {
+            *data_type = types[i].data_type;
+            return types[i].size;
+        }
+    }
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// ODT entries and A2L metadata
+
+// Order of the ODT entries by address extension and address
+static int XcpDaqLoggerCompareEntry(const void *a, const void *b) {
+    const tDaqLoggerEntry *ea = &gXcpDaqLogger.entries[*(const uint32_t *)a];
+    const tDaqLoggerEntry *eb = &gXcpDaqLogger.entries[*(const uint32_t *)b];
+    if (ea->ext != eb->ext)
+        return ea->ext < eb->ext ? -1 : 1;
+    if (ea->addr != eb->addr)
+        return ea->addr < eb->addr ? -1 : 1;
+    return 0;
+}
+
+// Build the DAQ list and ODT entry tables of the running DAQ lists
+static bool XcpDaqLoggerInitDaqLists(void) {
+
+    gXcpDaqLogger.daq_count = XcpGetDaqListCount();
+    gXcpDaqLogger.daq_lists = (tDaqLoggerDaqList *)calloc(gXcpDaqLogger.daq_count, sizeof(tDaqLoggerDaqList));
+    if (gXcpDaqLogger.daq_lists == NULL)
+        return false;
+
+    // Count the ODT entries
+    uint32_t entry_count = 0;
+    for (uint16_t daq = 0; daq < gXcpDaqLogger.daq_count; daq++) {
+        if (XcpGetDaqListEvent(daq) == XCP_UNDEFINED_EVENT_ID)
+            continue;
+        uint8_t ext, size;
+        uint32_t addr;
+        for (uint16_t odt = 0; XcpGetOdtEntry(daq, odt, 0, &ext, &addr, &size); odt++) {
+            for (uint16_t idx = 0; XcpGetOdtEntry(daq, odt, idx, &ext, &addr, &size); idx++) {
+                entry_count++;
+            }
+        }
+    }
+    gXcpDaqLogger.entries = (tDaqLoggerEntry *)calloc(entry_count > 0 ? entry_count : 1, sizeof(tDaqLoggerEntry));
+    if (gXcpDaqLogger.entries == NULL)
+        return false;
+
+    // Build the tables
+    for (uint16_t daq = 0; daq < gXcpDaqLogger.daq_count; daq++) {
+        if (XcpGetDaqListEvent(daq) == XCP_UNDEFINED_EVENT_ID)
+            continue;
+        tDaqLoggerDaqList *d = &gXcpDaqLogger.daq_lists[daq];
+        uint8_t ext, size;
+        uint32_t addr;
+        uint16_t odt_count = 0;
+        while (XcpGetOdtEntry(daq, odt_count, 0, &ext, &addr, &size))
+            odt_count++;
+        d->odt_size = (uint16_t *)calloc(odt_count, sizeof(uint16_t));
+        if (d->odt_size == NULL)
+            return false;
+        d->first_entry = gXcpDaqLogger.entry_count;
+        uint32_t offset = DAQ_LOGGER_RECORD_HEADER_SIZE - 2;
+        for (uint16_t odt = 0; odt < odt_count; odt++) {
+            for (uint16_t idx = 0; XcpGetOdtEntry(daq, odt, idx, &ext, &addr, &size); idx++) {
+                tDaqLoggerEntry *e = &gXcpDaqLogger.entries[gXcpDaqLogger.entry_count++];
+                e->addr = addr;
+                e->ext = ext;
+                e->size = size;
+                e->daq = daq;
+                e->offset = offset;
+                e->measurement = -1;
+                offset += size;
+                d->odt_size[odt] = (uint16_t)(d->odt_size[odt] + size);
+            }
+        }
+        d->entry_count = gXcpDaqLogger.entry_count - d->first_entry;
+        d->record_size = offset + 2;
+        if (odt_count > 1) {
+            d->buffer = (uint8_t *)malloc(d->record_size);
+            if (d->buffer == NULL)
+                return false;
+        }
+        d->odt_count = odt_count;
+        DBG_PRINTF4("DAQ logger: DAQ %u, %u ODTs, %u ODT entries, record size %u\n", daq, odt_count, d->entry_count, d->record_size);
+    }
+    return true;
+}
+
+// Add an A2L measurement to all ODT entries within its memory range
+static void XcpDaqLoggerAddMeasurement(const uint32_t *sorted, const char *name, const char *type, const char *conv, char *unit, uint16_t dim, uint8_t ext, uint32_t addr) {
+
+    uint8_t data_type = 0;
+    uint8_t size = XcpDaqLoggerGetType(type, &data_type);
+    if (size == 0) {
+        free(unit);
+        return;
+    }
+
+    // Lower bound of the ODT entries at or after addr
+    uint32_t lo = 0;
+    uint32_t hi = gXcpDaqLogger.entry_count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        const tDaqLoggerEntry *e = &gXcpDaqLogger.entries[sorted[mid]];
+        if (e->ext < ext || (e->ext == ext && e->addr < addr)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    int32_t m = -1;
+    uint32_t end = addr + (uint32_t)size * dim;
+    for (uint32_t i = lo; i < gXcpDaqLogger.entry_count; i++) {
+        tDaqLoggerEntry *e = &gXcpDaqLogger.entries[sorted[i]];
+        if (e->ext != ext || e->addr >= end)
+            break;
+        if (e->measurement >= 0 || (e->addr - addr) % size != 0 || e->size % size != 0 || e->addr + e->size > end)
+            continue; // Already named or not aligned to the elements of this measurement
+
+        // Create the measurement on first use
+        if (m < 0) {
+            tDaqLoggerMeasurement *p = (tDaqLoggerMeasurement *)realloc(gXcpDaqLogger.measurements, (gXcpDaqLogger.measurement_count + 1) * sizeof(tDaqLoggerMeasurement));
+            if (p == NULL)
+                break;
+            gXcpDaqLogger.measurements = p;
+            m = (int32_t)gXcpDaqLogger.measurement_count++;
+            p[m].name = XcpDaqLoggerStrDup(name, strlen(name));
+            p[m].unit = unit;
+            p[m].conv = strcmp(conv, "NO_COMPU_METHOD") != 0 ? XcpDaqLoggerStrDup(conv, strlen(conv)) : NULL;
+            p[m].data_type = data_type;
+            p[m].size = size;
+            p[m].dim = dim;
+            unit = NULL;
+        }
+        e->measurement = m;
+        e->index = (uint16_t)((e->addr - addr) / size);
+    }
+    free(unit);
+}
+
+// Scan the A2L file for the MEASUREMENTs and VAL_BLK CHARACTERISTICs of the ODT entries and for linear conversions
+// The A2L writer writes each MEASUREMENT, CHARACTERISTIC and COMPU_METHOD on a single line
+static void XcpDaqLoggerLoadA2l(const char *filename) {
+
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        DBG_PRINTF_WARNING("DAQ logger: A2L file %s not found, channels are named by address\n", filename);
+        return;
+    }
+
+    uint32_t *sorted = (uint32_t *)malloc((gXcpDaqLogger.entry_count > 0 ? gXcpDaqLogger.entry_count : 1) * sizeof(uint32_t));
+    if (sorted == NULL) {
+        fclose(file);
+        return;
+    }
+    for (uint32_t i = 0; i < gXcpDaqLogger.entry_count; i++)
+        sorted[i] = i;
+    qsort(sorted, gXcpDaqLogger.entry_count, sizeof(uint32_t), XcpDaqLoggerCompareEntry);
+
+    static char line[4 * XCP_A2L_MAX_LINE_LENGTH];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        const char *s = line;
+        while (*s == ' ' || *s == '\t')
+            s++;
+
+        // /begin MEASUREMENT name "comment" type conv 0 0 min max [MATRIX_DIM n] ECU_ADDRESS 0x.. [ECU_ADDRESS_EXTENSION n] [PHYS_UNIT "unit"] ...
+        if (strncmp(s, "/begin MEASUREMENT ", 19) == 0) {
+            char name[XCP_A2L_MAX_SYMBOL_NAME_LENGTH];
+            char type[16];
+            char conv[XCP_A2L_MAX_SYMBOL_NAME_LENGTH];
+            if (sscanf(s + 19, "%63s", name) != 1)
+                continue;
+            const char *p = XcpDaqLoggerGetQuoted(s + 19, NULL);
+            if (p == NULL || sscanf(p, "%15s %63s", type, conv) != 2)
+                continue;
+            const char *a = strstr(p, "ECU_ADDRESS 0x");
+            uint32_t addr = 0;
+            if (a == NULL || sscanf(a + 12, "%" SCNx32, &addr) != 1)
+                continue;
+            unsigned int ext = 0;
+            const char *x = strstr(p, "ECU_ADDRESS_EXTENSION ");
+            if (x != NULL)
+                sscanf(x + 22, "%u", &ext);
+            unsigned int dim = 1;
+            const char *d = strstr(p, "MATRIX_DIM ");
+            if (d != NULL && d < a)
+                sscanf(d + 11, "%u", &dim);
+            char *unit = NULL;
+            const char *u = strstr(p, "PHYS_UNIT ");
+            if (u != NULL)
+                XcpDaqLoggerGetQuoted(u, &unit);
+            XcpDaqLoggerAddMeasurement(sorted, name, type, conv, unit, (uint16_t)(dim > 0 ? dim : 1), (uint8_t)ext, addr);
+        }
+
+        // Measurable arrays are VAL_BLK characteristics
+        // /begin CHARACTERISTIC name "comment" VAL_BLK 0x.. layout 0 conv min max MATRIX_DIM x y [ECU_ADDRESS_EXTENSION n] ...
+        else if (strncmp(s, "/begin CHARACTERISTIC ", 22) == 0 && strstr(s, " VAL_BLK ") != NULL) {
+            char name[XCP_A2L_MAX_SYMBOL_NAME_LENGTH];
+            char layout[16];
+            char conv[XCP_A2L_MAX_SYMBOL_NAME_LENGTH];
+            uint32_t addr = 0;
+            if (sscanf(s + 22, "%63s", name) != 1)
+                continue;
+            const char *p = XcpDaqLoggerGetQuoted(s + 22, NULL);
+            if (p == NULL || sscanf(p, " VAL_BLK %" SCNx32 " %15s 0 %63s", &addr, layout, conv) != 3)
+                continue;
+            unsigned int ext = 0;
+            const char *x = strstr(p, "ECU_ADDRESS_EXTENSION ");
+            if (x != NULL)
+                sscanf(x + 22, "%u", &ext);
+            unsigned int dim_x = 1, dim_y = 1;
+            const char *d = strstr(p, "MATRIX_DIM ");
+            if (d != NULL)
+                sscanf(d + 11, "%u %u", &dim_x, &dim_y);
+            char *unit = NULL;
+            const char *u = strstr(p, "PHYS_UNIT ");
+            if (u != NULL)
+                XcpDaqLoggerGetQuoted(u, &unit);
+            unsigned int dim = dim_x * dim_y;
+            XcpDaqLoggerAddMeasurement(sorted, name, layout, conv, unit, (uint16_t)(dim > 0 ? dim : 1), (uint8_t)ext, addr);
+        }
+
+        // /begin COMPU_METHOD name "comment" LINEAR "format" "unit" COEFFS_LINEAR factor offset /end COMPU_METHOD
+        else if (strncmp(s, "/begin COMPU_METHOD ", 20) == 0 && strstr(s, " LINEAR ") != NULL) {
+            char name[XCP_A2L_MAX_SYMBOL_NAME_LENGTH];
+            if (sscanf(s + 20, "%63s", name) != 1)
+                continue;
+            const char *p = XcpDaqLoggerGetQuoted(strstr(s, " LINEAR "), NULL); // Format
+            char *unit = NULL;
+            p = p != NULL ? XcpDaqLoggerGetQuoted(p, &unit) : NULL;
+            const char *c = p != NULL ? strstr(p, "COEFFS_LINEAR ") : NULL;
+            double factor, offset;
+            tDaqLoggerConversion *conv = NULL;
+            if (c != NULL && sscanf(c + 14, "%lf %lf", &factor, &offset) == 2) {
+                conv = (tDaqLoggerConversion *)realloc(gXcpDaqLogger.conversions, (gXcpDaqLogger.conversion_count + 1) * sizeof(tDaqLoggerConversion));
+            }
+            if (conv == NULL) {
+                free(unit);
+                continue;
+            }
+            gXcpDaqLogger.conversions = conv;
+            conv = &conv[gXcpDaqLogger.conversion_count++];
+            conv->name = XcpDaqLoggerStrDup(name, strlen(name));
+            conv->unit = unit;
+            conv->factor = factor;
+            conv->offset = offset;
+        }
+    }
+    fclose(file);
+    free(sorted);
+
+    uint32_t named = 0;
+    for (uint32_t i = 0; i < gXcpDaqLogger.entry_count; i++) {
+        if (gXcpDaqLogger.entries[i].measurement >= 0)
+            named++;
+    }
+    DBG_PRINTF3("DAQ logger: %u of %u ODT entries found in %s\n", named, gXcpDaqLogger.entry_count, filename);
+}
+
+static const tDaqLoggerConversion *XcpDaqLoggerGetConversion(const char *name) {
+    if (name == NULL)
+        return NULL;
+    for (uint32_t i = 0; i < gXcpDaqLogger.conversion_count; i++) {
+        if (gXcpDaqLogger.conversions[i].name != NULL && strcmp(gXcpDaqLogger.conversions[i].name, name) == 0)
+            return &gXcpDaqLogger.conversions[i];
+    }
+    return NULL;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// MDF4 writer
+
+// Write data at the current file position
+static void XcpDaqLoggerWrite(const void *data, uint64_t size) {
+    if (size > 0 && fwrite(data, (size_t)size, 1, gXcpDaqLogger.file) != 1) {
+        if (!gXcpDaqLogger.file_error) {
+            DBG_PRINT_ERROR("DAQ logger: MDF4 file write failed\n");
+        }
+        gXcpDaqLogger.file_error = true;
+    }
+    gXcpDaqLogger.file_pos += size;
+}
+
+// Write data at a position in the file which is already written
+static void XcpDaqLoggerPatch(uint64_t pos, const void *data, uint32_t size) {
+    if (fseek(gXcpDaqLogger.file, (long)pos, SEEK_SET) != 0 || fwrite(data, size, 1, gXcpDaqLogger.file) != 1) {
+        gXcpDaqLogger.file_error = true;
+    }
+}
+
+// Write a block, returns its position
+static uint64_t XcpDaqLoggerWriteBlock(const char *id, const uint64_t *links, uint32_t link_count, const void *data, uint32_t data_size) {
+    static const uint8_t padding[8] = {0};
+    uint64_t pos = gXcpDaqLogger.file_pos;
+    uint32_t padded_size = (data_size + 7) & ~7u;
+    tMdfBlockHeader header;
+    memcpy(header.id, id, 4);
+    header.res = 0;
+    header.length = sizeof(header) + link_count * 8ULL + padded_size;
+    header.link_count = link_count;
+    XcpDaqLoggerWrite(&header, sizeof(header));
+    XcpDaqLoggerWrite(links, link_count * 8ULL);
+    XcpDaqLoggerWrite(data, data_size);
+    XcpDaqLoggerWrite(padding, padded_size - data_size);
+    return pos;
+}
+
+// Write a TX or MD block, returns its position or 0 for an empty text
+static uint64_t XcpDaqLoggerWriteText(const char *id, const char *text) {
+    if (text == NULL || text[0] == 0)
+        return 0;
+    return XcpDaqLoggerWriteBlock(id, NULL, 0, text, (uint32_t)strlen(text) + 1);
+}
+
+// Write a CC block for a linear conversion, returns its position
+static uint64_t XcpDaqLoggerWriteConversion(double factor, double offset, const char *unit) {
+    uint64_t links[4] = {0, XcpDaqLoggerWriteText("##TX", unit), 0, 0}; // tx_name, md_unit, md_comment, cc_inverse
+    tMdfCcData cc;
+    memset(&cc, 0, sizeof(cc));
+    cc.type = 1; // Linear
+    cc.val_count = 2;
+    cc.val[0] = offset;
+    cc.val[1] = factor;
+    return XcpDaqLoggerWriteBlock("##CC", links, 4, &cc, sizeof(cc));
+}
+
+// Write a CN block, returns its position
+static uint64_t XcpDaqLoggerWriteChannel(uint64_t next, const char *name, uint64_t conversion, const char *unit, uint8_t type, uint8_t data_type, uint32_t byte_offset,
+                                         uint32_t size) {
+    uint64_t name_pos = XcpDaqLoggerWriteText("##TX", name);
+    uint64_t unit_pos = XcpDaqLoggerWriteText("##TX", unit);
+    uint64_t links[8] = {next, 0, name_pos, 0, conversion, 0, unit_pos, 0}; // cn_next, composition, tx_name, si_source, cc_conversion, data, md_unit, md_comment
+    tMdfCnData cn;
+    memset(&cn, 0, sizeof(cn));
+    cn.type = type;
+    cn.sync_type = (type == 2) ? 1 : 0; // Master channel is time
+    cn.data_type = data_type;
+    cn.byte_offset = byte_offset;
+    cn.bit_count = size * 8;
+    return XcpDaqLoggerWriteBlock("##CN", links, 8, &cn, sizeof(cn));
+}
+
+// Write the channels of an ODT entry in reverse order, returns the position of the first channel
+static uint64_t XcpDaqLoggerWriteEntryChannels(uint64_t next, const tDaqLoggerEntry *e) {
+
+    char name[XCP_A2L_MAX_SYMBOL_NAME_LENGTH + 16];
+
+    // Unknown ODT entry, named by address
+    if (e->measurement < 0) {
+        SNPRINTF(name, sizeof(name), "0x%08X_%u", e->addr, e->ext);
+        bool integer = e->size == 1 || e->size == 2 || e->size == 4 || e->size == 8;
+        return XcpDaqLoggerWriteChannel(next, name, 0, NULL, 0, integer ? MDF_DATA_TYPE_UINT_LE : MDF_DATA_TYPE_BYTE_ARRAY, e->offset, e->size);
+    }
+
+    // One channel per element of the A2L measurement
+    const tDaqLoggerMeasurement *m = &gXcpDaqLogger.measurements[e->measurement];
+    const tDaqLoggerConversion *conv = XcpDaqLoggerGetConversion(m->conv);
+    const char *unit = (conv != NULL && conv->unit != NULL && conv->unit[0] != 0) ? conv->unit : m->unit;
+    for (uint32_t i = e->size / m->size; i-- > 0;) {
+        if (m->dim > 1) {
+            SNPRINTF(name, sizeof(name), "%s[%u]", m->name, e->index + i);
+        } else {
+            SNPRINTF(name, sizeof(name), "%s", m->name);
+        }
+        uint64_t cc = (conv != NULL) ? XcpDaqLoggerWriteConversion(conv->factor, conv->offset, NULL) : 0;
+        next = XcpDaqLoggerWriteChannel(next, name, cc, unit, 0, m->data_type, e->offset + i * m->size, m->size);
+    }
+    return next;
+}
+
+// Write the ID block
+static void XcpDaqLoggerWriteId(bool finalized) {
+    tMdfId id;
+    memset(&id, 0, sizeof(id));
+    memcpy(id.file_id, finalized ? "MDF     " : "UnFinMF ", 8);
+    memcpy(id.format_id, "4.10    ", 8);
+    memcpy(id.program_id, "XCPlite ", 8);
+    id.version = 410;
+    id.unfin_flags = finalized ? 0 : (MDF_UNFIN_CG_CYCLE_COUNT | MDF_UNFIN_DT_LENGTH);
+    if (finalized) {
+        XcpDaqLoggerPatch(0, &id, sizeof(id));
+    } else {
+        XcpDaqLoggerWrite(&id, sizeof(id));
+    }
+}
+
+// Embed the A2L file as attachment, returns the position of the AT block or 0
+static uint64_t XcpDaqLoggerWriteA2l(const char *filename) {
+
+    FILE *a2l = fopen(filename, "rb");
+    if (a2l == NULL)
+        return 0;
+    fseek(a2l, 0, SEEK_END);
+    long size = ftell(a2l);
+    fseek(a2l, 0, SEEK_SET);
+    if (size <= 0) {
+        fclose(a2l);
+        return 0;
+    }
+
+    const char *basename = filename;
+    for (const char *s = filename; *s != 0; s++) {
+        if (*s == '/' || *s == '\\')
+            basename = s + 1;
+    }
+    uint64_t links[4] = {0, XcpDaqLoggerWriteText("##TX", basename), XcpDaqLoggerWriteText("##TX", "application/A2L"), 0}; // at_next, tx_filename, tx_mimetype, md_comment
+
+    // AT block header and fixed data, followed by the A2L file content
+    static const uint8_t padding[8] = {0};
+    uint64_t pos = gXcpDaqLogger.file_pos;
+    uint64_t padded_size = ((uint64_t)size + 7) & ~7ULL;
+    tMdfBlockHeader header;
+    memcpy(header.id, "##AT", 4);
+    header.res = 0;
+    header.length = sizeof(header) + sizeof(links) + sizeof(tMdfAtData) + padded_size;
+    header.link_count = 4;
+    tMdfAtData at;
+    memset(&at, 0, sizeof(at));
+    at.flags = 1; // Embedded
+    at.original_size = (uint64_t)size;
+    at.embedded_size = (uint64_t)size;
+    XcpDaqLoggerWrite(&header, sizeof(header));
+    XcpDaqLoggerWrite(links, sizeof(links));
+    XcpDaqLoggerWrite(&at, sizeof(at));
+    uint64_t n = 0;
+    while (n < (uint64_t)size) {
+        size_t l = fread(gXcpDaqLogger.buffer, 1, XCP_DAQ_LOGGER_WRITE_BUFFER_SIZE, a2l);
+        if (l == 0)
+            break;
+        XcpDaqLoggerWrite(gXcpDaqLogger.buffer, l);
+        n += l;
+    }
+    fclose(a2l);
+    if (n != (uint64_t)size) {
+        gXcpDaqLogger.file_error = true;
+    }
+    XcpDaqLoggerWrite(padding, padded_size - (uint64_t)size);
+    return pos;
+}
+
+// Open a new MDF4 file and write the file header and the channel descriptions
+static bool XcpDaqLoggerOpenFile(void) {
+
+    char filename[256];
+    SNPRINTF(filename, sizeof(filename), "%s_%04u.mf4", gXcpDaqLogger.mdf_file_prefix, gXcpDaqLogger.file_index++);
+    gXcpDaqLogger.file = fopen(filename, "wb");
+    if (gXcpDaqLogger.file == NULL) {
+        DBG_PRINTF_ERROR("DAQ logger: failed to create MDF4 file %s\n", filename);
+        return false;
+    }
+    gXcpDaqLogger.file_pos = 0;
+    gXcpDaqLogger.file_error = false;
+    gXcpDaqLogger.file_start_time = clockGetMonotonicNs();
+
+    // ID block and space for the HD block, which is written when all links are known
+    XcpDaqLoggerWriteId(false);
+    static const uint8_t hd_space[sizeof(tMdfBlockHeader) + MDF_HD_LINK_COUNT * 8 + sizeof(tMdfHdData)] = {0};
+    XcpDaqLoggerWrite(hd_space, sizeof(hd_space));
+
+    // File history
+    char text[256];
+    SNPRINTF(text, sizeof(text),
+             "<FHcomment><TX>DAQ logger</TX><tool_id>XCPlite</tool_id><tool_vendor>Vector Informatik GmbH</tool_vendor><tool_version>%u.%u.%u</tool_version></FHcomment>",
+             OPTION_VERSION_MAJOR, OPTION_VERSION_MINOR, OPTION_VERSION_PATCH);
+    uint64_t fh_links[2] = {0, XcpDaqLoggerWriteText("##MD", text)}; // fh_next, md_comment
+    tMdfFhData fh;
+    memset(&fh, 0, sizeof(fh));
+    fh.time_ns = (uint64_t)time(NULL) * 1000000000ULL;
+    uint64_t fh_pos = XcpDaqLoggerWriteBlock("##FH", fh_links, 2, &fh, sizeof(fh));
+
+    // A2L file attachment
+    uint64_t at_pos = XcpDaqLoggerWriteA2l(A2lGetFilename());
+
+    // Channel groups and channels, written in reverse order to link each block to the already written next one
+    uint64_t cg_pos = 0;
+    for (uint16_t daq = gXcpDaqLogger.daq_count; daq-- > 0;) {
+        tDaqLoggerDaqList *d = &gXcpDaqLogger.daq_lists[daq];
+        if (d->odt_count == 0)
+            continue;
+        uint64_t cn_pos = 0;
+        for (uint32_t i = d->entry_count; i-- > 0;) {
+            cn_pos = XcpDaqLoggerWriteEntryChannels(cn_pos, &gXcpDaqLogger.entries[d->first_entry + i]);
+        }
+        cn_pos = XcpDaqLoggerWriteChannel(cn_pos, "time", XcpDaqLoggerWriteConversion(1.0 / CLOCK_TICKS_PER_S, 0.0, NULL), "s", 2, MDF_DATA_TYPE_INT_LE, 0, 8);
+
+#ifdef XCP_ENABLE_DAQ_EVENT_LIST
+        const char *acq_name = XcpGetEventName(XcpGetDaqListEvent(daq));
+#else
+        const char *acq_name = NULL;
+#endif
+        uint64_t cg_links[6] = {cg_pos, cn_pos, XcpDaqLoggerWriteText("##TX", acq_name), 0, 0, 0}; // cg_next, cn_first, tx_acq_name, si_acq_source, sr_first, md_comment
+        tMdfCgData cg;
+        memset(&cg, 0, sizeof(cg));
+        cg.record_id = daq;
+        cg.data_bytes = d->record_size - 2;
+        cg_pos = XcpDaqLoggerWriteBlock("##CG", cg_links, 6, &cg, sizeof(cg));
+        d->cg_pos = cg_pos;
+        d->cycle_count = 0;
+    }
+
+    // Header block comment
+    SNPRINTF(text, sizeof(text), "<HDcomment><TX>%s %s</TX></HDcomment>", XcpGetProjectName(), XcpGetEpk());
+    uint64_t hd_md_pos = XcpDaqLoggerWriteText("##MD", text);
+
+    // Data group, the DT block follows immediately
+    uint64_t dg_links[4] = {0, cg_pos, gXcpDaqLogger.file_pos + sizeof(tMdfBlockHeader) + 4 * 8 + sizeof(tMdfDgData), 0}; // dg_next, cg_first, data, md_comment
+    tMdfDgData dg;
+    memset(&dg, 0, sizeof(dg));
+    dg.rec_id_size = 2;
+    uint64_t dg_pos = XcpDaqLoggerWriteBlock("##DG", dg_links, 4, &dg, sizeof(dg));
+
+    // DT block header, the length is updated when the file is closed
+    gXcpDaqLogger.dt_pos = XcpDaqLoggerWriteBlock("##DT", NULL, 0, NULL, 0);
+    assert(gXcpDaqLogger.dt_pos == dg_links[2]);
+
+    // Header block
+    uint64_t hd_links[MDF_HD_LINK_COUNT] = {dg_pos, fh_pos, 0, at_pos, 0, hd_md_pos}; // dg_first, fh_first, ch_first, at_first, ev_first, md_comment
+    uint64_t end_pos = gXcpDaqLogger.file_pos;
+    tMdfHdData hd;
+    memset(&hd, 0, sizeof(hd));
+    hd.start_time_ns = gXcpDaqLogger.start_time_ns;
+    gXcpDaqLogger.file_pos = MDF_HD_POS;
+    fseek(gXcpDaqLogger.file, MDF_HD_POS, SEEK_SET);
+    XcpDaqLoggerWriteBlock("##HD", hd_links, MDF_HD_LINK_COUNT, &hd, sizeof(hd));
+    fseek(gXcpDaqLogger.file, (long)end_pos, SEEK_SET);
+    gXcpDaqLogger.file_pos = end_pos;
+
+    if (gXcpDaqLogger.file_error) {
+        fclose(gXcpDaqLogger.file);
+        gXcpDaqLogger.file = NULL;
+        return false;
+    }
+    DBG_PRINTF3("DAQ logger: writing %s\n", filename);
+    return true;
+}
+
+// Write the collected records to the file
+static void XcpDaqLoggerFlush(void) {
+    if (gXcpDaqLogger.buffer_level > 0) {
+        XcpDaqLoggerWrite(gXcpDaqLogger.buffer, gXcpDaqLogger.buffer_level);
+        gXcpDaqLogger.byte_count += gXcpDaqLogger.buffer_level;
+        gXcpDaqLogger.buffer_level = 0;
+    }
+}
+
+// Finalize and close the current MDF4 file
+static void XcpDaqLoggerCloseFile(void) {
+
+    if (gXcpDaqLogger.file == NULL)
+        return;
+    XcpDaqLoggerFlush();
+
+    // DT block length, cycle counters and ID
+    uint64_t dt_length = gXcpDaqLogger.file_pos - gXcpDaqLogger.dt_pos;
+    XcpDaqLoggerPatch(gXcpDaqLogger.dt_pos + 8, &dt_length, sizeof(dt_length));
+    for (uint16_t daq = 0; daq < gXcpDaqLogger.daq_count; daq++) {
+        tDaqLoggerDaqList *d = &gXcpDaqLogger.daq_lists[daq];
+        if (d->odt_count > 0) {
+            XcpDaqLoggerPatch(d->cg_pos + MDF_CG_CYCLE_COUNT_OFFSET, &d->cycle_count, sizeof(d->cycle_count));
+        }
+    }
+    XcpDaqLoggerWriteId(true);
+
+    if (fclose(gXcpDaqLogger.file) != 0 || gXcpDaqLogger.file_error) {
+        DBG_PRINT_ERROR("DAQ logger: failed to finalize MDF4 file\n");
+    }
+    gXcpDaqLogger.file = NULL;
+}
+
+// Reserve space for a record in the write buffer
+static inline uint8_t *XcpDaqLoggerReserve(uint32_t size) {
+    if (gXcpDaqLogger.buffer_level + size > XCP_DAQ_LOGGER_WRITE_BUFFER_SIZE) {
+        XcpDaqLoggerFlush();
+    }
+    uint8_t *p = gXcpDaqLogger.buffer + gXcpDaqLogger.buffer_level;
+    gXcpDaqLogger.buffer_level += size;
+    return p;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// DAQ message processing
+
+// Process a DAQ message from the transmit queue
+// Records of DAQ lists with a single ODT are assembled in place in the write buffer
+// now is the DAQ clock after the message has been peeked, to extend the 32 bit DTO timestamp to 64 bit
+static void XcpDaqLoggerHandleMessage(const uint8_t *b, uint32_t l, uint64_t now) {
+
+    // Skip response, error, event and service packets
+    if (b[0] >= 0xFC)
+        return;
+#ifdef XCP_ENABLE_OVERRUN_INDICATION_PID
+    uint16_t odt = b[0] & 0x7F;
+#else
+    uint16_t odt = b[0];
+#endif
+    uint16_t daq = *(const uint16_t *)&b[2];
+    if (daq >= gXcpDaqLogger.daq_count)
+        return;
+    tDaqLoggerDaqList *d = &gXcpDaqLogger.daq_lists[daq];
+    if (odt >= d->odt_count)
+        return;
+
+    uint32_t hs = 4; // ODT header
+    if (odt == 0) {
+        if (d->odt != 0) {
+            gXcpDaqLogger.lost_count++; // Record under assembly is incomplete
+        }
+        hs = 8; // ODT header and 32 bit timestamp
+
+        // The DTO timestamp is the low 32 bit of the DAQ clock of a sample taken before now
+        uint64_t clock = (now & 0xFFFFFFFF00000000ULL) | *(const uint32_t *)&b[4];
+        if (clock > now)
+            clock -= 0x100000000ULL;
+        int64_t t = (int64_t)(clock - gXcpDaqLogger.daq_start_clock);
+
+        d->record = (d->odt_count == 1) ? XcpDaqLoggerReserve(d->record_size) : d->buffer;
+        memcpy(d->record, &daq, 2);
+        memcpy(d->record + 2, &t, 8);
+        d->fill = DAQ_LOGGER_RECORD_HEADER_SIZE;
+    } else if (odt != d->odt) {
+        if (d->odt != 0) {
+            gXcpDaqLogger.lost_count++; // ODT lost, drop the record under assembly
+            d->odt = 0;
+        }
+        return;
+    }
+
+    uint16_t size = d->odt_size[odt];
+    assert(hs + size <= l);
+    (void)l;
+    memcpy(d->record + d->fill, b + hs, size);
+    d->fill += size;
+    if (++d->odt == d->odt_count) {
+        if (d->odt_count > 1) {
+            memcpy(XcpDaqLoggerReserve(d->record_size), d->buffer, d->record_size);
+        }
+        d->odt = 0;
+        d->cycle_count++;
+        gXcpDaqLogger.record_count++;
+    }
+}
+
+// Process all committed entries in the transmit queue, returns the number of entries
+static uint32_t XcpDaqLoggerHandleQueue(void) {
+
+    tQueueBuffer queue_buffers[MAX_BUFFERS];
+    uint32_t lost = 0;
+    uint32_t n = queuePeekBatch(gXcpDaqLogger.queue, 0, XCP_DAQ_LOGGER_WRITE_BUFFER_SIZE, queue_buffers, MAX_BUFFERS, &lost, NULL);
+    if (lost > 0) {
+        gXcpDaqLogger.lost_count += lost;
+        DBG_PRINTF_WARNING("DAQ logger: transmit queue overflow, lost %u packets\n", lost);
+    }
+    if (n == 0)
+        return 0;
+
+    uint64_t now = ApplXcpGetClock64();
+    for (uint32_t i = 0; i < n; i++) {
+        const uint8_t *b = queue_buffers[i].buffer;
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+        // A queue entry may contain multiple messages
+        const uint8_t *e = b + queue_buffers[i].size;
+        while (b < e) {
+            uint32_t l = queueGetMessageSize(b);
+            XcpDaqLoggerHandleMessage(b + XCPTL_TRANSPORT_LAYER_HEADER_SIZE, l, now);
+            b += XCPTL_TRANSPORT_LAYER_HEADER_SIZE + l;
+        }
+#else
+        XcpDaqLoggerHandleMessage(b + XCPTL_TRANSPORT_LAYER_HEADER_SIZE, queue_buffers[i].size - XCPTL_TRANSPORT_LAYER_HEADER_SIZE, now);
+#endif
+    }
+    queueReleaseBatch(gXcpDaqLogger.queue, queue_buffers, n);
+    return n;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Start and stop
+
+// Free all memory of the logger state
+static void XcpDaqLoggerFree(void) {
+    for (uint16_t daq = 0; gXcpDaqLogger.daq_lists != NULL && daq < gXcpDaqLogger.daq_count; daq++) {
+        free(gXcpDaqLogger.daq_lists[daq].odt_size);
+        free(gXcpDaqLogger.daq_lists[daq].buffer);
+    }
+    free(gXcpDaqLogger.daq_lists);
+    gXcpDaqLogger.daq_lists = NULL;
+    gXcpDaqLogger.daq_count = 0;
+    free(gXcpDaqLogger.entries);
+    gXcpDaqLogger.entries = NULL;
+    gXcpDaqLogger.entry_count = 0;
+    for (uint32_t i = 0; i < gXcpDaqLogger.measurement_count; i++) {
+        free(gXcpDaqLogger.measurements[i].name);
+        free(gXcpDaqLogger.measurements[i].unit);
+        free(gXcpDaqLogger.measurements[i].conv);
+    }
+    free(gXcpDaqLogger.measurements);
+    gXcpDaqLogger.measurements = NULL;
+    gXcpDaqLogger.measurement_count = 0;
+    for (uint32_t i = 0; i < gXcpDaqLogger.conversion_count; i++) {
+        free(gXcpDaqLogger.conversions[i].name);
+        free(gXcpDaqLogger.conversions[i].unit);
+    }
+    free(gXcpDaqLogger.conversions);
+    gXcpDaqLogger.conversions = NULL;
+    gXcpDaqLogger.conversion_count = 0;
+    free(gXcpDaqLogger.buffer);
+    gXcpDaqLogger.buffer = NULL;
+    free(gXcpDaqLogger.daq_config_file);
+    gXcpDaqLogger.daq_config_file = NULL;
+    free(gXcpDaqLogger.mdf_file_prefix);
+    gXcpDaqLogger.mdf_file_prefix = NULL;
+}
+
+// Start the DAQ setup and open the first MDF4 file
+static bool XcpDaqLoggerStart(void) {
+
+    if (!XcpLoadDaqConfig(gXcpDaqLogger.daq_config_file))
+        return false;
+    gXcpDaqLogger.daq_start_clock = XcpGetDaqStartTime();
+    gXcpDaqLogger.start_time_ns = (uint64_t)time(NULL) * 1000000000ULL;
+
+    if (!XcpDaqLoggerInitDaqLists())
+        return false;
+    XcpDaqLoggerLoadA2l(A2lGetFilename());
+    gXcpDaqLogger.file_index = 0;
+    return XcpDaqLoggerOpenFile();
+}
+
+// Stop DAQ, write the remaining data and close the MDF4 file
+static void XcpDaqLoggerStop(void) {
+
+    XcpFreeDaq();
+
+    // Drain the queue, producers may still commit samples acquired before DAQ was stopped
+    if (gXcpDaqLogger.file != NULL) {
+        while (XcpDaqLoggerHandleQueue() > 0 || queueWait(gXcpDaqLogger.queue, QUEUE_WAIT_TIME_US)) {
+        }
+        XcpDaqLoggerCloseFile();
+    }
+
+    DBG_PRINTF3("DAQ logger: %" PRIu64 " records, %" PRIu64 " MBytes written to %u files, %u lost\n", gXcpDaqLogger.record_count, gXcpDaqLogger.byte_count / (1024 * 1024),
+                gXcpDaqLogger.file_index, gXcpDaqLogger.lost_count);
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Public functions
+
+bool XcpDaqLoggerStatus(void) {
+    if (!XcpIsActivated())
+        return true;
+    return gXcpDaqLogger.is_init && gXcpDaqLogger.thread_running;
+}
+
+bool XcpDaqLoggerInit(const char *daq_config_file, const char *mdf_file_prefix, uint32_t queue_size) {
+
+    // Check and ignore, if the XCP singleton has not been initialized and activated
+    if (!XcpIsActivated()) {
+        DBG_PRINT5("XcpDaqLoggerInit: XCP is deactivated!\n");
+        return true;
+    }
+
+    // Check if already initialized and running
+    if (gXcpDaqLogger.is_init) {
+        DBG_PRINT_WARNING("DAQ logger already running!\n");
+        return false;
+    }
+
+    assert(daq_config_file != NULL && mdf_file_prefix != NULL);
+    memset(&gXcpDaqLogger, 0, sizeof(gXcpDaqLogger));
+    gXcpDaqLogger.daq_config_file = XcpDaqLoggerStrDup(daq_config_file, strlen(daq_config_file));
+    gXcpDaqLogger.mdf_file_prefix = XcpDaqLoggerStrDup(mdf_file_prefix, strlen(mdf_file_prefix));
+    gXcpDaqLogger.buffer = (uint8_t *)malloc(XCP_DAQ_LOGGER_WRITE_BUFFER_SIZE);
+    if (gXcpDaqLogger.daq_config_file == NULL || gXcpDaqLogger.mdf_file_prefix == NULL || gXcpDaqLogger.buffer == NULL) {
+        XcpDaqLoggerFree();
+        return false;
+    }
+
+    // Create the transmit queue on heap
+    assert(queue_size > 0);
+    gXcpDaqLogger.queue = queueInit(queue_size);
+    if (gXcpDaqLogger.queue == NULL) {
+        XcpDaqLoggerFree();
+        return false;
+    }
+#ifdef OPTION_QUEUE_PRIORITY_HEADROOM
+    queueSetOverflowPolicy(gXcpDaqLogger.queue, OPTION_QUEUE_OVERFLOW_POLICY, OPTION_QUEUE_PRIORITY_HEADROOM);
+#endif
+
+    // The A2L file is needed for the channel names and is embedded into the MDF4 files
+    A2lFinalize();
+
+    // Create the logger thread, which starts the XCP protocol layer and the DAQ setup
+    DBG_PRINT3(ANSI_COLOR_GREEN "Start DAQ logger\n" ANSI_COLOR_RESET);
+    create_thread(&gXcpDaqLogger.thread_handle, NULL, XcpDaqLoggerThread, NULL);
+    while (!gXcpDaqLogger.thread_started) {
+        sleepUs(100);
+    }
+    if (!gXcpDaqLogger.thread_running) {
+        join_thread(gXcpDaqLogger.thread_handle);
+        queueDeinit(gXcpDaqLogger.queue);
+        XcpDaqLoggerFree();
+        return false;
+    }
+
+    gXcpDaqLogger.is_init = true;
+    return true;
+}
+
+bool XcpDaqLoggerShutdown(void) {
+
+    if (!XcpIsActivated()) {
+        DBG_PRINT5("XcpDaqLoggerShutdown: XCP is deactivated!\n");
+        return false;
+    }
+
+    // Check if already initialized and running
+    if (!gXcpDaqLogger.is_init) {
+        DBG_PRINT_WARNING("XcpDaqLoggerShutdown: DAQ logger not running!\n");
+        return false;
+    }
+
+    DBG_PRINT3("Shutdown DAQ logger\n");
+    gXcpDaqLogger.thread_running = false;
+    join_thread(gXcpDaqLogger.thread_handle);
+
+    // Reset the XCP protocol layer
+    XcpDeinit();
+
+    queueDeinit(gXcpDaqLogger.queue);
+    XcpDaqLoggerFree();
+    gXcpDaqLogger.is_init = false;
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------------
+// Logger thread
+
+#if defined(_WIN) // Windows
+DWORD WINAPI XcpDaqLoggerThread(LPVOID par)
+#else
+extern void *XcpDaqLoggerThread(void *par)
+#endif
+{
+    (void)par;
+    DBG_PRINT3("Start DAQ logger thread\n");
+
+    // Start the XCP protocol layer and event handling and start the DAQ setup
+    XcpStart(gXcpDaqLogger.queue, false);
+    if (!XcpDaqLoggerStart()) {
+        DBG_PRINT_ERROR("DAQ logger start failed!\n");
+        XcpFreeDaq();
+        gXcpDaqLogger.thread_started = true;
+        return 0;
+    }
+    gXcpDaqLogger.thread_running = true;
+    gXcpDaqLogger.thread_started = true;
+
+    uint64_t last_time = clockGetMonotonicNs();
+    while (gXcpDaqLogger.thread_running) {
+
+        // Process all committed data, wait for more data if the queue is empty
+        if (XcpDaqLoggerHandleQueue() == 0) {
+            queueWait(gXcpDaqLogger.queue, QUEUE_WAIT_TIME_US);
+        }
+
+        // Handle background tasks, e.g. pending calibration updates, and file rotation
+        uint64_t now = clockGetMonotonicNs();
+        if (now - last_time >= BACKGROUND_TASKS_CYCLE_MS * 1000000ULL) {
+            last_time = now;
+            XcpBackgroundTasks();
+            if (gXcpDaqLogger.file_pos + gXcpDaqLogger.buffer_level >= (uint64_t)XCP_DAQ_LOGGER_FILE_SIZE ||
+                now - gXcpDaqLogger.file_start_time >= XCP_DAQ_LOGGER_FILE_TIME_S * 1000000000ULL) {
+                XcpDaqLoggerCloseFile();
+                if (!XcpDaqLoggerOpenFile()) {
+                    break; // error -> terminate thread
+                }
+            }
+        }
+    }
+    gXcpDaqLogger.thread_running = false;
+
+    XcpDaqLoggerStop();
+
+    DBG_PRINT3("DAQ logger thread terminated!\n");
+    return 0;
+}
+
+#endif // XCP_ENABLE_DAQ_LOGGER
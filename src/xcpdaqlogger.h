@@ -0,0 +1,33 @@
+#pragma once
+#define __XCP_DAQ_LOGGER_H__
+
+/*----------------------------------------------------------------------------
+| File:
+|   xcpdaqlogger.h
+|
+| Description:
+|   XCPlite internal header file for xcpdaqlogger.c
+|
+| Copyright (c) Vector Informatik GmbH. All rights reserved.
+| See LICENSE file in the project root for details.
+|
+ ----------------------------------------------------------------------------*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/// Initialize the DAQ logger singleton.
+/// Starts a saved DAQ setup without XCP client and writes the DAQ data into MDF4 files.
+/// @pre User has called XcpInit, the XCP on Ethernet server is not running.
+/// @param daq_config_file DAQ setup file written by XcpSaveDaqConfig.
+/// @param mdf_file_prefix Path and name prefix of the MDF4 files, a file number and the extension .mf4 are appended.
+/// @param measurement_queue_size Measurement queue size in bytes. Includes the bytes occupied by the queue header and some space needed for alignment.
+/// @return true on success, otherwise false.
+bool XcpDaqLoggerInit(const char *daq_config_file, const char *mdf_file_prefix, uint32_t measurement_queue_size);
+
+/// Stop DAQ, finalize the current MDF4 file and shutdown the DAQ logger.
+bool XcpDaqLoggerShutdown(void);
+
+/// Get the DAQ logger status.
+/// @return true if the DAQ logger is running, otherwise false.
+bool XcpDaqLoggerStatus(void);
@@ -54,6 +54,10 @@ static DWORD WINAPI XcpServerTransmitThread(LPVOID lpParameter);
 static void *XcpServerTransmitThread(void *par);
 #endif
 
+#if defined(OPTION_QUEUE_PRIORITY_HEADROOM) && !defined(OPTION_QUEUE_OVERFLOW_POLICY)
+#define OPTION_QUEUE_OVERFLOW_POLICY QUEUE_OVERFLOW_DROP_NEWEST
+#endif
+
 #if !defined(OPTION_ENABLE_TCP) && !defined(OPTION_ENABLE_UDP)
 #error "Please define OPTION_ENABLE_TCP or OPTION_ENABLE_UDP"
 #endif
@@ -121,7 +125,7 @@ static struct {
 #ifdef OPTION_SHM_MODE // SHM server functions
 
 // Initialize shared memory queue and start the background thread for non-server processes in SHM mode
-static bool ShmServerInit_(uint32_t queue_size) {
+static bool ShmServerInit_(uint32_t queue_size, bool huge_pages) {
 
     gXcpServer.shm_thread_running = false;
     gXcpServer.shm_queue_ptr = NULL;
@@ -136,6 +140,10 @@ static bool ShmServerInit_(uint32_t queue_size) {
         DBG_PRINT_ERROR("XcpEthServerInit: failed to create '/xcpqueue'\n");
         return false;
     }
+    // Pre-fault and lock the mapping of this process, transparent huge pages if enabled for shared memory
+    if (huge_pages) {
+        platformMemLock(queue_ptr, queue_total_size);
+    }
     tShmQueueHeader *hdr = (tShmQueueHeader *)queue_ptr;
     if (queue_leader) {
         hdr->queue_size = queue_size;
@@ -151,17 +159,23 @@ static bool ShmServerInit_(uint32_t queue_size) {
     gXcpServer.shm_queue_ptr = queue_ptr;
     gXcpServer.shm_queue_total_size = queue_total_size;
     void *queue_mem = (uint8_t *)queue_ptr + sizeof(tShmQueueHeader);
-    gXcpServer.transmit_queue = queueInitFromMemory(queue_mem, queue_size, queue_leader /* clear*/, NULL);
+    gXcpServer.transmit_queue = queueInitFromMemoryEx(queue_mem, queue_size, queue_leader /* clear*/, NULL, false /* locked above */);
     if (gXcpServer.transmit_queue == NULL) {
         DBG_PRINT_ERROR("XcpEthServerInit: queueInitFromMemory failed\n");
         platformShmClose("/xcpqueue", queue_ptr, queue_total_size, queue_leader /* unlink */);
         return false;
     }
     if (queue_leader) {
+#ifdef OPTION_QUEUE_PRIORITY_HEADROOM
+        queueSetOverflowPolicy(gXcpServer.transmit_queue, OPTION_QUEUE_OVERFLOW_POLICY, OPTION_QUEUE_PRIORITY_HEADROOM);
+#endif
         atomic_store(&hdr->is_initialized, 1U);
     }
     DBG_PRINTF3(ANSI_COLOR_BLUE "Queue init from memory (clear=%u, queue_size=%u)\n" ANSI_COLOR_RESET, queue_leader, queue_size);
 
+    // Register as queue producer, the server reclaims the entries this process reserved and never committed, if it dies
+    XcpShmSetQueueProducerTag(queueRegisterProducer(gXcpServer.transmit_queue));
+
     // Start the background thread for non-server processes
     if (!XcpShmIsXcpServer()) {
         create_thread(&gXcpServer.shm_thread_handle, NULL, ShmThread_, NULL);
@@ -249,7 +263,7 @@ bool XcpShmServerInit(uint32_t queue_size) {
     gXcpServer.receive_thread_running = false;
     gXcpServer.transmit_queue = NULL;
 
-    if (!ShmServerInit_(queue_size)) {
+    if (!ShmServerInit_(queue_size, QUEUE_HUGE_PAGES_DEFAULT)) {
         return false;
     }
 
@@ -284,7 +298,9 @@ bool XcpEthServerStatus(void) {
 }
 
 // XCP on ethernet server init
-bool XcpEthServerInit(const uint8_t *addr, uint16_t port, bool useTCP, uint32_t queue_size) {
+bool XcpEthServerInit(const uint8_t *addr, uint16_t port, bool useTCP, uint32_t queue_size) { return XcpEthServerInitEx(addr, port, useTCP, queue_size, QUEUE_HUGE_PAGES_DEFAULT); }
+
+bool XcpEthServerInitEx(const uint8_t *addr, uint16_t port, bool useTCP, uint32_t queue_size, bool huge_pages) {
 
     // Check and ignore, if the XCP singleton has not been initialized and activated
     if (!XcpIsActivated()) {
@@ -304,15 +320,18 @@ bool XcpEthServerInit(const uint8_t *addr, uint16_t port, bool useTCP, uint32_t
 
 #ifdef OPTION_SHM_MODE // call SHM server init
     // Init SHM and create the transmit queue in shared memory
-    if (!ShmServerInit_(queue_size)) {
+    if (!ShmServerInit_(queue_size, huge_pages)) {
         return false;
     }
 #else
     // Create the transmit queue on heap
     assert(queue_size > 0);
-    gXcpServer.transmit_queue = queueInit(queue_size);
+    gXcpServer.transmit_queue = queueInitEx(queue_size, huge_pages);
     if (gXcpServer.transmit_queue == NULL)
         return false;
+#ifdef OPTION_QUEUE_PRIORITY_HEADROOM
+    queueSetOverflowPolicy(gXcpServer.transmit_queue, OPTION_QUEUE_OVERFLOW_POLICY, OPTION_QUEUE_PRIORITY_HEADROOM);
+#endif
 #endif
 
 #ifdef OPTION_SHM_MODE // XCP server initialisation
@@ -480,6 +499,15 @@ bool XcpEthServerShutdown(void) {
 //-------------------------------------------------------------------------------------------------------
 // Server threads
 
+// Close the io_uring of the receive thread, also when the thread is cancelled by a forcefull termination
+// Closing it from another thread would signal that thread with the completions of the cancelled receives
+#ifdef XCPTL_ENABLE_IO_URING
+static void XcpServerStopCommands(void *par) {
+    (void)par;
+    XcpEthTlStopCommands();
+}
+#endif
+
 // XCP server unicast command receive thread
 #if defined(_WIN) // Windows
 DWORD WINAPI XcpServerReceiveThread(LPVOID par)
@@ -490,10 +518,13 @@ extern void *XcpServerReceiveThread(void *par)
     (void)par;
     DBG_PRINT3("Start XCP receive thread\n");
 
-    // Start the XCP protocol layer and event handling
-    XcpStart(gXcpServer.transmit_queue, false);
+    // Start the XCP protocol layer and event handling, resume a DAQ setup stored by the client
+    XcpStart(gXcpServer.transmit_queue, true);
 
     // Receive XCP unicast commands loop
+#ifdef XCPTL_ENABLE_IO_URING
+    pthread_cleanup_push(XcpServerStopCommands, NULL);
+#endif
     gXcpServer.receive_thread_running = true;
     while (gXcpServer.receive_thread_running) {
 
@@ -533,7 +564,13 @@ extern void *XcpServerReceiveThread(void *par)
 
 #ifdef OPTION_SHM_MODE // check alive counters of all applications
             // In SHM mode, Server checks alive counters of all applications and prints debug info
-            XcpShmCheckAliveCounters();
+            // Queue entries left uncommitted by stale applications are reclaimed
+            uint32_t stale_apps = XcpShmCheckAliveCounters();
+            for (uint8_t i = 0; stale_apps != 0; i++, stale_apps >>= 1) {
+                if (stale_apps & 1) {
+                    queueReclaimProducer(gXcpServer.transmit_queue, XcpShmGetQueueProducerTag(i));
+                }
+            }
 #endif
 
 #ifdef TEST_ENABLE_DBG_CHECKS
@@ -553,6 +590,11 @@ extern void *XcpServerReceiveThread(void *par)
         }
     }
     gXcpServer.receive_thread_running = false;
+#ifdef XCPTL_ENABLE_IO_URING
+    pthread_cleanup_pop(1);
+#else
+    XcpEthTlStopCommands();
+#endif
 
     DBG_PRINT3("XCP receive thread terminated!\n");
     return 0;
@@ -25,6 +25,12 @@
 /// @return true on success, otherwise false.
 bool XcpEthServerInit(const uint8_t *address, uint16_t port, bool use_tcp, uint32_t measurement_queue_size);
 
+/// Initialize the server singleton, optionally with a transmit queue backed by huge pages.
+/// XcpEthServerInit uses huge pages, if OPTION_QUEUE_HUGE_PAGES is defined.
+/// @param huge_pages Allocate the measurement queue with 2 MiB huge pages, pre-faulted and locked in RAM, falls back to normal pages. In SHM mode, the shared queue is pre-faulted and locked.
+/// @return true on success, otherwise false.
+bool XcpEthServerInitEx(const uint8_t *address, uint16_t port, bool use_tcp, uint32_t measurement_queue_size, bool huge_pages);
+
 /// Shutdown the server.
 bool XcpEthServerShutdown(void);
 
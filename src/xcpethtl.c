@@ -26,6 +26,7 @@
 #include "xcp_cfg.h"    // for XCP_xxx
 #include "xcplib_cfg.h" // for OPTION_xxx
 #include "xcplite.h"    // for tXcpDaqLists, XcpXxx, ApplXcpXxx, ...
+#include "xcptl.h"      // for XcpTlXxx
 #include "xcptl_cfg.h"  // for XCPTL_xxx
 
 // Parameter checks
@@ -46,6 +47,11 @@
 #error "XCPTL_ENABLE_MULTICAST must be defined for GET_DAQ_CLOCK_MULTICAST"
 #endif
 #endif
+#ifdef XCPTL_ENABLE_COMPRESSION
+#if XCPTL_MAX_SEGMENT_SIZE >= TL_COMPRESSED_SEGMENT_FLAG
+#error "XCPTL_MAX_SEGMENT_SIZE is too large for XCPTL_ENABLE_COMPRESSION!"
+#endif
+#endif
 
 #pragma pack(push, 1)
 typedef struct {
@@ -59,8 +65,20 @@ static struct {
 
     tQueueHandle queue; // Transmit queue handle, used to transmit XCP DTO and EVENT messages
 
+#if defined(OPTION_QUEUE_64_FIX_SIZE) || defined(OPTION_QUEUE_64_VAR_SIZE)
+    uint16_t ctr; // Next message packet counter, used by the transmit thread only
+#ifdef XCPTL_EXCLUDE_CRM_FROM_CTR
+    atomic_uint_fast16_t crm_ctr; // Next CRM response message packet counter, independent from the DAQ message packet counter
+#endif
+#ifndef XCPTL_CRM_VIA_TRANSMIT_QUEUE
+    // Command response slot, filled by the command thread and sent by the transmit thread, to keep the consistency of the message counter
+    atomic_uint_least32_t crm_state; // CRM_SLOT_xxx
+    tXcpCtoMessage crm;              // Command response message
+#endif
+#else
     MUTEX ctr_mutex; // Transmit queue handler mutex, used to keep the consistency of the message counter
     uint16_t ctr;    // Next CRM response message packet counter
+#endif
 
 #if defined(_WIN) // Windows
     HANDLE queue_event;
@@ -84,12 +102,63 @@ static struct {
 #ifdef XCPTL_ENABLE_MULTICAST
     THREAD_HANDLE multicast_thread_handle;
     SOCKET_HANDLE multicast_sock;
+    bool multicast_thread; // Multicast thread started, otherwise multicast commands are received with rx_ring
+#endif
+
+    // io_uring, NULL if not available, created by the thread which uses it, see XcpEthTlInitUring
+#ifdef XCPTL_ENABLE_IO_URING
+    IO_URING_HANDLE tx_ring; // TCP transmit, used by the transmit thread only
+    IO_URING_HANDLE rx_ring; // UDP unicast and multicast command receive, used by the receive thread only, closed by XcpEthTlStopCommands
+    bool tx_ring_init;       // tx_ring has been created or is not available
+    bool rx_ring_init;       // rx_ring has been created or is not available
+    bool rx_pending[2];      // Receive pending for RX_SLOT_xxx
+    tXcpCtoMessage rx_msg;   // Unicast command receive buffer
+#ifdef XCPTL_ENABLE_MULTICAST
+    uint8_t rx_multicast_buffer[256]; // Multicast command receive buffer
+#endif
 #endif
 
 #if defined(OPTION_QUEUE_64_FIX_SIZE) || defined(OPTION_QUEUE_64_VAR_SIZE)
     uint64_t last_transmit_time; // Last transmit time in ns from clockGetMonotonicNs()
 #endif
 
+#ifdef XCP_ENABLE_DAQ_RESUME
+    atomic_uint_fast64_t resume_discarded; // Number of bytes discarded while DAQ is resumed without client, reported and cleared on CONNECT
+#endif
+
+#ifdef XCPTL_ENABLE_UDP_GSO
+    bool gso; // UDP generic segmentation offload enabled, cleared when rejected by the kernel or the network interface
+#endif
+
+    // TCP zero copy transmit, used by the transmit thread only, except zc_connection
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+    atomic_uint_fast32_t zc_connection;             // Incremented by the receive thread for each accepted TCP connection
+    uint32_t zc_connection_used;                    // Connection of the held queue buffers
+    bool zc_enabled;                                // Zero copy enabled for this connection, cleared when the kernel copies
+    uint32_t zc_next_id;                            // Completion id of the next zero copy send
+    uint32_t zc_completed;                          // All completion ids before this one are notified
+    uint32_t zc_count;                              // Number of queue buffers held until their zero copy sends are completed
+    tQueueBuffer zc_buffers[QUEUE_PEEK_MAX_COUNT];  // Held queue buffers in peek order
+    uint32_t zc_last_id[QUEUE_PEEK_MAX_COUNT];      // Completion id of the last send referencing the held queue buffer
+#endif
+
+    // Transmit segment compression, used by the transmit thread only, except compression_request
+#ifdef XCPTL_ENABLE_COMPRESSION
+    atomic_uint_fast8_t compression_request;         // Compression mode TL_COMPRESSION_xxx requested by the client
+    uint8_t compression;                             // Compression mode TL_COMPRESSION_xxx
+    uint64_t compression_in;                         // Number of segment bytes before compression
+    uint64_t compression_out;                        // Number of segment bytes sent
+    uint8_t compression_src[XCPTL_MAX_SEGMENT_SIZE]; // Gathered segment
+    uint8_t compression_dst[XCPTL_MAX_SEGMENT_SIZE]; // Compressed segment message, always smaller than the segment
+#endif
+
+    // Transmit queue statistics
+#if defined(OPTION_QUEUE_STATISTICS_EVENT) && defined(XCP_ENABLE_DAQ_EVENT_LIST)
+    tQueueStatistics queue_statistics;  // Measurement object of the queue statistics event
+    tXcpEventId queue_statistics_event; // Queue statistics event
+    uint64_t queue_statistics_time;     // Last update time in ns from clockGetMonotonicNs()
+#endif
+
 } gXcpTl;
 
 #if defined(XCPTL_ENABLE_TCP) && defined(XCPTL_ENABLE_UDP)
@@ -103,12 +172,58 @@ static struct {
 #endif
 
 #ifdef XCPTL_ENABLE_MULTICAST
-static int handleXcpMulticastCommand(int n, tXcpCtoMessage *p, uint8_t *dstAddr, uint16_t dstPort);
+static int handleXcpMulticastCommand(int n, tXcpCtoMessage *p, uint8_t *srcAddr, uint16_t srcPort);
+#ifdef XCPTL_ENABLE_IO_URING
+extern void *XcpTlMulticastThread(void *par);
+#endif
+#endif
+
+#ifdef XCPTL_ENABLE_IO_URING
+#define RX_SLOT_UNICAST 0
+#define RX_SLOT_MULTICAST 1
 #endif
 
 //-------------------------------------------------------------------------------------------------------
 // Ethernet transport layer socket functions
 
+// DAQ resumed by XcpStart without client, DAQ data is discarded and counted until a client connects
+#ifdef XCP_ENABLE_DAQ_RESUME
+#define isResumedWithoutClient() ((XcpGetSessionStatus() & (SS_RESUME | SS_CONNECTED)) == SS_RESUME)
+#define XcpEthTlDiscard(size) atomic_fetch_add_explicit(&gXcpTl.resume_discarded, (uint64_t)(size), memory_order_relaxed)
+#else
+#define isResumedWithoutClient() false
+#define XcpEthTlDiscard(size)
+#endif
+
+// Create the io_uring of the calling thread on its first use
+// The threads, which created or submitted to an io_uring, are notified with a signal when it is closed, their blocking socket calls with timeout fail with EINTR then
+// So an io_uring is created by the thread which uses it, not by XcpEthTlInit on the application thread
+#ifdef XCPTL_ENABLE_IO_URING
+static IO_URING_HANDLE XcpEthTlInitUring(IO_URING_HANDLE *ring, bool *init, const char *name) {
+    if (!*init) {
+        *init = true;
+        *ring = ioUringInit(XCPTL_IO_URING_ENTRIES);
+        if (*ring != NULL) {
+            DBG_PRINTF3("Using io_uring for %s\n", name);
+        } else {
+            DBG_PRINTF_WARNING("io_uring not available for %s, using blocking socket calls\n", name);
+        }
+    }
+    return *ring;
+}
+#endif
+
+// Get the number of bytes in a list of queue buffers
+#if defined(XCP_ENABLE_DAQ_RESUME) && (defined(OPTION_QUEUE_64_FIX_SIZE) || defined(OPTION_QUEUE_64_VAR_SIZE))
+static uint32_t XcpEthTlGetBufferSize(const tQueueBuffer buffers[], uint16_t count) {
+    uint32_t size = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        size += buffers[i].size;
+    }
+    return size;
+}
+#endif
+
 // Transmit a UDP datagramm or TCP segment (contains multiple XCP DTO messages or a single CRM message (len+ctr+packet+fill))
 // Must be thread safe, because it is called from CMD and from DAQ thread
 // Returns false on error
@@ -121,6 +236,11 @@ static bool XcpEthTlSend(const uint8_t *data, uint16_t size, const uint8_t *addr
     assert(data != NULL);
     DBG_PRINTF6("XcpEthTlSend: msg_len = %u\n", size);
 
+    if (addr == NULL && isResumedWithoutClient()) {
+        XcpEthTlDiscard(size);
+        return true;
+    }
+
 #ifdef TEST_ENABLE_DBG_METRICS
     gXcpTxPacketCount++;
 #endif
@@ -169,6 +289,11 @@ static bool XcpEthTlSendV(tQueueBuffer buffers[], uint16_t count) {
 
     DBG_PRINTF6("XcpEthTlSendV: buffers count = %u\n", count);
 
+    if (isResumedWithoutClient()) {
+        XcpEthTlDiscard(XcpEthTlGetBufferSize(buffers, count));
+        return true;
+    }
+
 #ifdef TEST_ENABLE_BUFFERCOUNT_HISTOGRAM
     assert(count <= 256);
     if (gBufferCountHistogram[0] == 0xFFFFFFFF) {
@@ -205,10 +330,226 @@ static bool XcpEthTlSendV(tQueueBuffer buffers[], uint16_t count) {
     }
     return true;
 }
+
+// Transmit multiple XCP segments (UDP or TCP) with a single system call
+// segment_end is the buffer index after the last buffer of each segment
+// Returns false on error
+#ifdef XCPTL_ENABLE_MULTI_SEGMENT_SEND
+static bool XcpEthTlSendMV(tQueueBuffer buffers[], uint16_t count, const uint16_t segment_end[], uint16_t segments) {
+
+    assert(buffers != NULL);
+    assert(count > 0 && segments > 0);
+
+    int32_t r;
+
+    DBG_PRINTF6("XcpEthTlSendMV: buffers count = %u, segments = %u\n", count, segments);
+
+    if (isResumedWithoutClient()) {
+        XcpEthTlDiscard(XcpEthTlGetBufferSize(buffers, count));
+        return true;
+    }
+
+#ifdef TEST_ENABLE_DBG_METRICS
+    gXcpTxMessageCount += segments;
+    gXcpTxIoVectorCount += count;
+#endif
+
+#ifdef XCPTL_ENABLE_TCP
+    if (isTCP()) {
+#ifdef XCPTL_ENABLE_IO_URING
+        if (XcpEthTlInitUring(&gXcpTl.tx_ring, &gXcpTl.tx_ring_init, "TCP transmit") != NULL) {
+            r = ioUringSendMV(gXcpTl.tx_ring, gXcpTl.socket, buffers, count, segment_end, segments, NULL, 0); // Linked sends with a single system call
+        } else
+#endif
+        {
+            r = 0;
+            for (uint16_t s = 0, i = 0; s < segments; i = segment_end[s++]) {
+                r = socketSendV(gXcpTl.socket, &buffers[i], (uint16_t)(segment_end[s] - i)); // One segment per send, the byte count is 16 bit
+                if (r <= 0)
+                    break;
+            }
+        }
+    } else
+#endif
+#ifdef XCPTL_ENABLE_UDP
+    {
+        // Respond to active master
+        if (!gXcpTl.master_addr_valid) {
+            DBG_PRINT_ERROR("XcpEthTlSendMV: invalid master address!\n");
+            return false;
+        }
+        r = -2;
+#ifdef XCPTL_ENABLE_UDP_GSO
+        // Segments of equal size, except the last one, are sent as one UDP GSO datagram
+        // UDP payload size is limited to 64K
+        if (gXcpTl.gso && segments > 1) {
+            uint32_t segment_size = 0;
+            uint32_t total = 0;
+            bool equal = true;
+            for (uint16_t s = 0, i = 0; s < segments; i = segment_end[s++]) {
+                uint32_t l = 0;
+                for (uint16_t j = i; j < segment_end[s]; j++) {
+                    l += buffers[j].size;
+                }
+                if (s == 0) {
+                    segment_size = l;
+                } else if (l > segment_size || (l < segment_size && s + 1 < segments)) {
+                    equal = false;
+                    break;
+                }
+                total += l;
+            }
+            if (equal && total <= XCPTL_MAX_GSO_SIZE) {
+                r = socketSendToGso(gXcpTl.socket, buffers, count, (uint16_t)segment_size, gXcpTl.master_addr, gXcpTl.master_port);
+                if (r == -2) {
+                    DBG_PRINT_WARNING("UDP GSO rejected, using sendmmsg\n");
+                    gXcpTl.gso = false;
+                }
+            }
+        }
+#endif
+        if (r == -2) {
+            r = socketSendToMV(gXcpTl.socket, buffers, count, segment_end, segments, gXcpTl.master_addr, gXcpTl.master_port);
+        }
+    }
+#endif // UDP
+
+    if (r <= 0) {
+        DBG_PRINTF_ERROR("XcpEthTlSendMV: vectored send failed (result=%d)!\n", r);
+        return false;
+    }
+    return true;
+}
+#endif // XCPTL_ENABLE_MULTI_SEGMENT_SEND
+
+// Transmit multiple XCP segments on TCP with MSG_ZEROCOPY
+// The buffers must not be released before the kernel completed all sends, calls is set to the number of completion ids consumed
+// Returns false on error
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+static bool XcpEthTlSendZeroCopy(tQueueBuffer buffers[], uint16_t count, uint16_t segments, uint32_t *calls) {
+
+    assert(buffers != NULL);
+    assert(count > 0 && segments > 0);
+    assert(calls != NULL);
+
+    *calls = 0;
+
+    DBG_PRINTF6("XcpEthTlSendZeroCopy: buffers count = %u, segments = %u\n", count, segments);
+
+    if (isResumedWithoutClient()) {
+        XcpEthTlDiscard(XcpEthTlGetBufferSize(buffers, count));
+        return true;
+    }
+
+#ifdef TEST_ENABLE_DBG_METRICS
+    gXcpTxMessageCount += segments;
+    gXcpTxIoVectorCount += count;
+#else
+    (void)segments;
+#endif
+
+    int32_t r = socketSendZeroCopyV(gXcpTl.socket, buffers, count, calls); // All segments with a single system call
+    if (r <= 0) {
+        DBG_PRINTF_ERROR("XcpEthTlSendZeroCopy: zero copy send failed (result=%d)!\n", r);
+        return false;
+    }
+    return true;
+}
+#endif // XCPTL_ENABLE_TCP_ZEROCOPY
+
 #endif // OPTION_QUEUE_64_FIX_SIZE
 
 //-------------------------------------------------------------------------------------------------------
 
+#if defined(OPTION_QUEUE_64_FIX_SIZE) || defined(OPTION_QUEUE_64_VAR_SIZE)
+
+// Get the packet counter for the next command response message
+// Transmit thread only, except for XCPTL_EXCLUDE_CRM_FROM_CTR
+static inline uint16_t XcpTlNextCrmCtr(void) {
+#ifdef XCPTL_EXCLUDE_CRM_FROM_CTR
+    return (uint16_t)atomic_fetch_add_explicit(&gXcpTl.crm_ctr, 1, memory_order_relaxed);
+#else
+    return gXcpTl.ctr++;
+#endif
+}
+
+#ifndef XCPTL_CRM_VIA_TRANSMIT_QUEUE
+
+// Command response slot states
+#define CRM_SLOT_FREE 0
+#define CRM_SLOT_BUSY 1             // Filled by the command thread
+#define CRM_SLOT_PENDING 2          // Filled, waiting for the transmit thread
+#define CRM_SLOT_SLEEP_US 20        // Poll interval, when the previous command response is not sent yet
+#define CRM_SLOT_TIMEOUT_US 1000000 // Drop the command response, when the transmit thread does not send the previous one within this time
+
+// Send a pending command response with the next packet counter and free the slot
+// Transmit thread only, the transmit thread is the only one writing to the socket, so the packet counters are in wire order
+// Returns false, if there is none
+static bool XcpTlSendCrmSlot(void) {
+    if (atomic_load_explicit(&gXcpTl.crm_state, memory_order_acquire) != CRM_SLOT_PENDING)
+        return false;
+
+    // Send the packet using the same sendmsg path as DAQ to avoid UDP datagram reordering
+    // At the NIC/kernel sendto vs sendmsg can be treated differently
+    // No error handling, loosing a CRM message will lead to a timeout in the XCP client
+    gXcpTl.crm.ctr = XcpTlNextCrmCtr();
+    tQueueBuffer buf = {.buffer = (uint8_t *)&gXcpTl.crm, .size = (uint16_t)(gXcpTl.crm.dlc + XCPTL_TRANSPORT_LAYER_HEADER_SIZE)};
+    XcpEthTlSendV(&buf, 1);
+    atomic_store_explicit(&gXcpTl.crm_state, CRM_SLOT_FREE, memory_order_release);
+    return true;
+}
+
+// Transmit a packet (the packet contains a single XCP CRM command response message)
+// The command response is handed over to the transmit thread, which sends it before any DAQ message with a later packet counter
+// Does not block on the socket, only when the previous command response is not sent yet
+// A command response handed over before the transmit thread runs, is sent when it starts
+void XcpTlSendCrm(const uint8_t *data, uint8_t size) {
+    assert(size <= XCPTL_MAX_CTO_SIZE); // Check for buffer overflow
+
+    DBG_PRINTF6("XcpEthTlSendCrm: msg_len = %u\n", size);
+
+#ifdef XCPTL_EXCLUDE_CRM_FROM_CTR
+    // UDP with independent packet counters, the order to DAQ messages does not matter, send the datagram directly
+    if (!isTCP()) {
+        tXcpCtoMessage p;
+        p.dlc = size;
+        p.ctr = XcpTlNextCrmCtr();
+        memcpy(p.packet, data, size);
+        tQueueBuffer buf = {.buffer = (uint8_t *)&p, .size = (uint16_t)(size + XCPTL_TRANSPORT_LAYER_HEADER_SIZE)};
+        XcpEthTlSendV(&buf, 1);
+        return;
+    }
+#endif
+
+    // Take the slot, wait until the previous command response is sent
+    for (uint32_t t = 0;; t += CRM_SLOT_SLEEP_US) {
+        uint_least32_t expected = CRM_SLOT_FREE;
+        if (atomic_compare_exchange_weak_explicit(&gXcpTl.crm_state, &expected, CRM_SLOT_BUSY, memory_order_acquire, memory_order_relaxed))
+            break;
+        if (t >= CRM_SLOT_TIMEOUT_US) {
+            DBG_PRINT_ERROR("XcpTlSendCrm: Transmit thread does not send command responses, response dropped!\n");
+            return;
+        }
+        sleepUs(CRM_SLOT_SLEEP_US);
+    }
+
+    // Build XCP CTO message (ctr+dlc+packet), the packet counter is set when it is sent
+    gXcpTl.crm.dlc = size;
+    memcpy(gXcpTl.crm.packet, data, size);
+
+    // Hand over to the transmit thread and wake it up
+    atomic_store_explicit(&gXcpTl.crm_state, CRM_SLOT_PENDING, memory_order_release);
+    queueNotify(gXcpTl.queue);
+}
+
+#else
+
+static inline bool XcpTlSendCrmSlot(void) { return false; }
+
+#endif // XCPTL_CRM_VIA_TRANSMIT_QUEUE
+
+#else
+
 // Transmit a packet (the packet contains a single XCP CRM command response message)
 #ifndef XCPTL_CRM_VIA_TRANSMIT_QUEUE
 void XcpTlSendCrm(const uint8_t *data, uint8_t size) {
@@ -224,20 +565,15 @@ void XcpTlSendCrm(const uint8_t *data, uint8_t size) {
     p.ctr = gXcpTl.ctr++; // Get next response packet counter
     memcpy(p.packet, data, size);
 
-    // Send the packet using the same sendmsg path as DAQ to avoid UDP datagram reordering
-    // At the NIC/kernel sendto vs sendmsg can be treated differently
     // No error handling, loosing a CRM message will lead to a timeout in the XCP client
-#if defined(OPTION_QUEUE_64_FIX_SIZE) || defined(OPTION_QUEUE_64_VAR_SIZE)
-    tQueueBuffer buf = {.buffer = (uint8_t *)&p, .size = (uint16_t)(size + XCPTL_TRANSPORT_LAYER_HEADER_SIZE)};
-    XcpEthTlSendV(&buf, 1);
-#else
     XcpEthTlSend((const uint8_t *)&p, (uint16_t)(size + XCPTL_TRANSPORT_LAYER_HEADER_SIZE), NULL, 0);
-#endif
 
     mutexUnlock(&gXcpTl.ctr_mutex);
 }
 #endif
 
+#endif // OPTION_QUEUE_64_FIX_SIZE
+
 // Transmit XCP multicast response
 #ifdef XCPTL_ENABLE_MULTICAST
 void XcpEthTlSendMulticastCrm(const uint8_t *packet, uint16_t packet_size, const uint8_t *addr, uint16_t port) {
@@ -322,7 +658,17 @@ static bool handleXcpCommand(tXcpCtoMessage *p, uint8_t *srcAddr, uint16_t srcPo
             }
 #endif // UDP
 
-            queueClear(gXcpTl.queue);                                     // Clear the transmit queue, just to be sure, should be already empty
+            if (!isResumedWithoutClient()) {
+                queueClear(gXcpTl.queue); // Clear the transmit queue, just to be sure, should be already empty, in resume mode DAQ is running
+            }
+#ifdef XCP_ENABLE_DAQ_RESUME
+            else {
+                uint64_t discarded = atomic_exchange_explicit(&gXcpTl.resume_discarded, 0, memory_order_relaxed);
+                if (discarded > 0) {
+                    DBG_PRINTF_WARNING("Resume mode: %" PRIu64 " bytes of DAQ data discarded without client\n", discarded);
+                }
+            }
+#endif
             XcpCommand((const uint32_t *)&p->packet[0], (uint8_t)p->dlc); // Handle CONNECT command
         } else {
             DBG_PRINT_WARNING("handleXcpCommand: no valid CONNECT command\n");
@@ -343,6 +689,68 @@ static bool handleXcpCommand(tXcpCtoMessage *p, uint8_t *srcAddr, uint16_t srcPo
     return true;
 }
 
+// Receive UDP unicast and multicast commands with io_uring, blocking with timeout XCPTL_RECV_TIMEOUT_MS
+// Returns false on error
+#ifdef XCPTL_ENABLE_IO_URING
+static bool XcpEthTlHandleCommandsUring(void) {
+
+    // Prepare the receives which are not pending
+    if (!gXcpTl.rx_pending[RX_SLOT_UNICAST]) {
+        if (!ioUringRecvFrom(gXcpTl.rx_ring, RX_SLOT_UNICAST, gXcpTl.socket, (uint8_t *)&gXcpTl.rx_msg, (uint16_t)sizeof(gXcpTl.rx_msg)))
+            return false;
+        gXcpTl.rx_pending[RX_SLOT_UNICAST] = true;
+    }
+#ifdef XCPTL_ENABLE_MULTICAST
+    if (!gXcpTl.rx_pending[RX_SLOT_MULTICAST]) {
+        if (!ioUringRecvFrom(gXcpTl.rx_ring, RX_SLOT_MULTICAST, gXcpTl.multicast_sock, gXcpTl.rx_multicast_buffer, (uint16_t)sizeof(gXcpTl.rx_multicast_buffer)))
+            return false;
+        gXcpTl.rx_pending[RX_SLOT_MULTICAST] = true;
+    }
+#endif
+
+    // Wait for the next received command
+    uint8_t slot;
+    uint16_t srcPort;
+    uint8_t srcAddr[4];
+    int16_t n = ioUringWaitRecv(gXcpTl.rx_ring, XCPTL_RECV_TIMEOUT_MS, &slot, srcAddr, &srcPort);
+    if (slot <= RX_SLOT_MULTICAST) {
+        gXcpTl.rx_pending[slot] = false;
+    }
+    if (n < 0) {
+        DBG_PRINTF_ERROR("XcpEthTlHandleCommands: ioUringWaitRecv failed n=%d (errno=%d, %s)!\n", n, socketGetLastError(), socketGetErrorString(socketGetLastError()));
+        return false; // Socket error
+    }
+    if (n == 0) {
+        return true; // Timeout — no data pending
+    }
+
+#ifdef XCPTL_ENABLE_MULTICAST
+    if (slot == RX_SLOT_MULTICAST) {
+        handleXcpMulticastCommand(n, (tXcpCtoMessage *)gXcpTl.rx_multicast_buffer, srcAddr, srcPort);
+        return true;
+    }
+#endif
+
+#ifdef TEST_ENABLE_DBG_METRICS
+    gXcpRxPacketCount++;
+#endif
+    if (gXcpTl.rx_msg.dlc != n - XCPTL_TRANSPORT_LAYER_HEADER_SIZE) {
+        DBG_PRINT_ERROR("XcpEthTlHandleCommands: Corrupt message received!\n");
+        return false; // Error
+    }
+    return handleXcpCommand(&gXcpTl.rx_msg, srcAddr, srcPort);
+}
+#endif
+
+// Stop receiving XCP commands
+// The io_uring receives are cancelled by the thread which submitted them
+// Cancelling them from another thread on shutdown makes this thread an io_uring task, its blocking socket calls with timeout then fail with EINTR
+void XcpEthTlStopCommands(void) {
+#ifdef XCPTL_ENABLE_IO_URING
+    ioUringClose(&gXcpTl.rx_ring);
+#endif
+}
+
 // Handle incoming XCP commands
 // Returns false on error
 // @@@@ TODO: Check error handling
@@ -370,6 +778,9 @@ bool XcpEthTlHandleCommands(void) {
             } else {
                 // Set receive timeout to allow periodic checks for shutdown and background tasks
                 socketSetTimeout(gXcpTl.socket, XCPTL_RECV_TIMEOUT_MS);
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+                atomic_fetch_add_explicit(&gXcpTl.zc_connection, 1, memory_order_release); // Notify the transmit thread
+#endif
                 DBG_PRINTF3("XCP master %u.%u.%u.%u accepted!\n", gXcpTl.master_addr[0], gXcpTl.master_addr[1], gXcpTl.master_addr[2], gXcpTl.master_addr[3]);
                 DBG_PRINT3("Listening for XCP commands on TCP socket\n");
             }
@@ -454,6 +865,17 @@ bool XcpEthTlHandleCommands(void) {
 
 #ifdef XCPTL_ENABLE_UDP
     if (!isTCP()) {
+#ifdef XCPTL_ENABLE_IO_URING
+        if (XcpEthTlInitUring(&gXcpTl.rx_ring, &gXcpTl.rx_ring_init, "UDP receive") != NULL) {
+            return XcpEthTlHandleCommandsUring();
+        }
+#ifdef XCPTL_ENABLE_MULTICAST
+        if (!gXcpTl.multicast_thread) { // Multicast commands are not received with rx_ring
+            gXcpTl.multicast_thread = true;
+            create_thread(&gXcpTl.multicast_thread_handle, NULL, XcpTlMulticastThread, NULL);
+        }
+#endif
+#endif
         uint16_t srcPort;
         uint8_t srcAddr[4];
         n = socketRecvFrom(gXcpTl.socket, (uint8_t *)&msgBuf, (uint16_t)sizeof(msgBuf), srcAddr, &srcPort, NULL);
@@ -493,13 +915,21 @@ bool XcpEthTlHandleCommands(void) {
 
 #ifdef XCPTL_ENABLE_MULTICAST
 
-static int handleXcpMulticastCommand(int n, tXcpCtoMessage *p, uint8_t *dstAddr, uint16_t dstPort) {
+static int handleXcpMulticastCommand(int n, tXcpCtoMessage *p, uint8_t *srcAddr, uint16_t srcPort) {
 
-    (void)dstAddr;
-    (void)dstPort;
+    (void)srcAddr;
+    (void)srcPort;
 
     // @@@@ TODO: Check multicast addr and cluster id and port
-    // printf("MULTICAST: %u.%u.%u.%u:%u len=%u\n", dstAddr[0], dstAddr[1], dstAddr[2], dstAddr[3], dstPort, n);
+    // printf("MULTICAST: %u.%u.%u.%u:%u len=%u\n", srcAddr[0], srcAddr[1], srcAddr[2], srcAddr[3], srcPort, n);
+
+#ifdef XCLTL_RESTRICT_MULTICAST
+    // Accept multicast from active master only
+    if (!gXcpTl.master_addr_valid || memcmp(gXcpTl.master_addr, srcAddr, 4) != 0) {
+        DBG_PRINTF_WARNING("Ignored Multicast from %u.%u.%u.%u:%u\n", srcAddr[0], srcAddr[1], srcAddr[2], srcAddr[3], srcPort);
+        return 1;
+    }
+#endif
 
     // Valid socket data received, at least transport layer header and 1 byte
     if (n >= XCPTL_TRANSPORT_LAYER_HEADER_SIZE + 1 && p->dlc <= n - XCPTL_TRANSPORT_LAYER_HEADER_SIZE) {
@@ -538,16 +968,7 @@ extern void *XcpTlMulticastThread(void *par)
         n = socketRecvFrom(gXcpTl.multicast_sock, buffer, (uint16_t)sizeof(buffer), srcAddr, &srcPort, NULL);
         if (n <= 0)
             break; // Terminate on error or socket close
-#ifdef XCLTL_RESTRICT_MULTICAST
-        // Accept multicast from active master only
-        if (gXcpTl.master_addr_valid && memcmp(gXcpTl.master_addr, srcAddr, 4) == 0) {
-            handleXcpMulticastCommand(n, (tXcpCtoMessage *)buffer, srcAddr, srcPort);
-        } else {
-            DBG_PRINTF_WARNING("Ignored Multicast from %u.%u.%u.%u:%u\n", srcAddr[0], srcAddr[1], srcAddr[2], srcAddr[3], srcPort);
-        }
-#else
         handleXcpMulticastCommand(n, (tXcpCtoMessage *)buffer, srcAddr, srcPort);
-#endif
     }
     DBG_PRINT3("XCP multicast thread terminated\n");
     socketClose(&gXcpTl.multicast_sock);
@@ -570,11 +991,44 @@ bool XcpEthTlInit(const uint8_t *addr, uint16_t port, bool useTCP, tQueueHandle
 
     assert(Queue != NULL);
     gXcpTl.queue = Queue;
-    mutexInit(&gXcpTl.ctr_mutex, false, 0);
     gXcpTl.ctr = 0; // Reset packet counter
+#if defined(OPTION_QUEUE_64_FIX_SIZE) || defined(OPTION_QUEUE_64_VAR_SIZE)
+#ifdef XCPTL_EXCLUDE_CRM_FROM_CTR
+    atomic_store_explicit(&gXcpTl.crm_ctr, 0, memory_order_relaxed);
+#endif
+#ifndef XCPTL_CRM_VIA_TRANSMIT_QUEUE
+    atomic_store_explicit(&gXcpTl.crm_state, CRM_SLOT_FREE, memory_order_relaxed);
+#endif
+#else
+    mutexInit(&gXcpTl.ctr_mutex, false, 0);
+#endif
 #if defined(OPTION_QUEUE_64_FIX_SIZE) || defined(OPTION_QUEUE_64_VAR_SIZE)
     gXcpTl.last_transmit_time = 0; // Reset last transmit time
 #endif
+#ifdef XCP_ENABLE_DAQ_RESUME
+    atomic_store_explicit(&gXcpTl.resume_discarded, 0, memory_order_relaxed);
+#endif
+#ifdef XCPTL_ENABLE_COMPRESSION
+    atomic_store_explicit(&gXcpTl.compression_request, TL_COMPRESSION_NONE, memory_order_relaxed);
+    gXcpTl.compression = TL_COMPRESSION_NONE;
+    gXcpTl.compression_in = gXcpTl.compression_out = 0;
+#endif
+#ifdef XCPTL_ENABLE_UDP_GSO
+    gXcpTl.gso = true;
+#endif
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+    atomic_store_explicit(&gXcpTl.zc_connection, 0, memory_order_relaxed);
+    gXcpTl.zc_connection_used = 0;
+    gXcpTl.zc_enabled = false;
+    gXcpTl.zc_count = 0;
+#endif
+
+    // Create the queue statistics event
+#if defined(OPTION_QUEUE_STATISTICS_EVENT) && defined(XCP_ENABLE_DAQ_EVENT_LIST)
+    memset(&gXcpTl.queue_statistics, 0, sizeof(gXcpTl.queue_statistics));
+    gXcpTl.queue_statistics_time = 0;
+    gXcpTl.queue_statistics_event = XcpCreateEvent(XCPTL_QUEUE_STATISTICS_EVENT_NAME, XCPTL_QUEUE_STATISTICS_CYCLE_TIME_MS * 1000000, 0);
+#endif
 
     // Initialize transport layer event
 #if defined(_WIN) // Windows
@@ -623,6 +1077,14 @@ bool XcpEthTlInit(const uint8_t *addr, uint16_t port, bool useTCP, tQueueHandle
         DBG_PRINTF3("  Listening for XCP commands on UDP %u.%u.%u.%u port %u\n", bind_addr[0], bind_addr[1], bind_addr[2], bind_addr[3], port);
     }
 
+    // io_uring for TCP transmit or UDP receive, if available, created by the transmit or receive thread
+#ifdef XCPTL_ENABLE_IO_URING
+    gXcpTl.tx_ring = gXcpTl.rx_ring = NULL;
+    gXcpTl.tx_ring_init = !useTCP;
+    gXcpTl.rx_ring_init = useTCP;
+    gXcpTl.rx_pending[RX_SLOT_UNICAST] = gXcpTl.rx_pending[RX_SLOT_MULTICAST] = false;
+#endif
+
 #ifdef OPTION_ENABLE_GET_LOCAL_ADDR
     {
         uint8_t addr1[4] = {0, 0, 0, 0};
@@ -655,8 +1117,16 @@ bool XcpEthTlInit(const uint8_t *addr, uint16_t port, bool useTCP, tQueueHandle
         return false;
     DBG_PRINTF3("  Listening for XCP GET_DAQ_CLOCK multicast on %u.%u.%u.%u\n", maddr[0], maddr[1], maddr[2], maddr[3]);
 
-    DBG_PRINT3("  Start XCP multicast thread\n");
-    create_thread(&gXcpTl.multicast_thread_handle, NULL, XcpTlMulticastThread, NULL);
+    // With io_uring for UDP receive, multicast commands are received by the io_uring receive loop, the receive thread starts the multicast thread, if io_uring is not available
+    gXcpTl.multicast_thread = false;
+#ifdef XCPTL_ENABLE_IO_URING
+    if (useTCP)
+#endif
+    {
+        DBG_PRINT3("  Start XCP multicast thread\n");
+        gXcpTl.multicast_thread = true;
+        create_thread(&gXcpTl.multicast_thread_handle, NULL, XcpTlMulticastThread, NULL);
+    }
 
 #endif
 
@@ -665,12 +1135,15 @@ bool XcpEthTlInit(const uint8_t *addr, uint16_t port, bool useTCP, tQueueHandle
 
 void XcpEthTlShutdown(void) {
 
+#if !defined(OPTION_QUEUE_64_FIX_SIZE) && !defined(OPTION_QUEUE_64_VAR_SIZE)
     mutexDestroy(&gXcpTl.ctr_mutex);
+#endif
 
     // Close all sockets to enable all threads to terminate
 #ifdef XCPTL_ENABLE_MULTICAST
     socketClose(&gXcpTl.multicast_sock);
-    join_thread(gXcpTl.multicast_thread_handle);
+    if (gXcpTl.multicast_thread)
+        join_thread(gXcpTl.multicast_thread_handle);
 #endif
 #ifdef XCPTL_ENABLE_TCP
     if (isTCP())
@@ -678,6 +1151,12 @@ void XcpEthTlShutdown(void) {
 #endif
     socketClose(&gXcpTl.socket);
 
+    // Cancel pending io_uring receives, if the receive thread was terminated without XcpEthTlStopCommands
+#ifdef XCPTL_ENABLE_IO_URING
+    ioUringClose(&gXcpTl.tx_ring);
+    ioUringClose(&gXcpTl.rx_ring);
+#endif
+
 #if defined(_WIN) // Windows
     CloseHandle(gXcpTl.queue_event);
 #endif
@@ -718,6 +1197,188 @@ void XcpEthTlGetInfo(bool *isTcp, uint8_t *mac, uint8_t *addr, uint16_t *port) {
 //-------------------------------------------------------------------------------------------------------
 // Generic transport layer functions
 
+// Transmit queue statistics
+// Update the statistics measurement object and trigger the statistics event every XCPTL_QUEUE_STATISTICS_CYCLE_TIME_MS
+// Called by the transmit thread
+#if defined(OPTION_QUEUE_STATISTICS_EVENT) && defined(XCP_ENABLE_DAQ_EVENT_LIST)
+
+static void XcpTlUpdateQueueStatistics(void) {
+    uint64_t t = clockGetMonotonicNs();
+    if (gXcpTl.queue_statistics_event == XCP_UNDEFINED_EVENT_ID || t - gXcpTl.queue_statistics_time < XCPTL_QUEUE_STATISTICS_CYCLE_TIME_MS * 1000000ULL) {
+        return;
+    }
+    gXcpTl.queue_statistics_time = t;
+    queueGetStatistics(gXcpTl.queue, QUEUE_STATISTICS_ALL_PRODUCERS, &gXcpTl.queue_statistics);
+    XcpEvent(gXcpTl.queue_statistics_event);
+}
+
+// Get the queue statistics measurement object and its event for the A2L file
+const tQueueStatistics *XcpTlGetQueueStatistics(uint16_t *event_id) {
+    if (gXcpTl.queue == NULL || gXcpTl.queue_statistics_event == XCP_UNDEFINED_EVENT_ID) {
+        return NULL;
+    }
+    if (event_id != NULL) {
+        *event_id = gXcpTl.queue_statistics_event;
+    }
+    return &gXcpTl.queue_statistics;
+}
+
+#endif
+
+//-------------------------------------------------------------------------------------------------------
+// Transmit segment compression
+
+#ifdef XCPTL_ENABLE_COMPRESSION
+
+#define LZ4_HASH_BITS 10    // Hash table size, segments are small
+#define LZ4_MIN_MATCH 4     // Minimum match length
+#define LZ4_MF_LIMIT 12     // The last match must start at least 12 bytes before the end of the block
+#define LZ4_LAST_LITERALS 5 // The last 5 bytes of the block are always literals
+#define LZ4_RUN_MASK 0x0F   // Length field mask in the sequence token
+
+// Append a LZ4 length extension
+static inline uint8_t *XcpTlLz4Length(uint8_t *op, uint32_t l) {
+    for (; l >= 255; l -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)l;
+    return op;
+}
+
+// Compress n bytes from src into a LZ4 block (greedy matching, single probe hash table)
+// Returns the compressed size or 0, if the compressed block does not fit into cap bytes
+static uint32_t XcpTlLz4Compress(const uint8_t *src, uint32_t n, uint8_t *dst, uint32_t cap) {
+
+    uint16_t table[1 << LZ4_HASH_BITS]; // Last position of each hashed 4 byte sequence
+    memset(table, 0, sizeof(table));
+
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src; // Start of the pending literals
+    const uint8_t *end = src + n;
+    uint8_t *op = dst;
+    const uint8_t *oend = dst + cap;
+
+    if (n > LZ4_MF_LIMIT) {
+        const uint8_t *mf_limit = end - LZ4_MF_LIMIT;
+        const uint8_t *match_limit = end - LZ4_LAST_LITERALS;
+        while (ip < mf_limit) {
+
+            // Find a match candidate with the same 4 byte sequence
+            uint32_t seq;
+            memcpy(&seq, ip, 4);
+            uint32_t h = (seq * 2654435761u) >> (32 - LZ4_HASH_BITS);
+            const uint8_t *ref = src + table[h];
+            table[h] = (uint16_t)(ip - src);
+            if (ref >= ip || memcmp(ref, ip, LZ4_MIN_MATCH) != 0) {
+                ip++;
+                continue;
+            }
+
+            // Extend the match
+            const uint8_t *mp = ip + LZ4_MIN_MATCH;
+            const uint8_t *rp = ref + LZ4_MIN_MATCH;
+            while (mp < match_limit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            // Emit the sequence: token, literal length, literals, offset, match length
+            uint32_t lit = (uint32_t)(ip - anchor);
+            uint32_t ml = (uint32_t)(mp - ip) - LZ4_MIN_MATCH;
+            if (op + 1 + lit / 255 + 1 + lit + 2 + ml / 255 + 1 > oend)
+                return 0;
+            uint8_t *token = op++;
+            *token = (uint8_t)(((lit >= LZ4_RUN_MASK) ? LZ4_RUN_MASK : lit) << 4);
+            if (lit >= LZ4_RUN_MASK)
+                op = XcpTlLz4Length(op, lit - LZ4_RUN_MASK);
+            memcpy(op, anchor, lit);
+            op += lit;
+            uint16_t offset = (uint16_t)(ip - ref);
+            *op++ = (uint8_t)offset;
+            *op++ = (uint8_t)(offset >> 8);
+            *token |= (uint8_t)((ml >= LZ4_RUN_MASK) ? LZ4_RUN_MASK : ml);
+            if (ml >= LZ4_RUN_MASK)
+                op = XcpTlLz4Length(op, ml - LZ4_RUN_MASK);
+
+            ip = anchor = mp;
+        }
+    }
+
+    // Last literals
+    uint32_t lit = (uint32_t)(end - anchor);
+    if (op + 1 + lit / 255 + 1 + lit > oend)
+        return 0;
+    *op++ = (uint8_t)(((lit >= LZ4_RUN_MASK) ? LZ4_RUN_MASK : lit) << 4);
+    if (lit >= LZ4_RUN_MASK)
+        op = XcpTlLz4Length(op, lit - LZ4_RUN_MASK);
+    memcpy(op, anchor, lit);
+    op += lit;
+    return (uint32_t)(op - dst);
+}
+
+// Compress a segment of count buffers into a single compressed segment message
+// Returns false, if compression is off or the segment does not get smaller
+// Transmit thread only
+static bool XcpTlCompressSegment(const tQueueBuffer buffers[], uint32_t count, tQueueBuffer *compressed) {
+
+    if (gXcpTl.compression != TL_COMPRESSION_LZ4)
+        return false;
+
+    // Gather the segment
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        assert(n + buffers[i].size <= XCPTL_MAX_SEGMENT_SIZE);
+        memcpy(&gXcpTl.compression_src[n], buffers[i].buffer, buffers[i].size);
+        n += buffers[i].size;
+    }
+    gXcpTl.compression_in += n;
+
+    // Compressed segment message (len|flag+ctr, segment size, mode, LZ4 block), must be smaller than the segment
+    const uint32_t hs = XCPTL_TRANSPORT_LAYER_HEADER_SIZE + TL_COMPRESSED_SEGMENT_HEADER_SIZE;
+    uint8_t *d = gXcpTl.compression_dst;
+    uint32_t l = n > hs ? XcpTlLz4Compress(gXcpTl.compression_src, n, d + hs, n - hs) : 0;
+    if (l == 0) {
+        gXcpTl.compression_out += n;
+        return false;
+    }
+    l += TL_COMPRESSED_SEGMENT_HEADER_SIZE;
+    *(uint32_t *)&d[0] = (uint32_t)(TL_COMPRESSED_SEGMENT_FLAG | l); // ctr = 0
+    *(uint16_t *)&d[4] = (uint16_t)n;
+    *(uint16_t *)&d[6] = TL_COMPRESSION_LZ4;
+    compressed->buffer = d;
+    compressed->size = (uint16_t)(XCPTL_TRANSPORT_LAYER_HEADER_SIZE + l);
+    gXcpTl.compression_out += compressed->size;
+    return true;
+}
+
+// Apply the compression mode requested by the client, before the next segment is sent
+// Transmit thread only
+static void XcpTlUpdateCompression(void) {
+    uint8_t mode = (uint8_t)atomic_load_explicit(&gXcpTl.compression_request, memory_order_relaxed);
+    if (gXcpTl.compression != mode) {
+        if (gXcpTl.compression_in > 0) {
+            DBG_PRINTF3("Transmit compression off, %" PRIu64 " bytes compressed to %" PRIu64 " bytes (%u%%)\n", gXcpTl.compression_in, gXcpTl.compression_out,
+                        (uint32_t)((gXcpTl.compression_out * 100) / gXcpTl.compression_in));
+        }
+        DBG_PRINTF3("Transmit compression mode %u\n", mode);
+        gXcpTl.compression = mode;
+        gXcpTl.compression_in = gXcpTl.compression_out = 0;
+    }
+}
+
+// Set the transmit segment compression mode
+// Thread safe, the transmit thread applies it to the next segment
+bool XcpTlSetCompression(uint8_t mode) {
+    if (mode != TL_COMPRESSION_NONE && mode != TL_COMPRESSION_LZ4)
+        return false;
+    atomic_store_explicit(&gXcpTl.compression_request, mode, memory_order_relaxed);
+    return true;
+}
+
+#endif // XCPTL_ENABLE_COMPRESSION
+
+//-------------------------------------------------------------------------------------------------------
+
 // Transmit completed and fully commited XCP DAQ and EVENT messages in the transmit queue as segments in UDP frames
 // Uses vectored io to send multiple messages in one UDP frame, if possible
 // Returns number of bytes sent or -1 on error
@@ -728,34 +1389,212 @@ void XcpEthTlGetInfo(bool *isTcp, uint8_t *mac, uint8_t *addr, uint16_t *port) {
 #define MAX_BUFFERS 256          // Max number of buffers that can be accumulated into one segment
 #define MIN_UPDATE_TIME_MS 50ULL // Update data at least every 50ms
 #define MAX_QUEUE_LEVEL 50       // Transmit immediately, when the queue is more than 50% full and there is no more commited data
-#define MAX_SLEEP_TIME_MS 1      // 1ms sleep time for retry, when there is was segment ready to send
+#define MAX_SLEEP_TIME_MS 1      // 1ms sleep time for retry, when there is was segment ready to send and the queue does not support notification
 #define MAX_RETRIES 100          // Return to the caller after MAX_RETRIES (100ms to allow background tasks and graceful shutdown)
 
-// Collect queue buffers for one segment and transmit them
+// Set the transport layer header (ctr+len) of a message in the transmit queue
+// Transmit thread only
+static inline void XcpTlSetMessageHeader(uint8_t *b, uint32_t l) {
+    assert(l > 0);
+    assert(l <= XCPTL_MAX_DTO_SIZE);
+    assert(l % 4 == 0);
+#ifdef XCPTL_EXCLUDE_CRM_FROM_CTR // CANape option exclude command response
+    uint16_t ctr;
+    if (b[4] == PID_ERR || b[4] == PID_RES) {
+        ctr = XcpTlNextCrmCtr(); // Command response from the transmit queue
+    } else {
+        assert(b[4] == PID_SERV || b[4] == PID_EV || b[5] == 0xAA);
+        ctr = gXcpTl.ctr++;
+    }
+#else
+    uint16_t ctr = gXcpTl.ctr++;
+#endif
+    *(uint32_t *)b = ((uint32_t)(ctr) << 16) | l; // Set transport layer counter for this segment
+}
+
+// Send one segment, compressed if requested by the client
+// Transmit thread only
+static bool XcpTlSendSegment(tQueueBuffer buffers[], uint16_t count) {
+#ifdef XCPTL_ENABLE_COMPRESSION
+    tQueueBuffer compressed_buffer;
+    if (XcpTlCompressSegment(buffers, count, &compressed_buffer)) {
+        return XcpEthTlSendV(&compressed_buffer, 1);
+    }
+#endif
+    return XcpEthTlSendV(buffers, count);
+}
+
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+
+// Release all queue buffers held for zero copy sends
+static void XcpTlZeroCopyReleaseAll(void) {
+    queueReleaseBatch(gXcpTl.queue, gXcpTl.zc_buffers, gXcpTl.zc_count);
+    gXcpTl.zc_count = 0;
+}
+
+// Check for a new TCP connection, get the zero copy completion notifications and release the queue buffers of all completed sends
+// Waits up to timeout_ms for the first notification, if there are held queue buffers
+// Returns the number of queue buffers still held
+static uint32_t XcpTlZeroCopyReap(uint32_t timeout_ms) {
+
+    // New TCP connection, the held queue buffers of the previous connection are obsolete
+    uint32_t connection = (uint32_t)atomic_load_explicit(&gXcpTl.zc_connection, memory_order_acquire);
+    if (connection != gXcpTl.zc_connection_used) {
+        XcpTlZeroCopyReleaseAll();
+        gXcpTl.zc_connection_used = connection;
+        gXcpTl.zc_next_id = gXcpTl.zc_completed = 0; // Completion ids are counted per socket
+        SOCKET_HANDLE socket = gXcpTl.socket;
+        gXcpTl.zc_enabled = socket != INVALID_SOCKET_HANDLE && socketEnableZeroCopy(socket);
+        DBG_PRINTF4("TCP zero copy transmit %s\n", gXcpTl.zc_enabled ? "enabled" : "not supported");
+    }
+    if (gXcpTl.zc_count == 0) {
+        return 0;
+    }
+
+    // Socket closed, the data is obsolete
+    SOCKET_HANDLE socket = gXcpTl.socket;
+    if (socket == INVALID_SOCKET_HANDLE) {
+        XcpTlZeroCopyReleaseAll();
+        return 0;
+    }
+
+    // Completions of TCP sends are notified in order, lo..hi ranges may be merged by the kernel
+    uint32_t lo, hi;
+    bool copied;
+    int32_t r;
+    while ((r = socketGetZeroCopyCompletion(socket, timeout_ms, &lo, &hi, &copied)) > 0) {
+        (void)lo;
+        if ((int32_t)(hi + 1 - gXcpTl.zc_completed) > 0) {
+            gXcpTl.zc_completed = hi + 1;
+        }
+        if (copied && gXcpTl.zc_enabled) {
+            DBG_PRINT3("TCP zero copy transmit disabled, the kernel copies the data for this connection\n");
+            gXcpTl.zc_enabled = false; // Zero copy has only overhead, when the kernel copies anyway
+        }
+        timeout_ms = 0;
+    }
+    if (r < 0) {
+        XcpTlZeroCopyReleaseAll();
+        return 0;
+    }
+
+    // Release the leading queue buffers, whose sends are all completed
+    uint32_t n = 0;
+    while (n < gXcpTl.zc_count && (int32_t)(gXcpTl.zc_last_id[n] - gXcpTl.zc_completed) < 0) {
+        n++;
+    }
+    if (n > 0) {
+        queueReleaseBatch(gXcpTl.queue, gXcpTl.zc_buffers, n);
+        gXcpTl.zc_count -= n;
+        memmove(&gXcpTl.zc_buffers[0], &gXcpTl.zc_buffers[n], gXcpTl.zc_count * sizeof(gXcpTl.zc_buffers[0]));
+        memmove(&gXcpTl.zc_last_id[0], &gXcpTl.zc_last_id[n], gXcpTl.zc_count * sizeof(gXcpTl.zc_last_id[0]));
+    }
+    return gXcpTl.zc_count;
+}
+
+// Release queue buffers after sending them
+// Queue buffers must be released in peek order, so release is deferred while older queue buffers are held for zero copy sends
+// calls: number of zero copy sends referencing the queue buffers
+// sent: false after a send error, the data is obsolete then
+static void XcpTlZeroCopyRelease(const tQueueBuffer buffers[], uint32_t count, uint32_t calls, bool sent) {
+
+    if (!sent || (calls == 0 && gXcpTl.zc_count == 0)) {
+        XcpTlZeroCopyReleaseAll();
+        queueReleaseBatch(gXcpTl.queue, buffers, count);
+        return;
+    }
+
+    uint32_t id = gXcpTl.zc_next_id + calls - 1; // Completion id of the last send referencing the buffers, or of the previous send, if none
+    gXcpTl.zc_next_id += calls;
+    assert(gXcpTl.zc_count + count <= QUEUE_PEEK_MAX_COUNT);
+    for (uint32_t i = 0; i < count; i++) {
+        gXcpTl.zc_buffers[gXcpTl.zc_count] = buffers[i];
+        gXcpTl.zc_last_id[gXcpTl.zc_count] = id;
+        gXcpTl.zc_count++;
+    }
+}
+
+#endif // XCPTL_ENABLE_TCP_ZEROCOPY
+
+// Collect queue buffers for one segment (or up to XCPTL_MAX_SEND_SEGMENTS segments) and transmit them
 // Returns n = number of bytes sent or -1 on error
 // Returns n = 0 after timeout, if there is nothing to send
 // Returns after each segment sent
 int32_t XcpTlHandleTransmitQueue(void) {
 
+#if defined(OPTION_QUEUE_STATISTICS_EVENT) && defined(XCP_ENABLE_DAQ_EVENT_LIST)
+    XcpTlUpdateQueueStatistics();
+#endif
+
+    // Send a pending command response first
+    XcpTlSendCrmSlot();
+
+    // Release the queue buffers of completed zero copy sends, they stay peeked in front of the buffers collected here
+    // Wait for completions, when too many queue buffers are held
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+    uint32_t held = XcpTlZeroCopyReap(0);
+    if (held > MAX_BUFFERS / 2) {
+        held = XcpTlZeroCopyReap(MIN_UPDATE_TIME_MS);
+        if (held > MAX_BUFFERS / 2) {
+            return 0; // Retry in the next call
+        }
+    }
+#else
+    const uint32_t held = 0;
+#endif
+
     uint32_t length = 0;                     // Number of bytes collected for transmission
     uint32_t index = 0;                      // Index for peeking into the queue
     uint32_t total_lost = 0;                 // Accumulated lost packet count across all peeks
     tQueueBuffer queue_buffers[MAX_BUFFERS]; // Buffer pointers for peeking into the queue, max segment size / min message size
+#ifdef XCPTL_ENABLE_MULTI_SEGMENT_SEND
+    uint16_t segment_end[XCPTL_MAX_SEND_SEGMENTS]; // Buffer index after the last buffer of each complete segment
+    uint16_t segment_count = 0;                    // Number of complete segments
+    uint32_t segment_length = 0;                   // Number of bytes in complete segments
+#endif
     for (uint16_t retries = 0; retries < MAX_RETRIES;) {
 
+        // Send a pending command response first, queueNotify in XcpTlSendCrm ends queueWait
+        XcpTlSendCrmSlot();
+
         uint32_t lost = 0;
         bool flush = false;
         // DBG_PRINTF3("P %u\n", index);
-        tQueueBuffer queue_buffer = queuePeek(gXcpTl.queue, index, &lost, &flush);
+        // Get all committed buffers which fit into the remaining segment space
+        uint32_t n = queuePeekBatch(gXcpTl.queue, held + index, XCPTL_MAX_SEGMENT_SIZE - length, &queue_buffers[index], MAX_BUFFERS - held - index, &lost, &flush);
         total_lost += lost;
-        uint16_t l = queue_buffer.size;
 
-        // Queue does not have more committed data to peek or is empty
-        if (l == 0) {
+        // Queue does not have more committed data to peek or is empty, or the next buffer does not fit into the segment
+        if (n == 0) {
 
             // If there is commited data
             if (length > 0) {
 
+                // If the next buffer does not fit into the maximum XCP segment size, break the loop and transmit the collected buffers
+                if (queuePeek(gXcpTl.queue, held + index, NULL, NULL).size > 0) {
+#ifdef XCPTL_ENABLE_MULTI_SEGMENT_SEND
+                    // Segment full and there is more committed data, continue with the next segment
+                    segment_end[segment_count++] = (uint16_t)index;
+                    segment_length += length;
+                    length = 0;
+                    if (segment_count < XCPTL_MAX_SEND_SEGMENTS && index < MAX_BUFFERS - held) {
+                        continue;
+                    }
+#endif
+                    // DBG_PRINT3("F\n");
+                    break; // Segment full, transmit collected buffers
+                }
+
+#ifdef XCPTL_ENABLE_MULTI_SEGMENT_SEND
+                // Don't wait for more data, when there are complete segments to transmit
+                // The incomplete segment stays peeked in the queue, it will be the first segment of the next call
+                if (segment_count > 0) {
+                    index = segment_end[segment_count - 1];
+                    length = 0;
+                    break;
+                }
+#endif
+
                 // If time since last transmit is longer than MIN_UPDATE_TIME_MS (50), break the loop and transmit any collected buffers
                 // (to avoid too long delays when there is only little data in the queue)
                 if ((clockGetMonotonicNs() - gXcpTl.last_transmit_time) > (MIN_UPDATE_TIME_MS * 1000000)) {
@@ -774,24 +1613,40 @@ int32_t XcpTlHandleTransmitQueue(void) {
                 }
             }
 
-            // Sleep some time and retry
-            sleepMs(MAX_SLEEP_TIME_MS);
+            // Wait for more data and retry
+            // Blocks until a producer commits a priority packet, the queue level exceeds the notification level or the timeout expired, if the queue supports notification
+            // Otherwise sleeps MAX_SLEEP_TIME_MS
+            // Timeout is the remaining time until the next update is due or the remaining retry time
+            // Small commits below the notification level don't wake up the consumer, the timeout must not exceed MIN_UPDATE_TIME_MS
+            uint64_t timeout_us = (uint64_t)(MAX_RETRIES - retries) * MAX_SLEEP_TIME_MS * 1000;
+            if (timeout_us > MIN_UPDATE_TIME_MS * 1000)
+                timeout_us = MIN_UPDATE_TIME_MS * 1000;
+            if (length > 0) {
+                uint64_t elapsed_us = (clockGetMonotonicNs() - gXcpTl.last_transmit_time) / 1000;
+                uint64_t remaining_us = (elapsed_us < MIN_UPDATE_TIME_MS * 1000) ? (MIN_UPDATE_TIME_MS * 1000 - elapsed_us + 1) : 0;
+                if (remaining_us < timeout_us)
+                    timeout_us = remaining_us;
+            }
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+            else if (held > 0 && timeout_us > MAX_SLEEP_TIME_MS * 1000) {
+                timeout_us = MAX_SLEEP_TIME_MS * 1000; // Return early to release the queue buffers of completed zero copy sends
+            }
+#endif
+            if (!queueWait(gXcpTl.queue, (uint32_t)timeout_us)) {
+                break; // Timeout, transmit collected buffers or return to the caller
+            }
             retries++;
 
         } else {
 
-            // Check if this buffer fits into the maximum XCP segment size, if not break the loop and transmit the collected buffers
-            if (length + l > XCPTL_MAX_SEGMENT_SIZE) {
-                // DBG_PRINT3("F\n");
-                break; // Segment full, transmit collected buffers
+            // Buffers are stored for later vectored io transmission and release
+            for (uint32_t i = index; i < index + n; i++) {
+                length += queue_buffers[i].size;
             }
-
-            // Store buffer for later vectored io transmission and release
-            queue_buffers[index++] = queue_buffer;
-            length += l;
+            index += n;
 
             // Reached max number of buffers for one segment, break loop and transmit collected buffers
-            if (index >= MAX_BUFFERS) {
+            if (index >= MAX_BUFFERS - held) {
                 // DBG_PRINT3("B\n");
                 break; // Buffers full, transmit collected buffers
             }
@@ -804,18 +1659,26 @@ int32_t XcpTlHandleTransmitQueue(void) {
         }
     } // for(;retries<MAX_RETRIES;) peek loop
 
+#ifdef XCPTL_ENABLE_MULTI_SEGMENT_SEND
+    // Complete the last segment
+    if (length > 0) {
+        segment_end[segment_count++] = (uint16_t)index;
+        segment_length += length;
+    }
+    length = segment_length;
+#endif
+
     // If there is nothing to send, return to the caller
     if (length == 0) {
         // DBG_PRINT3("XcpTlHandleTransmitQueue: Queue has no data, return\n");
         return 0; // Nothing to do, return to the caller, who can do other background tasks or shutdown the server gracefully
     }
 
-    // Maintain consistency of the message counter, so all messages in this segment have increasing transport layer counter
-    // Could be avoided by using the alternative transport layer counter mode of CANape, but this would required explicitly setting it in each new CANape project
-    // The only tradeoff of this approach is increased latency of command responses, which is important for GET_DAQ_CLOCK responses
-    mutexLock(&gXcpTl.ctr_mutex);
+    // The message counter is maintained by this thread only, command responses are sent by this thread as well, no lock needed
+    // A command response handed over before these messages were committed, is sent first
+    XcpTlSendCrmSlot();
 
-    // Account for any lost packets in the counter (must be inside the mutex to avoid race with XcpTlSendCrm)
+    // Account for any lost packets in the counter
     if (total_lost > 0) {
         gXcpTl.ctr += (uint16_t)total_lost;
         DBG_PRINTF_WARNING("Transmit queue overflow: lost %u packets, ctr=%u\n", total_lost, gXcpTl.ctr);
@@ -824,36 +1687,70 @@ int32_t XcpTlHandleTransmitQueue(void) {
     // Update the transport layer header (ctr+len) for all collected messages
     for (uint32_t i = 0; i < index; i++) {
         assert(queue_buffers[i].buffer != NULL);
-        uint32_t l = queue_buffers[i].size - XCPTL_TRANSPORT_LAYER_HEADER_SIZE; // Get message payload size without transport layer header
-        assert(l > 0);
-        assert(l <= XCPTL_MAX_DTO_SIZE);
-        assert(l % 4 == 0);
         uint8_t *b = queue_buffers[i].buffer;
-#ifdef XCPTL_EXCLUDE_CRM_FROM_CTR // CANape option exclude command response
-        uint16_t ctr = 0;
-        if (b[4] == PID_ERR || b[4] == PID_RES) {
-            ctr = 0;
-        } else {
-            assert(b[4] == PID_SERV || b[4] == PID_EV || b[5] == 0xAA);
-            ctr = gXcpTl.ctr++;
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+        // A queue entry may contain multiple messages, the queue stores the payload size of each message in its transport layer header
+        const uint8_t *e = b + queue_buffers[i].size;
+        while (b < e) {
+            uint32_t l = queueGetMessageSize(b);
+            XcpTlSetMessageHeader(b, l);
+            b += XCPTL_TRANSPORT_LAYER_HEADER_SIZE + l;
         }
+        assert(b == e);
 #else
-        uint16_t ctr = gXcpTl.ctr++;
+        XcpTlSetMessageHeader(b, queue_buffers[i].size - XCPTL_TRANSPORT_LAYER_HEADER_SIZE); // Message payload size without transport layer header
 #endif
-        *(uint32_t *)b = ((uint32_t)(ctr) << 16) | l; // Set transport layer counter for this segment
     }
 
-    // Send the complete frame (blocking until sent)
-    bool res = XcpEthTlSendV(queue_buffers, index);
-
-    mutexUnlock(&gXcpTl.ctr_mutex);
+    // Send the complete frames (blocking until sent), compressed if requested by the client
+    bool res;
+#ifdef XCPTL_ENABLE_COMPRESSION
+    XcpTlUpdateCompression();
+#endif
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+    uint32_t zc_calls = 0;
+    bool zc = gXcpTl.zc_enabled && isTCP();
+#ifdef XCPTL_ENABLE_COMPRESSION
+    zc = zc && gXcpTl.compression == TL_COMPRESSION_NONE; // Compressed segments are sent from the reused compression buffer
+#endif
+    if (zc) {
+#ifdef XCPTL_ENABLE_MULTI_SEGMENT_SEND
+        res = XcpEthTlSendZeroCopy(queue_buffers, (uint16_t)index, segment_count, &zc_calls);
+#else
+        res = XcpEthTlSendZeroCopy(queue_buffers, (uint16_t)index, 1, &zc_calls);
+#endif
+    } else
+#endif
+    {
+#ifdef XCPTL_ENABLE_MULTI_SEGMENT_SEND
+        bool batch = segment_count > 1;
+#ifdef XCPTL_ENABLE_COMPRESSION
+        batch = batch && gXcpTl.compression == TL_COMPRESSION_NONE; // Compressed segments are sent one by one
+#endif
+        if (batch) {
+            res = XcpEthTlSendMV(queue_buffers, (uint16_t)index, segment_end, segment_count);
+        } else {
+            res = true;
+            for (uint16_t s = 0, i = 0; res && s < segment_count; i = segment_end[s++]) {
+                res = XcpTlSendSegment(&queue_buffers[i], (uint16_t)(segment_end[s] - i));
+            }
+        }
+#else
+        res = XcpTlSendSegment(queue_buffers, (uint16_t)index);
+#endif
+    }
 
     gXcpTl.last_transmit_time = clockGetMonotonicNs(); // Update last transmit time
 
-    // Free all queue buffers
-    for (uint32_t i = 0; i < index; i++) {
-        queueRelease(gXcpTl.queue, &queue_buffers[i]);
-    }
+    // Don't delay a command response handed over during the send until the next call
+    XcpTlSendCrmSlot();
+
+    // Free all queue buffers, deferred until the kernel completed zero copy sends
+#ifdef XCPTL_ENABLE_TCP_ZEROCOPY
+    XcpTlZeroCopyRelease(queue_buffers, index, zc_calls, res);
+#else
+    queueReleaseBatch(gXcpTl.queue, queue_buffers, index);
+#endif
 
     if (res) {
         // DBG_PRINTF3("XcpTlHandleTransmitQueue: Segment transmitted, length=%u, ctr=(%u-%u)\n", length, ctr - index + 1, ctr);
@@ -916,7 +1813,15 @@ int32_t XcpTlHandleTransmitQueue(void) {
                 mutexUnlock(&gXcpTl.ctr_mutex);
                 break; // queue is empty, break inner loop and sleep a bit
             } else {
-                // Send this frame (blocking)
+                // Send this frame (blocking), compressed if requested by the client
+#ifdef XCPTL_ENABLE_COMPRESSION
+                XcpTlUpdateCompression();
+                tQueueBuffer compressed_buffer;
+                if (XcpTlCompressSegment(&queue_buffer, 1, &compressed_buffer)) {
+                    b = compressed_buffer.buffer;
+                    l = compressed_buffer.size;
+                }
+#endif
                 bool r = XcpEthTlSend(b, l, NULL, 0);
                 mutexUnlock(&gXcpTl.ctr_mutex);
 
@@ -941,6 +1846,9 @@ int32_t XcpTlHandleTransmitQueue(void) {
 #if defined(OPTION_DAQ_ASYNC_EVENT) && defined(XCP_ENABLE_DAQ_EVENT_LIST)
         XcpEvent(gXcpAsyncEvent);
 #endif
+#if defined(OPTION_QUEUE_STATISTICS_EVENT) && defined(XCP_ENABLE_DAQ_EVENT_LIST)
+        XcpTlUpdateQueueStatistics();
+#endif
 
     } // for(j)
     return n;
@@ -25,6 +25,7 @@ bool XcpEthTlInit(const uint8_t *addr, uint16_t port, bool useTCP, tQueueHandle
 void XcpEthTlShutdown(void);
 void XcpEthTlGetInfo(bool *isTCP, uint8_t *mac, uint8_t *addr, uint16_t *port);
 bool XcpEthTlHandleCommands(void); // Handle incoming XCP commands
+void XcpEthTlStopCommands(void);   // Stop receiving XCP commands, called by the thread which handled the commands before it terminates
 #ifdef XCPTL_ENABLE_MULTICAST
 void XcpEthTlSendMulticastCrm(const uint8_t *data, uint16_t n, const uint8_t *addr, uint16_t port); // Send multicast command response
 void XcpEthTlSetClusterId(uint16_t clusterId);                                                      // Set cluster id for GET_DAQ_CLOCK_MULTICAST reception
@@ -82,6 +82,7 @@
 #define OPTION_ENABLE_UDP
 #define OPTION_MTU 8000                     // Ethernet packet size (MTU), must be %8 - Jumbo frames supported
 #define OPTION_SERVER_FORCEFULL_TERMINATION // Don't wait for the rx and tx thread to finish, just terminate them
+// #define OPTION_ENABLE_IO_URING           // Linux only: use io_uring for the server socket I/O, if the kernel supports it (otherwise blocking socket calls)
 
 //-------------------------------------------------------------------------------
 // CAL setting
@@ -123,7 +124,7 @@
 //-------------------------------------------------------------------------------
 // DAQ settings
 
-#define OPTION_DAQ_MEM_SIZE (1024 * 8) // Memory bytes used for XCP DAQ tables - 6 bytes per measurement signal/block needed
+#define OPTION_DAQ_MEM_SIZE (1024 * 8) // Memory bytes used for XCP DAQ tables - 6 bytes per measurement signal/block needed, the copy plan is allocated in addition
 #define OPTION_DAQ_EVENT_COUNT 64      // Maximum number of DAQ events (integer value, must be even)
 // #define OPTION_DAQ_ASYNC_EVENT         // Create an asynchronous, cyclic DAQ event for asynchronous data acquisition
 
@@ -131,6 +132,57 @@
 // Default:
 #define OPTION_QUEUE_64_VAR_SIZE
 
+// Sharded producer lanes for OPTION_QUEUE_64_VAR_SIZE
+// Each producer thread is assigned to one of n lanes on its first queueAcquire, producers on different lanes never contend on the same cache line
+// The consumer merges the lanes round robin, the FIFO order is preserved for each lane
+// The queue memory is split into n equal parts, each lane must fit at least 2 entries of maximum size
+// #define OPTION_QUEUE_64_VAR_SIZE_LANES 8
+
+// Large queue entries for OPTION_QUEUE_64_VAR_SIZE
+// Multiple messages are packed into one queue entry up to XCPTL_MAX_SEGMENT_SIZE, all ODTs of a DAQ list are acquired and committed as a single entry
+// and transmitted without copying, saves the entry header, commit, peek and release of each ODT
+// The wrap around space of each lane increases to XCPTL_MAX_SEGMENT_SIZE, each lane must fit at least 2 entries of this size
+// #define OPTION_QUEUE_64_VAR_SIZE_LARGE_ENTRIES
+
+// Blocking transmit thread wakeup (Linux futex)
+// OPTION_QUEUE_64_VAR_SIZE: The transmit thread blocks until a producer commits a priority packet or a lane level exceeds OPTION_QUEUE_NOTIFY_LEVEL percent,
+// instead of polling the queue with 1ms sleep
+// All queues: queueNotify wakes up the transmit thread immediately, used to send command responses
+#if defined(__linux__)
+#define OPTION_QUEUE_NOTIFY
+#define OPTION_QUEUE_NOTIFY_LEVEL 50 // Queue lane level in percent, which wakes up the transmit thread
+#endif
+
+// Transmit queue overflow policy
+// Part of the transmit queue in percent, reserved for command responses and priority DAQ lists (SET_DAQ_LIST_MODE priority > 0)
+// QUEUE_OVERFLOW_DROP_NEWEST: All priority DAQ lists may use the full headroom (default)
+// QUEUE_OVERFLOW_GRADED_HEADROOM: The usable part of the headroom grows with the DAQ list priority, lower priorities are dropped first
+// Data already queued is never evicted, on overflow the new sample is dropped and counted as lost
+// #define OPTION_QUEUE_PRIORITY_HEADROOM 10
+// #define OPTION_QUEUE_OVERFLOW_POLICY QUEUE_OVERFLOW_GRADED_HEADROOM
+
+// Back the transmit queue with 2 MiB huge pages (MAP_HUGETLB), pre-faulted and locked in RAM (mlock) at init
+// Falls back to normal pages with transparent huge pages, if no huge pages are reserved (/proc/sys/vm/nr_hugepages), and to unlocked memory, if RLIMIT_MEMLOCK is too low
+// The queue size is rounded up to the huge page size, a shared memory queue (OPTION_SHM_MODE) is pre-faulted and locked
+// Default for queueInit, queueInitFromMemory and XcpEthServerInit, selectable at runtime with queueInitEx, queueInitFromMemoryEx and XcpEthServerInitEx
+// #define OPTION_QUEUE_HUGE_PAGES
+#ifdef OPTION_QUEUE_HUGE_PAGES
+#define QUEUE_HUGE_PAGES_DEFAULT true
+#else
+#define QUEUE_HUGE_PAGES_DEFAULT false
+#endif
+
+// Sampled latency histograms for the transmit queue runtime statistics (queueGetStatistics)
+// The counters (acquires, retries, losses, overflow bursts, level high water mark) are always available, this adds a clock read to every 16th queue operation of a thread
+// The histograms are kept in process local heap memory, not in the queue memory, they are not available for a queue in shared memory (OPTION_SHM_MODE)
+// #define OPTION_QUEUE_STATISTICS
+
+// Publish the transmit queue runtime statistics (queueGetStatistics) as measurements on the XCP event "xcp_queue", updated every 100ms
+// #define OPTION_QUEUE_STATISTICS_EVENT
+#if defined(OPTION_QUEUE_STATISTICS_EVENT) && !defined(OPTION_QUEUE_STATISTICS)
+#define OPTION_QUEUE_STATISTICS
+#endif
+
 // Transport layer queue, vectored IO, lockless with fixed queue entry size
 // For maximum performance with large DTO size, but less efficient memory usage with partially filled queue entries
 // Entry size is XCPTL_MAX_DTO_SIZE  + XCPTL_TRANSPORT_LAYER_HEADER_SIZE (4) + 4
@@ -139,7 +191,7 @@
 // Larger DTO size may not payoff, rely on transport layer message accumulation
 // #define OPTION_QUEUE_64_FIX_SIZE
 
-// Transport layer queue, with variable queue entry size, 32 bit not lockless with mutex synchronization
+// Transport layer queue, with variable queue entry size, lockless with 32 bit atomics, accumulates messages in segments
 // Mandatory for Windows and 32 bit platforms
 // #define OPTION_QUEUE_32
 #if defined(OPTION_ATOMIC_EMULATION) || defined(PLATFORM_32_BIT)
@@ -164,7 +216,6 @@
 #if !defined(NDEBUG)
 
 // #define TEST_CLOCK_GET_STATISTIC // Count number of calls to clockGet and clockGetLast, print results with clockPrintStatistic()
-// #define TEST_ACQUIRE_LOCK_TIMING // Create a queue acquire time histogram, prints results on queue deinit, significant performance impact, for testing only !!!!!!!!!!
 // #define TEST_ENABLE_DBG_METRICS // Enable debug metrics for XCP events and transport layer packets
 // #define TEST_ENABLE_BUFFERCOUNT_HISTOGRAM // Enable histogram of the used buffer counts in the transport layer vectored io
 // #define TEST_MUTABLE_ACCESS_OWNERSHIP // Enable tracking of mutable access thread ownership to detect overseen potential memory safety problems
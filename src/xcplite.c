@@ -181,6 +181,25 @@ tXcpData gXcpData = {0};
 #endif
 tXcpLocalData gXcpLocalData = {0}; // XCP_MODE_DEACTIVATE by default
 
+// DAQ table memory of the XCP singleton, allocated by XcpInit and XcpSetDaqMemSize
+// Not cleared by XcpInit, reused if the size did not change
+#ifdef XCP_ENABLE_DAQ_MEM_ALLOC
+static uint64_t *gXcpDaqMem = NULL;
+static uint32_t gXcpDaqMemSize = 0;
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+static uint16_t *gXcpDaqDispatchMem = NULL; // Running DAQ list arrays of both DAQ dispatch tables
+#endif
+#endif
+
+// Event trigger mask of the XCP singleton, tested inline by the event trigger macros
+// Points to an all zero mask, as long as this process is not attached to the shared state
+#ifdef OPTION_SHM_MODE
+static const uint64_t gXcpEventMaskOff[XCP_EVENT_MASK_WORDS] = {0};
+const volatile uint64_t *gXcpEventMask = gXcpEventMaskOff;
+#else
+const volatile uint64_t *gXcpEventMask = (const volatile uint64_t *)gXcpData.event_mask;
+#endif
+
 // Debug
 // Test the thread safety concept
 // - Assert mutable access to the XCP singleton is either safe or allowed to the owner thread
@@ -250,40 +269,81 @@ static inline tXcpData *XcpMut_(const char *file, int line) {
 /****************************************************************************/
 
 static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLen);
+#ifdef XCP_ENABLE_DAQ_RECORDER
+static void XcpRecorderStreamTask(void);
+#endif
+#ifdef XCP_ENABLE_DAQ_RESUME
+static void XcpSendResumeModeEvent(void);
+#endif
 
 /****************************************************************************/
 /* Macros                                                                   */
 /****************************************************************************/
 
+// DAQ memory access shortcuts
+// DaqMemSize is the size for the DAQ, ODT and ODT entry tables, DaqMemTotalSize includes the tables computed on DAQ list start
+#ifdef XCP_ENABLE_DAQ_MEM_ALLOC
+#define DaqMemSize gXcpDaqMemSize
+#define DaqMem ((const uint8_t *)gXcpDaqMem)
+#define DaqMemMut ((uint8_t *)gXcpDaqMem)
+#else
+#define DaqMemSize ((uint32_t)XCP_DAQ_MEM_SIZE)
+#define DaqMem ((const uint8_t *)shared.daq_lists.u.b)
+#define DaqMemMut ((uint8_t *)shared_mut.daq_lists.u.b)
+#endif
+#define DaqMemTotalSize ((uint32_t)XCP_DAQ_MEM_TOTAL_SIZE(DaqMemSize))
+
+// Maximum number of DAQ lists in the DAQ memory, DAQ list numbers are 16 bit
+#define DaqMemMaxDaqCount (DaqMemSize / (uint32_t)sizeof(tXcpDaqList) > 0xFFFF ? 0xFFFFu : DaqMemSize / (uint32_t)sizeof(tXcpDaqList))
+
+// DAQ dispatch table access shortcuts
+// t is the dispatch table index 0 or 1
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+#ifdef XCP_ENABLE_DAQ_MEM_ALLOC
+#define DaqDispatchDaqTable(t) ((const uint16_t *)&gXcpDaqDispatchMem[(t) * DaqMemMaxDaqCount])
+#define DaqDispatchDaqTableMut(t) (&gXcpDaqDispatchMem[(t) * DaqMemMaxDaqCount])
+#else
+#define DaqDispatchDaqTable(t) ((const uint16_t *)shared.daq_dispatch[t].daq)
+#define DaqDispatchDaqTableMut(t) (shared_mut.daq_dispatch[t].daq)
+#endif
+
+// DAQ dispatch reader slot
+// Bits 0-15 and 16-31 number of event processing threads reading table index 0 and 1
+#define DaqDispatchReader(t) ((uint32_t)1 << (16 * (t)))
+#define DaqDispatchReaderCount(readers, t) ((uint32_t)(((readers) >> (16 * (t))) & 0xFFFFu))
+#endif
+
 // DAQ list access shortcuts
 // j is absolute odt number
 // i is daq number
-#define DaqListOdtTable ((const tXcpOdt *)&shared.daq_lists.u.daq_list[shared.daq_lists.daq_count])
+#define DaqListTable ((const tXcpDaqList *)DaqMem)
+#define DaqListTableMut ((tXcpDaqList *)DaqMemMut)
+#define DaqListOdtTable ((const tXcpOdt *)&DaqListTable[shared.daq_lists.daq_count])
 #define DaqListOdtEntryAddrTable ((const uint32_t *)&DaqListOdtTable[shared.daq_lists.odt_count])
 #define DaqListOdtEntrySizeTable ((const uint8_t *)&DaqListOdtEntryAddrTable[shared.daq_lists.odt_entry_count])
 #ifdef XCP_ENABLE_DAQ_ADDREXT
 #define DaqListOdtEntryAddrExtTable ((const uint8_t *)&DaqListOdtEntrySizeTable[shared.daq_lists.odt_entry_count])
 #endif
-#define DaqListOdtTableMut ((tXcpOdt *)&shared_mut.daq_lists.u.daq_list[shared.daq_lists.daq_count])
+#define DaqListOdtTableMut ((tXcpOdt *)&DaqListTableMut[shared.daq_lists.daq_count])
 #define DaqListOdtEntryAddrTableMut ((uint32_t *)&DaqListOdtTableMut[shared.daq_lists.odt_count])
 #define DaqListOdtEntrySizeTableMut ((uint8_t *)&DaqListOdtEntryAddrTableMut[shared.daq_lists.odt_entry_count])
 #ifdef XCP_ENABLE_DAQ_ADDREXT
 #define DaqListOdtEntryAddrExtTableMut ((uint8_t *)&DaqListOdtEntrySizeTableMut[shared.daq_lists.odt_entry_count])
 #endif
 #define DaqListOdtEntryCount(j) ((DaqListOdtTable[j].last_odt_entry - DaqListOdtTable[j].first_odt_entry) + 1)
-#define DaqListOdtCount(i) ((shared.daq_lists.u.daq_list[i].last_odt - shared.daq_lists.u.daq_list[i].first_odt) + 1)
-#define DaqListLastOdt(i) shared.daq_lists.u.daq_list[i].last_odt
-#define DaqListFirstOdt(i) shared.daq_lists.u.daq_list[i].first_odt
-#define DaqListMode(i) shared.daq_lists.u.daq_list[i].mode
-#define DaqListModeMut(i) shared_mut.daq_lists.u.daq_list[i].mode
-#define DaqListState(i) shared.daq_lists.u.daq_list[i].state
-#define DaqListStateMut(i) shared_mut.daq_lists.u.daq_list[i].state
-#define DaqListEventChannel(i) shared.daq_lists.u.daq_list[i].event_id
-#define DaqListEventChannelMut(i) shared_mut.daq_lists.u.daq_list[i].event_id
-#define DaqListAddrExt(i) shared.daq_lists.u.daq_list[i].addr_ext
-#define DaqListAddrExtMut(i) shared_mut.daq_lists.u.daq_list[i].addr_ext
-#define DaqListPriority(i) shared.daq_lists.u.daq_list[i].priority
-#define DaqListPriorityMut(i) shared_mut.daq_lists.u.daq_list[i].priority
+#define DaqListOdtCount(i) ((DaqListTable[i].last_odt - DaqListTable[i].first_odt) + 1)
+#define DaqListLastOdt(i) DaqListTable[i].last_odt
+#define DaqListFirstOdt(i) DaqListTable[i].first_odt
+#define DaqListMode(i) DaqListTable[i].mode
+#define DaqListModeMut(i) DaqListTableMut[i].mode
+#define DaqListState(i) DaqListTable[i].state
+#define DaqListStateMut(i) DaqListTableMut[i].state
+#define DaqListEventChannel(i) DaqListTable[i].event_id
+#define DaqListEventChannelMut(i) DaqListTableMut[i].event_id
+#define DaqListAddrExt(i) DaqListTable[i].addr_ext
+#define DaqListAddrExtMut(i) DaqListTableMut[i].addr_ext
+#define DaqListPriority(i) DaqListTable[i].priority
+#define DaqListPriorityMut(i) DaqListTableMut[i].priority
 #ifdef XCP_MAX_EVENT_COUNT
 #ifdef XCP_ENABLE_DAQ_EVENT_LIST
 #define DaqListFirst(event_id) shared.event_list.event[event_id].daq_first
@@ -292,8 +352,8 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
 #define DaqListFirst(event_id) shared.daq_lists.daq_first[event_id]
 #define DaqListFirstMut(event_id) shared_mut.daq_lists.daq_first[event_id]
 #endif
-#define DaqListNext(daq) shared.daq_lists.u.daq_list[daq].next
-#define DaqListNextMut(daq) shared_mut.daq_lists.u.daq_list[daq].next
+#define DaqListNext(daq) DaqListTable[daq].next
+#define DaqListNextMut(daq) DaqListTableMut[daq].next
 #endif
 
 // Command response buffer access shortcuts
@@ -811,6 +871,40 @@ uint16_t XcpGetEventIndex(tXcpEventId event) {
     return shared.event_list.event[event].index;
 }
 
+// Get the number of DAQ list samples of an event lost since DAQ start
+uint32_t XcpGetEventDaqLostCount(tXcpEventId event) {
+    if (!isActivated() || event >= getEventCount())
+        return 0;
+    return (uint32_t)atomic_load_explicit(&shared.event_list.event[event].daq_lost, memory_order_relaxed);
+}
+
+#ifdef XCP_ENABLE_DAQ_EVENT_BUDGET
+// Set the DAQ byte budget of an event in bytes per second, 0 = unlimited
+bool XcpSetEventByteBudget(tXcpEventId event, uint32_t bytes_per_s) {
+    if (!isActivated() || event >= acquireEventCount())
+        return false;
+    shared_mut_safe.event_list.event[event].daq_budget = (uint32_t)(((uint64_t)bytes_per_s * XCP_DAQ_EVENT_BUDGET_WINDOW_MS) / 1000);
+    DBG_PRINTF3("Event %u DAQ budget %u bytes/s\n", event, bytes_per_s);
+    return true;
+}
+#endif
+
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+// Make all DAQ lists of an event send on change
+bool XcpSetEventSendOnChange(tXcpEventId event, bool enable) {
+    if (!isActivated() || event >= acquireEventCount())
+        return false;
+    tXcpEvent *evt = &shared_mut_safe.event_list.event[event];
+    if (enable) {
+        evt->flags |= XCP_DAQ_EVENT_FLAG_SEND_ON_CHANGE;
+    } else {
+        evt->flags &= (uint8_t)(~XCP_DAQ_EVENT_FLAG_SEND_ON_CHANGE);
+    }
+    DBG_PRINTF3("Event %u send on change %s\n", event, enable ? "on" : "off");
+    return true;
+}
+#endif
+
 // @@@@ TODO: Not process-safe
 static tXcpEventId XcpFindEventInstances(const char *name, uint16_t *pcount) {
     uint16_t id = XCP_UNDEFINED_EVENT_ID;
@@ -877,6 +971,12 @@ tXcpEventId XcpCreateIndexedEvent(const char *name, uint16_t index, uint32_t cyc
 #endif
     shared_mut_safe.event_list.event[e].daq_first = XCP_UNDEFINED_DAQ_LIST;
     shared_mut_safe.event_list.event[e].cycle_time_ns = cycle_time_ns;
+    atomic_store_explicit(&shared_mut_safe.event_list.event[e].daq_lost, 0, memory_order_relaxed);
+#ifdef XCP_ENABLE_DAQ_EVENT_BUDGET
+    shared_mut_safe.event_list.event[e].daq_budget = 0;
+    atomic_store_explicit(&shared_mut_safe.event_list.event[e].daq_budget_used, 0, memory_order_relaxed);
+    atomic_store_explicit(&shared_mut_safe.event_list.event[e].daq_budget_window, 0, memory_order_relaxed);
+#endif
     // In SHM mode, assign event to the application, different apps have different namespace
 #ifdef OPTION_SHM_MODE // store event application id in event
     shared_mut_safe.event_list.event[e].app_id = XcpShmGetAppId();
@@ -949,14 +1049,91 @@ const char *XcpGetEventName(tXcpEventId event) {
 // Timestamp size is hardcoded to 4 bytes
 #define ODT_TIMESTAMP_SIZE 4
 
+// Maximum number of ODTs in a DAQ list
+#ifdef XCP_ENABLE_OVERRUN_INDICATION_PID
+#define ODT_MAX_COUNT 0x7C // MSB of ODT number is reserved for overflow indication, 0xFC-0xFF for response, error, event and service
+#else
+#define ODT_MAX_COUNT 0xFC // 0xFC-0xFF for response, error, event and service
+#endif
+
+// Event trigger mask word index and bit of an event
+#define EventMaskWord(event) (((uint16_t)(event) >> 6) & (XCP_EVENT_MASK_WORDS - 1))
+#define EventMaskBit(event) ((uint64_t)1 << ((event) & 63))
+
+#ifdef XCP_ENABLE_DYN_ADDRESSING
+
+// Set the event trigger mask bit of an event
+static void XcpSetEventMaskBit(tXcpEventId event) {
+    atomic_uint_fast64_t *p = &shared_mut_safe.event_mask[EventMaskWord(event)];
+    uint64_t mask = atomic_load_explicit(p, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(p, &mask, mask | EventMaskBit(event), memory_order_release, memory_order_relaxed)) {
+    }
+}
+
+// Clear the event trigger mask bit of an event, if there is no running DAQ list on an event with the same bit
+static void XcpClearEventMaskBit(tXcpEventId event) {
+    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
+        uint16_t e = DaqListEventChannel(daq);
+        if ((DaqListState(daq) & DAQ_STATE_RUNNING) != 0 && EventMaskWord(e) == EventMaskWord(event) && EventMaskBit(e) == EventMaskBit(event))
+            return;
+    }
+    atomic_uint_fast64_t *p = &shared_mut_safe.event_mask[EventMaskWord(event)];
+    uint64_t mask = atomic_load_explicit(p, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(p, &mask, mask & ~EventMaskBit(event), memory_order_release, memory_order_relaxed)) {
+    }
+}
+
+#endif // XCP_ENABLE_DYN_ADDRESSING
+
+// Rebuild the event trigger mask from the running DAQ lists and the pending async command
+// Called by the XCP command thread on DAQ list start and stop
+static void XcpUpdateEventMask(void) {
+
+    uint64_t mask[XCP_EVENT_MASK_WORDS] = {0};
+    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
+        if ((DaqListState(daq) & DAQ_STATE_RUNNING) != 0) {
+            uint16_t event = DaqListEventChannel(daq);
+            mask[EventMaskWord(event)] |= EventMaskBit(event);
+        }
+    }
+#ifdef XCP_ENABLE_DYN_ADDRESSING
+    if (atomic_load_explicit(&shared.cmd_pending, memory_order_acquire) && XcpAddrIsDyn(local.mta_ext)) {
+        uint16_t event = XcpAddrDecodeDynEvent(local.mta_addr);
+        mask[EventMaskWord(event)] |= EventMaskBit(event);
+    }
+#endif
+    for (uint16_t i = 0; i < XCP_EVENT_MASK_WORDS; i++) {
+        atomic_store_explicit(&shared_mut_safe.event_mask[i], mask[i], memory_order_release);
+    }
+}
+
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+// Activate DAQ dispatch table 1 or 2, 0 = none
+// Sequentially consistent with the reader slot updates of the event processing threads, see XcpGetDaqDispatchReaderCount
+static void XcpSetDaqDispatchActive(uint8_t active) { atomic_store_explicit(&shared_mut_safe.daq_dispatch_active, active, memory_order_seq_cst); }
+#endif
+
 // Free all dynamic DAQ lists
 static void XcpClearDaq(void) {
 
-    shared_mut.session_status &= (uint16_t)(~SS_DAQ);
+#ifdef XCP_ENABLE_DAQ_RECORDER
+    XcpRecorderStop(); // The recorded samples refer to the DAQ lists
+#endif
+
+    shared_mut.session_status &= (uint16_t)(~(SS_DAQ | SS_RESUME));
     atomic_store_explicit(&shared_mut_safe.daq_running, false, memory_order_release);
 
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+    XcpSetDaqDispatchActive(0);
+#endif
+
     memset((uint8_t *)&shared.daq_lists, 0, sizeof(tXcpDaqLists));
     shared_mut.daq_lists.res = 0xBEAC;
+#ifdef XCP_ENABLE_DAQ_MEM_ALLOC
+    if (gXcpDaqMem != NULL) {
+        memset(DaqMemMut, 0, DaqMemTotalSize);
+    }
+#endif
 
 #ifdef XCP_MAX_EVENT_COUNT
 #ifdef XCP_ENABLE_DAQ_EVENT_LIST
@@ -970,28 +1147,140 @@ static void XcpClearDaq(void) {
     }
 #endif
 #endif
+
+    XcpUpdateEventMask();
 }
 
-// Check if there is sufficient memory for the values of DaqCount, OdtCount and OdtEntryCount
-// Return CRC_MEMORY_OVERFLOW if not
-static uint8_t XcpCheckMemory(void) {
+#ifdef XCP_ENABLE_DAQ_MEM_ALLOC
 
-    uint32_t s;
+// Free the DAQ table memory
+static void XcpFreeDaqMem(void) {
+    free(gXcpDaqMem);
+    gXcpDaqMem = NULL;
+    gXcpDaqMemSize = 0;
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+    free(gXcpDaqDispatchMem);
+    gXcpDaqDispatchMem = NULL;
+#endif
+}
 
-#ifdef XCP_ENABLE_DAQ_ADDREXT
-#define ODT_ENTRY_SIZE 6
+// Allocate size bytes of DAQ table memory plus the memory for the tables computed on DAQ list start and the running DAQ list arrays of the DAQ dispatch tables
+// The DAQ tables must be cleared with XcpClearDaq after that
+static bool XcpAllocDaqMem(uint32_t size) {
+
+    size = (size + 7) & ~7u;
+    if (gXcpDaqMem != NULL && gXcpDaqMemSize == size) {
+        return true;
+    }
+    XcpFreeDaqMem();
+    gXcpDaqMem = (uint64_t *)malloc(XCP_DAQ_MEM_TOTAL_SIZE(size));
+    if (gXcpDaqMem == NULL) {
+        DBG_PRINTF_ERROR("Failed to allocate %u bytes of DAQ memory\n", (uint32_t)XCP_DAQ_MEM_TOTAL_SIZE(size));
+        return false;
+    }
+    gXcpDaqMemSize = size;
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+    gXcpDaqDispatchMem = (uint16_t *)malloc(2 * DaqMemMaxDaqCount * sizeof(uint16_t));
+    if (gXcpDaqDispatchMem == NULL) {
+        DBG_PRINT_ERROR("Failed to allocate DAQ dispatch tables\n");
+        XcpFreeDaqMem();
+        return false;
+    }
+#endif
+    DBG_PRINTF4("Allocated %u bytes of DAQ memory, %u bytes for DAQ tables\n", (uint32_t)XCP_DAQ_MEM_TOTAL_SIZE(size), size);
+    return true;
+}
+
+#endif // XCP_ENABLE_DAQ_MEM_ALLOC
+
+// Change the size of the DAQ table memory
+bool XcpSetDaqMemSize(uint32_t size) {
+
+    if (!isActivated()) {
+        return false;
+    }
+#ifdef XCP_ENABLE_DAQ_MEM_ALLOC
+    if (isConnected() || isDaqRunning()) {
+        DBG_PRINT_ERROR("XcpSetDaqMemSize: DAQ memory can not be changed while connected or DAQ is running\n");
+        return false;
+    }
+    if (size < 8 || size > 0x7FFFFFF8 / 3) { // The total size with the tables computed on DAQ list start fits 32 bit
+        DBG_PRINTF_ERROR("XcpSetDaqMemSize: invalid size %u\n", size);
+        return false;
+    }
+    bool ok = XcpAllocDaqMem(size);
+    if (!ok) {
+        (void)XcpAllocDaqMem(XCP_DAQ_MEM_SIZE); // Fall back to the default size
+    }
+    XcpClearDaq();
+    DBG_PRINTF3("DAQ memory size %u, max %u DAQ lists\n", DaqMemSize, DaqMemMaxDaqCount);
+    return ok;
 #else
-#define ODT_ENTRY_SIZE 5
+    (void)size;
+    DBG_PRINT_ERROR("XcpSetDaqMemSize: DAQ memory has the fixed size XCP_DAQ_MEM_SIZE in SHM mode\n");
+    return false;
 #endif
+}
+
+// Size of the DAQ list, ODT and ODT entry arrays in the DAQ memory
+static uint32_t XcpGetDaqTableSize(void) {
+    return (shared.daq_lists.daq_count * (uint32_t)sizeof(tXcpDaqList)) + (shared.daq_lists.odt_count * (uint32_t)sizeof(tXcpOdt)) +
+           (shared.daq_lists.odt_entry_count * ODT_ENTRY_SIZE);
+}
+
+// DTO size table, 8 byte aligned after the ODT entry tables in the DAQ memory
+// One DTO size per ODT including ODT header and timestamp, computed on DAQ list start
+static uint32_t XcpGetOdtDtoSizeTableOffset(void) { return (XcpGetDaqTableSize() + 7) & ~7u; }
+#define DaqListOdtDtoSizeTable ((const uint16_t *)(DaqMem + XcpGetOdtDtoSizeTableOffset()))
+#define DaqListOdtDtoSizeTableMut ((uint16_t *)(DaqMemMut + XcpGetOdtDtoSizeTableOffset()))
+
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+// ODT copy plan table, 8 byte aligned after the DTO size table in the DAQ memory
+// Copy plan entries of an ODT start at the index of its first ODT entry, there are never more copy plan entries than ODT entries
+static uint32_t XcpGetOdtCopyTableOffset(void) {
+    uint32_t s = XcpGetOdtDtoSizeTableOffset() + shared.daq_lists.odt_count * (uint32_t)sizeof(uint16_t);
+    return (s + 7) & ~7u;
+}
+#define DaqListOdtCopyTable ((const tXcpOdtCopy *)(DaqMem + XcpGetOdtCopyTableOffset()))
+#define DaqListOdtCopyTableMut ((tXcpOdtCopy *)(DaqMemMut + XcpGetOdtCopyTableOffset()))
+#endif
+
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+// Shadow table, 8 byte aligned after the copy plan table in the DAQ memory
+// One offset per DAQ list to its shadow block (tXcpDaqShadow followed by the payload), 0 = no shadow, the DAQ list is always sent
+static uint32_t XcpGetDaqShadowTableOffset(void) {
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+    uint32_t s = XcpGetOdtCopyTableOffset() + shared.daq_lists.odt_entry_count * (uint32_t)sizeof(tXcpOdtCopy);
+#else
+    uint32_t s = XcpGetOdtDtoSizeTableOffset() + shared.daq_lists.odt_count * (uint32_t)sizeof(uint16_t);
+#endif
+    return (s + 7) & ~7u;
+}
+#define DaqListShadowTable ((const uint32_t *)(DaqMem + XcpGetDaqShadowTableOffset()))
+#define DaqListShadowTableMut ((uint32_t *)(DaqMemMut + XcpGetDaqShadowTableOffset()))
+#define DaqListShadowMut(daq) ((tXcpDaqShadow *)(DaqMemMut + DaqListShadowTable[daq]))
+#endif
+
+// Check if there is sufficient memory for the values of DaqCount, OdtCount and OdtEntryCount
+// Return CRC_MEMORY_OVERFLOW if not
+static uint8_t XcpCheckMemory(void) {
 
     /* Check memory overflow */
-    s = (shared.daq_lists.daq_count * (uint32_t)sizeof(tXcpDaqList)) + (shared.daq_lists.odt_count * (uint32_t)sizeof(tXcpOdt)) +
-        (shared.daq_lists.odt_entry_count * ODT_ENTRY_SIZE);
-    if (s >= XCP_DAQ_MEM_SIZE) {
-        DBG_PRINTF_ERROR("DAQ memory overflow, %u of %u Bytes required\n", s, XCP_DAQ_MEM_SIZE);
+    uint32_t s = XcpGetDaqTableSize();
+    if (s >= DaqMemSize) {
+        DBG_PRINTF_ERROR("DAQ memory overflow, %u of %u Bytes required\n", s, DaqMemSize);
         return CRC_MEMORY_OVERFLOW;
     }
 
+    /* The tables computed on DAQ list start always fit into the additional memory */
+#if defined(XCP_ENABLE_DAQ_SEND_ON_CHANGE)
+    assert(XcpGetDaqShadowTableOffset() + shared.daq_lists.daq_count * (uint32_t)sizeof(uint32_t) <= DaqMemTotalSize);
+#elif defined(XCP_ENABLE_DAQ_COPY_PLAN)
+    assert(XcpGetOdtCopyTableOffset() + shared.daq_lists.odt_entry_count * (uint32_t)sizeof(tXcpOdtCopy) <= DaqMemTotalSize);
+#else
+    assert(XcpGetOdtDtoSizeTableOffset() + shared.daq_lists.odt_count * (uint32_t)sizeof(uint16_t) <= DaqMemTotalSize);
+#endif
+
     static_assert(sizeof(tXcpDaqList) == 12, "Invalid tXcpDaqList size"); // Check size
     static_assert(sizeof(tXcpOdt) == 8, "Invalid tXcpOdt size");          // Check size
     assert(((uint64_t)&shared.daq_lists % 4) == 0);                       // Check alignment
@@ -999,7 +1288,7 @@ static uint8_t XcpCheckMemory(void) {
     assert(((uint64_t)&DaqListOdtEntryAddrTable[0] % 4) == 0);            // Check alignment
     assert(((uint64_t)&DaqListOdtEntrySizeTable[0] % 4) == 0);            // Check alignment
 
-    DBG_PRINTF6("[XcpCheckMemory] %u of %u Bytes used\n", s, XCP_DAQ_MEM_SIZE);
+    DBG_PRINTF6("[XcpCheckMemory] %u of %u Bytes used\n", s, DaqMemSize);
     return 0;
 }
 
@@ -1040,19 +1329,14 @@ static uint8_t XcpAllocOdt(uint16_t daq, uint8_t odtCount) {
     if (daq >= shared.daq_lists.daq_count)
         return CRC_DAQ_CONFIG;
 
-#ifdef XCP_ENABLE_OVERRUN_INDICATION_PID
-    if (odtCount == 0 || odtCount >= 0x7C)
-        return CRC_OUT_OF_RANGE; // MSB of ODT number is reserved for overflow indication, 0xFC-0xFF for response, error, event and service
-#else
-    if (odtCount == 0 || odtCount >= 0xFC)
-        return CRC_OUT_OF_RANGE; // 0xFC-0xFF for response, error, event and service
-#endif
+    if (odtCount >= ODT_MAX_COUNT)
+        return CRC_OUT_OF_RANGE;
     n = (uint32_t)shared.daq_lists.odt_count + (uint32_t)odtCount;
     if (n > 0xFFFF)
         return CRC_OUT_OF_RANGE; // Overall number of ODTs limited to 64K
-    shared_mut.daq_lists.u.daq_list[daq].first_odt = shared.daq_lists.odt_count;
+    DaqListTableMut[daq].first_odt = shared.daq_lists.odt_count;
     shared_mut.daq_lists.odt_count = (uint16_t)n;
-    shared_mut.daq_lists.u.daq_list[daq].last_odt = (uint16_t)(shared.daq_lists.odt_count - 1);
+    DaqListTableMut[daq].last_odt = (uint16_t)(shared.daq_lists.odt_count - 1);
     return XcpCheckMemory();
 }
 
@@ -1094,7 +1378,7 @@ static uint8_t XcpAllocOdtEntry(uint16_t daq, uint8_t odt, uint8_t odtEntryCount
     if (n > 0xFFFF)
         return CRC_MEMORY_OVERFLOW;
 
-    xcpFirstOdt = shared.daq_lists.u.daq_list[daq].first_odt;
+    xcpFirstOdt = DaqListTable[daq].first_odt;
     DaqListOdtTableMut[xcpFirstOdt + odt].first_odt_entry = shared.daq_lists.odt_entry_count;
     shared_mut.daq_lists.odt_entry_count = (uint16_t)n;
     DaqListOdtTableMut[xcpFirstOdt + odt].last_odt_entry = (uint16_t)(shared.daq_lists.odt_entry_count - 1);
@@ -1251,6 +1535,13 @@ static uint8_t XcpSetDaqListMode(uint16_t daq, uint16_t event_id, uint8_t mode,
 #endif
 #endif
 
+#if defined(XCP_ENABLE_DAQ_SEND_ON_CHANGE) && defined(XCP_ENABLE_DAQ_EVENT_LIST)
+    // Events configured with XcpSetEventSendOnChange make their DAQ lists send on change
+    if ((event->flags & XCP_DAQ_EVENT_FLAG_SEND_ON_CHANGE) != 0) {
+        mode |= DAQ_MODE_SEND_ON_CHANGE;
+    }
+#endif
+
     DaqListEventChannelMut(daq) = event_id;
     DaqListModeMut(daq) = mode;
     DaqListPriorityMut(daq) = prio;
@@ -1261,8 +1552,8 @@ static uint8_t XcpSetDaqListMode(uint16_t daq, uint16_t event_id, uint8_t mode,
     uint16_t *daq0_next = &DaqListFirstMut(event_id);
     while (daq0 != XCP_UNDEFINED_DAQ_LIST) {
         assert(daq0 < shared.daq_lists.daq_count);
-        daq0 = DaqListNext(daq0);
         daq0_next = &DaqListNextMut(daq0);
+        daq0 = DaqListNext(daq0);
     }
     *daq0_next = daq;
 #endif
@@ -1329,108 +1620,938 @@ bool XcpCheckDaqLists(uint8_t daq_state, tXcpEventId event_id) {
     return true;
 }
 
-// Start DAQ
-static void XcpStartDaq(void) {
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+
+// Get the reader slot of the calling event processing thread, assigned on its first event
+// Slots are shared, if there are more threads than slots or after the XCP singleton has been reinitialized
+static atomic_uint_least32_t *XcpGetDaqDispatchReaderSlot(void) {
+    static THREAD_LOCAL uint32_t slot = 0; // Slot index + 1, 0 = not assigned yet
+    if (slot == 0) {
+        slot = (uint32_t)atomic_fetch_add_explicit(&shared_mut_safe.daq_dispatch_reader_ticket, 1, memory_order_relaxed) % XCP_DAQ_DISPATCH_READER_SLOTS + 1;
+    }
+    return &shared_mut_safe.daq_dispatch_reader[slot - 1].readers;
+}
+
+// Get the number of event processing threads reading DAQ dispatch table index t
+// A thread counts itself as reader of the active table and checks it is still active after that, both sequentially consistent
+// After a table has been deactivated, this count includes all threads, which entered it while it was active
+static uint32_t XcpGetDaqDispatchReaderCount(uint8_t t) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < XCP_DAQ_DISPATCH_READER_SLOTS; i++) {
+        n += DaqDispatchReaderCount(atomic_load_explicit(&shared.daq_dispatch_reader[i].readers, memory_order_seq_cst), t);
+    }
+    return n;
+}
+
+// Get a DAQ dispatch table without readers to rebuild, 1 or 2, 0 = none
+// Prefer the inactive table, event processing continues on the active table then
+// Otherwise deactivate the active table and wait until one of both tables has no readers, event processing walks the DAQ list chains meanwhile
+// The wait is limited in case a reader never leaves (terminated application in SHM mode), a table with such a reader is never rebuilt again
+static uint8_t XcpGetDaqDispatchTable(void) {
+
+    uint8_t active = (uint8_t)atomic_load_explicit(&shared.daq_dispatch_active, memory_order_relaxed);
+    uint8_t next = (active == 1) ? 2 : 1;
+    if (XcpGetDaqDispatchReaderCount(next - 1) == 0)
+        return next;
+
+    XcpSetDaqDispatchActive(0);
+    for (uint32_t timeout = 0; timeout < XCP_DAQ_DISPATCH_WAIT_MS * 10; timeout++) {
+        if (XcpGetDaqDispatchReaderCount(0) == 0)
+            return 1;
+        if (XcpGetDaqDispatchReaderCount(1) == 0)
+            return 2;
+        sleepUs(100);
+    }
+    DBG_PRINTF_ERROR("DAQ dispatch tables not available, %u and %u readers\n", XcpGetDaqDispatchReaderCount(0), XcpGetDaqDispatchReaderCount(1));
+    return 0;
+}
+
+// Build the DAQ dispatch table from the running DAQ lists and activate it
+// The inactive table is rebuilt, event processing continues on the active table until it is swapped
+// A table is never rebuilt while it has readers, see XcpGetDaqDispatchTable
+static void XcpUpdateDaqDispatch(void) {
+
+    uint8_t next = XcpGetDaqDispatchTable();
+    if (next == 0)
+        return;
+
+    tXcpDaqDispatch *dispatch = &shared_mut.daq_dispatch[next - 1];
+    uint16_t *dispatch_daq = DaqDispatchDaqTableMut(next - 1);
+
+    uint16_t n = 0;
+#ifdef XCP_ENABLE_DAQ_EVENT_LIST
+    uint16_t event_count = getEventCount();
+#else
+    uint16_t event_count = XCP_MAX_EVENT_COUNT;
+#endif
+    for (uint16_t event = 0; event < XCP_MAX_EVENT_COUNT; event++) {
+        dispatch->event_first[event] = n;
+        if (event >= event_count)
+            continue;
+        for (uint16_t daq = DaqListFirst(event); daq != XCP_UNDEFINED_DAQ_LIST; daq = DaqListNext(daq)) {
+            if ((DaqListState(daq) & DAQ_STATE_RUNNING) != 0) {
+                assert(n < DaqMemMaxDaqCount);
+                dispatch_daq[n++] = daq;
+            }
+        }
+    }
+    dispatch->event_first[XCP_MAX_EVENT_COUNT] = n;
+
+    XcpSetDaqDispatchActive(next);
+    DBG_PRINTF4("DAQ dispatch table %u active, %u running DAQ lists\n", next, n);
+}
+
+#endif
+
+// Start DAQ
+static void XcpStartDaq(void) {
+
+    // If not already running
+    if (isDaqRunning())
+        return;
+
+    local_mut.daq_start_clock = ApplXcpGetClock64();
+    shared_mut.daq_overflow_count = 0;
+
+#ifdef XCP_ENABLE_DAQ_EVENT_LIST
+    // Reset the per event loss counters and budget windows
+    for (uint16_t e = 0; e < getEventCount(); e++) {
+        atomic_store_explicit(&shared_mut.event_list.event[e].daq_lost, 0, memory_order_relaxed);
+#ifdef XCP_ENABLE_DAQ_EVENT_BUDGET
+        atomic_store_explicit(&shared_mut.event_list.event[e].daq_budget_used, 0, memory_order_relaxed);
+        atomic_store_explicit(&shared_mut.event_list.event[e].daq_budget_window, local.daq_start_clock, memory_order_relaxed);
+#endif
+    }
+#endif
+
+#ifdef DBG_LEVEL
+    if (DBG_LEVEL >= 4) {
+        char ts[64];
+        clockGetString(ts, sizeof(ts), local.daq_start_clock);
+        DBG_PRINTF3("DAQ processing start at t=%s\n", ts);
+    }
+#endif
+
+    // XcpStartDaq might be called multiple times, if DAQ lists are started individually
+    // CANape never does this
+    ApplXcpStartDaq();
+
+    shared_mut.session_status |= SS_DAQ; // Start processing DAQ events
+    atomic_store_explicit(&shared_mut_safe.daq_running, true, memory_order_release);
+}
+
+// Stop DAQ
+static void XcpStopDaq(void) {
+
+    shared_mut.session_status &= (uint16_t)(~(SS_DAQ | SS_RESUME)); // Stop processing DAQ events
+    atomic_store_explicit(&shared_mut_safe.daq_running, false, memory_order_release);
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+    XcpSetDaqDispatchActive(0);
+#endif
+
+    // Reset all DAQ list states
+    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
+        DaqListStateMut(daq) = DAQ_STATE_STOPPED_UNSELECTED;
+    }
+    XcpUpdateEventMask();
+
+    ApplXcpStopDaq();
+
+#if defined(XCP_ENABLE_DAQ_EVENT_LIST) && defined(OPTION_ENABLE_DBG_PRINTS)
+    // Report the events which lost DAQ samples
+    for (uint16_t e = 0; e < getEventCount(); e++) {
+        uint32_t lost = (uint32_t)atomic_load_explicit(&shared.event_list.event[e].daq_lost, memory_order_relaxed);
+        if (lost > 0) {
+            DBG_PRINTF_WARNING("Event %u '%s' lost %u DAQ samples\n", e, XcpGetEventName(e), lost);
+        }
+    }
+#endif
+
+    DBG_PRINT3("DAQ processing stop\n");
+}
+
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+
+// Compile the copy plan for all ODTs of a DAQ list
+// Adjacent ODT entries with the same address extension are merged into a single copy plan entry
+// Overlapping ODT entries are not merged, each ODT entry has its own space in the DTO
+// The DAQ memory for the copy plan of all ODT entries is allocated in addition to the DAQ memory size, see XCP_DAQ_MEM_DERIVED_SIZE
+static void XcpCompileDaqList(uint16_t daq) {
+
+    assert(XcpGetOdtCopyTableOffset() + shared.daq_lists.odt_entry_count * (uint32_t)sizeof(tXcpOdtCopy) <= DaqMemTotalSize);
+
+    uint32_t entry_count = 0;
+    uint32_t copy_count = 0;
+    for (uint16_t i = DaqListFirstOdt(daq); i <= DaqListLastOdt(daq); i++) {
+        tXcpOdtCopy *c = &DaqListOdtCopyTableMut[DaqListOdtTable[i].first_odt_entry];
+        uint16_t n = 0;
+        for (uint16_t e = DaqListOdtTable[i].first_odt_entry; e <= DaqListOdtTable[i].last_odt_entry; e++) {
+            uint32_t addr = DaqListOdtEntryAddrTable[e];
+            uint8_t size = DaqListOdtEntrySizeTable[e];
+#ifdef XCP_ENABLE_DAQ_ADDREXT
+            uint8_t ext = DaqListOdtEntryAddrExtTable[e];
+#else
+            uint8_t ext = DaqListAddrExt(daq);
+#endif
+            if (n > 0 && c[n - 1].addr_ext == ext && c[n - 1].addr + c[n - 1].size == addr) {
+                c[n - 1].size = (uint16_t)(c[n - 1].size + size); // Adjacent to the previous ODT entry
+            } else {
+                c[n].addr = addr;
+                c[n].size = size;
+                c[n].addr_ext = ext;
+                c[n].res = 0;
+                n++;
+            }
+        }
+        DaqListOdtTableMut[i].copy_count = n;
+        entry_count += DaqListOdtEntryCount(i);
+        copy_count += n;
+    }
+    DBG_PRINTF4("DAQ %u: %u ODT entries compiled to %u copies\n", daq, entry_count, copy_count);
+}
+
+#endif // XCP_ENABLE_DAQ_COPY_PLAN
+
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+
+// Payload size of all ODTs of a DAQ list
+static uint32_t XcpGetDaqListPayloadSize(uint16_t daq) {
+    uint32_t size = 0;
+    for (uint16_t i = DaqListFirstOdt(daq); i <= DaqListLastOdt(daq); i++) {
+        size += DaqListOdtTable[i].size;
+    }
+    return size;
+}
+
+// Offset of the shadow block of a DAQ list in the DAQ memory
+// Shadow blocks are located after the shadow table in the order of the DAQ lists, so the location does not depend on the order in which DAQ lists are started
+static uint32_t XcpGetDaqShadowOffset(uint16_t daq) {
+    uint32_t end = XcpGetDaqShadowTableOffset() + ((shared.daq_lists.daq_count * (uint32_t)sizeof(uint32_t) + 7) & ~7u);
+    for (uint16_t daq0 = 0; daq0 < daq; daq0++) {
+        if ((DaqListMode(daq0) & DAQ_MODE_SEND_ON_CHANGE) != 0) {
+            end += (uint32_t)sizeof(tXcpDaqShadow) + ((XcpGetDaqListPayloadSize(daq0) + 7) & ~7u);
+        }
+    }
+    return end;
+}
+
+// Check if there is sufficient memory for the shadow blocks of all send on change DAQ lists
+// Return CRC_MEMORY_OVERFLOW if not
+static uint8_t XcpCheckDaqShadowMemory(void) {
+    uint32_t s = XcpGetDaqShadowOffset(shared.daq_lists.daq_count);
+    if (s > DaqMemTotalSize) {
+        DBG_PRINTF_ERROR("DAQ memory overflow, %u of %u Bytes required for the send on change shadow copies\n", s, DaqMemTotalSize);
+        return CRC_MEMORY_OVERFLOW;
+    }
+    return 0;
+}
+
+// Allocate the shadow block of a send on change DAQ list
+// The memory for the shadow table is allocated in addition to the DAQ memory size, the memory for the shadow blocks is checked with XcpCheckDaqShadowMemory before DAQ start
+static void XcpInitDaqShadow(uint16_t daq) {
+
+    DaqListShadowTableMut[daq] = 0;
+    if ((DaqListMode(daq) & DAQ_MODE_SEND_ON_CHANGE) == 0)
+        return;
+
+    uint32_t end = XcpGetDaqShadowOffset(daq);
+    uint32_t size = XcpGetDaqListPayloadSize(daq);
+    if (end + sizeof(tXcpDaqShadow) + size > DaqMemTotalSize) {
+        DBG_PRINTF_ERROR("DAQ %u: not enough DAQ memory for the send on change shadow, %u bytes required, the DAQ list is always sent\n", daq,
+                         (uint32_t)sizeof(tXcpDaqShadow) + size);
+        return;
+    }
+    DaqListShadowTableMut[daq] = end;
+    tXcpDaqShadow *shadow = DaqListShadowMut(daq);
+    shadow->clock = 0;
+    shadow->size = size;
+    shadow->valid = 0; // The first sample is always sent
+    atomic_store_explicit(&shadow->busy, 0, memory_order_relaxed);
+    DBG_PRINTF4("DAQ %u: send on change, %u bytes shadow\n", daq, size);
+}
+
+// Compare the source data of an ODT entry or copy plan entry with the shadow copy
+// Most ODT entries are scalar signals, compare them with a single load instead of a memcmp call, larger blocks use memcmp
+static inline bool XcpDaqDataChanged(const uint8_t *src, const uint8_t *shadow, uint32_t n) {
+    switch (n) {
+    case 1:
+        return *src != *shadow;
+    case 2: {
+        uint16_t a, b;
+        memcpy(&a, src, 2);
+        memcpy(&b, shadow, 2);
+        return a != b;
+    }
+    case 4: {
+        uint32_t a, b;
+        memcpy(&a, src, 4);
+        memcpy(&b, shadow, 4);
+        return a != b;
+    }
+    case 8: {
+        uint64_t a, b;
+        memcpy(&a, src, 8);
+        memcpy(&b, shadow, 8);
+        return a != b;
+    }
+    default:
+        return memcmp(src, shadow, n) != 0;
+    }
+}
+
+// Check if the data of a DAQ list changed since the last sent sample
+// Compares the source data of all copy plan entries or ODT entries with the payload in the shadow block, stops at the first difference
+#ifdef XCP_ENABLE_DAQ_ADDREXT
+static bool XcpDaqListChanged(uint16_t daq, int count, const uint8_t **bases, const uint8_t *shadow) {
+#else
+static bool XcpDaqListChanged(uint16_t daq, const uint8_t *base, const uint8_t *shadow) {
+#endif
+    for (uint16_t odt = DaqListFirstOdt(daq); odt <= DaqListLastOdt(daq); odt++) {
+
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+        if (DaqListOdtTable[odt].copy_count > 0) {
+            const tXcpOdtCopy *c = &DaqListOdtCopyTable[DaqListOdtTable[odt].first_odt_entry];
+            const tXcpOdtCopy *cl = c + DaqListOdtTable[odt].copy_count;
+            for (; c < cl; c++) {
+#ifdef XCP_ENABLE_DAQ_ADDREXT
+#ifdef XCP_ENABLE_TEST_CHECKS
+                assert(c->addr_ext < count && bases[c->addr_ext] != NULL);
+#endif
+                const uint8_t *src = (const uint8_t *)&bases[c->addr_ext][c->addr];
+#else
+                const uint8_t *src = (const uint8_t *)&base[c->addr];
+#endif
+                if (XcpDaqDataChanged(src, shadow, c->size))
+                    return true;
+                shadow += c->size;
+            }
+            continue;
+        }
+#endif
+
+        for (uint32_t e = DaqListOdtTable[odt].first_odt_entry; e <= DaqListOdtTable[odt].last_odt_entry; e++) {
+            uint8_t n = DaqListOdtEntrySizeTable[e];
+#ifdef XCP_ENABLE_DAQ_ADDREXT
+#ifdef XCP_ENABLE_TEST_CHECKS
+            assert(DaqListOdtEntryAddrExtTable[e] < count && bases[DaqListOdtEntryAddrExtTable[e]] != NULL);
+#else
+            (void)count;
+#endif
+            const uint8_t *src = (const uint8_t *)&bases[DaqListOdtEntryAddrExtTable[e]][DaqListOdtEntryAddrTable[e]];
+#else
+            const uint8_t *src = (const uint8_t *)&base[DaqListOdtEntryAddrTable[e]];
+#endif
+            if (XcpDaqDataChanged(src, shadow, n))
+                return true;
+            shadow += n;
+        }
+    }
+    return false;
+}
+
+#endif // XCP_ENABLE_DAQ_SEND_ON_CHANGE
+
+// Start DAQ list
+// Do not start DAQ event processing yet
+static void XcpStartDaqList(uint16_t daq) {
+
+    // DTO sizes of all ODTs for the transmit queue, the first ODT has the timestamp
+    uint16_t hs = ODT_HEADER_SIZE + ODT_TIMESTAMP_SIZE;
+    for (uint16_t i = DaqListFirstOdt(daq); i <= DaqListLastOdt(daq); hs = ODT_HEADER_SIZE, i++) {
+        DaqListOdtDtoSizeTableMut[i] = (uint16_t)(DaqListOdtTable[i].size + hs);
+    }
+
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+    XcpCompileDaqList(daq);
+#endif
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+    XcpInitDaqShadow(daq);
+#endif
+
+    DaqListStateMut(daq) |= DAQ_STATE_RUNNING;
+
+#ifdef DBG_LEVEL
+    if (DBG_LEVEL >= 4) {
+        XcpPrintDaqList(daq);
+    }
+#endif
+}
+
+// Start all selected DAQ lists
+// Do not start DAQ event processing yet
+static void XcpStartSelectedDaqLists(void) {
+
+    // Start all selected DAQ lists, reset the selected state
+    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
+        if ((DaqListState(daq) & DAQ_STATE_SELECTED) != 0) {
+            DaqListStateMut(daq) &= (uint8_t)(~DAQ_STATE_SELECTED);
+            XcpStartDaqList(daq);
+        }
+    }
+
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+    XcpUpdateDaqDispatch();
+#endif
+    XcpUpdateEventMask();
+}
+
+// Stop individual DAQ list
+// If all DAQ lists are stopped, stop event processing
+static void XcpStopDaqList(uint16_t daq) {
+
+    DaqListStateMut(daq) &= (uint8_t)(~(DAQ_STATE_OVERRUN | DAQ_STATE_RUNNING));
+
+    /* Check if all DAQ lists are stopped */
+    for (uint16_t d = 0; d < shared.daq_lists.daq_count; d++) {
+        if ((DaqListState(d) & DAQ_STATE_RUNNING) != 0) {
+            return; // Not all DAQ lists stopped yet
+        }
+    }
+
+    // All DAQ lists are stopped, stop DAQ event processing
+    XcpStopDaq();
+}
+
+// Stop all selected DAQ lists
+// If all DAQ lists are stopped, stop event processing
+static void XcpStopSelectedDaqLists(void) {
+
+    // Stop all selected DAQ lists, reset the selected state
+    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
+        if ((DaqListState(daq) & DAQ_STATE_SELECTED) != 0) {
+            XcpStopDaqList(daq);
+            DaqListStateMut(daq) = DAQ_STATE_STOPPED_UNSELECTED;
+        }
+    }
+
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+    if (isDaqRunning()) {
+        XcpUpdateDaqDispatch();
+    }
+#endif
+    XcpUpdateEventMask();
+}
+
+/****************************************************************************/
+/* DAQ setup files                                                          */
+/****************************************************************************/
+
+#if defined(XCP_ENABLE_DAQ_LOGGER) || defined(XCP_ENABLE_DAQ_RESUME)
+
+// Write the DAQ tables at the current position of a file
+// The DAQ list states are saved as well, XcpReadDaqConfig selects the DAQ lists which were running or selected
+bool XcpWriteDaqConfig(FILE *file) {
+
+    uint16_t count = 0;
+    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
+        if ((DaqListState(daq) & (DAQ_STATE_SELECTED | DAQ_STATE_RUNNING)) != 0)
+            count++;
+    }
+    if (count == 0) {
+        DBG_PRINT_WARNING("No running or selected DAQ lists to save\n");
+        return false;
+    }
+
+    tXcpDaqConfigFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "XCPDAQ1", 8);
+    strncpy(header.epk, XcpGetEpk(), XCP_EPK_MAX_LENGTH);
+    header.daq_count = shared.daq_lists.daq_count;
+    header.odt_count = shared.daq_lists.odt_count;
+    header.odt_entry_count = shared.daq_lists.odt_entry_count;
+#ifdef XCP_ENABLE_DAQ_RESUME
+    header.config_id = shared.daq_lists.config_id;
+#endif
+    header.daq_table_size = XcpGetDaqTableSize();
+    if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(DaqMem, header.daq_table_size, 1, file) != 1) {
+        return false;
+    }
+    DBG_PRINTF4("DAQ setup with %u DAQ lists saved\n", count);
+    return true;
+}
+
+// Read the DAQ tables from the current position of a file and select the DAQ lists which were running or selected
+// Must be called from the thread which started the protocol layer, while no client is connected
+bool XcpReadDaqConfig(FILE *file) {
+
+    if (!isStarted() || isConnected() || isDaqRunning()) {
+        DBG_PRINT_WARNING("DAQ setup can not be loaded, not started, connected or DAQ running\n");
+        return false;
+    }
+
+    tXcpDaqConfigFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, "XCPDAQ1", 8) == 0;
+    if (ok && strncmp(header.epk, XcpGetEpk(), XCP_EPK_MAX_LENGTH) != 0) {
+        DBG_PRINTF_ERROR("DAQ setup does not match EPK %s\n", XcpGetEpk());
+        return false;
+    }
+    if (ok) {
+        XcpClearDaq();
+        shared_mut.daq_lists.daq_count = header.daq_count;
+        shared_mut.daq_lists.odt_count = header.odt_count;
+        shared_mut.daq_lists.odt_entry_count = header.odt_entry_count;
+#ifdef XCP_ENABLE_DAQ_RESUME
+        shared_mut.daq_lists.config_id = header.config_id;
+#endif
+        ok = header.daq_table_size == XcpGetDaqTableSize() && XcpCheckMemory() == 0 && fread(DaqMemMut, header.daq_table_size, 1, file) == 1;
+    }
+
+    // Rebuild the event to DAQ list associations and select the DAQ lists which were running or selected
+    if (ok) {
+        for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
+            bool selected = (DaqListState(daq) & (DAQ_STATE_SELECTED | DAQ_STATE_RUNNING)) != 0 && DaqListEventChannel(daq) != XCP_UNDEFINED_EVENT_ID;
+            DaqListStateMut(daq) = selected ? DAQ_STATE_SELECTED : DAQ_STATE_STOPPED_UNSELECTED;
+#ifdef XCP_MAX_EVENT_COUNT
+            DaqListNextMut(daq) = XCP_UNDEFINED_DAQ_LIST;
+#endif
+        }
+        for (uint16_t daq = 0; ok && daq < shared.daq_lists.daq_count; daq++) {
+            if (DaqListState(daq) == DAQ_STATE_SELECTED) {
+                ok = XcpSetDaqListMode(daq, DaqListEventChannel(daq), DaqListMode(daq), 1, DaqListPriority(daq)) == 0;
+            }
+        }
+        ok = ok && XcpCheckDaqLists(DAQ_STATE_SELECTED, XCP_UNDEFINED_EVENT_ID);
+    }
+    if (!ok) {
+        DBG_PRINT_ERROR("Invalid DAQ setup\n");
+        XcpClearDaq();
+        return false;
+    }
+    return true;
+}
+
+#endif // XCP_ENABLE_DAQ_LOGGER || XCP_ENABLE_DAQ_RESUME
+
+#ifdef XCP_ENABLE_DAQ_LOGGER
+
+// Save the DAQ tables to a file
+bool XcpSaveDaqConfig(const char *filename) {
+
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        DBG_PRINTF_ERROR("Failed to open DAQ setup file %s\n", filename);
+        return false;
+    }
+    bool ok = XcpWriteDaqConfig(file);
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok) {
+        DBG_PRINTF_ERROR("Failed to write DAQ setup file %s\n", filename);
+        return false;
+    }
+    DBG_PRINTF3("DAQ setup saved to %s\n", filename);
+    return true;
+}
+
+// Load the DAQ tables from a file and start DAQ
+// Must be called from the thread which started the protocol layer, while no client is connected
+bool XcpLoadDaqConfig(const char *filename) {
+
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        DBG_PRINTF_ERROR("Failed to open DAQ setup file %s\n", filename);
+        return false;
+    }
+    bool ok = XcpReadDaqConfig(file);
+    fclose(file);
+    if (!ok) {
+        DBG_PRINTF_ERROR("DAQ setup file %s not loaded\n", filename);
+        return false;
+    }
+
+    XcpStartSelectedDaqLists();
+    XcpStartDaq();
+    DBG_PRINTF3("DAQ setup loaded from %s and started\n", filename);
+    return true;
+}
+
+// Stop DAQ and free all DAQ lists
+void XcpFreeDaq(void) {
+    if (isDaqRunning()) {
+        XcpStopDaq();
+    }
+    XcpClearDaq();
+}
+
+uint16_t XcpGetDaqListCount(void) { return shared.daq_lists.daq_count; }
+
+tXcpEventId XcpGetDaqListEvent(uint16_t daq) {
+    if (daq >= shared.daq_lists.daq_count || (DaqListState(daq) & DAQ_STATE_RUNNING) == 0)
+        return XCP_UNDEFINED_EVENT_ID;
+    return DaqListEventChannel(daq);
+}
+
+bool XcpGetOdtEntry(uint16_t daq, uint16_t odt, uint16_t idx, uint8_t *ext, uint32_t *addr, uint8_t *size) {
+    if (daq >= shared.daq_lists.daq_count || odt >= DaqListOdtCount(daq))
+        return false;
+    uint16_t odt0 = (uint16_t)(DaqListFirstOdt(daq) + odt); // Absolute odt index
+    if (idx >= DaqListOdtEntryCount(odt0))
+        return false;
+    uint16_t e = (uint16_t)(DaqListOdtTable[odt0].first_odt_entry + idx);
+#ifdef XCP_ENABLE_DAQ_ADDREXT
+    *ext = DaqListOdtEntryAddrExtTable[e];
+#else
+    *ext = DaqListAddrExt(daq);
+#endif
+    *addr = DaqListOdtEntryAddrTable[e];
+    *size = DaqListOdtEntrySizeTable[e];
+    return true;
+}
+
+#endif // XCP_ENABLE_DAQ_LOGGER
 
-    // If not already running
-    if (isDaqRunning())
-        return;
+/****************************************************************************/
+/* DAQ recorder                                                             */
+/****************************************************************************/
 
-    local_mut.daq_start_clock = ApplXcpGetClock64();
-    shared_mut.daq_overflow_count = 0;
+#ifdef XCP_ENABLE_DAQ_RECORDER
+
+// Recorder ring
+// Records are reserved with an atomic add to the absolute head position, the ring offset of a record is its position modulo XCP_DAQ_RECORDER_SIZE
+// A record which would wrap around the end of the ring is turned into padding at the end and at the start of the ring and reserved again
+// The oldest records are overwritten, a record must be completed before the ring wrapped around once
+// The block index keeps the position of the first record starting in each block of the ring, to find the oldest complete record on trigger
+#define RECORDER_BLOCK_SIZE (64 * 1024)
+#define RECORDER_BLOCK_COUNT (XCP_DAQ_RECORDER_SIZE / RECORDER_BLOCK_SIZE)
+static_assert(XCP_DAQ_RECORDER_SIZE % RECORDER_BLOCK_SIZE == 0, "XCP_DAQ_RECORDER_SIZE must be a multiple of 64 KiB");
+
+// Recorder state, XCP_RECORDER_xxx in bits 0-7 and the number of event processing threads writing a record in bits 8-63
+#define RECORDER_STATE_MASK 0xFFu
+#define RECORDER_WRITER ((uint64_t)1 << 8)
+
+static struct {
+    atomic_uint_fast64_t state;           // XCP_RECORDER_xxx and writer count, see RECORDER_WRITER
+    atomic_uint_fast64_t head;            // Absolute position of the next record
+    MUTEX mutex;                          // Serializes the recorder control functions, event processing does not lock it
+    uint8_t *buffer;                      // Ring memory, XCP_DAQ_RECORDER_SIZE bytes
+    uint64_t first[RECORDER_BLOCK_COUNT]; // Absolute position of the first record starting at or after the start of each block
+    uint64_t pre_trigger;                 // Pre-trigger time in DAQ clock ticks, 0 = whole ring
+    uint64_t trigger_clock;               // DAQ clock of the trigger
+    uint64_t read;                        // Absolute position of the next record to stream or dump
+    uint32_t read_count;                  // Number of records left to stream or dump
+} gXcpRecorder;
+
+#define RecorderRecord(pos) ((tXcpRecord *)&gXcpRecorder.buffer[(pos) % XCP_DAQ_RECORDER_SIZE])
+#define RecorderState() ((uint8_t)(atomic_load_explicit(&gXcpRecorder.state, memory_order_relaxed) & RECORDER_STATE_MASK))
+
+static void XcpRecorderInit(void) {
+    mutexInit(&gXcpRecorder.mutex, false, 0);
+    atomic_store_explicit(&gXcpRecorder.state, XCP_RECORDER_OFF, memory_order_relaxed);
+    atomic_store_explicit(&gXcpRecorder.head, 0, memory_order_relaxed);
+    gXcpRecorder.buffer = NULL;
+}
 
-#ifdef DBG_LEVEL
-    if (DBG_LEVEL >= 4) {
-        char ts[64];
-        clockGetString(ts, sizeof(ts), local.daq_start_clock);
-        DBG_PRINTF3("DAQ processing start at t=%s\n", ts);
+static void XcpRecorderDeinit(void) {
+    XcpRecorderStop();
+    free(gXcpRecorder.buffer);
+    gXcpRecorder.buffer = NULL;
+    mutexDestroy(&gXcpRecorder.mutex);
+}
+
+// Change the recorder state from old_state to new_state, keep the writer count
+// Returns false, if the recorder is not in old_state
+static bool XcpRecorderChangeState(uint8_t old_state, uint8_t new_state) {
+    uint64_t state = atomic_load_explicit(&gXcpRecorder.state, memory_order_relaxed);
+    do {
+        if ((state & RECORDER_STATE_MASK) != old_state)
+            return false;
+    } while (!atomic_compare_exchange_weak_explicit(&gXcpRecorder.state, &state, (state & ~(uint64_t)RECORDER_STATE_MASK) | new_state, memory_order_acq_rel,
+                                                    memory_order_relaxed));
+    return true;
+}
+
+// Wait until all event processing threads completed their records, after the recorder left the armed state
+static void XcpRecorderWaitWriters(void) {
+    while ((atomic_load_explicit(&gXcpRecorder.state, memory_order_acquire) & ~(uint64_t)RECORDER_STATE_MASK) != 0) {
+        sleepUs(10);
     }
-#endif
+}
 
-    // XcpStartDaq might be called multiple times, if DAQ lists are started individually
-    // CANape never does this
-    ApplXcpStartDaq();
+// Clear the ring, must be called with the mutex locked, while the recorder is off
+static void XcpRecorderClear(void) {
+    atomic_store_explicit(&gXcpRecorder.head, 0, memory_order_relaxed);
+    gXcpRecorder.read = 0;
+    gXcpRecorder.read_count = 0;
+}
 
-    shared_mut.session_status |= SS_DAQ; // Start processing DAQ events
-    atomic_store_explicit(&shared_mut_safe.daq_running, true, memory_order_release);
+// Write the header of a record of len bytes at pos and update the block index
+// Padding has odt_count 0, it may be only 8 bytes long and has no clock
+static tXcpRecord *XcpRecorderPut(uint64_t pos, uint32_t len, uint16_t daq, uint16_t odt_count) {
+    // The first record starting at or after the start of a block within this record is the next record
+    for (uint64_t b = (pos + RECORDER_BLOCK_SIZE - 1) / RECORDER_BLOCK_SIZE; b * RECORDER_BLOCK_SIZE < pos + len; b++) {
+        gXcpRecorder.first[b % RECORDER_BLOCK_COUNT] = (b * RECORDER_BLOCK_SIZE == pos) ? pos : pos + len;
+    }
+    tXcpRecord *record = RecorderRecord(pos);
+    record->size = len;
+    record->daq = daq;
+    record->odt_count = odt_count;
+    return record;
 }
 
-// Stop DAQ
-static void XcpStopDaq(void) {
+// Get buffers for all ODTs of a DAQ list sample in the recorder ring
+// Returns NULL, if the recorder is not armed, otherwise the sample must be committed with XcpRecorderCommit
+static tXcpRecord *XcpRecorderAcquire(uint16_t daq, const uint16_t *sizes, uint16_t odt_count, uint64_t clock, tQueueBuffer *queue_buffers) {
 
-    shared_mut.session_status &= (uint16_t)(~SS_DAQ); // Stop processing DAQ events
-    atomic_store_explicit(&shared_mut_safe.daq_running, false, memory_order_release);
+    uint32_t len = (uint32_t)sizeof(tXcpRecord);
+    for (uint16_t i = 0; i < odt_count; i++) {
+        len += (uint32_t)sizeof(uint32_t) + (((uint32_t)sizes[i] + 3) & ~3u);
+    }
+    len = (len + 7) & ~7u;
+    assert(len <= XCP_DAQ_RECORDER_SIZE);
+
+    // Register as writer, while the recorder is armed
+    uint64_t state = atomic_load_explicit(&gXcpRecorder.state, memory_order_relaxed);
+    do {
+        if ((state & RECORDER_STATE_MASK) != XCP_RECORDER_ARMED)
+            return NULL; // Frozen, discard the sample
+    } while (!atomic_compare_exchange_weak_explicit(&gXcpRecorder.state, &state, state + RECORDER_WRITER, memory_order_acquire, memory_order_relaxed));
+
+    // Reserve len bytes at head
+    uint64_t pos;
+    for (;;) {
+        pos = atomic_fetch_add_explicit(&gXcpRecorder.head, len, memory_order_relaxed);
+        uint32_t offset = (uint32_t)(pos % XCP_DAQ_RECORDER_SIZE);
+        if (offset + len <= XCP_DAQ_RECORDER_SIZE)
+            break;
+        // Wrap around, turn the reservation into padding and try again
+        uint32_t n = XCP_DAQ_RECORDER_SIZE - offset;
+        XcpRecorderPut(pos, n, XCP_UNDEFINED_DAQ_LIST, 0);
+        XcpRecorderPut(pos + n, len - n, XCP_UNDEFINED_DAQ_LIST, 0);
+    }
 
-    // Reset all DAQ list states
-    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
-        DaqListStateMut(daq) = DAQ_STATE_STOPPED_UNSELECTED;
+    tXcpRecord *record = XcpRecorderPut(pos, len, daq, odt_count);
+    record->clock = clock;
+    uint8_t *p = (uint8_t *)(record + 1);
+    for (uint16_t i = 0; i < odt_count; i++) {
+        *(uint32_t *)p = sizes[i];
+        queue_buffers[i].buffer = p + sizeof(uint32_t);
+        queue_buffers[i].size = sizes[i];
+        p += sizeof(uint32_t) + (((uint32_t)sizes[i] + 3) & ~3u);
     }
+    return record;
+}
 
-    ApplXcpStopDaq();
+// Commit a DAQ list sample acquired with XcpRecorderAcquire
+static void XcpRecorderCommit(void) { atomic_fetch_sub_explicit(&gXcpRecorder.state, RECORDER_WRITER, memory_order_release); }
 
-    DBG_PRINT3("DAQ processing stop\n");
+// Arm the recorder
+bool XcpRecorderStart(uint32_t pre_trigger_ms) {
+
+    mutexLock(&gXcpRecorder.mutex);
+    if (gXcpRecorder.buffer == NULL) {
+        gXcpRecorder.buffer = (uint8_t *)malloc(XCP_DAQ_RECORDER_SIZE);
+        if (gXcpRecorder.buffer == NULL) {
+            mutexUnlock(&gXcpRecorder.mutex);
+            DBG_PRINT_ERROR("Out of memory for the DAQ recorder\n");
+            return false;
+        }
+    }
+    // Discard a previous recording
+    uint8_t state = RecorderState();
+    if (state != XCP_RECORDER_OFF) {
+        XcpRecorderChangeState(state, XCP_RECORDER_OFF);
+        XcpRecorderWaitWriters();
+    }
+    XcpRecorderClear();
+    gXcpRecorder.pre_trigger = (uint64_t)pre_trigger_ms * (CLOCK_TICKS_PER_S / 1000);
+    gXcpRecorder.trigger_clock = 0;
+    XcpRecorderChangeState(XCP_RECORDER_OFF, XCP_RECORDER_ARMED);
+    mutexUnlock(&gXcpRecorder.mutex);
+
+    DBG_PRINTF3("DAQ recorder armed, %u bytes, pre-trigger %u ms\n", (uint32_t)XCP_DAQ_RECORDER_SIZE, pre_trigger_ms);
+    return true;
 }
 
-// Start DAQ list
-// Do not start DAQ event processing yet
-static void XcpStartDaqList(uint16_t daq) {
+// Freeze the recorder ring and select the pre-trigger samples
+bool XcpRecorderTrigger(void) {
 
-    DaqListStateMut(daq) |= DAQ_STATE_RUNNING;
+    mutexLock(&gXcpRecorder.mutex);
+    if (!XcpRecorderChangeState(XCP_RECORDER_ARMED, XCP_RECORDER_FROZEN)) {
+        mutexUnlock(&gXcpRecorder.mutex);
+        return false;
+    }
+    gXcpRecorder.trigger_clock = ApplXcpGetClock64();
+    XcpRecorderWaitWriters(); // All records reserved before the trigger are complete
+
+    // Start at the first record in the oldest block of the ring, records starting before may be partially overwritten
+    uint64_t head = atomic_load_explicit(&gXcpRecorder.head, memory_order_relaxed);
+    uint64_t pos = 0;
+    if (head > XCP_DAQ_RECORDER_SIZE) {
+        uint64_t b = (head - XCP_DAQ_RECORDER_SIZE + RECORDER_BLOCK_SIZE - 1) / RECORDER_BLOCK_SIZE;
+        pos = gXcpRecorder.first[b % RECORDER_BLOCK_COUNT];
+    }
 
-#ifdef DBG_LEVEL
-    if (DBG_LEVEL >= 4) {
-        XcpPrintDaqList(daq);
+    // Skip the padding and the records older than the pre-trigger time
+    uint64_t start = 0;
+    if (gXcpRecorder.pre_trigger != 0 && gXcpRecorder.trigger_clock > gXcpRecorder.pre_trigger) {
+        start = gXcpRecorder.trigger_clock - gXcpRecorder.pre_trigger;
     }
-#endif
+    uint32_t count = 0;
+    gXcpRecorder.read = head;
+    gXcpRecorder.read_count = 0;
+    for (; pos < head; pos += RecorderRecord(pos)->size) {
+        const tXcpRecord *record = RecorderRecord(pos);
+        if (record->odt_count == 0)
+            continue; // Padding
+        count++;
+        if (gXcpRecorder.read_count == 0) {
+            if (record->clock < start)
+                continue;
+            gXcpRecorder.read = pos;
+        }
+        gXcpRecorder.read_count++;
+    }
+    mutexUnlock(&gXcpRecorder.mutex);
+
+    DBG_PRINTF3("DAQ recorder triggered, %u samples recorded, %u samples pre-trigger, %" PRIu64 " bytes overwritten\n", count, gXcpRecorder.read_count,
+                head > XCP_DAQ_RECORDER_SIZE ? head - XCP_DAQ_RECORDER_SIZE : 0);
+    return true;
 }
 
-// Start all selected DAQ lists
-// Do not start DAQ event processing yet
-static void XcpStartSelectedDaqLists(void) {
+// Start transmitting the pre-trigger samples in XcpBackgroundTasks
+bool XcpRecorderStream(void) {
+    if (!isConnected() || !isDaqRunning())
+        return false;
+    return XcpRecorderChangeState(XCP_RECORDER_FROZEN, XCP_RECORDER_STREAMING);
+}
 
-    // Start all selected DAQ lists, reset the selected state
-    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
-        if ((DaqListState(daq) & DAQ_STATE_SELECTED) != 0) {
-            DaqListStateMut(daq) &= (uint8_t)(~DAQ_STATE_SELECTED);
-            XcpStartDaqList(daq);
+// Transmit the pre-trigger samples as DTOs, until the transmit queue is full
+// The client still has the DAQ configuration of the recorded samples, their timestamps are the timestamps of the acquisition
+static void XcpRecorderStreamTask(void) {
+
+    if (RecorderState() != XCP_RECORDER_STREAMING)
+        return;
+
+    uint16_t sizes[ODT_MAX_COUNT];
+    tQueueBuffer queue_buffers[ODT_MAX_COUNT];
+    mutexLock(&gXcpRecorder.mutex);
+    while (gXcpRecorder.read_count > 0) {
+        const tXcpRecord *record = RecorderRecord(gXcpRecorder.read);
+        if (record->odt_count == 0) {
+            gXcpRecorder.read += record->size; // Padding
+            continue;
         }
+        const uint8_t *p = (const uint8_t *)(record + 1);
+        for (uint16_t i = 0; i < record->odt_count; i++) {
+            sizes[i] = (uint16_t)(*(const uint32_t *)p);
+            p += sizeof(uint32_t) + (((uint32_t)sizes[i] + 3) & ~3u);
+        }
+        if (!queueAcquireMulti(local.queue, sizes, record->odt_count, QUEUE_PRIORITY_NORMAL, queue_buffers))
+            break; // Transmit queue is full, continue later
+        p = (const uint8_t *)(record + 1);
+        for (uint16_t i = 0; i < record->odt_count; i++) {
+            memcpy(queue_buffers[i].buffer, p + sizeof(uint32_t), sizes[i]);
+            p += sizeof(uint32_t) + (((uint32_t)sizes[i] + 3) & ~3u);
+        }
+        queuePushMulti(local.queue, queue_buffers, record->odt_count, false);
+        gXcpRecorder.read += record->size;
+        gXcpRecorder.read_count--;
     }
+    if (gXcpRecorder.read_count == 0) {
+        XcpRecorderChangeState(XCP_RECORDER_STREAMING, XCP_RECORDER_FROZEN);
+        DBG_PRINT3("DAQ recorder streamed\n");
+    }
+    mutexUnlock(&gXcpRecorder.mutex);
 }
 
-// Stop individual DAQ list
-// If all DAQ lists are stopped, stop event processing
-static void XcpStopDaqList(uint16_t daq) {
+// Write the pre-trigger samples to a file
+bool XcpRecorderDump(const char *filename) {
 
-    DaqListStateMut(daq) &= (uint8_t)(~(DAQ_STATE_OVERRUN | DAQ_STATE_RUNNING));
+    if (RecorderState() != XCP_RECORDER_FROZEN)
+        return false;
 
-    /* Check if all DAQ lists are stopped */
-    for (uint16_t d = 0; d < shared.daq_lists.daq_count; d++) {
-        if ((DaqListState(d) & DAQ_STATE_RUNNING) != 0) {
-            return; // Not all DAQ lists stopped yet
-        }
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        DBG_PRINTF_ERROR("Failed to open DAQ recorder file %s\n", filename);
+        return false;
     }
 
-    // All DAQ lists are stopped, stop DAQ event processing
-    XcpStopDaq();
-}
+    mutexLock(&gXcpRecorder.mutex);
+    tXcpRecorderFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "XCPREC1", 8);
+    header.daq_start_clock = local.daq_start_clock;
+    header.trigger_clock = gXcpRecorder.trigger_clock;
+    header.record_count = gXcpRecorder.read_count;
+    header.daq_count = shared.daq_lists.daq_count;
+    header.odt_count = shared.daq_lists.odt_count;
+    header.odt_entry_count = shared.daq_lists.odt_entry_count;
+    header.daq_table_size = XcpGetDaqTableSize();
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (header.daq_table_size > 0) {
+        ok = ok && fwrite(DaqMem, header.daq_table_size, 1, file) == 1;
+    }
+    uint64_t pos = gXcpRecorder.read;
+    for (uint32_t n = 0; ok && n < gXcpRecorder.read_count; pos += RecorderRecord(pos)->size) {
+        if (RecorderRecord(pos)->odt_count == 0)
+            continue; // Padding
+        ok = fwrite(RecorderRecord(pos), RecorderRecord(pos)->size, 1, file) == 1;
+        n++;
+    }
+    mutexUnlock(&gXcpRecorder.mutex);
 
-// Stop all selected DAQ lists
-// If all DAQ lists are stopped, stop event processing
-static void XcpStopSelectedDaqLists(void) {
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok) {
+        DBG_PRINTF_ERROR("Failed to write DAQ recorder file %s\n", filename);
+        return false;
+    }
+    DBG_PRINTF3("DAQ recorder dumped %u samples to %s\n", header.record_count, filename);
+    return true;
+}
 
-    // Stop all selected DAQ lists, reset the selected state
-    for (uint16_t daq = 0; daq < shared.daq_lists.daq_count; daq++) {
-        if ((DaqListState(daq) & DAQ_STATE_SELECTED) != 0) {
-            XcpStopDaqList(daq);
-            DaqListStateMut(daq) = DAQ_STATE_STOPPED_UNSELECTED;
-        }
+// Stop the recorder
+void XcpRecorderStop(void) {
+    if (RecorderState() == XCP_RECORDER_OFF)
+        return;
+    mutexLock(&gXcpRecorder.mutex);
+    uint8_t state = RecorderState();
+    if (state != XCP_RECORDER_OFF) {
+        XcpRecorderChangeState(state, XCP_RECORDER_OFF);
+        XcpRecorderWaitWriters();
+        XcpRecorderClear();
     }
+    mutexUnlock(&gXcpRecorder.mutex);
+    DBG_PRINT3("DAQ recorder stopped\n");
 }
 
+uint8_t XcpRecorderGetState(void) { return RecorderState(); }
+
+#endif // XCP_ENABLE_DAQ_RECORDER
+
 /****************************************************************************/
 /* Data Acquisition Event Processor                                         */
 /****************************************************************************/
 
+// Copy measurement data, with fixed size moves for the common sizes of scalar measurement signals
+static inline void XcpCopyDaqData(uint8_t *dst, const uint8_t *src, uint32_t n) {
+    switch (n) {
+    case 1:
+        *dst = *src;
+        break;
+    case 2:
+        memcpy(dst, src, 2);
+        break;
+    case 4:
+        memcpy(dst, src, 4);
+        break;
+    case 8:
+        memcpy(dst, src, 8);
+        break;
+    default:
+        memcpy(dst, src, n);
+        break;
+    }
+}
+
+// Array of n queue buffers on the stack, sized by the ODT count of the DAQ list
+#ifdef _MSC_VER
+#include <malloc.h> // for _alloca
+#define DaqQueueBuffers(name, n) tQueueBuffer *name = (tQueueBuffer *)_alloca((size_t)(n) * sizeof(tQueueBuffer))
+#else
+#define DaqQueueBuffers(name, n) tQueueBuffer name[n]
+#endif
+
 // Trigger DAQ list
 #ifdef XCP_ENABLE_DAQ_ADDREXT
 static void XcpTriggerDaqList_(tQueueHandle queue_handle, uint16_t daq, int count, const uint8_t **bases, uint64_t clock) {
@@ -1438,31 +2559,105 @@ static void XcpTriggerDaqList_(tQueueHandle queue_handle, uint16_t daq, int coun
 static void XcpTriggerDaqList_(tQueueHandle queue_handle, uint16_t daq, const uint8_t *base, uint64_t clock) {
 #endif
     uint8_t *d0;
-    uint16_t odt, hs;
+    uint16_t odt, hs, i;
+    uint16_t first_odt = DaqListFirstOdt(daq);
+    uint16_t odt_count = (uint16_t)(DaqListLastOdt(daq) - first_odt + 1);
+#ifdef XCP_ENABLE_TEST_CHECKS
+    assert(odt_count > 0 && odt_count <= ODT_MAX_COUNT);
+#endif
+    const uint16_t *sizes = &DaqListOdtDtoSizeTable[first_odt]; // DTO sizes computed on DAQ list start
+    DaqQueueBuffers(queue_buffers, odt_count);
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+    const tXcpOdtCopy *copy_table = DaqListOdtCopyTable;
+#endif
 
-    // Outer loop
-    // Loop over all ODTs of the current DAQ list
-    for (hs = ODT_HEADER_SIZE + ODT_TIMESTAMP_SIZE, odt = DaqListFirstOdt(daq); odt <= DaqListLastOdt(daq); hs = ODT_HEADER_SIZE, odt++) {
+#ifdef XCP_ENABLE_DAQ_EVENT_LIST
+    tXcpEvent *event = &shared_mut.event_list.event[DaqListEventChannel(daq)];
+#endif
+
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+    // Skip the sample of a send on change DAQ list, if its data did not change since the last sent sample and the keep alive time did not expire
+    // Send on change DAQ lists are expected to be triggered from one thread at a time, the busy flag protects the shadow block against concurrent triggers
+    // A sample is always sent, if another thread is accessing the shadow block
+    tXcpDaqShadow *shadow = NULL;
+    if ((DaqListMode(daq) & DAQ_MODE_SEND_ON_CHANGE) != 0 && DaqListShadowTable[daq] != 0) {
+        shadow = DaqListShadowMut(daq);
+        if (atomic_exchange_explicit(&shadow->busy, 1, memory_order_acquire) == 0) {
+            bool changed = true;
+            if (shadow->valid != 0 && clock - shadow->clock < (uint64_t)XCP_DAQ_SEND_ON_CHANGE_KEEP_ALIVE_MS * (CLOCK_TICKS_PER_S / 1000)) {
+#ifdef XCP_ENABLE_DAQ_ADDREXT
+                changed = XcpDaqListChanged(daq, count, bases, (const uint8_t *)(shadow + 1));
+#else
+                changed = XcpDaqListChanged(daq, base, (const uint8_t *)(shadow + 1));
+#endif
+            }
+            atomic_store_explicit(&shadow->busy, 0, memory_order_release);
+            if (!changed)
+                return; // Skip this event, no change
+        }
+    }
+#endif
+
+#ifdef XCP_ENABLE_DAQ_EVENT_BUDGET
+    // Check the byte budget of the event, start a new budget window if the current one is expired
+    // The event may be triggered from multiple threads, only one of them starts the new window, the budget may be exceeded by concurrent samples
+    if (event->daq_budget != 0) {
+        uint32_t len = 0;
+        for (i = 0; i < odt_count; i++) {
+            len += sizes[i];
+        }
+        uint64_t window = atomic_load_explicit(&event->daq_budget_window, memory_order_relaxed);
+        if (clock - window >= (uint64_t)XCP_DAQ_EVENT_BUDGET_WINDOW_MS * (CLOCK_TICKS_PER_S / 1000)) {
+            if (atomic_compare_exchange_strong_explicit(&event->daq_budget_window, &window, clock, memory_order_relaxed, memory_order_relaxed)) {
+                atomic_store_explicit(&event->daq_budget_used, 0, memory_order_relaxed);
+            }
+        }
+        if (atomic_load_explicit(&event->daq_budget_used, memory_order_relaxed) + len > event->daq_budget) {
+            atomic_fetch_add_explicit(&event->daq_lost, 1, memory_order_relaxed);
+            return; // Skip this event, budget exceeded
+        }
+        atomic_fetch_add_explicit(&event->daq_budget_used, len, memory_order_relaxed);
+    }
+#endif
+
+    // Get DTO buffers for all ODTs of the current DAQ list with one queue operation
+    // Either all ODTs of this event are transmitted or none of them
+    // Get the DTO buffers in the recorder ring instead of the transmit queue, if the recorder is on
+#ifdef XCP_ENABLE_DAQ_RECORDER
+    bool recording = RecorderState() != XCP_RECORDER_OFF;
+    if (recording && XcpRecorderAcquire(daq, sizes, odt_count, clock, queue_buffers) == NULL)
+        return; // Recorder frozen, discard the sample
+#else
+    const bool recording = false;
+#endif
 
-        // Get DTO buffer
-        tQueueBuffer queue_buffer = queueAcquire(queue_handle, DaqListOdtTable[odt].size + hs);
-        d0 = queue_buffer.buffer;
+    // Priority of the DAQ list from SET_DAQ_LIST_MODE, the transmit queue may reserve headroom for priority DAQ lists
+    if (!recording && !queueAcquireMulti(queue_handle, sizes, odt_count, DaqListPriority(daq), queue_buffers)) {
 
         // DAQ queue overflow
-        if (d0 == NULL) {
+#ifdef XCP_ENABLE_DAQ_EVENT_LIST
+        atomic_fetch_add_explicit(&event->daq_lost, 1, memory_order_relaxed);
+#endif
 #ifdef XCP_ENABLE_OVERRUN_INDICATION_PID
-            shared_mut.daq_overflow_count++;
-            DaqListState(daq) |= DAQ_STATE_OVERRUN;
-            DBG_PRINTF4("DAQ queue overrun, daq=%u, odt=%u, overruns=%u\n", daq, odt, shared.daq_overflow_count);
+        shared_mut.daq_overflow_count++;
+        DaqListState(daq) |= DAQ_STATE_OVERRUN;
+        DBG_PRINTF4("DAQ queue overrun, daq=%u, overruns=%u\n", daq, shared.daq_overflow_count);
 #else
-            // Queue overflow has to be handled and indicated by the transmit queue
-            DBG_PRINTF6("DAQ queue overflow, daq=%u, odt=%u\n", daq, odt);
+        // Queue overflow has to be handled and indicated by the transmit queue
+        DBG_PRINTF6("DAQ queue overflow, daq=%u\n", daq);
 #endif
-            return; // Skip rest of this event on queue overrun, to simplify resynchronisation of the client
-        }
+        return; // Skip this event on queue overrun, to simplify resynchronisation of the client
+    }
+
+    // Outer loop
+    // Loop over all ODTs of the current DAQ list
+    for (hs = ODT_HEADER_SIZE + ODT_TIMESTAMP_SIZE, i = 0; i < odt_count; hs = ODT_HEADER_SIZE, i++) {
+
+        odt = first_odt + i;
+        d0 = queue_buffers[i].buffer;
 
         // ODT header (ODT8,FIL8,DAQ16 or ODT8,DAQ8)
-        d0[0] = (uint8_t)(odt - DaqListFirstOdt(daq)); /* Relative odt number as byte*/
+        d0[0] = (uint8_t)i; /* Relative odt number as byte*/
 #if ODT_HEADER_SIZE == 4
         d0[1] = 0xAA; // Align byte
         *((uint16_t *)&d0[2]) = daq;
@@ -1487,6 +2682,28 @@ static void XcpTriggerDaqList_(tQueueHandle queue_handle, uint16_t daq, const ui
         }
 
         // Inner loop
+        // Loop over all copy plan entries of an ODT
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+        if (DaqListOdtTable[odt].copy_count > 0) {
+            uint8_t *dst = &d0[hs];
+            const tXcpOdtCopy *c = &copy_table[DaqListOdtTable[odt].first_odt_entry];
+            const tXcpOdtCopy *cl = c + DaqListOdtTable[odt].copy_count;
+            for (; c < cl; c++) {
+#ifdef XCP_ENABLE_DAQ_ADDREXT
+#ifdef XCP_ENABLE_TEST_CHECKS
+                assert(c->addr_ext < count && bases[c->addr_ext] != NULL);
+#endif
+                const uint8_t *src = (const uint8_t *)&bases[c->addr_ext][c->addr];
+#else
+                const uint8_t *src = (const uint8_t *)&base[c->addr];
+#endif
+                XcpCopyDaqData(dst, src, c->size);
+                dst += c->size;
+            }
+            continue;
+        }
+#endif
+
         // Loop over all ODT entries in a ODT
         {
             uint8_t *dst = &d0[hs];
@@ -1512,15 +2729,37 @@ static void XcpTriggerDaqList_(tQueueHandle queue_handle, uint16_t daq, const ui
 #else
                 const uint8_t *src = (const uint8_t *)&base[*addr_ptr++];
 #endif
-                memcpy(dst, src, n);
+                XcpCopyDaqData(dst, src, n);
                 dst += n;
                 e++;
             }
         }
 
-        queuePush(queue_handle, &queue_buffer, DaqListPriority(daq) != 0 && odt == DaqListLastOdt(daq));
-
     } /* odt */
+
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+    // Update the shadow block with the payload of the sample, skip the update if another thread is accessing the shadow block
+    if (shadow != NULL && atomic_exchange_explicit(&shadow->busy, 1, memory_order_acquire) == 0) {
+        uint8_t *dst = (uint8_t *)(shadow + 1);
+        for (hs = ODT_HEADER_SIZE + ODT_TIMESTAMP_SIZE, i = 0; i < odt_count; hs = ODT_HEADER_SIZE, i++) {
+            uint16_t n = DaqListOdtTable[first_odt + i].size;
+            memcpy(dst, &queue_buffers[i].buffer[hs], n);
+            dst += n;
+        }
+        shadow->clock = clock;
+        shadow->valid = 1;
+        atomic_store_explicit(&shadow->busy, 0, memory_order_release);
+    }
+#endif
+
+    // Commit all ODTs
+#ifdef XCP_ENABLE_DAQ_RECORDER
+    if (recording) {
+        XcpRecorderCommit();
+        return;
+    }
+#endif
+    queuePushMulti(queue_handle, queue_buffers, odt_count, DaqListPriority(daq) != 0);
 }
 
 // Trigger DAQ event
@@ -1589,6 +2828,38 @@ static void XcpTriggerDaqEvent_(tQueueHandle queue_handle, tXcpEventId event_id,
     }
 #endif
 
+#ifdef XCP_ENABLE_DAQ_DISPATCH
+    // Loop over all running DAQ lists associated to the current event in the active DAQ dispatch table
+    // Enter the active table as reader in the reader slot of this thread, it is not rebuilt before all of its readers have left
+    // The table may have been deactivated before the reader count was visible, walk the DAQ list chains then
+    uint8_t active = (uint8_t)atomic_load_explicit(&shared.daq_dispatch_active, memory_order_relaxed);
+    atomic_uint_least32_t *readers = NULL;
+    if (active != 0) {
+        readers = XcpGetDaqDispatchReaderSlot();
+        atomic_fetch_add_explicit(readers, DaqDispatchReader(active - 1), memory_order_seq_cst);
+        if (atomic_load_explicit(&shared.daq_dispatch_active, memory_order_seq_cst) != active) {
+            atomic_fetch_sub_explicit(readers, DaqDispatchReader(active - 1), memory_order_release);
+            active = 0;
+        }
+    }
+    if (active != 0) {
+        const tXcpDaqDispatch *dispatch = &shared.daq_dispatch[active - 1];
+        const uint16_t *dispatch_daq = DaqDispatchDaqTable(active - 1);
+        for (uint16_t i = dispatch->event_first[event_id]; i < dispatch->event_first[event_id + 1]; i++) {
+            uint16_t daq = dispatch_daq[i];
+#ifndef XCP_ENABLE_DAQ_ADDREXT
+            // Address extension unique per DAQ list, use base pointer for this DAQ list
+            uint8_t ext = DaqListAddrExt(daq);
+            XcpTriggerDaqList_(queue_handle, daq, bases[ext], clock); // Trigger DAQ list
+#else
+            XcpTriggerDaqList_(queue_handle, daq, count, bases, clock); // Trigger DAQ list
+#endif
+        }
+        atomic_fetch_sub_explicit(readers, DaqDispatchReader(active - 1), memory_order_release);
+        return;
+    }
+#endif
+
     // Loop over all active DAQ lists associated to the current event
     for (uint16_t daq = DaqListFirst(event_id); daq != XCP_UNDEFINED_DAQ_LIST; daq = DaqListNext(daq)) {
         assert(daq < shared.daq_lists.daq_count);
@@ -1613,6 +2884,7 @@ static void XcpProcessPendingCommand(tXcpEventId event, int count, const uint8_t
         if (XcpAddrIsDyn(local.mta_ext) && XcpAddrDecodeDynEvent(local.mta_addr) == event) {
             ATOMIC_BOOL_TYPE old_value = true;
             if (atomic_compare_exchange_weak_explicit(&shared_mut_safe.cmd_pending, &old_value, false, memory_order_release, memory_order_relaxed)) {
+                XcpClearEventMaskBit(event);
                 // Convert relative signed 16 bit addr in MtaAddr to pointer MtaPtr
                 assert(local.mta_ext < count);
                 local_mut.mta_ptr = (uint8_t *)(bases[local.mta_ext] + XcpAddrDecodeDynOffset(local.mta_addr));
@@ -1626,6 +2898,8 @@ static void XcpProcessPendingCommand(tXcpEventId event, int count, const uint8_t
 
 void XcpEventExtAt_(tXcpEventId event, int count, const uint8_t **bases, uint64_t clock) {
 
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
     if (!isStarted())
         return;
 
@@ -1649,6 +2923,8 @@ void XcpEventExtAt_(tXcpEventId event, int count, const uint8_t **bases, uint64_
 
 void XcpEventExt_(tXcpEventId event, int count, const uint8_t **bases) {
 
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
     if (!isStarted())
         return;
 
@@ -1694,6 +2970,8 @@ void XcpEventExtAt(tXcpEventId event, const uint8_t *base, uint64_t clock) {
 
 // Supports absolute addressing only
 void XcpEvent(tXcpEventId event) {
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
     if (!isDaqRunning())
         return; // DAQ not running
 
@@ -1713,6 +2991,8 @@ void XcpEvent(tXcpEventId event) {
     XcpTriggerDaqEvent_(local.queue, event, 2, bases, ApplXcpGetClock64());
 }
 void XcpEventAt(tXcpEventId event, uint64_t clock) {
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
     if (!isDaqRunning())
         return; // DAQ not running
 
@@ -1738,6 +3018,8 @@ void XcpEventAt(tXcpEventId event, uint64_t clock) {
 
 void XcpEventExt_Var(tXcpEventId event, int args_count, ...) {
 
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
     if (!isStarted())
         return;
 
@@ -1768,6 +3050,8 @@ void XcpEventExt_Var(tXcpEventId event, int args_count, ...) {
 
 void XcpEventExtAt_Var(tXcpEventId event, uint64_t clock, int args_count, ...) {
 
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
     if (!isStarted())
         return;
 
@@ -1796,6 +3080,42 @@ void XcpEventExtAt_Var(tXcpEventId event, uint64_t clock, int args_count, ...) {
     XcpTriggerDaqEvent_(local.queue, event, XCP_ADDR_EXT_DYN + args_count, bases, clock);
 }
 
+// Fixed arity variants of XcpEventExt_Var and XcpEventExtAt_Var
+// The base pointer array is built in place, XcpEventExtAt_ is in the same translation unit and may be inlined
+// clock == 0 takes the timestamp in XcpTriggerDaqEvent_, only when DAQ is running
+
+void XcpEventExtAt1(tXcpEventId event, uint64_t clock, const uint8_t *base2) {
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
+    const uint8_t *bases[XCP_ADDR_EXT_DYN + 1] = {xcp_get_base_addr(), xcp_get_base_addr(), base2};
+    XcpEventExtAt_(event, XCP_ADDR_EXT_DYN + 1, bases, clock);
+}
+void XcpEventExtAt2(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3) {
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
+    const uint8_t *bases[XCP_ADDR_EXT_DYN + 2] = {xcp_get_base_addr(), xcp_get_base_addr(), base2, base3};
+    XcpEventExtAt_(event, XCP_ADDR_EXT_DYN + 2, bases, clock);
+}
+void XcpEventExtAt3(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4) {
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
+    const uint8_t *bases[XCP_ADDR_EXT_DYN + 3] = {xcp_get_base_addr(), xcp_get_base_addr(), base2, base3, base4};
+    XcpEventExtAt_(event, XCP_ADDR_EXT_DYN + 3, bases, clock);
+}
+void XcpEventExtAt4(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4, const uint8_t *base5) {
+    if (!XcpIsEventActive(event))
+        return; // No running DAQ list and no pending command for this event
+    const uint8_t *bases[XCP_ADDR_EXT_DYN + 4] = {xcp_get_base_addr(), xcp_get_base_addr(), base2, base3, base4, base5};
+    XcpEventExtAt_(event, XCP_ADDR_EXT_DYN + 4, bases, clock);
+}
+
+void XcpEventExt1(tXcpEventId event, const uint8_t *base2) { XcpEventExtAt1(event, 0, base2); }
+void XcpEventExt2(tXcpEventId event, const uint8_t *base2, const uint8_t *base3) { XcpEventExtAt2(event, 0, base2, base3); }
+void XcpEventExt3(tXcpEventId event, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4) { XcpEventExtAt3(event, 0, base2, base3, base4); }
+void XcpEventExt4(tXcpEventId event, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4, const uint8_t *base5) {
+    XcpEventExtAt4(event, 0, base2, base3, base4, base5);
+}
+
 #endif // XCP_ENABLE_DYN_ADDRESSING
 
 #ifdef XCP_ENABLE_DAQ_EVENT_LIST
@@ -1840,7 +3160,15 @@ void XcpDisconnect(void) {
 
     if (isConnected()) {
 
-        if (isDaqRunning()) {
+        // Keep DAQ running into the recorder ring, if the recorder is on, stop streaming to the client
+#ifdef XCP_ENABLE_DAQ_RECORDER
+        XcpRecorderChangeState(XCP_RECORDER_STREAMING, XCP_RECORDER_FROZEN);
+        bool recording = XcpRecorderGetState() != XCP_RECORDER_OFF;
+#else
+        const bool recording = false;
+#endif
+
+        if (isDaqRunning() && !recording) {
             XcpStopDaq();
             XcpTlWaitForTransmitQueueEmpty(XCP_TRANSMIT_QUEUE_FLUSH_TIMEOUT_MS);
         }
@@ -1853,6 +3181,10 @@ void XcpDisconnect(void) {
         shared_mut.session_status &= (uint16_t)(~SS_CONNECTED);
         ApplXcpDisconnect();
 
+#ifdef XCPTL_ENABLE_COMPRESSION
+        XcpTlSetCompression(TL_COMPRESSION_NONE);
+#endif
+
         // Freeze working page data
 #if defined(OPTION_ENABLE_PERSISTENCE) && defined(XCP_ENABLE_FREEZE_ON_DISCONNECT)
         if ((XcpGetInitMode() & XCP_MODE_PERSISTENCE) != 0) {
@@ -1877,7 +3209,7 @@ static void XcpSendResponse(bool async, const tXcpCto *crm, uint8_t crmLen) {
 #endif
     {
         // Send via transmit queue
-        tQueueBuffer queue_buffer = queueAcquire(local.queue, crmLen);
+        tQueueBuffer queue_buffer = queueAcquire(local.queue, crmLen, QUEUE_PRIORITY_HIGH);
         if (queue_buffer.buffer != NULL) {
             memcpy(queue_buffer.buffer, crm, crmLen);
             queuePush(local.queue, &queue_buffer, true); // High priority = true, disable further packet accumulation
@@ -1918,6 +3250,11 @@ static uint8_t XcpPushCommand(const tXcpCto *cmdBuf, uint8_t cmdLen) {
     }
     shared_mut.cmd_pending_crm_len = cmdLen;
     memcpy(&shared_mut.cmd_pending_crm, cmdBuf, cmdLen);
+
+    // Make sure the event the command is waiting for is triggered
+    if (XcpAddrIsDyn(local.mta_ext)) {
+        XcpSetEventMaskBit(XcpAddrDecodeDynEvent(local.mta_addr));
+    }
     return CRC_CMD_OK;
 }
 #endif // XCP_ENABLE_DYN_ADDRESSING
@@ -1939,6 +3276,9 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
 #define CRO_DWORD(x) (CRO->dw[x])
 
     uint8_t err = 0;
+#ifdef XCP_ENABLE_DAQ_RESUME
+    bool resume = false; // CONNECT to DAQ resumed by XcpStart
+#endif
 
     assert(isStarted());
     assert(CRO_LEN <= XCPTL_MAX_CTO_SIZE);
@@ -1966,10 +3306,25 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
             return CRC_CMD_OK; // Application not ready, ignore
 
         // Initialize XCP Session Status on connect
-        shared_mut.session_status = (SS_ACTIVATED | SS_STARTED | SS_CONNECTED | SS_LEGACY_MODE);
+        // In resume mode, keep DAQ running, the client gets the DAQ setup id with EV_RESUME_MODE after the response and with GET_STATUS
+#ifdef XCP_ENABLE_DAQ_RESUME
+        resume = (shared.session_status & SS_RESUME) != 0 && isDaqRunning();
+#else
+        const bool resume = false;
+#endif
+        if (resume) {
+            shared_mut.session_status = (SS_ACTIVATED | SS_STARTED | SS_CONNECTED | SS_LEGACY_MODE | SS_RESUME | SS_DAQ);
+        } else {
+            shared_mut.session_status = (SS_ACTIVATED | SS_STARTED | SS_CONNECTED | SS_LEGACY_MODE);
 
-        /* Reset DAQ */
-        XcpClearDaq();
+            /* Reset DAQ */
+            XcpClearDaq();
+        }
+
+        // Transmit compression has to be requested again by the new client
+#ifdef XCPTL_ENABLE_COMPRESSION
+        XcpTlSetCompression(TL_COMPRESSION_NONE);
+#endif
 
         // Response
         CRM_LEN = CRM_CONNECT_LEN;
@@ -1979,7 +3334,7 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
         CRM_CONNECT_MAX_DTO_SIZE = XCPTL_MAX_DTO_SIZE;
         CRM_CONNECT_RESOURCE = RM_DAQ | RM_CAL_PAG;      /* DAQ and CAL supported */
         CRM_CONNECT_COMM_BASIC = CMB_OPTIONAL;           // GET_COMM_MODE_INFO available, byte order Intel, address granularity byte, no server block mode
-        assert(*(uint8_t *)&shared.session_status == 0); // Intel byte order
+        assert(*(uint8_t *)&shared.session_status == (uint8_t)shared.session_status); // Intel byte order
     }
 
     // Handle other all other commands
@@ -2003,15 +3358,31 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
         case CC_USER_CMD: {
             check_len(CRO_USER_CMD_LEN);
             uint8_t subcmd = CRO_USER_CMD_SUBCOMMAND;
+            switch (subcmd) {
 #ifdef XCP_ENABLE_CALSEG_LIST
-            if (subcmd == 0x01) {
+            case USER_CMD_BEGIN_ATOMIC_CAL:
                 XcpCalSegBeginAtomicTransaction();
-            } else if (subcmd == 0x02) {
+                break;
+            case USER_CMD_END_ATOMIC_CAL:
                 check_error(XcpCalSegEndAtomicTransaction());
-            } else
+                break;
 #endif
-            {
+#ifdef XCP_ENABLE_DAQ_RECORDER
+            case USER_CMD_RECORDER_START:
+                if (!XcpRecorderStart(CRO_USER_CMD_PAR_WORD))
+                    error(CRC_MEMORY_OVERFLOW);
+                break;
+            case USER_CMD_RECORDER_TRIGGER:
+                if (!XcpRecorderTrigger() || !XcpRecorderStream())
+                    error(CRC_SEQUENCE);
+                break;
+            case USER_CMD_RECORDER_STOP:
+                XcpRecorderStop();
+                break;
+#endif
+            default:
                 check_error(ApplXcpUserCommand(subcmd));
+                break;
             }
         } break;
 #endif // XCP_ENABLE_USER_COMMAND
@@ -2146,7 +3517,7 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
 #ifdef XCP_ENABLE_DAQ_RESUME
             case SS_STORE_DAQ_REQ: {
                 uint16_t config_id = CRO_SET_REQUEST_CONFIG_ID;
-                shared.daq_lists.config_id = config_id;
+                shared_mut.daq_lists.config_id = config_id;
                 // shared_mut.session_status |= SS_STORE_DAQ_REQ;
                 check_error(ApplXcpDaqResumeStore(config_id));
                 // @@@@ TODO: Send an event message
@@ -2374,7 +3745,16 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
         case CC_GET_DAQ_PROCESSOR_INFO: {
             CRM_LEN = CRM_GET_DAQ_PROCESSOR_INFO_LEN;
             CRM_GET_DAQ_PROCESSOR_INFO_MIN_DAQ = 0;                          // Total number of predefined DAQ lists
-            CRM_GET_DAQ_PROCESSOR_INFO_MAX_DAQ = shared.daq_lists.daq_count; // Number of currently dynamically allocated DAQ lists
+            // Number of DAQ lists, which fit into the DAQ memory with one ODT and one ODT entry each
+            uint32_t daq_size = (uint32_t)sizeof(tXcpDaqList) + (uint32_t)sizeof(tXcpOdt) + (uint32_t)sizeof(uint16_t) + ODT_ENTRY_SIZE;
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+            daq_size += (uint32_t)sizeof(tXcpOdtCopy);
+#endif
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+            daq_size += (uint32_t)sizeof(uint32_t);
+#endif
+            uint32_t max_daq = DaqMemSize / daq_size;
+            CRM_GET_DAQ_PROCESSOR_INFO_MAX_DAQ = (uint16_t)(max_daq > 0xFFFF ? 0xFFFF : max_daq);
 #if defined(XCP_ENABLE_DAQ_EVENT_INFO) && defined(XCP_ENABLE_DAQ_EVENT_LIST)
             CRM_GET_DAQ_PROCESSOR_INFO_MAX_EVENT = getEventCount(); // Number of currently available event channels which can be queried by GET_DAQ_EVENT_INFO
 #else
@@ -2519,6 +3899,10 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
                 error(CRC_OUT_OF_RANGE);
             if ((mode & (DAQ_MODE_ALTERNATING | DAQ_MODE_DIRECTION | DAQ_MODE_DTO_CTR | DAQ_MODE_PID_OFF)) != 0)
                 error(CRC_OUT_OF_RANGE); // none of these modes implemented
+#ifndef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+            if ((mode & DAQ_MODE_SEND_ON_CHANGE) != 0)
+                error(CRC_OUT_OF_RANGE); // send on change not enabled
+#endif
             if ((mode & DAQ_MODE_TIMESTAMP) == 0)
                 error(CRC_CMD_SYNTAX); // timestamp is fixed on
             check_error(XcpSetDaqListMode(daq, event, mode, prescaler, prio));
@@ -2563,12 +3947,25 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
 #ifdef XCP_ENABLE_TEST_CHECKS
                 DBG_PRINT_ERROR("START_STOP_DAQ_LIST to start individual DAQ list is not supported, START_STOP_SYNCH start selected is mandatory!\n");
                 error(CRC_MODE_NOT_VALID);
+#endif
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+                check_error(XcpCheckDaqShadowMemory());
 #endif
                 XcpStartDaqList(daq); // start DAQ list
-                XcpStartDaq();        // start event processing, if not already running
-            } else if (mode == 0) {   // stop
-                XcpStopDaqList(daq);  // stop individual daq list, stop event processing if all DAQ lists are stopped
-            } else {                  // illegal mode
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+                XcpUpdateDaqDispatch();
+#endif
+                XcpUpdateEventMask();
+                XcpStartDaq();      // start event processing, if not already running
+            } else if (mode == 0) { // stop
+                XcpStopDaqList(daq); // stop individual daq list, stop event processing if all DAQ lists are stopped
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+                if (isDaqRunning()) {
+                    XcpUpdateDaqDispatch();
+                }
+#endif
+                XcpUpdateEventMask();
+            } else { // illegal mode
                 error(CRC_MODE_NOT_VALID);
             }
         } break;
@@ -2599,6 +3996,9 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
                     DBG_PRINT_ERROR("DAQ is already running, start of additional DAQ list sets is not supported!\n");
                     error(CRC_DAQ_ACTIVE);
                 }
+#endif
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+                check_error(XcpCheckDaqShadowMemory());
 #endif
                 XcpSendResponse(async, &CRM, CRM_LEN); // Transmit response first and then start DAQ
                 XcpStartSelectedDaqLists();
@@ -2742,6 +4142,14 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
                 goto no_response;
 #endif // XCPTL_ENABLE_MULTICAST
 
+#ifdef XCPTL_ENABLE_COMPRESSION
+            case CC_TL_SET_COMPRESSION:
+                check_len(CRO_TL_SET_COMPRESSION_LEN);
+                if (!XcpTlSetCompression(CRO_TL_SET_COMPRESSION_MODE))
+                    error(CRC_OUT_OF_RANGE);
+                break;
+#endif
+
             case 0:
             default: /* unknown transport layer command */
                 error(CRC_CMD_UNKNOWN);
@@ -2808,6 +4216,11 @@ static uint8_t XcpAsyncCommand(bool async, const uint32_t *cmdBuf, uint8_t cmdLe
 
     // Transmit normal command response
     XcpSendResponse(async, &CRM, CRM_LEN);
+#ifdef XCP_ENABLE_DAQ_RESUME
+    if (resume) {
+        XcpSendResumeModeEvent();
+    }
+#endif
     return CRC_CMD_OK;
 
 // Transmit error response
@@ -2872,6 +4285,11 @@ void XcpBackgroundTasks(void) {
         }
     }
 
+#endif
+
+    // Transmit the pre-trigger samples of the DAQ recorder
+#ifdef XCP_ENABLE_DAQ_RECORDER
+    XcpRecorderStreamTask();
 #endif
 }
 
@@ -2887,7 +4305,7 @@ void XcpSendEvent(uint8_t evc, const uint8_t *d, uint8_t l) {
     if (l >= XCPTL_MAX_CTO_SIZE - 2)
         return;
 
-    tQueueBuffer queue_buffer = queueAcquire(local.queue, l + 2);
+    tQueueBuffer queue_buffer = queueAcquire(local.queue, l + 2, QUEUE_PRIORITY_HIGH);
     tXcpCto *crm = (tXcpCto *)queue_buffer.buffer;
     if (crm != NULL) {
         crm->b[0] = PID_EV; /* Event */
@@ -2905,6 +4323,18 @@ void XcpSendEvent(uint8_t evc, const uint8_t *d, uint8_t l) {
 // Send terminate session signal event
 void XcpSendTerminateSessionEvent(void) { XcpSendEvent(EVC_SESSION_TERMINATED, NULL, 0); }
 
+// Send resume mode event with the session configuration id and the current timestamp
+#ifdef XCP_ENABLE_DAQ_RESUME
+static void XcpSendResumeModeEvent(void) {
+    uint8_t d[6];
+    uint16_t config_id = shared.daq_lists.config_id;
+    uint32_t timestamp = (uint32_t)ApplXcpGetClock64();
+    memcpy(&d[0], &config_id, 2);
+    memcpy(&d[2], &timestamp, 4);
+    XcpSendEvent(EVC_RESUME_MODE, d, sizeof(d));
+}
+#endif
+
 /****************************************************************************/
 /* Print via SERV/SERV_TEXT                                                 */
 /****************************************************************************/
@@ -2916,7 +4346,7 @@ void XcpPrint(const char *str) {
         return;
 
     uint16_t l = (uint16_t)STRNLEN(str, XCPTL_MAX_CTO_SIZE - 4);
-    tQueueBuffer queue_buffer = queueAcquire(local.queue, l + 4);
+    tQueueBuffer queue_buffer = queueAcquire(local.queue, l + 4, QUEUE_PRIORITY_NORMAL);
     uint8_t *crm = queue_buffer.buffer;
     if (crm != NULL) {
         crm[0] = PID_SERV; /* Event */
@@ -3005,6 +4435,7 @@ bool XcpInit(const char *name, const char *epk, uint8_t mode) {
         local_mut.init_mode = XCP_MODE_DEACTIVATE;
 #ifdef OPTION_SHM_MODE
         gXcpData = NULL;
+        gXcpEventMask = gXcpEventMaskOff;
 #else
         gXcpData.session_status = 0;
 #endif
@@ -3019,6 +4450,7 @@ bool XcpInit(const char *name, const char *epk, uint8_t mode) {
         DBG_PRINT_ERROR("XcpInit: Failed to attach to shared memory\n");
         goto error_deactivate; // SHM problem, deactivate XCP
     }
+    gXcpEventMask = (const volatile uint64_t *)gXcpData->event_mask;
 
     // Shared memory already exists, register application and done
     if (!local_mut.shm_leader) {
@@ -3071,6 +4503,13 @@ bool XcpInit(const char *name, const char *epk, uint8_t mode) {
     memset((uint8_t *)&gXcpData, 0, sizeof(tXcpData));
 #endif
 
+    // Allocate the DAQ table memory with default size, if not already done
+#ifdef XCP_ENABLE_DAQ_MEM_ALLOC
+    if (gXcpDaqMem == NULL && !XcpAllocDaqMem(XCP_DAQ_MEM_SIZE)) {
+        goto error_deactivate;
+    }
+#endif
+
 #ifdef OPTION_SHM_MODE // XcpInit init SHM mode specific data and state
 
     // In SHM mode, only the leader reaches this point
@@ -3086,6 +4525,9 @@ bool XcpInit(const char *name, const char *epk, uint8_t mode) {
 #endif
 
     // Reset DAQ list memory
+#ifdef XCP_ENABLE_DAQ_RECORDER
+    XcpRecorderInit();
+#endif
     XcpClearDaq();
 
 #ifdef XCP_ENABLE_DAQ_CLOCK_MULTICAST
@@ -3157,6 +4599,7 @@ error_deactivate:
     local_mut.init_mode = XCP_MODE_DEACTIVATE;
 #ifdef OPTION_SHM_MODE // XcpInit deactivate XCP on error
     gXcpData = NULL;
+    gXcpEventMask = gXcpEventMaskOff;
 #else
     gXcpData.session_status = 0;
 #endif
@@ -3167,7 +4610,9 @@ error_deactivate:
 // Assume the transport layer is running
 void XcpStart(tQueueHandle queue_handle, bool resumeMode) {
 
-    (void)resumeMode; // Start in resume mode, not implemented yet
+#ifndef XCP_ENABLE_DAQ_RESUME
+    (void)resumeMode; // Resume mode not enabled
+#endif
 
     if (!isActivated())
         return;
@@ -3180,7 +4625,7 @@ void XcpStart(tQueueHandle queue_handle, bool resumeMode) {
     if (DBG_LEVEL >= 3) {
         DBG_PRINT3("Init XCP protocol layer\n");
         DBG_PRINTF3("  Version=%u.%u, MAX_CTO=%u, MAX_DTO=%u, DAQ_MEM=%u, MAX_DAQ=%u, MAX_ODT_ENTRY=%u, MAX_ODT_ENTRYSIZE=%u, %u KiB memory used\n",
-                    XCP_PROTOCOL_LAYER_VERSION >> 8, XCP_PROTOCOL_LAYER_VERSION & 0xFF, XCPTL_MAX_CTO_SIZE, XCPTL_MAX_DTO_SIZE, XCP_DAQ_MEM_SIZE, (1 << sizeof(uint16_t) * 8) - 1,
+                    XCP_PROTOCOL_LAYER_VERSION >> 8, XCP_PROTOCOL_LAYER_VERSION & 0xFF, XCPTL_MAX_CTO_SIZE, XCPTL_MAX_DTO_SIZE, DaqMemSize, (1 << sizeof(uint16_t) * 8) - 1,
                     (1 << sizeof(uint16_t) * 8) - 1, (1 << (sizeof(uint8_t) * 8)) - 1, (unsigned int)sizeof(tXcpData) / 1024);
 
         DBG_PRINT3("  Addressing scheme=" XCP_ADDRESS_MODE "\n");
@@ -3299,13 +4744,15 @@ void XcpStart(tQueueHandle queue_handle, bool resumeMode) {
 
     // Resume DAQ
 #ifdef XCP_ENABLE_DAQ_RESUME
-    if (resumeMode) {
+    // Load the DAQ setup stored by SET_REQUEST STORE_DAQ_REQ from the binary persistence file
+    if (resumeMode && (XcpGetInitMode() & XCP_MODE_PERSISTENCE) != 0 && XcpBinLoadDaq()) {
         if (XcpCheckDaqLists(DAQ_STATE_SELECTED, XCP_UNDEFINED_EVENT_ID)) {
             /* Goto temporary disconnected mode and start all selected DAQ lists */
             shared_mut.session_status |= SS_RESUME;
             /* Start DAQ */
             XcpStartSelectedDaqLists();
-            // @@@@ TODO: Send an event message to indicate resume mode
+            XcpStartDaq();
+            // No client connected, EV_RESUME_MODE is sent on CONNECT, DAQ data is discarded by the transport layer until then
 
 #ifdef DBG_LEVEL
             if (DBG_LEVEL != 0) {
@@ -3338,7 +4785,12 @@ void XcpDeinit(void) {
     XcpDeinitCalSegList();
 #endif
 
+#ifdef XCP_ENABLE_DAQ_RECORDER
+    XcpRecorderDeinit();
+#endif
+
 #ifdef OPTION_SHM_MODE // XcpDeinit SHM mode specific deinitialization
+    gXcpEventMask = gXcpEventMaskOff; // The shared memory may be unmapped
     XcpShmShutdownApp(local_mut.shm_app_id);
 #else
     // Reset shared XCP state to not activated
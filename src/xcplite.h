@@ -16,6 +16,7 @@
 
 #include <stdbool.h> // for bool
 #include <stdint.h>  // for uint16_t, uint32_t, uint8_t
+#include <stdio.h>   // for FILE
 
 #include "cal.h"        // for calibration segment management if enabled
 #include "dbg_print.h"  // for DBG_LEVEL, DBG_PRINTF, DBG_PRINT, ...
@@ -84,6 +85,22 @@ void XcpEventExtAt_(tXcpEventId event, int count, const uint8_t **bases, uint64_
 // Variadic dyn base address list
 void XcpEventExt_Var(tXcpEventId event, int count, ...);
 void XcpEventExtAt_Var(tXcpEventId event, uint64_t clock, int count, ...);
+// Fixed arity dyn base address list
+void XcpEventExt1(tXcpEventId event, const uint8_t *base2);
+void XcpEventExt2(tXcpEventId event, const uint8_t *base2, const uint8_t *base3);
+void XcpEventExt3(tXcpEventId event, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4);
+void XcpEventExt4(tXcpEventId event, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4, const uint8_t *base5);
+void XcpEventExtAt1(tXcpEventId event, uint64_t clock, const uint8_t *base2);
+void XcpEventExtAt2(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3);
+void XcpEventExtAt3(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4);
+void XcpEventExtAt4(tXcpEventId event, uint64_t clock, const uint8_t *base2, const uint8_t *base3, const uint8_t *base4, const uint8_t *base5);
+
+// Event trigger mask
+// One bit per event, set if the event has running DAQ lists or a pending async command, event ids are folded modulo XCP_EVENT_MASK_WORDS*64
+// Tested inline before calling a trigger function, a set bit may be a false positive, which is filtered by the trigger function
+#define XCP_EVENT_MASK_WORDS 16
+extern const volatile uint64_t *gXcpEventMask;
+#define XcpIsEventActive(event) (0 != (gXcpEventMask[((uint16_t)(event) >> 6) & (XCP_EVENT_MASK_WORDS - 1)] & ((uint64_t)1 << ((event) & 63))))
 
 // Enable or disable a XCP DAQ event
 void XcpEventEnable(tXcpEventId event, bool enable);
@@ -113,6 +130,40 @@ uint32_t XcpGetDaqOverflowCount(void);
 #define DAQ_STATE_RUNNING ((uint8_t)0x02)  /* Running */
 bool XcpCheckDaqLists(uint8_t daq_state, tXcpEventId event_id);
 
+// DAQ recorder
+// While armed, running DAQ lists write into the recorder ring instead of the transmit queue, the oldest samples are overwritten
+// DAQ keeps running, when the client disconnects, a new CONNECT or FREE_DAQ stops the recorder
+#ifdef XCP_ENABLE_DAQ_RECORDER
+#define XCP_RECORDER_OFF 0       // DAQ lists write into the transmit queue
+#define XCP_RECORDER_ARMED 1     // DAQ lists write into the recorder ring
+#define XCP_RECORDER_FROZEN 2    // Triggered, the recorder ring is frozen, new samples are discarded
+#define XCP_RECORDER_STREAMING 3 // Triggered, the pre-trigger samples are transmitted to the client in the background
+bool XcpRecorderStart(uint32_t pre_trigger_ms); // Arm the recorder, the pre-trigger time limits the samples kept on trigger, 0 = whole ring, returns false on out of memory
+bool XcpRecorderTrigger(void);                  // Freeze the recorder ring, returns false if the recorder is not armed
+bool XcpRecorderStream(void);                   // Transmit the pre-trigger samples to the connected client, returns false if not frozen or not connected
+bool XcpRecorderDump(const char *filename);     // Write the pre-trigger samples and the DAQ tables to a file, returns false if not frozen or on file error
+void XcpRecorderStop(void);                     // Discard the recorder ring, DAQ lists write into the transmit queue again
+uint8_t XcpRecorderGetState(void);              // Get the recorder state XCP_RECORDER_xxx
+#endif
+
+// DAQ setup persistence for the DAQ logger and DAQ resume mode
+// The DAQ tables are written to or read from the current position of an open file, a DAQ setup is only valid for the same EPK
+#if defined(XCP_ENABLE_DAQ_LOGGER) || defined(XCP_ENABLE_DAQ_RESUME)
+bool XcpWriteDaqConfig(FILE *file); // Write the DAQ tables, returns false if no DAQ list is running or selected or on file error
+bool XcpReadDaqConfig(FILE *file);  // Read the DAQ tables and select the DAQ lists which were running or selected, returns false if connected, EPK mismatch or on file error
+#endif
+
+// DAQ setup files and DAQ list layout for the DAQ logger
+// A DAQ setup is saved while a client measures and started again later without client, the file is only valid for the same EPK
+#ifdef XCP_ENABLE_DAQ_LOGGER
+bool XcpSaveDaqConfig(const char *filename); // Save the DAQ tables, returns false if no DAQ list is running or selected or on file error
+bool XcpLoadDaqConfig(const char *filename); // Load the DAQ tables and start the DAQ lists which were running or selected, returns false if connected, EPK mismatch or on file error
+void XcpFreeDaq(void);                       // Stop DAQ and free all DAQ lists
+uint16_t XcpGetDaqListCount(void);
+tXcpEventId XcpGetDaqListEvent(uint16_t daq); // Event of a running DAQ list, XCP_UNDEFINED_EVENT_ID if the DAQ list is not running
+bool XcpGetOdtEntry(uint16_t daq, uint16_t odt, uint16_t idx, uint8_t *ext, uint32_t *addr, uint8_t *size); // Relative ODT and ODT entry, returns false if out of range
+#endif
+
 // Time synchronisation
 #ifdef XCP_ENABLE_DAQ_CLOCK_MULTICAST
 #if XCP_PROTOCOL_LAYER_VERSION < 0x0103
@@ -143,8 +194,9 @@ void XcpSetLogLevel(uint8_t level);
 #define XCP_MAX_EVENT_NAME 15
 #endif
 
-#define XCP_DAQ_EVENT_FLAG_DISABLED 0x01 // Event is disabled
-#define XCP_DAQ_EVENT_FLAG_PRIORITY 0x02 // Event priority flag
+#define XCP_DAQ_EVENT_FLAG_DISABLED 0x01       // Event is disabled
+#define XCP_DAQ_EVENT_FLAG_PRIORITY 0x02       // Event priority flag
+#define XCP_DAQ_EVENT_FLAG_SEND_ON_CHANGE 0x04 // DAQ lists of this event are send on change
 
 typedef struct {
     uint32_t cycle_time_ns; // Cycle time in nanoseconds, 0 means sporadic event
@@ -159,6 +211,12 @@ typedef struct {
     uint8_t daq_prescaler_cnt; // Current prescaler counter
 #endif
     char name[XCP_MAX_EVENT_NAME + 1]; // Event name
+    atomic_uint_fast32_t daq_lost;     // Number of DAQ list samples of this event lost since DAQ start, on queue overflow or exceeded byte budget
+#ifdef XCP_ENABLE_DAQ_EVENT_BUDGET
+    uint32_t daq_budget;                    // Maximum number of DAQ bytes per XCP_DAQ_EVENT_BUDGET_WINDOW_MS, 0 = unlimited
+    atomic_uint_fast32_t daq_budget_used;   // DAQ bytes in the current budget window
+    atomic_uint_fast64_t daq_budget_window; // Start of the current budget window (DAQ clock)
+#endif
 } tXcpEvent;
 
 typedef struct {
@@ -188,6 +246,24 @@ uint16_t XcpGetEventIndex(tXcpEventId event);
 // Get the event descriptor struct by id, returns NULL if not found
 const tXcpEvent *XcpGetEvent(tXcpEventId event);
 
+// Get the number of DAQ list samples of an event lost since DAQ start, on transmit queue overflow or exceeded byte budget
+uint32_t XcpGetEventDaqLostCount(tXcpEventId event);
+
+#ifdef XCP_ENABLE_DAQ_EVENT_BUDGET
+// Limit the DAQ data rate of an event, samples exceeding the budget are dropped and accounted as lost
+// Budget is in bytes per second including the ODT headers, measured in windows of XCP_DAQ_EVENT_BUDGET_WINDOW_MS, 0 = unlimited
+// Returns false if the event does not exist
+bool XcpSetEventByteBudget(tXcpEventId event, uint32_t bytes_per_s);
+#endif
+
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+// Make all DAQ lists of an event send on change, this applies to DAQ lists set up with SET_DAQ_LIST_MODE afterwards
+// A sample is only sent, when its data changed since the last sent sample or after XCP_DAQ_SEND_ON_CHANGE_KEEP_ALIVE_MS
+// The event should be triggered from one thread at a time, samples triggered concurrently are always sent
+// Returns false if the event does not exist
+bool XcpSetEventSendOnChange(tXcpEventId event, bool enable);
+#endif
+
 #ifdef OPTION_SHM_MODE // get event application id
 // In SHM mode, get event application id
 uint8_t XcpGetEventAppId(tXcpEventId event);
@@ -218,11 +294,33 @@ typedef struct {
     uint16_t first_odt_entry; /* Absolute odt entry number */
     uint16_t last_odt_entry;  /* Absolute odt entry number */
     uint16_t size;            /* Number of bytes */
-    uint16_t res;
+    uint16_t copy_count;      /* Number of copy plan entries, starting at index first_odt_entry, 0 = no copy plan */
 } tXcpOdt;
 #pragma pack(pop)
 // static_assert(sizeof(tXcpOdt) == 8, "Error: size of tXcpOdt is not equal to 8");
 
+/* ODT copy plan entry */
+// A run of adjacent ODT entries, copied with a single memcpy
+// size = 8 byte
+#pragma pack(push, 1)
+typedef struct {
+    uint32_t addr;    /* Address offset of the first ODT entry */
+    uint16_t size;    /* Number of bytes */
+    uint8_t addr_ext; /* Address extension */
+    uint8_t res;
+} tXcpOdtCopy;
+#pragma pack(pop)
+
+/* Shadow copy of the last sent sample of a send on change DAQ list */
+// size = 16 byte, followed by the payload of all ODTs of the DAQ list
+typedef struct {
+    uint64_t clock;            /* DAQ clock of the last sent sample */
+    uint32_t size;             /* Payload size */
+    uint8_t valid;             /* 0 = no sample sent yet */
+    atomic_uint_least8_t busy; /* A trigger is comparing or updating the shadow copy */
+    uint16_t res;
+} tXcpDaqShadow;
+
 /* DAQ list */
 // size = 12 byte
 #pragma pack(push, 1)
@@ -243,7 +341,25 @@ typedef struct {
 #pragma pack(pop)
 static_assert(sizeof(tXcpDaqList) == 12, "Error: size of tXcpDaqList is not equal to 12");
 
-/* Dynamic DAQ list structure in a linear memory block with size XCP_DAQ_MEM_SIZE + 8  */
+// Size of an ODT entry in the DAQ memory (address, size and optional address extension)
+#ifdef XCP_ENABLE_DAQ_ADDREXT
+#define ODT_ENTRY_SIZE 6
+#else
+#define ODT_ENTRY_SIZE 5
+#endif
+
+// DAQ memory for the tables computed on DAQ list start, allocated in addition to the DAQ memory size for the DAQ, ODT and ODT entry tables
+// Worst case is a DAQ memory filled with ODT entries, a copy plan entry needs 8 bytes per ODT entry, the DTO size and shadow tables need less than 1/3 byte per byte
+// 3 * 8 bytes for the alignment of the 3 tables
+#ifdef XCP_ENABLE_DAQ_COPY_PLAN
+#define XCP_DAQ_MEM_DERIVED_SIZE(size) (((size) / ODT_ENTRY_SIZE) * 8 + 24)
+#else
+#define XCP_DAQ_MEM_DERIVED_SIZE(size) ((size) / 3 + 24)
+#endif
+#define XCP_DAQ_MEM_TOTAL_SIZE(size) ((size) + XCP_DAQ_MEM_DERIVED_SIZE(size))
+
+/* Dynamic DAQ list structure in a linear memory block with size XCP_DAQ_MEM_TOTAL_SIZE(XCP_DAQ_MEM_SIZE) + 8  */
+// With XCP_ENABLE_DAQ_MEM_ALLOC, the DAQ array is a heap memory block with runtime size, see XcpSetDaqMemSize
 #pragma pack(push, 1)
 typedef struct {
     uint16_t odt_entry_count; // Total number of ODT entries in ODT entry addr and size arrays
@@ -251,7 +367,8 @@ typedef struct {
     uint16_t daq_count;       // Number of DAQ lists in DAQ list array
     uint16_t res;
 #ifdef XCP_ENABLE_DAQ_RESUME
-    uint16_t config_id;
+    uint16_t config_id;     // Session configuration id of SET_REQUEST STORE_DAQ_REQ
+    uint16_t res_resume[3]; // Keep the DAQ array 8 byte aligned
 #endif
 #if !defined(XCP_ENABLE_DAQ_EVENT_LIST) && defined(XCP_MAX_EVENT_COUNT)
     uint16_t daq_first[XCP_MAX_EVENT_COUNT]; // Event channel to DAQ list mapping when there is no event management
@@ -265,6 +382,10 @@ typedef struct {
     //  uint32_t[]    - ODT entry addr array
     //  uint8_t[]     - ODT entry size array
     //  uint8_t[]     - ODT entry addr extension array (optional)
+    //  uint16_t[]    - ODT DTO size array, 8 byte aligned, computed on DAQ list start, this and the following tables are in the additional XCP_DAQ_MEM_DERIVED_SIZE
+    //  tXcpOdtCopy[] - ODT copy plan array, 8 byte aligned, compiled on DAQ list start (optional)
+    //  uint32_t[]    - Send on change shadow table, 8 byte aligned, followed by the shadow blocks in the unused memory (optional)
+#ifndef XCP_ENABLE_DAQ_MEM_ALLOC
     union {
         // DAQ array
         tXcpDaqList daq_list[(size_t)XCP_DAQ_MEM_SIZE / sizeof(tXcpDaqList)];
@@ -278,12 +399,73 @@ typedef struct {
 #ifdef XCP_ENABLE_DAQ_ADDREXT
         uint8_t odt_entry_addr_ext[(size_t)XCP_DAQ_MEM_SIZE / 1];
 #endif
-        uint64_t b[XCP_DAQ_MEM_SIZE / 8 + 1];
+        uint64_t b[XCP_DAQ_MEM_TOTAL_SIZE(XCP_DAQ_MEM_SIZE) / 8 + 1];
     } u;
+#endif
 
 } tXcpDaqLists;
 #pragma pack(pop)
 
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+/* DAQ dispatch table */
+// Running DAQ lists grouped by event, in the order of the DAQ list chain of the event
+// Read only for event processing, rebuilt on DAQ list start and stop into the inactive one of two tables, which is then activated
+// A table is not rebuilt, before all event processing threads, which read it while it was active, have left it
+typedef struct {
+    uint16_t event_first[XCP_MAX_EVENT_COUNT + 1];                // Index of the first running DAQ list of each event in daq, the last element is the overall count
+#ifndef XCP_ENABLE_DAQ_MEM_ALLOC                                  // Otherwise allocated with the DAQ memory
+    uint16_t daq[(size_t)XCP_DAQ_MEM_SIZE / sizeof(tXcpDaqList)]; // Running DAQ lists
+#endif
+} tXcpDaqDispatch;
+
+// Reader slot of the event processing threads, padded to a cache line
+// Number of threads reading DAQ dispatch table 1 in bits 0-15 and table 2 in bits 16-31
+typedef union {
+    atomic_uint_least32_t readers;
+    uint8_t padding[64];
+} tXcpDaqDispatchReaderSlot;
+#endif
+
+#ifdef XCP_ENABLE_DAQ_RECORDER
+/* DAQ recorder record */
+// One DAQ list sample in the recorder ring or in a recorder file
+// size = 16 byte, followed by odt_count ODTs, each a uint32_t DTO size and the DTO (ODT header, timestamp and payload) padded to 4 byte
+typedef struct {
+    uint32_t size;      /* Record size in bytes including this header, multiple of 8 */
+    uint16_t daq;       /* DAQ list */
+    uint16_t odt_count; /* Number of ODTs */
+    uint64_t clock;     /* DAQ clock of the sample */
+} tXcpRecord;
+
+/* DAQ recorder file header */
+// Followed by daq_table_size bytes of DAQ tables (DAQ list, ODT and ODT entry arrays) and record_count records
+typedef struct {
+    char magic[8];            /* "XCPREC1" */
+    uint64_t daq_start_clock; /* DAQ clock of DAQ start */
+    uint64_t trigger_clock;   /* DAQ clock of the trigger */
+    uint32_t record_count;    /* Number of records */
+    uint32_t daq_table_size;  /* Size of the DAQ tables */
+    uint16_t daq_count;       /* Number of DAQ lists in the DAQ tables */
+    uint16_t odt_count;       /* Number of ODTs in the DAQ tables */
+    uint16_t odt_entry_count; /* Number of ODT entries in the DAQ tables */
+    uint16_t res;
+} tXcpRecorderFileHeader;
+#endif
+
+#if defined(XCP_ENABLE_DAQ_LOGGER) || defined(XCP_ENABLE_DAQ_RESUME)
+/* DAQ setup file header */
+// Followed by daq_table_size bytes of DAQ tables (DAQ list, ODT and ODT entry arrays)
+typedef struct {
+    char magic[8];                    /* "XCPDAQ1" */
+    char epk[XCP_EPK_MAX_LENGTH + 1]; /* EPK of the application, null terminated */
+    uint32_t daq_table_size;          /* Size of the DAQ tables */
+    uint16_t daq_count;               /* Number of DAQ lists in the DAQ tables */
+    uint16_t odt_count;               /* Number of ODTs in the DAQ tables */
+    uint16_t odt_entry_count;         /* Number of ODT entries in the DAQ tables */
+    uint16_t config_id;               /* Session configuration id of SET_REQUEST in resume mode */
+} tXcpDaqConfigFileHeader;
+#endif
+
 /****************************************************************************/
 /* Protocol layer state                                                     */
 /****************************************************************************/
@@ -314,9 +496,16 @@ typedef struct XcpData {
 #endif
 
     /* DAQ */
-    ATOMIC_BOOL daq_running;     // DAQ is running
-    tXcpDaqLists daq_lists;      // DAQ list
-    uint32_t daq_overflow_count; // DAQ queue overflow
+    ATOMIC_BOOL daq_running;                               // DAQ is running
+    tXcpDaqLists daq_lists;                                // DAQ list
+    uint32_t daq_overflow_count;                           // DAQ queue overflow
+    atomic_uint_fast64_t event_mask[XCP_EVENT_MASK_WORDS]; // Event trigger mask, see XcpIsEventActive
+#if defined(XCP_ENABLE_DAQ_DISPATCH) && defined(XCP_MAX_EVENT_COUNT)
+    atomic_uint_least32_t daq_dispatch_active;                                    // Active DAQ dispatch table 1 or 2, 0 = none
+    atomic_uint_least32_t daq_dispatch_reader_ticket;                             // Reader slot assignment counter
+    tXcpDaqDispatch daq_dispatch[2];                                              // DAQ dispatch tables
+    tXcpDaqDispatchReaderSlot daq_dispatch_reader[XCP_DAQ_DISPATCH_READER_SLOTS]; // Reader counts of the event processing threads, see DaqDispatchReader
+#endif
 
     /* Optional event list */
 #ifdef XCP_ENABLE_DAQ_EVENT_LIST
@@ -23,3 +23,12 @@ int32_t XcpTlHandleTransmitQueue(void);
 bool XcpTlWaitForTransmitQueueEmpty(uint16_t timeout_ms); // Wait (sleep) until transmit queue is empty, timeout after 1s return false
 void XcpTlSendCrm(const uint8_t *data, uint8_t size);     // Transmit a packet (the packet contains a single XCP CRM command response message)
 uint16_t XcpTlGetCtr(void);                               // Get the next transmit message counter
+#ifdef XCPTL_ENABLE_COMPRESSION
+bool XcpTlSetCompression(uint8_t mode); // Set the transmit segment compression mode (TL_COMPRESSION_xxx), returns false if the mode is not supported
+#endif
+
+// for A2L writer
+#ifdef OPTION_QUEUE_STATISTICS_EVENT
+struct QueueStatistics;
+const struct QueueStatistics *XcpTlGetQueueStatistics(uint16_t *event_id); // Get the queue statistics measurement object and its event, NULL if not available
+#endif
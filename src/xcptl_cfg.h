@@ -68,6 +68,55 @@
 // 'include command response' is default !
 // #define XCPTL_EXCLUDE_CRM_FROM_CTR
 
+// Transmit segment compression
+// Segments are compressed, after the client requested it with the XCPlite specific transport layer command SET_COMPRESSION
+// Measurement data is highly repetitive, this saves bandwidth on slow links for the cost of some CPU time in the transmit thread
+// Off by default, a standard XCP client does not request it
+// #define XCPTL_ENABLE_COMPRESSION
+
+// Transmit multiple segments with a single system call
+// When the transmit queue holds committed data for more than one segment, the transmit thread collects up to XCPTL_MAX_SEND_SEGMENTS complete segments
+// UDP segments are sent as individual datagrams with a single sendmmsg (Linux only, one sendmsg per datagram on other platforms), TCP segments are sent one by one
+// The timing of incomplete segments is not changed, they are still sent when full, flushed or after the update timeout
+// Off by default, enabled by OPTION_ENABLE_IO_URING on Linux, which sends the collected segments with linked io_uring sends
+// #define XCPTL_ENABLE_MULTI_SEGMENT_SEND
+#if defined(OPTION_ENABLE_IO_URING) && defined(__linux__) && !defined(XCPTL_ENABLE_MULTI_SEGMENT_SEND)
+#define XCPTL_ENABLE_MULTI_SEGMENT_SEND
+#endif
+#define XCPTL_MAX_SEND_SEGMENTS 8
+
+// UDP generic segmentation offload (UDP_SEGMENT, Linux 4.18)
+// When all segments collected for transmission have the same size (except the last one), they are sent with a single sendmsg,
+// the kernel or the network interface splits them into datagrams. Otherwise or when the kernel or the network interface reject it, sendmmsg is used
+// Off by default, requires XCPTL_ENABLE_MULTI_SEGMENT_SEND
+// #define XCPTL_ENABLE_UDP_GSO
+#if defined(XCPTL_ENABLE_UDP_GSO) && !(defined(XCPTL_ENABLE_MULTI_SEGMENT_SEND) && defined(__linux__))
+#undef XCPTL_ENABLE_UDP_GSO
+#endif
+#define XCPTL_MAX_GSO_SIZE 65000 // Max UDP GSO payload size, must be less than 64K - IP and UDP header size
+
+// io_uring socket I/O (OPTION_ENABLE_IO_URING)
+// TCP: multiple transmit segments are submitted as linked sends with a single system call
+// UDP: unicast and multicast command receives are completed in the receive thread, no multicast thread needed
+#if defined(OPTION_ENABLE_IO_URING) && defined(XCPTL_ENABLE_MULTI_SEGMENT_SEND) && defined(__linux__)
+#define XCPTL_ENABLE_IO_URING
+#define XCPTL_IO_URING_ENTRIES 16 // Submission queue entries, must be >= XCPTL_MAX_SEND_SEGMENTS
+#endif
+
+// TCP zero copy transmit (MSG_ZEROCOPY, Linux 4.14)
+// The transmit queue memory is sent without copying it into the socket buffer, the queue buffers are released when the kernel notifies the completion
+// Only pays off for large segments on network interfaces with scatter-gather DMA, on loopback the kernel copies anyway and zero copy is turned off for the connection
+// Not used while segment compression is active
+// #define XCPTL_ENABLE_TCP_ZEROCOPY
+#if defined(XCPTL_ENABLE_TCP_ZEROCOPY) && !(defined(XCPTL_ENABLE_TCP) && defined(__linux__) && (defined(OPTION_QUEUE_64_FIX_SIZE) || defined(OPTION_QUEUE_64_VAR_SIZE)))
+#undef XCPTL_ENABLE_TCP_ZEROCOPY
+#endif
+
+// Transmit queue statistics event (OPTION_QUEUE_STATISTICS_EVENT)
+// Name and cycle time of the XCP event, which publishes the transmit queue statistics as measurements
+#define XCPTL_QUEUE_STATISTICS_EVENT_NAME "xcp_queue"
+#define XCPTL_QUEUE_STATISTICS_CYCLE_TIME_MS 100
+
 // Multicast (GET_DAQ_CLOCK_MULTICAST)
 // Not recommended setting
 // #define XCPTL_ENABLE_MULTICAST
@@ -0,0 +1,920 @@
+// daq_api_test
+// Functional test of the DAQ event processing
+// Runs the XCP server on localhost and acts as XCP client on a UDP socket, to set up DAQ lists and check the received DTOs
+// Exits with 0 when all checks passed
+
+#include <assert.h>  // for assert
+#include <stdbool.h> // for bool
+#include <stdint.h>  // for uintxx_t
+#include <stdio.h>   // for printf
+#include <string.h>  // for memcpy, memcmp
+
+#include "xcplib_cfg.h"
+#ifndef OPTION_ATOMIC_EMULATION
+#include <stdatomic.h> // for atomic_
+#endif
+
+// Public XCPlite API
+#include "xcplib.h" // for application programming interface
+
+// Internal libxcplite includes
+// Note: Take care for include order, when using internal libxcplite headers !!
+#include "dbg_print.h"
+#include "platform.h" // for socketxxx, sleepUs, clockGetMonotonicNs, THREAD, create_thread, join_thread
+#include "xcplite.h"  // for XCP protocol definitions
+#ifdef XCP_ENABLE_DAQ_RESUME
+#include "persistence.h" // for XcpBinWrite
+#endif
+
+//-----------------------------------------------------------------------------------------------------
+// XCP parameters
+
+#define OPTION_PROJECT_NAME "daq_api_test" // Project name
+#define OPTION_PROJECT_VERSION "V1.0.0"    // EPK version string
+#define OPTION_SERVER_PORT 5556            // Port, differs from the other tests and examples
+#define OPTION_SERVER_ADDR {127, 0, 0, 1}  // Localhost only
+#define OPTION_QUEUE_SIZE (1024 * 256)     // Size of the measurement queue in bytes
+#define OPTION_LOG_LEVEL 2                 // Log level, 0 = no log, 1 = error, 2 = warning, 3 = info, 4 = show XCP commands
+
+// Binary persistence file for resume mode
+#define OPTION_BIN_FILE OPTION_PROJECT_NAME "_" OPTION_PROJECT_VERSION ".bin"
+
+//-----------------------------------------------------------------------------------------------------
+
+static uint32_t fail_count = 0;
+
+#define CHECK(cond)                                                                                                                                                                \
+    do {                                                                                                                                                                           \
+        if (!(cond)) {                                                                                                                                                             \
+            printf("  FAILED: %s (line %d)\n", #cond, __LINE__);                                                                                                                   \
+            fail_count++;                                                                                                                                                          \
+        }                                                                                                                                                                          \
+    } while (0)
+
+// Measurement signals
+static struct {
+    uint32_t a;
+    uint32_t b;
+    uint16_t c;
+    uint16_t gap;
+    uint64_t d;
+    uint8_t block[400];
+} signals;
+
+//-----------------------------------------------------------------------------------------------------
+// XCP client on UDP
+
+#define DTO_HEADER_SIZE 4    // ODT (BYTE), fill byte, DAQ (WORD)
+#define DTO_TIMESTAMP_SIZE 4 // First ODT of a DAQ list has a 32 bit timestamp
+#define DTO_MAX_SIZE 512
+#define DTO_MAX_COUNT 1024
+#define DAQ_MAX_COUNT 8
+
+// Received DTO
+typedef struct {
+    uint16_t daq;
+    uint8_t odt;
+    uint16_t size;
+    uint8_t data[DTO_MAX_SIZE];
+} tDto;
+
+static SOCKET_HANDLE client_socket = INVALID_SOCKET_HANDLE;
+static const uint8_t server_addr[4] = OPTION_SERVER_ADDR;
+static uint16_t cmd_ctr = 0;
+
+static uint8_t crm[XCPTL_MAX_CTO_SIZE]; // Last command response
+static uint16_t crm_size = 0;
+
+static uint8_t ev[XCPTL_MAX_CTO_SIZE]; // Last event
+static uint16_t ev_size = 0;
+
+static tDto dtos[DTO_MAX_COUNT];          // DTOs received since the last clearDtos
+static uint32_t dto_count = 0;            // Number of DTOs stored in dtos
+static uint32_t daq_count[DAQ_MAX_COUNT]; // Number of DTOs received per DAQ list, including the ones not stored
+
+static void clearDtos(void) {
+    dto_count = 0;
+    memset(daq_count, 0, sizeof(daq_count));
+}
+
+#ifdef XCPTL_ENABLE_COMPRESSION
+
+static uint32_t compressed_count = 0; // Number of compressed segments received
+
+// Read the extension bytes of a LZ4 literal or match length
+static bool lz4Length(const uint8_t *src, uint32_t n, uint32_t *i, uint32_t *l) {
+    if (*l != 15)
+        return true;
+    uint8_t b;
+    do {
+        if (*i >= n)
+            return false;
+        b = src[(*i)++];
+        *l += b;
+    } while (b == 255);
+    return true;
+}
+
+// Decode a LZ4 block, returns the decoded size or 0, if the block is corrupt or does not fit into dst
+static uint32_t lz4Decompress(const uint8_t *src, uint32_t n, uint8_t *dst, uint32_t cap) {
+    uint32_t i = 0, o = 0;
+    while (i < n) {
+        uint8_t token = src[i++];
+
+        // Literals
+        uint32_t l = token >> 4;
+        if (!lz4Length(src, n, &i, &l) || i + l > n || o + l > cap)
+            return 0;
+        memcpy(&dst[o], &src[i], l);
+        i += l;
+        o += l;
+        if (i == n)
+            break; // Last sequence has no match
+
+        // Match, may overlap with its own output
+        if (i + 2 > n)
+            return 0;
+        uint32_t offset = (uint32_t)(src[i] | (src[i + 1] << 8));
+        i += 2;
+        l = token & 0x0F;
+        if (!lz4Length(src, n, &i, &l))
+            return 0;
+        l += 4;
+        if (offset == 0 || offset > o || o + l > cap)
+            return 0;
+        for (uint32_t k = 0; k < l; k++, o++) {
+            dst[o] = dst[o - offset];
+        }
+    }
+    return o;
+}
+
+#endif
+
+// Parse a segment, which may contain multiple messages, each with transport layer header LEN (WORD), CTR (WORD)
+static bool parseSegment(const uint8_t *buffer, uint32_t n, bool *got_crm) {
+    for (uint32_t i = 0; i + 4 <= n;) {
+        uint16_t len = (uint16_t)(buffer[i] | (buffer[i + 1] << 8));
+        const uint8_t *p = &buffer[i + 4];
+#ifdef XCPTL_ENABLE_COMPRESSION
+        if ((len & TL_COMPRESSED_SEGMENT_FLAG) != 0) { // Compressed segment (size, mode, LZ4 block)
+            static uint8_t segment[XCPTL_MAX_SEGMENT_SIZE];
+            len &= (uint16_t)~TL_COMPRESSED_SEGMENT_FLAG;
+            if (len < TL_COMPRESSED_SEGMENT_HEADER_SIZE || i + 4 + len > n || p[2] != TL_COMPRESSION_LZ4) {
+                printf("  Invalid compressed segment, len=%u, segment size=%u\n", len, n);
+                return false;
+            }
+            uint16_t size = (uint16_t)(p[0] | (p[1] << 8));
+            if (lz4Decompress(p + TL_COMPRESSED_SEGMENT_HEADER_SIZE, len - TL_COMPRESSED_SEGMENT_HEADER_SIZE, segment, sizeof(segment)) != size) {
+                printf("  Corrupt compressed segment, len=%u, size=%u\n", len, size);
+                return false;
+            }
+            compressed_count++;
+            if (!parseSegment(segment, size, got_crm))
+                return false;
+            i += 4u + len;
+            continue;
+        }
+#endif
+        if (len == 0 || i + 4 + len > n) {
+            printf("  Invalid message in segment, offset=%u, len=%u, segment size=%u\n", i, len, n);
+            return false;
+        }
+        if (p[0] >= PID_SERV) { // Command response, error, event or service request
+            if (p[0] == PID_RES || p[0] == PID_ERR) {
+                memcpy(crm, p, len);
+                crm_size = len;
+                *got_crm = true;
+            } else if (p[0] == PID_EV) {
+                memcpy(ev, p, len);
+                ev_size = len;
+            }
+        } else { // DTO
+            uint16_t daq = (uint16_t)(p[2] | (p[3] << 8));
+            if (daq < DAQ_MAX_COUNT)
+                daq_count[daq]++;
+            if (dto_count < DTO_MAX_COUNT && len <= DTO_MAX_SIZE) {
+                tDto *dto = &dtos[dto_count++];
+                dto->daq = daq;
+                dto->odt = p[0];
+                dto->size = len;
+                memcpy(dto->data, p, len);
+            }
+        }
+        i += 4u + len;
+    }
+    return true;
+}
+
+// Receive XCP messages, until a command response was received (wait_crm) or there was no message for timeout_ms
+// Returns after max_ms at the latest, if max_ms is not 0
+static bool receive(bool wait_crm, uint32_t timeout_ms, uint32_t max_ms) {
+    static uint8_t buffer[1024 * 16];
+    uint64_t start_time = clockGetMonotonicNs();
+    uint64_t last_time = start_time;
+    for (;;) {
+        if (max_ms != 0 && clockGetMonotonicNs() - start_time > (uint64_t)max_ms * 1000000)
+            return !wait_crm;
+        int16_t n = socketRecvFrom(client_socket, buffer, (uint16_t)sizeof(buffer), NULL, NULL, NULL);
+        if (n < 0)
+            return false;
+        if (n == 0) {
+            if (clockGetMonotonicNs() - last_time > (uint64_t)timeout_ms * 1000000)
+                return !wait_crm;
+            continue;
+        }
+        last_time = clockGetMonotonicNs();
+        bool got_crm = false;
+        if (!parseSegment(buffer, (uint32_t)n, &got_crm))
+            return false;
+        if (wait_crm && got_crm)
+            return true;
+    }
+}
+
+// Send a command and wait for the response, returns true on positive response
+static bool command(const uint8_t *cmd, uint16_t len) {
+    uint8_t buffer[4 + XCPTL_MAX_CTO_SIZE];
+    assert(len <= XCPTL_MAX_CTO_SIZE);
+    buffer[0] = (uint8_t)len;
+    buffer[1] = (uint8_t)(len >> 8);
+    buffer[2] = (uint8_t)cmd_ctr;
+    buffer[3] = (uint8_t)(cmd_ctr >> 8);
+    cmd_ctr++;
+    memcpy(&buffer[4], cmd, len);
+    crm_size = 0;
+    if (socketSendTo(client_socket, buffer, (uint16_t)(len + 4), server_addr, OPTION_SERVER_PORT, NULL) != (int16_t)(len + 4))
+        return false;
+    if (!receive(true, 1000, 0)) {
+        printf("  No response to command 0x%02X\n", cmd[0]);
+        return false;
+    }
+    if (crm[0] != PID_RES) {
+        printf("  Command 0x%02X failed, error 0x%02X\n", cmd[0], crm_size > 1 ? crm[1] : 0);
+        return false;
+    }
+    return true;
+}
+
+#define WORD(v) (uint8_t)(v), (uint8_t)((v) >> 8)
+#define DWORD(v) (uint8_t)(v), (uint8_t)((v) >> 8), (uint8_t)((v) >> 16), (uint8_t)((v) >> 24)
+
+static bool cmdConnect(void) {
+    const uint8_t cmd[] = {CC_CONNECT, 0};
+    return command(cmd, sizeof(cmd));
+}
+
+static bool cmdDisconnect(void) {
+    const uint8_t cmd[] = {CC_DISCONNECT};
+    return command(cmd, sizeof(cmd));
+}
+
+static bool cmdStartStopSynch(uint8_t mode) {
+    const uint8_t cmd[] = {CC_START_STOP_SYNCH, mode};
+    return command(cmd, sizeof(cmd));
+}
+
+static bool cmdStartStopDaqList(uint8_t mode, uint16_t daq) {
+    const uint8_t cmd[] = {CC_START_STOP_DAQ_LIST, mode, WORD(daq)};
+    return command(cmd, sizeof(cmd));
+}
+
+//-----------------------------------------------------------------------------------------------------
+// DAQ setup
+
+typedef struct {
+    const void *addr;
+    uint8_t size;
+} tEntry;
+
+typedef struct {
+    uint8_t entry_count;
+    tEntry entry[8];
+} tOdt;
+
+typedef struct {
+    tXcpEventId event;
+    uint8_t mode; // Additional DAQ list mode bits, DAQ_MODE_TIMESTAMP is always set
+    uint8_t odt_count;
+    tOdt odt[3];
+} tDaqList;
+
+// Free all DAQ lists, create and select the given DAQ lists, DAQ must be stopped
+static bool setupDaq(const tDaqList *lists, uint16_t count) {
+    assert(count <= DAQ_MAX_COUNT);
+    {
+        const uint8_t cmd[] = {CC_FREE_DAQ};
+        if (!command(cmd, sizeof(cmd)))
+            return false;
+    }
+    {
+        const uint8_t cmd[] = {CC_ALLOC_DAQ, 0, WORD(count)};
+        if (!command(cmd, sizeof(cmd)))
+            return false;
+    }
+    for (uint16_t daq = 0; daq < count; daq++) {
+        const uint8_t cmd[] = {CC_ALLOC_ODT, 0, WORD(daq), lists[daq].odt_count};
+        if (!command(cmd, sizeof(cmd)))
+            return false;
+    }
+    for (uint16_t daq = 0; daq < count; daq++) {
+        for (uint8_t odt = 0; odt < lists[daq].odt_count; odt++) {
+            const uint8_t cmd[] = {CC_ALLOC_ODT_ENTRY, 0, WORD(daq), odt, lists[daq].odt[odt].entry_count};
+            if (!command(cmd, sizeof(cmd)))
+                return false;
+        }
+    }
+    for (uint16_t daq = 0; daq < count; daq++) {
+        for (uint8_t odt = 0; odt < lists[daq].odt_count; odt++) {
+            const uint8_t ptr[] = {CC_SET_DAQ_PTR, 0, WORD(daq), odt, 0};
+            if (!command(ptr, sizeof(ptr)))
+                return false;
+            for (uint8_t idx = 0; idx < lists[daq].odt[odt].entry_count; idx++) {
+                const tEntry *e = &lists[daq].odt[odt].entry[idx];
+                uint32_t addr = ApplXcpGetAddr((const uint8_t *)e->addr);
+                uint8_t ext = ApplXcpGetAddrExt((const uint8_t *)e->addr);
+                const uint8_t cmd[] = {CC_WRITE_DAQ, 0xFF, e->size, ext, DWORD(addr)};
+                if (!command(cmd, sizeof(cmd)))
+                    return false;
+            }
+        }
+        const uint8_t mode[] = {CC_SET_DAQ_LIST_MODE, (uint8_t)(DAQ_MODE_TIMESTAMP | lists[daq].mode), WORD(daq), WORD(lists[daq].event), 1, 0};
+        if (!command(mode, sizeof(mode)))
+            return false;
+        if (!cmdStartStopDaqList(2, daq)) // Select
+            return false;
+    }
+    return true;
+}
+
+// Start all selected DAQ lists and clear the received DTOs
+static bool startDaq(void) {
+    if (!cmdStartStopSynch(1))
+        return false;
+    receive(false, 100, 0);
+    clearDtos();
+    return true;
+}
+
+// Wait until all pending DTOs are received
+static void flushDtos(void) { receive(false, 200, 0); }
+
+// Receive DTOs for the given time
+static void receiveDtos(uint32_t ms) { receive(false, ms, ms); }
+
+// Check the payload of a received DTO against the current memory content of its ODT entries
+static bool checkDto(const tDto *dto, const tDaqList *list) {
+    if (dto->odt >= list->odt_count)
+        return false;
+    const tOdt *odt = &list->odt[dto->odt];
+    uint16_t offset = DTO_HEADER_SIZE + (dto->odt == 0 ? DTO_TIMESTAMP_SIZE : 0);
+    for (uint8_t i = 0; i < odt->entry_count; i++) {
+        if (offset + odt->entry[i].size > dto->size)
+            return false;
+        if (memcmp(&dto->data[offset], odt->entry[i].addr, odt->entry[i].size) != 0)
+            return false;
+        offset += odt->entry[i].size;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+// Copy plan
+// Adjacent ODT entries are merged into one copy operation, the DTO payload must still match the ODT entries
+
+static void test_copy_plan(void) {
+
+    printf("Test copy plan\n");
+
+    tXcpEventId event = XcpCreateEvent("copy_plan", 0, 0);
+    assert(event != XCP_UNDEFINED_EVENT_ID);
+
+    static const tDaqList list = {
+        .event = 0, // Set below
+        .mode = 0,
+        .odt_count = 3,
+        .odt =
+            {
+                // Adjacent entries a, b, c, a gap before d, a repeated entry
+                {5, {{&signals.a, 4}, {&signals.b, 4}, {&signals.c, 2}, {&signals.d, 8}, {&signals.a, 4}}},
+                // Two adjacent blocks
+                {2, {{&signals.block[0], 100}, {&signals.block[100], 100}}},
+                // Adjacent blocks in reverse order, a repeated block
+                {4, {{&signals.block[300], 100}, {&signals.block[200], 100}, {&signals.block[0], 10}, {&signals.block[0], 10}}},
+            },
+    };
+    tDaqList l = list;
+    l.event = event;
+    CHECK(setupDaq(&l, 1));
+    CHECK(startDaq());
+
+    for (uint32_t n = 0; n < 10; n++) {
+        signals.a = 0x11111111 * n;
+        signals.b = ~signals.a;
+        signals.c = (uint16_t)(n * 3);
+        signals.gap = 0xFFFF;
+        signals.d = 0x0102030405060708ULL * n;
+        for (uint32_t i = 0; i < sizeof(signals.block); i++) {
+            signals.block[i] = (uint8_t)(i + n);
+        }
+        clearDtos();
+        XcpEvent(event);
+        flushDtos();
+        CHECK(dto_count == 3);
+        for (uint32_t i = 0; i < dto_count; i++) {
+            CHECK(dtos[i].daq == 0);
+            CHECK(dtos[i].odt == i);
+            CHECK(checkDto(&dtos[i], &l));
+        }
+    }
+
+    CHECK(cmdStartStopSynch(0));
+}
+
+//-----------------------------------------------------------------------------------------------------
+// DAQ memory
+// The DAQ memory size is available for the DAQ, ODT and ODT entry tables, the tables computed on DAQ list start are allocated in addition
+
+#define MEM_TEST_ODT_COUNT 16
+#define MEM_TEST_ENTRY_COUNT ((XCP_DAQ_MEM_SIZE - 12 - MEM_TEST_ODT_COUNT * 8) / ODT_ENTRY_SIZE / MEM_TEST_ODT_COUNT) // Entries per ODT, which fit
+
+// Allocate one DAQ list with MEM_TEST_ODT_COUNT ODTs of entry_count entries
+static bool allocDaqMemory(uint8_t entry_count) {
+    const uint8_t free_daq[] = {CC_FREE_DAQ};
+    const uint8_t alloc_daq[] = {CC_ALLOC_DAQ, 0, WORD(1)};
+    const uint8_t alloc_odt[] = {CC_ALLOC_ODT, 0, WORD(0), MEM_TEST_ODT_COUNT};
+    if (!command(free_daq, sizeof(free_daq)) || !command(alloc_daq, sizeof(alloc_daq)) || !command(alloc_odt, sizeof(alloc_odt)))
+        return false;
+    for (uint8_t odt = 0; odt < MEM_TEST_ODT_COUNT; odt++) {
+        const uint8_t cmd[] = {CC_ALLOC_ODT_ENTRY, 0, WORD(0), odt, entry_count};
+        if (!command(cmd, sizeof(cmd)))
+            return false;
+    }
+    return true;
+}
+
+static void test_daq_memory(void) {
+
+    printf("Test DAQ memory (%u ODT entries)\n", MEM_TEST_ODT_COUNT * MEM_TEST_ENTRY_COUNT);
+    static_assert(MEM_TEST_ENTRY_COUNT <= 255 && MEM_TEST_ENTRY_COUNT + 8 <= DTO_MAX_SIZE, "DAQ memory test does not fit");
+
+    tXcpEventId event = XcpCreateEvent("daq_memory", 0, 0);
+    assert(event != XCP_UNDEFINED_EVENT_ID);
+
+    // More entries than fit into the DAQ memory are rejected
+    printf("  Expect a memory overflow error:\n");
+    CHECK(!allocDaqMemory(MEM_TEST_ENTRY_COUNT + 2));
+
+    // The DAQ memory is filled with ODT entries, the copy plan is compiled on start
+    CHECK(allocDaqMemory(MEM_TEST_ENTRY_COUNT));
+    for (uint8_t odt = 0; odt < MEM_TEST_ODT_COUNT; odt++) {
+        const uint8_t ptr[] = {CC_SET_DAQ_PTR, 0, WORD(0), odt, 0};
+        CHECK(command(ptr, sizeof(ptr)));
+        for (uint32_t idx = 0; idx < MEM_TEST_ENTRY_COUNT; idx++) {
+            const uint8_t *a = &signals.block[(odt * MEM_TEST_ENTRY_COUNT + idx) % sizeof(signals.block)];
+            uint32_t addr = ApplXcpGetAddr(a);
+            const uint8_t cmd[] = {CC_WRITE_DAQ, 0xFF, 1, ApplXcpGetAddrExt(a), DWORD(addr)};
+            CHECK(command(cmd, sizeof(cmd)));
+        }
+    }
+    const uint8_t mode[] = {CC_SET_DAQ_LIST_MODE, DAQ_MODE_TIMESTAMP, WORD(0), WORD(event), 1, 0};
+    CHECK(command(mode, sizeof(mode)));
+    CHECK(cmdStartStopDaqList(2, 0));
+    CHECK(startDaq());
+
+    for (uint32_t i = 0; i < sizeof(signals.block); i++) {
+        signals.block[i] = (uint8_t)(i * 7);
+    }
+    XcpEvent(event);
+    flushDtos();
+    CHECK(dto_count == MEM_TEST_ODT_COUNT);
+    for (uint32_t i = 0; i < dto_count; i++) {
+        uint16_t offset = DTO_HEADER_SIZE + (dtos[i].odt == 0 ? DTO_TIMESTAMP_SIZE : 0);
+        CHECK(dtos[i].size >= offset + MEM_TEST_ENTRY_COUNT); // DTOs may be padded
+        CHECK(dtos[i].data[offset] == signals.block[(dtos[i].odt * MEM_TEST_ENTRY_COUNT) % sizeof(signals.block)]);
+    }
+
+    CHECK(cmdStartStopSynch(0));
+}
+
+//-----------------------------------------------------------------------------------------------------
+// Dispatch table
+// An event triggers only the running DAQ lists associated to it, the dispatch table is updated when a DAQ list is stopped while the event is triggered
+
+static tXcpEventId dispatch_event[2];
+static atomic_uint_fast32_t dispatch_running;
+static atomic_uint_fast32_t dispatch_triggers;
+
+static void *dispatch_task(void *p) {
+    (void)p;
+    while (atomic_load_explicit(&dispatch_running, memory_order_relaxed) != 0) {
+        XcpEvent(dispatch_event[0]);
+        XcpEvent(dispatch_event[1]);
+        atomic_fetch_add_explicit(&dispatch_triggers, 1, memory_order_relaxed);
+        sleepUs(50);
+    }
+    return NULL;
+}
+
+static void test_dispatch(void) {
+
+    printf("Test dispatch table\n");
+
+    dispatch_event[0] = XcpCreateEvent("dispatch_1", 0, 0);
+    dispatch_event[1] = XcpCreateEvent("dispatch_2", 0, 0);
+    tXcpEventId unused_event = XcpCreateEvent("dispatch_3", 0, 0);
+    assert(dispatch_event[0] != XCP_UNDEFINED_EVENT_ID && dispatch_event[1] != XCP_UNDEFINED_EVENT_ID && unused_event != XCP_UNDEFINED_EVENT_ID);
+
+    // DAQ list 0 and 2 on event 1, DAQ list 1 on event 2
+    const tDaqList lists[3] = {
+        {.event = dispatch_event[0], .mode = 0, .odt_count = 1, .odt = {{1, {{&signals.a, 4}}}}},
+        {.event = dispatch_event[1], .mode = 0, .odt_count = 1, .odt = {{1, {{&signals.b, 4}}}}},
+        {.event = dispatch_event[0], .mode = 0, .odt_count = 1, .odt = {{1, {{&signals.c, 2}}}}},
+    };
+    CHECK(setupDaq(lists, 3));
+    CHECK(startDaq());
+
+    clearDtos();
+    XcpEvent(dispatch_event[0]);
+    flushDtos();
+    CHECK(daq_count[0] == 1 && daq_count[1] == 0 && daq_count[2] == 1);
+
+    clearDtos();
+    XcpEvent(dispatch_event[1]);
+    flushDtos();
+    CHECK(daq_count[0] == 0 && daq_count[1] == 1 && daq_count[2] == 0);
+
+    clearDtos();
+    XcpEvent(unused_event);
+    flushDtos();
+    CHECK(dto_count == 0);
+
+    // Stop DAQ list 2 and then DAQ list 1, while both events are triggered from two other threads, each counts as reader of the dispatch table in its own slot
+    clearDtos();
+    atomic_store_explicit(&dispatch_triggers, 0, memory_order_relaxed);
+    atomic_store_explicit(&dispatch_running, 1, memory_order_relaxed);
+    THREAD_HANDLE t[2];
+    create_thread(&t[0], NULL, dispatch_task, NULL);
+    create_thread(&t[1], NULL, dispatch_task, NULL);
+    receiveDtos(50);
+    CHECK(cmdStartStopDaqList(0, 2));
+    receiveDtos(50);
+    CHECK(cmdStartStopDaqList(0, 1));
+    receiveDtos(50);
+    atomic_store_explicit(&dispatch_running, 0, memory_order_relaxed);
+    join_thread(t[0]);
+    join_thread(t[1]);
+    flushDtos();
+    uint32_t triggers = (uint32_t)atomic_load_explicit(&dispatch_triggers, memory_order_relaxed);
+    printf("  %u triggers, DTOs: daq0=%u, daq1=%u, daq2=%u\n", triggers, daq_count[0], daq_count[1], daq_count[2]);
+    CHECK(daq_count[0] == triggers); // DAQ list 0 was running all the time
+    CHECK(daq_count[1] > 0 && daq_count[1] < triggers);
+    CHECK(daq_count[2] > 0 && daq_count[2] < daq_count[1]);
+
+    // Only DAQ list 0 is left
+    clearDtos();
+    XcpEvent(dispatch_event[0]);
+    XcpEvent(dispatch_event[1]);
+    flushDtos();
+    CHECK(daq_count[0] == 1 && daq_count[1] == 0 && daq_count[2] == 0);
+    for (uint32_t i = 0; i < dto_count; i++) {
+        CHECK(dtos[i].daq < 3 && checkDto(&dtos[i], &lists[dtos[i].daq]));
+    }
+
+    CHECK(cmdStartStopSynch(0));
+}
+
+//-----------------------------------------------------------------------------------------------------
+// Send on change
+// A send on change DAQ list skips samples without change, until the keep alive time expired
+
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+
+static void test_send_on_change(void) {
+
+    printf("Test send on change\n");
+
+    tXcpEventId event1 = XcpCreateEvent("on_change_1", 0, 0);
+    tXcpEventId event2 = XcpCreateEvent("on_change_2", 0, 0);
+    tXcpEventId event3 = XcpCreateEvent("on_change_3", 0, 0);
+    assert(event1 != XCP_UNDEFINED_EVENT_ID && event2 != XCP_UNDEFINED_EVENT_ID && event3 != XCP_UNDEFINED_EVENT_ID);
+    CHECK(XcpSetEventSendOnChange(event2, true));
+
+    // DAQ list 0 is send on change by DAQ list mode, DAQ list 1 by its event, DAQ list 2 sends all samples
+    const tDaqList lists[3] = {
+        {.event = event1,
+         .mode = DAQ_MODE_SEND_ON_CHANGE,
+         .odt_count = 2,
+         .odt = {{2, {{&signals.a, 4}, {&signals.b, 4}}}, {2, {{&signals.block[0], 100}, {&signals.block[100], 100}}}}},
+        {.event = event2, .mode = 0, .odt_count = 1, .odt = {{1, {{&signals.b, 4}}}}},
+        {.event = event3, .mode = 0, .odt_count = 1, .odt = {{1, {{&signals.b, 4}}}}},
+    };
+    CHECK(setupDaq(lists, 3));
+    CHECK(startDaq());
+
+    // The first sample is always sent
+    clearDtos();
+    for (uint32_t n = 0; n < 3; n++) {
+        XcpEvent(event1);
+        XcpEvent(event2);
+        XcpEvent(event3);
+    }
+    flushDtos();
+    CHECK(daq_count[0] == 2 && daq_count[1] == 1 && daq_count[2] == 3);
+
+    // A change in the second ODT of DAQ list 0 and in DAQ list 1
+    clearDtos();
+    signals.block[150]++;
+    signals.b++;
+    for (uint32_t n = 0; n < 3; n++) {
+        XcpEvent(event1);
+        XcpEvent(event2);
+        XcpEvent(event3);
+    }
+    flushDtos();
+    CHECK(daq_count[0] == 2 && daq_count[1] == 1 && daq_count[2] == 3);
+    for (uint32_t i = 0; i < dto_count; i++) {
+        CHECK(dtos[i].daq < 3 && checkDto(&dtos[i], &lists[dtos[i].daq]));
+    }
+
+    // Keep alive
+    receiveDtos(XCP_DAQ_SEND_ON_CHANGE_KEEP_ALIVE_MS + 100);
+    clearDtos();
+    XcpEvent(event1);
+    XcpEvent(event2);
+    flushDtos();
+    CHECK(daq_count[0] == 2 && daq_count[1] == 1);
+
+    CHECK(cmdStartStopSynch(0));
+    CHECK(XcpSetEventSendOnChange(event2, false));
+}
+
+#endif
+
+//-----------------------------------------------------------------------------------------------------
+// Segment compression
+// The DTOs in the LZ4 compressed segments must be identical to the uncompressed ones
+
+#ifdef XCPTL_ENABLE_COMPRESSION
+
+static bool cmdSetCompression(uint8_t mode) {
+    const uint8_t cmd[] = {CC_TRANSPORT_LAYER_CMD, CC_TL_SET_COMPRESSION, mode};
+    return command(cmd, sizeof(cmd));
+}
+
+static void test_compression(void) {
+
+    printf("Test compression\n");
+
+    tXcpEventId event = XcpCreateEvent("compression", 0, 0);
+    assert(event != XCP_UNDEFINED_EVENT_ID);
+
+    const tDaqList list = {.event = event, .mode = 0, .odt_count = 2, .odt = {{1, {{&signals.block[0], 200}}}, {1, {{&signals.block[200], 200}}}}};
+
+    for (uint8_t mode = TL_COMPRESSION_NONE; mode <= TL_COMPRESSION_LZ4; mode++) {
+        CHECK(cmdSetCompression(mode));
+        CHECK(setupDaq(&list, 1));
+        CHECK(startDaq());
+        compressed_count = 0;
+        bool ok = true;
+        for (uint32_t n = 0; n < 4; n++) {
+            // Repetitive data with some noise
+            for (uint32_t i = 0; i < sizeof(signals.block); i++) {
+                signals.block[i] = (uint8_t)((i % 8) + (i % 37 == n ? n : 0));
+            }
+            clearDtos();
+            for (uint32_t k = 0; k < 10; k++) {
+                XcpEvent(event);
+            }
+            flushDtos();
+            ok = ok && dto_count == 20;
+            for (uint32_t i = 0; i < dto_count; i++) {
+                ok = ok && dtos[i].daq == 0 && dtos[i].odt == i % 2 && checkDto(&dtos[i], &list);
+            }
+        }
+        CHECK(ok);
+        CHECK(mode == TL_COMPRESSION_LZ4 ? compressed_count > 0 : compressed_count == 0);
+        CHECK(cmdStartStopSynch(0));
+    }
+
+    // Unknown compression mode
+    CHECK(!cmdSetCompression(TL_COMPRESSION_LZ4 + 1));
+    CHECK(cmdSetCompression(TL_COMPRESSION_NONE));
+}
+
+#endif
+
+//-----------------------------------------------------------------------------------------------------
+// DAQ setup file
+// A DAQ setup saved while the client measures is loaded and started again without client
+
+#ifdef XCP_ENABLE_DAQ_LOGGER
+
+#define DAQ_CONFIG_FILE "daq_api_test.daq"
+
+static void test_daq_config(void) {
+
+    printf("Test DAQ setup file\n");
+
+    tXcpEventId event = XcpCreateEvent("daq_config", 0, 0);
+    assert(event != XCP_UNDEFINED_EVENT_ID);
+
+    const tDaqList list = {.event = event, .mode = 0, .odt_count = 2, .odt = {{2, {{&signals.a, 4}, {&signals.d, 8}}}, {1, {{&signals.block[0], 100}}}}};
+    CHECK(setupDaq(&list, 1));
+    CHECK(startDaq());
+    CHECK(XcpSaveDaqConfig(DAQ_CONFIG_FILE));
+    CHECK(!XcpLoadDaqConfig(DAQ_CONFIG_FILE)); // Connected
+    CHECK(cmdStartStopSynch(0));
+    CHECK(cmdDisconnect());
+
+    // Load and start the DAQ setup without client, the DTOs are dropped by the transport layer
+    CHECK(XcpLoadDaqConfig(DAQ_CONFIG_FILE));
+    CHECK(XcpGetDaqListCount() == 1);
+    CHECK(XcpGetDaqListEvent(0) == event);
+    for (uint16_t odt = 0; odt < list.odt_count; odt++) {
+        for (uint16_t idx = 0; idx < list.odt[odt].entry_count; idx++) {
+            const tEntry *e = &list.odt[odt].entry[idx];
+            uint8_t ext = 0, size = 0;
+            uint32_t addr = 0;
+            CHECK(XcpGetOdtEntry(0, odt, idx, &ext, &addr, &size));
+            CHECK(ext == ApplXcpGetAddrExt((const uint8_t *)e->addr) && addr == ApplXcpGetAddr((const uint8_t *)e->addr) && size == e->size);
+        }
+    }
+    {
+        uint8_t ext, size;
+        uint32_t addr;
+        CHECK(!XcpGetOdtEntry(0, 0, 2, &ext, &addr, &size));
+        CHECK(!XcpGetOdtEntry(0, 2, 0, &ext, &addr, &size));
+        CHECK(!XcpGetOdtEntry(1, 0, 0, &ext, &addr, &size));
+    }
+    XcpEvent(event);
+    XcpFreeDaq();
+    CHECK(XcpGetDaqListCount() == 0);
+
+    // A corrupt DAQ setup file is rejected
+    {
+        FILE *file = fopen(DAQ_CONFIG_FILE, "r+b");
+        CHECK(file != NULL);
+        if (file != NULL) {
+            fputc('?', file); // Magic
+            fclose(file);
+        }
+        CHECK(!XcpLoadDaqConfig(DAQ_CONFIG_FILE));
+        CHECK(XcpGetDaqListCount() == 0);
+    }
+    remove(DAQ_CONFIG_FILE);
+
+    CHECK(cmdConnect());
+}
+
+#endif
+
+//-----------------------------------------------------------------------------------------------------
+// Resume mode
+// A DAQ setup stored with SET_REQUEST STORE_DAQ_REQ is started again, when the application restarts
+
+#ifdef XCP_ENABLE_DAQ_RESUME
+
+static bool cmdSetRequest(uint8_t mode, uint16_t config_id) {
+    const uint8_t cmd[] = {CC_SET_REQUEST, mode, WORD(config_id)};
+    return command(cmd, sizeof(cmd));
+}
+
+// Get the session status and the session configuration id
+static bool cmdGetStatus(uint8_t *status, uint16_t *config_id) {
+    const uint8_t cmd[] = {CC_GET_STATUS};
+    if (!command(cmd, sizeof(cmd)) || crm_size < CRM_GET_STATUS_LEN)
+        return false;
+    *status = crm[1];
+    *config_id = (uint16_t)(crm[4] | (crm[5] << 8));
+    return true;
+}
+
+// Restart XCP like an application restart and connect, the events are restored from the binary persistence file
+static bool restartXcp(void) {
+    const uint8_t addr[4] = OPTION_SERVER_ADDR;
+    XcpEthServerShutdown();
+    return XcpInit(OPTION_PROJECT_NAME, OPTION_PROJECT_VERSION, XCP_MODE_LOCAL | XCP_MODE_PERSISTENCE) && XcpEthServerInit(addr, OPTION_SERVER_PORT, false, OPTION_QUEUE_SIZE) &&
+           cmdConnect();
+}
+
+static void test_resume(void) {
+
+    printf("Test resume mode\n");
+
+    tXcpEventId event = XcpCreateEvent("resume", 0, 0);
+    assert(event != XCP_UNDEFINED_EVENT_ID);
+
+    // The binary persistence file with the default page data, written by A2lFinalize in applications with A2L generation
+    CHECK(XcpBinWrite(XcpGetEpk()));
+
+    const tDaqList list = {.event = event, .mode = 0, .odt_count = 1, .odt = {{2, {{&signals.a, 4}, {&signals.b, 4}}}}};
+    CHECK(setupDaq(&list, 1));
+    CHECK(startDaq());
+    CHECK(cmdSetRequest((uint8_t)SS_STORE_DAQ_REQ, 0x1234));
+    CHECK(cmdStartStopSynch(0));
+    CHECK(cmdDisconnect());
+
+    // The DAQ list is running after restart, the client gets the configuration id with EV_RESUME_MODE and GET_STATUS and receives DTOs without DAQ setup
+    uint8_t status = 0;
+    uint16_t config_id = 0;
+    ev_size = 0;
+    CHECK(restartXcp());
+    CHECK(cmdGetStatus(&status, &config_id));
+    flushDtos(); // The event is sent via the transmit queue after the CONNECT response
+    CHECK(ev_size >= 4 && ev[0] == PID_EV && ev[1] == EVC_RESUME_MODE && (ev[2] | (ev[3] << 8)) == 0x1234);
+    CHECK((status & SS_RESUME) != 0 && (status & SS_DAQ) != 0 && config_id == 0x1234);
+#ifdef XCP_ENABLE_DAQ_LOGGER
+    CHECK(XcpGetDaqListEvent(0) == event);
+#endif
+    signals.a = 0xA5A5A5A5;
+    clearDtos();
+    XcpEvent(event);
+    flushDtos();
+    CHECK(dto_count == 1 && dtos[0].daq == 0 && checkDto(&dtos[0], &list));
+
+    // Stopping DAQ ends resume mode
+    CHECK(cmdStartStopSynch(0));
+    CHECK(cmdGetStatus(&status, &config_id));
+    CHECK((status & (SS_RESUME | SS_DAQ)) == 0);
+
+    // Not resumed after CLEAR_DAQ_REQ
+    CHECK(cmdSetRequest((uint8_t)SS_CLEAR_DAQ_REQ, 0));
+    CHECK(cmdDisconnect());
+    CHECK(restartXcp());
+    CHECK(cmdGetStatus(&status, &config_id));
+    CHECK((status & (SS_RESUME | SS_DAQ)) == 0);
+    clearDtos();
+    XcpEvent(event);
+    flushDtos();
+    CHECK(dto_count == 0);
+}
+
+#endif
+
+//-----------------------------------------------------------------------------------------------------
+
+int main(void) {
+
+    printf("\nXCP DAQ API test\n");
+
+    XcpSetLogLevel(OPTION_LOG_LEVEL);
+
+    // Resume mode needs the binary persistence file, start without the one of a previous run
+#ifdef XCP_ENABLE_DAQ_RESUME
+    remove(OPTION_BIN_FILE);
+    const uint8_t mode = XCP_MODE_LOCAL | XCP_MODE_PERSISTENCE;
+#else
+    const uint8_t mode = XCP_MODE_LOCAL;
+#endif
+    if (!XcpInit(OPTION_PROJECT_NAME, OPTION_PROJECT_VERSION, mode)) {
+        printf("Failed to initialize XCP\n");
+        return 1;
+    }
+    const uint8_t addr[4] = OPTION_SERVER_ADDR;
+    if (!XcpEthServerInit(addr, OPTION_SERVER_PORT, false, OPTION_QUEUE_SIZE)) {
+        printf("Failed to start the XCP server\n");
+        return 1;
+    }
+
+    // Client socket, bound to an ephemeral port
+    if (!socketOpen(&client_socket, 0) || !socketBind(client_socket, addr, 0) || !socketSetTimeout(client_socket, 20)) {
+        printf("Failed to open the client socket\n");
+        XcpEthServerShutdown();
+        return 1;
+    }
+
+    if (cmdConnect()) {
+        test_copy_plan();
+        test_daq_memory();
+        test_dispatch();
+#ifdef XCP_ENABLE_DAQ_SEND_ON_CHANGE
+        test_send_on_change();
+#endif
+#ifdef XCPTL_ENABLE_COMPRESSION
+        test_compression();
+#endif
+#ifdef XCP_ENABLE_DAQ_LOGGER
+        test_daq_config();
+#endif
+#ifdef XCP_ENABLE_DAQ_RESUME
+        test_resume();
+#endif
+        CHECK(cmdDisconnect());
+    } else {
+        CHECK(false);
+    }
+
+    socketClose(&client_socket);
+    XcpEthServerShutdown();
+#ifdef XCP_ENABLE_DAQ_RESUME
+    remove(OPTION_BIN_FILE);
+#endif
+
+    if (fail_count != 0) {
+        printf("\n%u checks failed\n", fail_count);
+        return 1;
+    }
+    printf("\nAll checks passed\n");
+    return 0;
+}
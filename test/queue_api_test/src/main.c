@@ -0,0 +1,546 @@
+// queue_api_test
+// Functional test of the queue API of the 64 bit queues (queue64v.c, queue64f.c)
+// Exits with 0 when all checks passed
+
+#include <assert.h>  // for assert
+#include <stdbool.h> // for bool
+#include <stdint.h>  // for uintxx_t
+#include <stdio.h>   // for printf
+#include <stdlib.h>  // for malloc, free
+#include <string.h>  // for memset
+
+// Note: Take care for include order
+
+#include "xcplib_cfg.h" // for OPTION_xxx
+#ifndef OPTION_ATOMIC_EMULATION
+#include <stdatomic.h> // for atomic_
+#endif
+// Disable socket support with vectored IO to avoid platform.h includes queue.h
+#undef OPTION_ENABLE_TCP
+#undef OPTION_ENABLE_UDP
+#include "platform.h"
+
+// Use the logger from XCPlite but don't include the rest of the API
+#include "dbg_print.h"
+void XcpSetLogLevel(uint8_t level);
+
+// Internal libxcplite includes
+#include "../src/queue.h"
+
+//-----------------------------------------------------------------------------------------------------
+
+#define OPTION_LOG_LEVEL 2 // Log level, 0 = no log, 1 = error, 2 = warning, 3 = info
+
+#define TEST_QUEUE_SIZE (1024 * 1024) // Queue size, each of up to 64 producer lanes must fit 2 large entries
+
+#define PRODUCER_COUNT 4       // Number of concurrent producer threads
+#define PRODUCER_MESSAGES 5000 // Number of messages of each producer thread
+
+// Test message payload
+typedef struct {
+    uint32_t producer; // Producer index
+    uint32_t seq;      // Message sequence number of this producer
+} tTestMessage;
+
+static uint32_t fail_count = 0;
+
+#define CHECK(cond)                                                                                                                                                                \
+    do {                                                                                                                                                                           \
+        if (!(cond)) {                                                                                                                                                             \
+            printf("  FAILED: %s (line %d)\n", #cond, __LINE__);                                                                                                                   \
+            fail_count++;                                                                                                                                                          \
+        }                                                                                                                                                                          \
+    } while (0)
+
+// The queue API with peek support is available with the 64 bit queues only
+#if defined(OPTION_QUEUE_64_VAR_SIZE) || defined(OPTION_QUEUE_64_FIX_SIZE)
+
+//-----------------------------------------------------------------------------------------------------
+// Consumer helpers
+
+typedef void (*tMessageCallback)(const uint8_t *payload, uint16_t size, void *context);
+
+// Peek and release all committed entries one by one, call fn for each message
+// Returns the number of messages, adds the packets lost to *lost
+static uint32_t consume(tQueueHandle queue, tMessageCallback fn, void *context, uint32_t *lost) {
+    uint32_t count = 0;
+    for (;;) {
+        uint32_t l = 0;
+        tQueueBuffer buffer = queuePeek(queue, 0, &l, NULL);
+        if (lost != NULL)
+            *lost += l;
+        if (buffer.size == 0)
+            break;
+#ifdef QUEUE_ENABLE_LARGE_ENTRIES
+        // A queue entry may contain multiple messages
+        for (const uint8_t *m = buffer.buffer; m < buffer.buffer + buffer.size; m += QUEUE_ENTRY_USER_HEADER_SIZE + queueGetMessageSize(m)) {
+            if (fn != NULL)
+                fn(m + QUEUE_ENTRY_USER_HEADER_SIZE, queueGetMessageSize(m), context);
+            count++;
+        }
+#else
+        if (fn != NULL)
+            fn(buffer.buffer + QUEUE_ENTRY_USER_HEADER_SIZE, (uint16_t)(buffer.size - QUEUE_ENTRY_USER_HEADER_SIZE), context);
+        count++;
+#endif
+        queueRelease(queue, &buffer);
+    }
+    return count;
+}
+
+// Check the per producer message order
+typedef struct {
+    uint32_t next_seq[PRODUCER_COUNT];
+    uint32_t count;
+    uint32_t errors;
+} tOrderCheck;
+
+static void check_order(const uint8_t *payload, uint16_t size, void *context) {
+    tOrderCheck *c = (tOrderCheck *)context;
+    const tTestMessage *m = (const tTestMessage *)payload;
+    if (size < sizeof(tTestMessage) || m->producer >= PRODUCER_COUNT || m->seq != c->next_seq[m->producer]) {
+        c->errors++;
+        return;
+    }
+    c->next_seq[m->producer]++;
+    c->count++;
+}
+
+//-----------------------------------------------------------------------------------------------------
+// Queue size check
+
+#ifdef OPTION_QUEUE_64_VAR_SIZE
+static void test_init_size(void) {
+    printf("Test queue size check\n");
+
+    // A queue which does not fit 2 entries of maximum size is rejected
+    CHECK(queueInit(QUEUE_MAX_ENTRY_SIZE) == NULL);
+    void *memory = aligned_alloc(64, 1024);
+    assert(memory != NULL);
+    CHECK(queueInitFromMemory(memory, 1024, true, NULL) == NULL);
+    free(memory);
+
+    tQueueHandle queue = queueInit(TEST_QUEUE_SIZE);
+    CHECK(queue != NULL);
+    if (queue != NULL)
+        queueDeinit(queue);
+}
+#endif
+
+//-----------------------------------------------------------------------------------------------------
+// Concurrent producers
+// With producer lanes (OPTION_QUEUE_64_VAR_SIZE_LANES), the lanes are merged by the consumer, messages are FIFO per producer thread
+
+static tQueueHandle producer_queue = NULL;
+static atomic_uint_fast32_t producer_overflows; // Failed acquires, each one is accounted as packet lost by the queue
+
+static void *producer_task(void *p) {
+    uint32_t producer = (uint32_t)(uintptr_t)p;
+    for (uint32_t seq = 0; seq < PRODUCER_MESSAGES; seq++) {
+        uint16_t size = (uint16_t)(sizeof(tTestMessage) + (seq % 8) * 4); // Variable size
+        tQueueBuffer buffer;
+        for (;;) { // Retry on overflow, no message must be lost
+            buffer = queueAcquire(producer_queue, size, QUEUE_PRIORITY_NORMAL);
+            if (buffer.size >= size)
+                break;
+            atomic_fetch_add_explicit(&producer_overflows, 1, memory_order_relaxed);
+            sleepUs(10);
+        }
+        tTestMessage *m = (tTestMessage *)buffer.buffer;
+        m->producer = producer;
+        m->seq = seq;
+        queuePush(producer_queue, &buffer, false);
+    }
+    return NULL;
+}
+
+static void test_producers(void) {
+    printf("Test concurrent producers (%u threads)\n", PRODUCER_COUNT);
+
+    // Huge page backing, falls back to normal pages, if no huge pages are reserved
+    producer_queue = queueInitEx(TEST_QUEUE_SIZE, true);
+    assert(producer_queue != NULL);
+    atomic_store_explicit(&producer_overflows, 0, memory_order_relaxed);
+
+    THREAD_HANDLE t[PRODUCER_COUNT];
+    for (uint32_t i = 0; i < PRODUCER_COUNT; i++) {
+        create_thread(&t[i], NULL, producer_task, (void *)(uintptr_t)i);
+    }
+
+    // Consume while the producers are running
+    tOrderCheck c;
+    memset(&c, 0, sizeof(c));
+    uint32_t lost = 0;
+    uint64_t t0 = clockGetMonotonicNs();
+    while (c.count + c.errors < PRODUCER_COUNT * PRODUCER_MESSAGES && clockGetMonotonicNs() - t0 < 10000000000ULL) {
+        if (consume(producer_queue, check_order, &c, &lost) == 0)
+            sleepUs(10);
+    }
+    for (uint32_t i = 0; i < PRODUCER_COUNT; i++) {
+        join_thread(t[i]);
+    }
+    consume(producer_queue, check_order, &c, &lost);
+
+    CHECK(c.errors == 0);
+    CHECK(lost == atomic_load_explicit(&producer_overflows, memory_order_relaxed));
+    CHECK(c.count == PRODUCER_COUNT * PRODUCER_MESSAGES);
+    for (uint32_t i = 0; i < PRODUCER_COUNT; i++) {
+        CHECK(c.next_seq[i] == PRODUCER_MESSAGES);
+    }
+    CHECK(queueLevel(producer_queue, NULL) == 0);
+
+    // The statistics counters are always collected
+    tQueueStatistics stats;
+    CHECK(queueGetStatistics(producer_queue, QUEUE_STATISTICS_ALL_PRODUCERS, &stats));
+    CHECK(stats.producer_count == PRODUCER_COUNT);
+    CHECK(stats.acquire_count == PRODUCER_COUNT * PRODUCER_MESSAGES);
+    CHECK(stats.packets_lost == lost);
+    CHECK(stats.peek_count > 0);
+    CHECK(queueGetStatistics(producer_queue, 0, &stats) && stats.acquire_count == PRODUCER_MESSAGES);
+    CHECK(!queueGetStatistics(producer_queue, PRODUCER_COUNT, &stats));
+
+    queueDeinit(producer_queue);
+    producer_queue = NULL;
+}
+
+//-----------------------------------------------------------------------------------------------------
+// Multiple buffers with a single reservation
+// Either all buffers of a group are acquired or none, the consumer sees a group only after queuePushMulti
+
+#define MULTI_COUNT 3
+
+static uint32_t acquire_group(tQueueHandle queue, uint32_t *seq) {
+    const uint16_t sizes[MULTI_COUNT] = {sizeof(tTestMessage), 40, 200};
+    tQueueBuffer buffers[MULTI_COUNT];
+    if (!queueAcquireMulti(queue, sizes, MULTI_COUNT, QUEUE_PRIORITY_NORMAL, buffers))
+        return 0;
+    for (uint32_t i = 0; i < MULTI_COUNT; i++) {
+        CHECK(buffers[i].buffer != NULL && buffers[i].size >= sizes[i]);
+        tTestMessage *m = (tTestMessage *)buffers[i].buffer;
+        m->producer = 0;
+        m->seq = (*seq)++;
+    }
+    queuePushMulti(queue, buffers, MULTI_COUNT, false);
+    return MULTI_COUNT;
+}
+
+static void test_acquire_multi(void) {
+    printf("Test queueAcquireMulti\n");
+
+    tQueueHandle queue = queueInit(TEST_QUEUE_SIZE);
+    assert(queue != NULL);
+    tOrderCheck c;
+    memset(&c, 0, sizeof(c));
+    uint32_t lost = 0;
+
+    // A group is not visible before it is committed
+    const uint16_t sizes[MULTI_COUNT] = {sizeof(tTestMessage), sizeof(tTestMessage), sizeof(tTestMessage)};
+    tQueueBuffer buffers[MULTI_COUNT];
+    CHECK(queueAcquireMulti(queue, sizes, MULTI_COUNT, QUEUE_PRIORITY_NORMAL, buffers));
+    for (uint32_t i = 0; i < MULTI_COUNT; i++) {
+        tTestMessage *m = (tTestMessage *)buffers[i].buffer;
+        m->producer = 0;
+        m->seq = i;
+    }
+    CHECK(queuePeek(queue, 0, NULL, NULL).size == 0);
+    queuePushMulti(queue, buffers, MULTI_COUNT, false);
+    CHECK(consume(queue, check_order, &c, &lost) == MULTI_COUNT);
+
+    // Fill the queue with groups until the first overflow, failed groups are lost completely
+    uint32_t seq = MULTI_COUNT;
+    uint32_t acquired = 0;
+    uint32_t n;
+    while ((n = acquire_group(queue, &seq)) > 0) {
+        acquired += n;
+    }
+    CHECK(acquired > 0);
+    CHECK(acquire_group(queue, &seq) == 0);
+    CHECK(consume(queue, check_order, &c, &lost) == acquired);
+    CHECK(lost == 2 * MULTI_COUNT); // The two failed groups
+    CHECK(c.errors == 0);
+    CHECK(c.count == MULTI_COUNT + acquired);
+    CHECK(queueLevel(queue, NULL) == 0);
+
+    // The queue is usable again after the overflow
+    CHECK(acquire_group(queue, &seq) == MULTI_COUNT);
+    CHECK(consume(queue, check_order, &c, &lost) == MULTI_COUNT);
+    CHECK(c.errors == 0);
+
+    queueDeinit(queue);
+}
+
+//-----------------------------------------------------------------------------------------------------
+// Overflow policy and priority headroom
+
+// Acquire and commit entries with the given priority until the first overflow, returns the number of entries committed
+static uint32_t fill(tQueueHandle queue, uint8_t priority) {
+    uint32_t n = 0;
+    for (;;) {
+        tQueueBuffer buffer = queueAcquire(queue, 64, priority);
+        if (buffer.size == 0)
+            return n;
+        memset(buffer.buffer, priority, buffer.size);
+        queuePush(queue, &buffer, false);
+        n++;
+    }
+}
+
+static void test_overflow_policy(void) {
+    printf("Test overflow policy and priority headroom\n");
+
+    tQueueHandle queue = queueInit(TEST_QUEUE_SIZE);
+    assert(queue != NULL);
+    uint32_t lost = 0;
+
+    // Default without headroom, all priorities may use the full queue
+    uint32_t n_full = fill(queue, QUEUE_PRIORITY_NORMAL);
+    CHECK(n_full > 0);
+    CHECK(fill(queue, QUEUE_PRIORITY_HIGH) == 0);
+    CHECK(consume(queue, NULL, NULL, &lost) == n_full);
+    CHECK(lost == 2); // One failed acquire of each fill
+
+    // Drop newest with 20% headroom, any priority > 0 may use the headroom
+    queueSetOverflowPolicy(queue, QUEUE_OVERFLOW_DROP_NEWEST, 20);
+    uint32_t n_normal = fill(queue, QUEUE_PRIORITY_NORMAL);
+    CHECK(n_normal > 0 && n_normal < n_full);
+    uint32_t n_prio = fill(queue, 1);
+    CHECK(n_prio > 0);
+    CHECK(n_normal + n_prio == n_full);
+    CHECK(fill(queue, QUEUE_PRIORITY_HIGH) == 0);
+    CHECK(consume(queue, NULL, NULL, NULL) == n_normal + n_prio);
+
+    // Drop lowest priority with 20% headroom, the usable part of the headroom grows with the priority
+    queueSetOverflowPolicy(queue, QUEUE_OVERFLOW_GRADED_HEADROOM, 20);
+    CHECK(fill(queue, QUEUE_PRIORITY_NORMAL) == n_normal);
+    uint32_t n_low = fill(queue, 0x40);
+    uint32_t n_high = fill(queue, QUEUE_PRIORITY_HIGH);
+    CHECK(n_low > 0);
+    CHECK(n_high > n_low);
+    CHECK(n_normal + n_low + n_high == n_full);
+    CHECK(fill(queue, QUEUE_PRIORITY_NORMAL) == 0);
+    CHECK(fill(queue, 0x40) == 0);
+    CHECK(consume(queue, NULL, NULL, NULL) == n_full);
+    CHECK(queueLevel(queue, NULL) == 0);
+
+    queueDeinit(queue);
+}
+
+//-----------------------------------------------------------------------------------------------------
+// Vectored batch peek and release
+
+#define BATCH_MESSAGES 40
+#define BATCH_FLUSH_SEQ 20 // Message committed with flush request
+
+// Get the sequence number of a single message buffer from queuePeek or queuePeekBatch
+static uint32_t get_seq(const tQueueBuffer *buffer) { return ((const tTestMessage *)(buffer->buffer + QUEUE_ENTRY_USER_HEADER_SIZE))->seq; }
+
+static void test_peek_batch(void) {
+    printf("Test queuePeekBatch and queueReleaseBatch\n");
+
+    tQueueHandle queue = queueInit(TEST_QUEUE_SIZE);
+    assert(queue != NULL);
+
+    for (uint32_t seq = 0; seq < BATCH_MESSAGES; seq++) {
+        tQueueBuffer buffer = queueAcquire(queue, (uint16_t)(sizeof(tTestMessage) + (seq % 5) * 8), QUEUE_PRIORITY_NORMAL);
+        assert(buffer.size > 0);
+        tTestMessage *m = (tTestMessage *)buffer.buffer;
+        m->producer = 0;
+        m->seq = seq;
+        queuePush(queue, &buffer, seq == BATCH_FLUSH_SEQ);
+    }
+
+    tQueueBuffer buffers[BATCH_MESSAGES];
+    uint32_t lost = 0;
+    bool flush = false;
+
+    // Limited by max_bytes, the entry which does not fit stays peeked
+    const uint32_t max_bytes = 300;
+    uint32_t n = queuePeekBatch(queue, 0, max_bytes, buffers, BATCH_MESSAGES, &lost, &flush);
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        CHECK(get_seq(&buffers[i]) == i);
+        bytes += buffers[i].size;
+    }
+    CHECK(n > 0 && n < BATCH_FLUSH_SEQ);
+    CHECK(bytes <= max_bytes);
+    tQueueBuffer next = queuePeek(queue, n, NULL, NULL);
+    CHECK(next.size > 0 && bytes + next.size > max_bytes);
+    CHECK(!flush);
+    CHECK(lost == 0);
+
+    // Continue at the next peek index, stops after the entry with flush request
+    uint32_t m = queuePeekBatch(queue, n, 0xFFFFFFFF, &buffers[n], BATCH_MESSAGES - n, NULL, &flush);
+    CHECK(n + m == BATCH_FLUSH_SEQ + 1);
+    CHECK(flush);
+    CHECK(buffers[n].buffer == next.buffer);
+    for (uint32_t i = n; i < n + m; i++) {
+        CHECK(get_seq(&buffers[i]) == i);
+    }
+
+    // Release in two parts, the remaining peeked entries keep their order
+    queueReleaseBatch(queue, buffers, 3);
+    tQueueBuffer first = queuePeek(queue, 0, NULL, NULL);
+    CHECK(first.buffer == buffers[3].buffer && get_seq(&first) == 3);
+    queueReleaseBatch(queue, &buffers[3], n + m - 3);
+
+    // Limited by max_count
+    flush = false;
+    n = queuePeekBatch(queue, 0, 0xFFFFFFFF, buffers, 10, NULL, &flush);
+    CHECK(n == 10);
+    m = queuePeekBatch(queue, n, 0xFFFFFFFF, &buffers[n], BATCH_MESSAGES, NULL, &flush);
+    CHECK(n + m == BATCH_MESSAGES - BATCH_FLUSH_SEQ - 1);
+    CHECK(!flush);
+    for (uint32_t i = 0; i < n + m; i++) {
+        CHECK(get_seq(&buffers[i]) == BATCH_FLUSH_SEQ + 1 + i);
+    }
+    queueReleaseBatch(queue, buffers, n + m);
+    CHECK(queuePeekBatch(queue, 0, 0xFFFFFFFF, buffers, BATCH_MESSAGES, NULL, NULL) == 0);
+    CHECK(queueLevel(queue, NULL) == 0);
+
+    queueDeinit(queue);
+}
+
+//-----------------------------------------------------------------------------------------------------
+// Dead producer reclamation
+// Simulates a producer process, which died with an uncommitted entry in a queue in shared memory
+
+#define RECLAIM_QUEUE_MEMORY_SIZE TEST_QUEUE_SIZE
+
+static void test_reclaim_producer(void) {
+    printf("Test dead producer reclamation\n");
+
+    void *memory = aligned_alloc(64, RECLAIM_QUEUE_MEMORY_SIZE);
+    assert(memory != NULL);
+    tQueueHandle queue = queueInitFromMemoryEx(memory, RECLAIM_QUEUE_MEMORY_SIZE, true, NULL, true); // Pre-faulted and locked
+    assert(queue != NULL);
+
+    // The producer attaches to the initialized queue
+    tQueueHandle producer = queueInitFromMemory(memory, RECLAIM_QUEUE_MEMORY_SIZE, false, NULL);
+    CHECK(producer == queue);
+
+    // The dead producer reserves an entry and never commits it
+    uint16_t dead_tag = queueRegisterProducer(producer);
+    CHECK(dead_tag != 0);
+    tQueueBuffer dead = queueAcquire(producer, sizeof(tTestMessage), QUEUE_PRIORITY_NORMAL);
+    CHECK(dead.size > 0);
+
+    // A restarted producer gets a new tag and commits an entry behind it
+    uint16_t tag = queueRegisterProducer(producer);
+    CHECK(tag != 0 && tag != dead_tag);
+    tQueueBuffer buffer = queueAcquire(producer, sizeof(tTestMessage), QUEUE_PRIORITY_NORMAL);
+    assert(buffer.size > 0);
+    tTestMessage *m = (tTestMessage *)buffer.buffer;
+    m->producer = 0;
+    m->seq = 1;
+    queuePush(producer, &buffer, false);
+
+    // The uncommitted entry blocks the consumer, until the producer is reclaimed
+    CHECK(queuePeek(queue, 0, NULL, NULL).size == 0);
+    queueReclaimProducer(queue, tag + 1); // Unknown producer, no effect
+    CHECK(queuePeek(queue, 0, NULL, NULL).size == 0);
+    queueReclaimProducer(queue, dead_tag);
+    tQueueBuffer next = queuePeek(queue, 0, NULL, NULL);
+    CHECK(next.size > 0 && get_seq(&next) == 1);
+    if (next.size > 0)
+        queueRelease(queue, &next);
+    CHECK(queueLevel(queue, NULL) == 0);
+
+    // The reclaimed entry is accounted as packet lost, reported with the next peek
+    uint32_t lost = 0;
+    CHECK(queuePeek(queue, 0, &lost, NULL).size == 0);
+    CHECK(lost == 1);
+
+    queueDeinit(queue);
+    free(memory);
+}
+
+// Producer tags are kept per queue, a tag is not reclaimed after it has been reissued
+static void test_producer_tags(void) {
+    printf("Test producer tags\n");
+
+    void *memory_a = aligned_alloc(64, RECLAIM_QUEUE_MEMORY_SIZE);
+    void *memory_b = aligned_alloc(64, RECLAIM_QUEUE_MEMORY_SIZE);
+    assert(memory_a != NULL && memory_b != NULL);
+    tQueueHandle queue_a = queueInitFromMemory(memory_a, RECLAIM_QUEUE_MEMORY_SIZE, true, NULL);
+    tQueueHandle queue_b = queueInitFromMemory(memory_b, RECLAIM_QUEUE_MEMORY_SIZE, true, NULL);
+    assert(queue_a != NULL && queue_b != NULL);
+
+    // This process is registered to queue a only, its entries in queue b are untagged and never reclaimed
+    uint16_t tag = queueRegisterProducer(queue_a);
+    CHECK(tag != 0);
+    tQueueBuffer buffer = queueAcquire(queue_b, sizeof(tTestMessage), QUEUE_PRIORITY_NORMAL);
+    assert(buffer.size > 0);
+    queueReclaimProducer(queue_b, tag);
+    CHECK(queuePeek(queue_b, 0, NULL, NULL).size == 0);
+    tTestMessage *m = (tTestMessage *)buffer.buffer;
+    m->producer = 0;
+    m->seq = 1;
+    queuePush(queue_b, &buffer, false);
+    tQueueBuffer next = queuePeek(queue_b, 0, NULL, NULL);
+    CHECK(next.size > 0 && get_seq(&next) == 1);
+    if (next.size > 0)
+        queueRelease(queue_b, &next);
+
+    // A dead tag is reissued, after the tag counter wrapped around, the entries of the new producer are not reclaimed
+    queueReclaimProducer(queue_a, tag);
+    uint16_t new_tag;
+    do {
+        new_tag = queueRegisterProducer(queue_a);
+    } while (new_tag != tag);
+    buffer = queueAcquire(queue_a, sizeof(tTestMessage), QUEUE_PRIORITY_NORMAL);
+    assert(buffer.size > 0);
+    CHECK(queuePeek(queue_a, 0, NULL, NULL).size == 0);
+    m = (tTestMessage *)buffer.buffer;
+    m->producer = 0;
+    m->seq = 2;
+    queuePush(queue_a, &buffer, false);
+    next = queuePeek(queue_a, 0, NULL, NULL);
+    CHECK(next.size > 0 && get_seq(&next) == 2);
+    if (next.size > 0)
+        queueRelease(queue_a, &next);
+    uint32_t lost = 0;
+    CHECK(queuePeek(queue_a, 0, &lost, NULL).size == 0);
+    CHECK(lost == 0);
+
+    queueDeinit(queue_a);
+    queueDeinit(queue_b);
+    free(memory_a);
+    free(memory_b);
+}
+
+#endif // OPTION_QUEUE_64_VAR_SIZE || OPTION_QUEUE_64_FIX_SIZE
+
+//-----------------------------------------------------------------------------------------------------
+
+int main(void) {
+
+    printf("\nqueue_api_test\n");
+    XcpSetLogLevel(OPTION_LOG_LEVEL);
+
+#if defined(OPTION_QUEUE_64_VAR_SIZE) || defined(OPTION_QUEUE_64_FIX_SIZE)
+#ifdef OPTION_QUEUE_64_VAR_SIZE
+    printf("Using queue64v.c, %u byte max entry size\n", QUEUE_MAX_ENTRY_SIZE);
+#else
+    printf("Using queue64f.c, %u byte entry size\n", QUEUE_MAX_ENTRY_SIZE);
+#endif
+
+#ifdef OPTION_QUEUE_64_VAR_SIZE
+    test_init_size();
+#endif
+    test_producers();
+    test_acquire_multi();
+    test_overflow_policy();
+    test_peek_batch();
+    test_reclaim_producer();
+    test_producer_tags();
+#else
+    printf("Queue API test requires a 64 bit queue with peek support, skipped\n");
+#endif
+
+    if (fail_count > 0) {
+        printf("\n%u checks FAILED\n", fail_count);
+        return 1;
+    }
+    printf("\nAll checks passed\n");
+    return 0;
+}
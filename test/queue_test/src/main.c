@@ -361,7 +361,7 @@ void *task(void *p)
             uint64_t start_time = clockGetMonotonicNs();
 #endif
 
-            tQueueBuffer queue_buffer = queueAcquire(queue_handle, size);
+            tQueueBuffer queue_buffer = queueAcquire(queue_handle, size, QUEUE_PRIORITY_NORMAL);
             if (queue_buffer.size >= size) {
                 assert(queue_buffer.buffer != NULL);
 
@@ -723,6 +723,18 @@ int main(int argc, char *argv[]) {
             join_thread(t[i]);
     }
 
+    // Print the queue runtime statistics
+    tQueueStatistics stats;
+    if (!g_shm_consumer && queueGetStatistics(queue_handle, QUEUE_STATISTICS_ALL_PRODUCERS, &stats)) {
+        printf("\nQueue statistics:\n");
+        printf("  producers=%u  acquired=%" PRIu64 "  lost=%" PRIu64 "  overflow_bursts=%u  level_max=%u/%u\n", stats.producer_count, stats.acquire_count, stats.packets_lost,
+               stats.overflow_bursts, stats.level_max, stats.queue_size);
+        printf("  acquire: retries=%" PRIu64 " (max %u)  p50=%uns  p99=%uns  max=%uns\n", stats.acquire_retries, stats.acquire_retries_max, stats.acquire_time_p50,
+               stats.acquire_time_p99, stats.acquire_time_max);
+        printf("  peek: count=%" PRIu64 "  waits=%" PRIu64 "  p50=%uns  p99=%uns  max=%uns\n", stats.peek_count, stats.wait_count, stats.peek_time_p50, stats.peek_time_p99,
+               stats.peek_time_max);
+    }
+
     // Deinitialize the queue
     queueDeinit(queue_handle); // Deinitialize the queue
 
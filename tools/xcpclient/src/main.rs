@@ -184,6 +184,12 @@ struct Args {
     #[arg(long, default_value_t = 0)]
     time: u64,
 
+    // --compression
+    /// Request LZ4 compression of the DAQ data transmitted by the XCP server.
+    /// Requires that the XCP server supports the XCPlite specific transport layer command SET_COMPRESSION.
+    #[arg(long, default_value_t = false)]
+    compression: bool,
+
     // --csv
     /// Save measurement data to a CSV file. If not specified, data is printed to the console.
     /// CSV format: time_ns,daq,name,value  (one row per measurement sample).
@@ -479,6 +485,7 @@ async fn xcp_client(
     measurement_duration_ms: u64,
     cal_args: Vec<String>,
     csv_filename: String,
+    compression: bool,
 ) -> Result<(), Box<dyn Error>> {
     // Create xcp_client
     let mut xcp_client = XcpClient::new(tcp, dest_addr, local_addr);
@@ -531,6 +538,14 @@ async fn xcp_client(
             info!("  XCP FREEZE_SUPPORTED = {}", xcp_client.freeze_supported);
             info!("  XCP MAX_EVENTS = {}", xcp_client.max_events);
 
+            // Request DAQ data compression
+            if compression {
+                match xcp_client.set_compression(xcp::TL_COMPRESSION_LZ4).await {
+                    Ok(_) => info!("  XCP DAQ data compression LZ4"),
+                    Err(e) => warn!("XCP server does not support DAQ data compression: {}", e),
+                }
+            }
+
             info!("Reading target ECU information via XCP GET_ID commands:");
 
             // Get target ECU name
@@ -1129,6 +1144,7 @@ async fn main() -> Result<(), Box<dyn Error>> {
             args.time * 1000,
             args.cal,
             args.csv,
+            args.compression,
         )
         .await;
         if let Err(e) = res {
@@ -448,7 +448,7 @@ impl XcpClient {
                     }
                 }
 
-                let len = header[0] as usize + ((header[1] as usize) << 8);
+                let len = (header[0] as usize + ((header[1] as usize) << 8)) & !(TL_COMPRESSED_SEGMENT_FLAG as usize);
                 if len == 0 || len > buf.len() - 4 {
                     return Err(std::io::Error::new(std::io::ErrorKind::InvalidData, format!("Invalid XCP header length: {}", len)));
                 }
@@ -475,6 +475,59 @@ impl XcpClient {
         }
     }
 
+    //------------------------------------------------------------------------
+    // Decode a LZ4 block into dst
+    // Returns the decoded size or None, if the block is corrupt or does not fit into dst
+    fn lz4_decompress(src: &[u8], dst: &mut [u8]) -> Option<usize> {
+        let mut i: usize = 0;
+        let mut o: usize = 0;
+        let read_length = |i: &mut usize, mut l: usize| -> Option<usize> {
+            if l == 15 {
+                loop {
+                    let b = *src.get(*i)?;
+                    *i += 1;
+                    l += b as usize;
+                    if b != 255 {
+                        break;
+                    }
+                }
+            }
+            Some(l)
+        };
+        while i < src.len() {
+            let token = src[i];
+            i += 1;
+
+            // Literals
+            let lit = read_length(&mut i, (token >> 4) as usize)?;
+            if i + lit > src.len() || o + lit > dst.len() {
+                return None;
+            }
+            dst[o..o + lit].copy_from_slice(&src[i..i + lit]);
+            i += lit;
+            o += lit;
+            if i == src.len() {
+                break; // Last sequence has no match
+            }
+
+            // Match, may overlap with its own output
+            if i + 2 > src.len() {
+                return None;
+            }
+            let offset = src[i] as usize + ((src[i + 1] as usize) << 8);
+            i += 2;
+            let ml = read_length(&mut i, (token & 0x0F) as usize)? + 4;
+            if offset == 0 || offset > o || o + ml > dst.len() {
+                return None;
+            }
+            for k in o..o + ml {
+                dst[k] = dst[k - offset];
+            }
+            o += ml;
+        }
+        Some(o)
+    }
+
     //------------------------------------------------------------------------
     // receiver task
     // Handle incoming data from XCP server
@@ -492,6 +545,11 @@ impl XcpClient {
         let mut buf: [u8; 8000] = [0; 8000];
         let mut task_control: Option<XcpTaskControl> = None;
 
+        // Transmit segment compression
+        let mut raw_buf: [u8; 8000] = [0; 8000]; // Decompressed segment
+        let mut rx_bytes: u64 = 0; // Number of bytes received since DAQ start
+        let mut raw_bytes: u64 = 0; // Number of bytes after decompression since DAQ start
+
         loop {
             select! {
 
@@ -513,7 +571,13 @@ impl XcpClient {
                                 ctr_first = true;
                                 ctr_last = 0;
                                 ctr_lost = 0;
+                                rx_bytes = 0;
+                                raw_bytes = 0;
+                            }
 
+                            // Stop DAQ, report the compression ratio
+                            else if rx_bytes < raw_bytes && task_control.as_ref().is_some_and(|t| t.running) {
+                                info!("receive_task: {} bytes received compressed to {} bytes ({:.1}%)", raw_bytes, rx_bytes, rx_bytes as f64 * 100.0 / raw_bytes as f64);
                             }
 
                             task_control = Some(c);
@@ -535,17 +599,35 @@ impl XcpClient {
                                 return Ok(());
                             }
 
+                            // Decompress a compressed segment, it contains the original transport layer messages
+                            rx_bytes += size as u64;
+                            let (data, size) = if size >= 4 + TL_COMPRESSED_SEGMENT_HEADER_SIZE && ((buf[1] as u16) << 8) & TL_COMPRESSED_SEGMENT_FLAG != 0 {
+                                let len = (buf[0] as usize + ((buf[1] as usize) << 8)) & !(TL_COMPRESSED_SEGMENT_FLAG as usize);
+                                let segment_size = buf[4] as usize + ((buf[5] as usize) << 8);
+                                let mode = buf[6];
+                                if mode != TL_COMPRESSION_LZ4 || len + 4 > size || len < TL_COMPRESSED_SEGMENT_HEADER_SIZE {
+                                    return Err(Box::new(XcpError::new(ERROR_TL_HEADER,0)) as Box<dyn Error>);
+                                }
+                                match Self::lz4_decompress(&buf[4 + TL_COMPRESSED_SEGMENT_HEADER_SIZE..4 + len], &mut raw_buf) {
+                                    Some(n) if n == segment_size => (&raw_buf[..], n),
+                                    _ => return Err(Box::new(XcpError::new(ERROR_TL_HEADER,0)) as Box<dyn Error>),
+                                }
+                            } else {
+                                (&buf[..], size)
+                            };
+                            raw_bytes += size as u64;
+
                             let mut i: usize = 0;
                             while i < size {
                                 // Decode the next transport layer message header in the packet
                                 if size < 5 {
                                     return Err(Box::new(XcpError::new(ERROR_TL_HEADER,0)) as Box<dyn Error>);
                                 }
-                                let len = buf[i] as usize + ((buf[i + 1] as usize) << 8);
+                                let len = data[i] as usize + ((data[i + 1] as usize) << 8);
                                 if len > size - 4 || len == 0 { // Corrupt packet received, not enough data received or no content
                                     return Err(Box::new(XcpError::new(ERROR_TL_HEADER,0)) as Box<dyn Error>);
                                 }
-                                let ctr = buf[i + 2] as u16 + ((buf[i + 3] as u16) << 8);
+                                let ctr = data[i + 2] as u16 + ((data[i + 3] as u16) << 8);
                                 if ctr_first {
                                     ctr_first = false;
                                 } else if ctr != ctr_last.wrapping_add(1) {
@@ -553,24 +635,24 @@ impl XcpClient {
 
                                 }
                                 ctr_last = ctr;
-                                let pid = buf[i + 4];
+                                let pid = data[i + 4];
                                 trace!("RX: i = {}, len = {}, pid = {}", i, len, pid,);
                                 match pid {
                                     0xFF => {
                                         // Command response
-                                        let response = &buf[(i + 4)..(i + 4 + len)];
+                                        let response = &data[(i + 4)..(i + 4 + len)];
                                         trace!("receive_task: XCP response = {:?}", response);
                                         tx_resp.send(response.to_vec()).await?;
                                     }
                                     0xFE => {
                                         // Command error response
-                                        let response = &buf[(i + 4)..(i + 6)];
+                                        let response = &data[(i + 4)..(i + 6)];
                                         trace!("receive_task: XCP error response = {:?}", response);
                                         tx_resp.send(response.to_vec()).await?;
                                     }
                                     0xFD => {
                                         // Event
-                                        let event_code = buf[i + 5];
+                                        let event_code = data[i + 5];
                                         match event_code {
                                             0x07 => { info!("receive_task: stop, SESSION_TERMINATDED"); return Err(Box::new(XcpError::new(ERROR_SESSION_TERMINATION,0)) as Box<dyn Error>); },
                                             _ => warn!("xcp_receive: ignored XCP event = 0x{:0X}", event_code),
@@ -579,9 +661,9 @@ impl XcpClient {
                                     }
                                     0xFC => {
                                         // Service
-                                        let service_code = buf[i + 5];
+                                        let service_code = data[i + 5];
                                         if service_code == 0x01 {
-                                            decode_serv_text.decode(&buf[i + 6..i + len + 4]);
+                                            decode_serv_text.decode(&data[i + 6..i + len + 4]);
                                         } else {
                                             // Unknown PID
                                             warn!(
@@ -597,7 +679,7 @@ impl XcpClient {
                                             // Handle DAQ data if DAQ running
                                             if c.running {
                                                 let mut m = decode_daq.lock(); // @@@@ TODO Unnecessary mutex ?????
-                                                m.decode(ctr_lost, &buf[i + 4..i + 4 + len]);
+                                                m.decode(ctr_lost, &data[i + 4..i + 4 + len]);
                                                 ctr_lost = 0;
                                             } // running
                                         }
@@ -1210,6 +1292,16 @@ impl XcpClient {
         Ok(())
     }
 
+    //-------------------------------------------------------------------------------------------------
+    // Transmit segment compression (XCPlite specific transport layer command)
+    // mode = TL_COMPRESSION_NONE or TL_COMPRESSION_LZ4, compressed segments are decompressed by the receive task
+    pub async fn set_compression(&mut self, mode: u8) -> Result<(), Box<dyn Error>> {
+        let _data = self
+            .send_command(XcpCommandBuilder::new(CC_TRANSPORT_LAYER_CMD).add_u8(CC_TL_SET_COMPRESSION).add_u8(mode).build())
+            .await?;
+        Ok(())
+    }
+
     //-------------------------------------------------------------------------------------------------
     // Clock
 
@@ -74,6 +74,18 @@ pub const CC_ALLOC_ODT: u8 = 0xD4;
 pub const CC_ALLOC_ODT_ENTRY: u8 = 0xD3;
 pub const CC_TIME_CORRELATION_PROPERTIES: u8 = 0xC6;
 pub const CC_GET_VERSION: u8 = 0xC0;
+pub const CC_TRANSPORT_LAYER_CMD: u8 = 0xF2;
+
+// XCP transport layer sub command codes
+pub const CC_TL_SET_COMPRESSION: u8 = 0xF0; // XCPlite specific
+
+// XCPlite transmit segment compression
+// A compressed segment is a single transport layer message with TL_COMPRESSED_SEGMENT_FLAG set in the length and counter 0
+// Its payload is the uncompressed segment size (u16), the compression mode (u16) and a LZ4 block of the original segment
+pub const TL_COMPRESSION_NONE: u8 = 0x00;
+pub const TL_COMPRESSION_LZ4: u8 = 0x01;
+pub const TL_COMPRESSED_SEGMENT_FLAG: u16 = 0x8000;
+pub const TL_COMPRESSED_SEGMENT_HEADER_SIZE: usize = 4;
 
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 // XCP protocol definitions
@@ -283,6 +295,7 @@ pub enum XcpCommand {
     AllocOdt = CC_ALLOC_ODT as isize,
     AllocOdtEntry = CC_ALLOC_ODT_ENTRY as isize,
     TimeCorrelationProperties = CC_TIME_CORRELATION_PROPERTIES as isize,
+    TransportLayerCmd = CC_TRANSPORT_LAYER_CMD as isize,
 }
 
 impl From<u8> for XcpCommand {
@@ -325,6 +338,7 @@ impl From<u8> for XcpCommand {
             CC_ALLOC_ODT => XcpCommand::AllocOdt,
             CC_ALLOC_ODT_ENTRY => XcpCommand::AllocOdtEntry,
             CC_TIME_CORRELATION_PROPERTIES => XcpCommand::TimeCorrelationProperties,
+            CC_TRANSPORT_LAYER_CMD => XcpCommand::TransportLayerCmd,
             _ => {
                 error!("Unknown command code: 0x{:02X}", code);
                 panic!("Unknown command code: 0x{:02X}", code);